@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+// Offline block-compression encoders used by the texture cooker.
+// Each function encodes one 4x4 block of RGBA8 pixels (row-major, 64 bytes).
+//
+// The encoders fit endpoints to the block's colour bounding box, which is
+// fast and good enough for cooking; they are not tuned for maximum quality.
+
+void EncodeBC1Block(const uint8_t rgba[64], uint8_t out[8]);
+void EncodeBC3Block(const uint8_t rgba[64], uint8_t out[16]);
+
+// BC7 using mode 6 only (one subset, RGBA endpoints with p-bits, 4-bit indices)
+void EncodeBC7Block(const uint8_t rgba[64], uint8_t out[16]);
+
+// Encode a whole image; partial edge blocks replicate the last row/column.
+// 'blockBytes' is 8 for BC1 and 16 for BC3/BC7.
+using BlockEncoder = void (*)(const uint8_t*, uint8_t*);
+void EncodeImageBlocks(const uint8_t* rgba, uint32_t width, uint32_t height,
+	BlockEncoder encoder, uint32_t blockBytes, uint8_t* out);
@@ -0,0 +1,9 @@
+#pragma once
+
+// Outcome of cooking one source asset
+enum class CookResult
+{
+	Cooked,
+	UpToDate,
+	Failed,
+};
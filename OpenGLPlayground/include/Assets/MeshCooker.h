@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "CookResult.h"
+#include "CookedMesh.h"
+#include "MeshOptimizer.h"
+
+// Offline conversion of source meshes (Wavefront OBJ) into the cooked mesh
+// container read by CookedMesh.
+
+// Uncompressed vertex, the layout the renderer used before meshes were cooked
+struct MeshVertex
+{
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::vec3 Color = glm::vec3(1.0f);
+	glm::vec2 TexCoord = glm::vec2(0.0f);
+};
+
+// Indexed triangle list
+struct MeshData
+{
+	std::vector<MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+};
+
+struct MeshCookSettings
+{
+	CookedPositionFormat PositionFormat = CookedPositionFormat::Snorm16;
+	bool OptimizeVertexCache = true;
+	bool OptimizeOverdraw = true;
+	float OverdrawThreshold = 1.05f;	// ACMR the overdraw pass may give up, as a ratio
+	bool Force = false;					// Re-cook even if the output is up to date
+};
+
+struct MeshCookStats
+{
+	MeshOptimizer::VertexCacheStats Before;
+	MeshOptimizer::VertexCacheStats After;
+	uint32_t ClampedTexCoords = 0;		// Outside 0..1, which unorm16 cannot store
+};
+
+// Load an OBJ file: positions, optional per-vertex colors ("v x y z r g b"),
+// texture coordinates and faces, which are fanned into triangles. Vertices
+// are shared between faces wherever position and texcoord both match.
+bool LoadObjMesh(const std::string& path, MeshData& mesh);
+
+// Optimize 'mesh' in place and return the complete cooked file image.
+std::vector<unsigned char> CookMeshData(MeshData& mesh, const MeshCookSettings& settings, uint64_t sourceHash = 0,
+	MeshCookStats* stats = nullptr);
+
+// Cook 'sourcePath' into 'outputPath'. The output's header records a hash of
+// the source bytes and the settings; when it matches, the source is not
+// parsed again and UpToDate is returned.
+CookResult CookMesh(const std::string& sourcePath, const std::string& outputPath, const MeshCookSettings& settings,
+	MeshCookStats* stats = nullptr);
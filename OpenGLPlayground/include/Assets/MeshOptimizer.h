@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Index and vertex reordering for triangle lists, run by the mesh cooker.
+// None of these change what is drawn, only the order it is drawn in.
+namespace MeshOptimizer
+{
+	struct VertexCacheStats
+	{
+		float Acmr = 0.0f;		// Vertex shader runs per triangle (0.5 is ideal on a regular grid, 3 is worst)
+		float Atvr = 0.0f;		// Vertex shader runs per referenced vertex (1 is ideal)
+	};
+
+	// Simulate a FIFO post-transform cache of 'cacheSize' entries over the indices
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// Reorder triangles for the post-transform vertex cache (Forsyth's linear
+	// speed greedy algorithm). Tuned for an LRU of 32 entries, which also does
+	// well on FIFO caches of 16 to 32 entries.
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	// Reorder runs of triangles so that outward-facing parts of the mesh are
+	// drawn first and hide what is behind them. Expects cache-optimized input:
+	// runs are only split where the vertex cache would restart anyway, or where
+	// splitting costs no more than 'threshold' times the run's original ACMR.
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount,
+		float threshold = 1.05f);
+
+	// Renumber vertices in the order the indices first use them, so vertex
+	// fetch walks memory forwards. Rewrites the indices, fills remap[old] with
+	// the new index (or UnusedVertex) and returns the number of used vertices.
+	constexpr uint32_t UnusedVertex = ~0u;
+	size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t* remap);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "CookResult.h"
+#include "CookedTexture.h"
+#include "ImageOps.h"
+
+// Offline conversion of source images (JPEG, PNG, ...) into the cooked
+// texture container read by CookedTexture.
+struct TextureCookSettings
+{
+	CookedFormat Format = CookedFormat::BC7;
+	bool GenerateMips = true;
+	ImageOps::MipFilter Filter = ImageOps::MipFilter::Box;
+	bool Force = false;		// Re-cook even if the output is up to date
+};
+
+// Cook 'sourcePath' into 'outputPath'. The output's header records a hash of
+// the source bytes and the settings; when it matches, the source is not
+// decoded again and UpToDate is returned.
+CookResult CookTexture(const std::string& sourcePath, const std::string& outputPath, const TextureCookSettings& settings);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "CookResult.h"
+#include "VirtualTexture.h"
+
+// Offline conversion of images into the tiled page files read by VirtualTexture.
+struct VirtualTextureCookSettings
+{
+	CookedFormat Format = CookedFormat::RGBA8;
+	uint32_t PageSize = 128;	// Multiple of 4, so block-compressed pages are whole blocks
+	uint32_t Border = 4;		// Texels of each neighbour stored around a tile
+	bool Force = false;			// Re-cook even if the output is up to date
+};
+
+// Writes row 'y' of an RGBA8 source image into 'row'. Rows are requested once
+// each, from the top.
+using ImageRowSource = std::function<void(uint32_t y, uint8_t* row)>;
+
+// Cook a width x height image, read one row at a time, into 'outputPath'.
+// Every level of the mip chain (2x2 box filtered) is built as rows arrive, and
+// only a tile row of each level is held at once, so sources need not fit in
+// memory. 'sourceHash' identifies the source content; with the settings it
+// decides whether an existing output is up to date.
+CookResult CookVirtualTexture(uint32_t width, uint32_t height, const ImageRowSource& source, uint64_t sourceHash,
+	const std::string& outputPath, const VirtualTextureCookSettings& settings);
+
+// Decode an image file with stb_image and cook it
+CookResult CookVirtualTexture(const std::string& sourcePath, const std::string& outputPath, const VirtualTextureCookSettings& settings);
+
+// Synthetic source for benchmarks: a grid of labelled cells at several
+// scales, so a wrong tile or level shows up as a visible seam.
+void GetTestPatternRow(uint32_t width, uint32_t height, uint32_t y, uint8_t* row);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations through replacements of the global operator new and
+// operator delete, so frame loops can prove they do not allocate.
+//
+// Counts are kept per thread, with no locks or shared cache lines on the
+// allocation path, and summed into process-wide totals. Only operator new is
+// seen: malloc() calls from C libraries and drivers are not counted.
+//
+// The hooks are compiled in with OGLP_TRACK_ALLOCATIONS; without it every
+// count stays zero and IsEnabled() returns false.
+namespace AllocationTracker
+{
+	struct Counters
+	{
+		uint64_t Allocations = 0;
+		uint64_t Frees = 0;
+		uint64_t Bytes = 0;		// Requested by the allocations
+
+		Counters operator-(const Counters& other) const
+		{
+			return { Allocations - other.Allocations, Frees - other.Frees, Bytes - other.Bytes };
+		}
+	};
+
+	bool IsEnabled();
+
+	// Since the calling thread started
+	Counters GetThreadCounters();
+
+	// Every thread since the process started
+	Counters GetTotalCounters();
+}
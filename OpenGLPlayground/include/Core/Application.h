@@ -1,29 +1,170 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "BatchRenderer.h"
+#include "Bvh.h"
+#include "Camera.h"
+#include "CommandBuffer.h"
+#include "CookedMesh.h"
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "JobSystem.h"
+#include "ShaderLibrary.h"
+#include "SpscQueue.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+#include "TransformSystem.h"
+#include "TripleBuffer.h"
+#include "UniformBuffers.h"
+#include "VirtualTexture.h"
+
+class HeadlessContext;
+
+// Settings for running without a window into an offscreen framebuffer.
+// Used by the benchmark target on machines without a display.
+struct HeadlessSettings
+{
+	int FrameCount = 1000;		// Number of frames rendered before Run() returns
+	int WarmupFrames = 30;		// Frames rendered before timing starts
+	std::string ReportPath;		// .csv or .json report; empty to only print the summary
+	std::string TracePath;		// Chrome trace of the timed frames; needs an OGLP_PROFILE build
+	std::string CapturePath;	// Timed frames as a .y4m video, or else PNGs in this directory; empty for none
+	std::string Label = "default";
+	bool AssertNoAllocations = false;	// Fail the run if a timed frame allocates on the render thread
+	PacingMode Pacing = PacingMode::Uncapped;
+	double PacingRate = 60.0;	// Frame rate for Limited, virtual display refresh for VSync and LowLatency
+	double MaxMissedPercent = -1.0;	// Fail the run if more timed frames miss their refresh; negative to not check
+};
+
 class Application
 {
 public:
 	Application(int width, int height, const std::string& title);
 	~Application();
 
+	// Render offscreen instead of opening a window, uncapped unless the
+	// settings pick another pacing mode.
+	// Must be called before Initialize().
+	void SetHeadless(const HeadlessSettings& settings);
+
+	// Draw a field of 'count' animated sprites through the batch renderer on
+	// top of the scene. Must be called before Initialize().
+	void SetSpriteCount(int count) { m_SpriteCount = count; }
+
+	// Add 'count' textured quads to the scene, culled against the camera and
+	// drawn as one multi-draw-indirect packet recorded on the GL thread.
+	// Must be called before Initialize().
+	void SetDrawCount(int count) { m_DrawCount = count; }
+
+	// Draw a floor under the scene textured with a cooked .oglv virtual
+	// texture, streamed in as the view needs it. Must be called before Initialize().
+	void SetVirtualTexture(const std::string& path) { m_VirtualTexturePath = path; }
+
+	// Run the simulation on its own thread instead of before each frame. The
+	// render thread then draws the latest snapshot the simulation published,
+	// so a slow update overlaps GPU submission instead of adding to it.
+	// Must be called before Run().
+	void SetPipelined(bool pipelined) { m_Pipelined = pipelined; }
+
+	// Fixed simulation rate, and busy CPU time added to every step to model a
+	// heavy update. Must be called before Run().
+	void SetSimulationRate(double stepsPerSecond) { m_SimulationStep = 1.0 / stepsPerSecond; }
+	void SetSimulationCost(double microseconds) { m_SimulationCostUs = microseconds; }
+
+	// How the windowed app paces frames; see FramePacer. A rate of 0 uses the
+	// monitor's refresh rate. Headless runs take theirs from HeadlessSettings.
+	// Must be called before Initialize().
+	void SetFramePacing(PacingMode mode, double rate = 0.0)
+	{
+		m_PacingMode = mode;
+		m_PacingRate = rate;
+	}
+
 	// Initialize libraries, create window, load OpenGL.
 	bool Initialize();
 
 	// Main loop
 	int Run();
 
+	const FrameStats& GetFrameStats() const { return m_FrameStats; }
+
 private:
 
+	bool InitializeWindow();
+	bool InitializeHeadless();
+	bool InitializePacing();
+
+	int RunWindowed();
+	int RunHeadless();
+
+	// Seconds since the application was constructed
+	double GetTime() const;
+
+	// Animation state after one simulation step
+	struct SceneState
+	{
+		float TriangleAngle = 0.0f;
+		std::vector<glm::vec3> Sprites;		// x, y in pixels, rotation
+		std::vector<float> ObjectAngles;
+	};
+
+	// What the simulation publishes: its last two steps, so the renderer can
+	// interpolate between them
+	struct SceneSnapshot
+	{
+		SceneState Previous;
+		SceneState Current;
+		double Time = 0.0;		// GetTime() at which Current is valid
+		uint64_t Step = 0;
+	};
+
+	// A key press or release, delivered to the simulation
+	struct InputEvent
+	{
+		int Key = 0;
+		bool Pressed = false;
+	};
+
 	void ProcessInput();
 	void Render(float deltaTime);
 
+#ifndef OGLP_NO_GLFW
+	static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+#endif
+
+	// Simulation side: these run on the simulation thread when pipelined
+	void InitializeSimulation();
+	void StartSimulation();
+	void StopSimulation();
+	void SimulationMain();
+	void AdvanceSimulation(double time);	// Step until the simulation reaches 'time'
+	void StepSimulation();
+	void HandleInput(const InputEvent& event);
+	void ComputeSceneState(SceneState& state, float time) const;
+	void PublishSnapshot();
+
 	void SetupTriangle();
+	bool SetupSprites();
+	void RenderSprites(const SceneSnapshot& snapshot, float alpha);
+
+	bool SetupFloor();
+	void RecordFloor(CommandBuffer& buffer);
 
-	GLuint LoadTextureFromFile(const char* path);
+	void SetupSceneObjects();
+	void UpdateSceneTransforms(const SceneSnapshot& snapshot, float alpha);
+	void CullSceneObjects();
+	void RecordSceneObjects(CommandBuffer& buffer);
 
 	int m_Width;
 	int m_Height;
@@ -31,18 +172,133 @@ private:
 
 	GLFWwindow* m_Window = nullptr;
 
+	bool m_Headless = false;
+	HeadlessSettings m_HeadlessSettings;
+	std::unique_ptr<HeadlessContext> m_HeadlessContext;
+	FrameStats m_FrameStats;
+
+	// Decides when each frame starts and how far the GPU may fall behind
+	PacingMode m_PacingMode = PacingMode::VSync;
+	double m_PacingRate = 0.0;
+	std::unique_ptr<FramePacer> m_FramePacer;
+
+	// Saves the timed headless frames without waiting for their readback
+	std::unique_ptr<FrameCapture> m_FrameCapture;
+
+	std::chrono::steady_clock::time_point m_StartTime;
 	double m_LastFrameTime = 0.0;
 
+	// F9 starts and stops a profiler capture in the windowed app
+	int m_CaptureCount = 0;
+
+	// The simulation advances in fixed steps and hands the renderer immutable
+	// snapshots; input reaches it as events rather than by polling the window
+	bool m_Pipelined = false;
+	double m_SimulationStep = 1.0 / 120.0;
+	double m_SimulationCostUs = 0.0;
+
+	// Owned by the simulation (its thread, when pipelined)
+	double m_SimulationTime = 0.0;		// GetTime() of the latest step
+	double m_AnimationTime = 0.0;		// Stops advancing while paused
+	bool m_Paused = false;
+	uint64_t m_SimulationSteps = 0;
+	SceneState m_PreviousState;
+	SceneState m_CurrentState;
+
+	TripleBuffer<SceneSnapshot> m_Snapshots;
+	SpscQueue<InputEvent, 256> m_InputEvents;
+	std::thread m_SimulationThread;
+	std::atomic<bool> m_StopSimulation{ false };
+
+	// Frames that found a new snapshot, and frames that drew the previous one again
+	uint64_t m_FreshSnapshotFrames = 0;
+	uint64_t m_ReusedSnapshotFrames = 0;
+
+	// Every binding the frame makes goes through here, so unchanged state costs no driver call
+	GLStateCache m_GLState;
+
+	// The quad drawn by the triangle and the scene objects, cooked at startup
+	std::vector<unsigned char> m_QuadMeshData;
+	CookedMesh m_QuadMesh;
 	GLuint m_VAO = 0;
-	GLuint m_VBO = 0;
-	GLuint m_EBO = 0;
-	GLuint m_ShaderProgram = 0;
-
-	GLint m_TimeUniformLocation = -1;
-	GLint m_ModelUniformLocation = -1;
-	GLint m_TextureUniformLocation = -1; // Uniform location for the texture sampler
-	GLint m_ViewUniformLocation = -1;
-	GLint m_ProjectionUniformLocation = -1;
-
-	GLuint m_Texture = 0; // OpenGL texture handle
-};
\ No newline at end of file
+	GLuint m_VBO = 0;		// Indices followed by vertices
+
+	std::unique_ptr<ShaderLibrary> m_ShaderLibrary;
+	ShaderHandle m_TriangleShader = InvalidShaderHandle;
+
+	// Frame and camera data live in uniform blocks shared by all programs
+	Camera m_Camera;
+	std::unique_ptr<UniformBuffers> m_UniformBuffers;
+
+	// Jobs of every system that runs in parallel: texture decoding, transforms,
+	// culling and command recording share these threads
+	std::unique_ptr<JobSystem> m_Jobs;
+
+	// Scratch arrays that live for one frame, such as culling bounds and the
+	// gathered draws; reset at the start of Render()
+	std::unique_ptr<FrameArena> m_FrameArena;
+
+	std::unique_ptr<TextureLoader> m_TextureLoader;
+	TextureHandle m_Texture = InvalidTextureHandle;
+
+	// Scene draws are recorded as sorted packets rather than issued directly
+	std::unique_ptr<CommandQueue> m_CommandQueue;
+
+	// World matrices of the triangle and the scene objects
+	std::unique_ptr<TransformSystem> m_Transforms;
+	TransformHandle m_TriangleTransform = InvalidTransformHandle;
+
+	// Each scene object is a small quad spinning in place
+	struct SceneObject
+	{
+		glm::vec3 Position;
+		float Scale;
+		float Speed;
+		TransformHandle Transform;
+		int32_t Proxy;		// Leaf in m_SceneBvh
+	};
+
+	int m_DrawCount = 0;
+	std::vector<SceneObject> m_SceneObjects;
+
+	// Scene objects are culled against the camera and the survivors drawn with
+	// one glMultiDrawElementsIndirect
+	DynamicBvh m_SceneBvh;
+	std::vector<uint32_t> m_VisibleObjects;
+	ShaderHandle m_SceneObjectShader = InvalidShaderHandle;
+	GLuint m_SceneVAO = 0;
+	GLuint m_ObjectMatrixBuffer = 0;	// Model matrix per visible object, read as an instanced attribute
+	GLuint m_IndirectBuffer = 0;
+	DynamicBvh::CullStats m_CullStats;
+
+	// Visible objects the indirect buffer holds commands for; the commands
+	// depend on nothing else, so the buffer is only rewritten when it changes
+	size_t m_LastCommandCount = 0;
+	double m_CullMs = 0.0;
+
+	// Each sprite orbits its own centre while spinning
+	struct Sprite
+	{
+		glm::vec2 Center;
+		float Radius;
+		float Speed;
+		float Phase;
+		float Size;
+		glm::vec4 Color;
+		AtlasHandle Image;
+	};
+
+	int m_SpriteCount = 0;
+	std::vector<Sprite> m_Sprites;
+	std::unique_ptr<BatchRenderer> m_BatchRenderer;
+	Camera m_SpriteCamera;		// Pixel coordinates, origin bottom-left
+
+	// Every sprite image shares one array texture, so all sprites draw as one batch
+	std::unique_ptr<TextureAtlas> m_SpriteAtlas;
+
+	// Floor quad below the scene, sampling a virtual texture much larger than its memory budgets
+	std::string m_VirtualTexturePath;
+	std::unique_ptr<VirtualTexture> m_VirtualTexture;
+	ShaderHandle m_FloorShader = InvalidShaderHandle;
+	glm::mat4 m_FloorModel = glm::mat4(1.0f);
+};
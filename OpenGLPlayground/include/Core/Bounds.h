@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Axis-aligned bounding box
+struct Aabb
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+
+	bool Contains(const Aabb& other) const
+	{
+		return glm::all(glm::lessThanEqual(Min, other.Min)) && glm::all(glm::greaterThanEqual(Max, other.Max));
+	}
+
+	// Half the surface area; only ever compared, so the factor of two is dropped
+	float GetArea() const
+	{
+		const glm::vec3 size = Max - Min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	Aabb Expanded(float margin) const { return { Min - glm::vec3(margin), Max + glm::vec3(margin) }; }
+
+	static Aabb Union(const Aabb& a, const Aabb& b) { return { glm::min(a.Min, b.Min), glm::max(a.Max, b.Max) }; }
+
+	// Box around 'box' after transforming it by 'matrix'
+	static Aabb Transform(const Aabb& box, const glm::mat4& matrix);
+};
+
+// Six planes bounding the view volume, normals pointing inwards, so a point p
+// is inside when dot(plane.xyz, p) + plane.w >= 0 for every plane
+struct Frustum
+{
+	glm::vec4 Planes[6];
+
+	// Planes of the clip volume of 'viewProjection' (GL clip space, -w..w)
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+};
+
+namespace Culling
+{
+	// Test four boxes at once. Returns a bit per box that is at least partly
+	// inside the frustum; 'inside' gets a bit per box that is entirely inside.
+	uint32_t TestAabbs4(const Frustum& frustum, const Aabb* const boxes[4], uint32_t& inside);
+
+	// Write the index of every box that is at least partly inside the frustum
+	// to 'visible' and return how many there are. Tests four boxes at a time.
+	size_t CullAabbs(const Frustum& frustum, const Aabb* boxes, size_t count, uint32_t* visible);
+}
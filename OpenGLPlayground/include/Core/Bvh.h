@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+
+// Dynamic bounding volume hierarchy over object boxes, for frustum culling.
+//
+// Each object is a leaf holding its box grown by a margin, so small movements
+// leave the tree alone. Insertion picks the sibling that adds the least
+// surface area and AVL-style rotations keep the tree balanced, so objects can
+// be added, removed and moved one at a time without rebuilding. Objects that
+// move a lot but should not be reinserted can be refitted in place instead.
+//
+// Cull() walks the tree four nodes at a time with Culling::TestAabbs4(), and
+// emits whole subtrees without further tests once they are entirely inside.
+class DynamicBvh
+{
+public:
+	static constexpr int32_t NullNode = -1;
+
+	struct CullStats
+	{
+		uint32_t NodesTested = 0;
+		uint32_t Visible = 0;
+	};
+
+	// 'margin' is added on every side of the boxes stored in the leaves
+	explicit DynamicBvh(float margin = 0.1f);
+
+	// Add an object and return its proxy; 'userData' is what Cull() reports.
+	int32_t Insert(const Aabb& bounds, uint32_t userData);
+	void Remove(int32_t proxy);
+
+	// Update an object's box. Reinserts the leaf if the box left its margin and
+	// returns true; otherwise does nothing.
+	bool Move(int32_t proxy, const Aabb& bounds);
+
+	// Update an object's box without moving its leaf: only the ancestors are
+	// grown or shrunk to fit. Cheaper than Move(), but the tree gets worse if
+	// objects travel far from where they were inserted.
+	void Refit(int32_t proxy, const Aabb& bounds);
+
+	void Clear();
+	void Reserve(size_t leafCount);
+
+	// Append the user data of every object whose box is at least partly inside
+	// the frustum to 'visible'. Not safe to call from several threads at once.
+	void Cull(const Frustum& frustum, std::vector<uint32_t>& visible, CullStats* stats = nullptr);
+
+	uint32_t GetUserData(int32_t proxy) const { return m_Nodes[proxy].UserData; }
+	const Aabb& GetFatBounds(int32_t proxy) const { return m_Nodes[proxy].Bounds; }
+	size_t GetLeafCount() const { return m_LeafCount; }
+	int32_t GetHeight() const { return m_Root == NullNode ? 0 : m_Nodes[m_Root].Height; }
+
+private:
+	struct Node
+	{
+		Aabb Bounds;
+		int32_t Parent = NullNode;		// Next free node while on the free list
+		int32_t Child1 = NullNode;
+		int32_t Child2 = NullNode;
+		int32_t Height = 0;				// 0 for leaves, -1 while free
+		uint32_t UserData = 0;
+
+		bool IsLeaf() const { return Child1 == NullNode; }
+	};
+
+	int32_t AllocateNode();
+	void FreeNode(int32_t node);
+
+	void InsertLeaf(int32_t leaf);
+	void RemoveLeaf(int32_t leaf);
+
+	// Refit bounds and heights from 'node' up to the root, rotating as needed
+	void FixUpwards(int32_t node);
+	int32_t Balance(int32_t node);
+
+	float m_Margin;
+	std::vector<Node> m_Nodes;
+	int32_t m_Root = NullNode;
+	int32_t m_FreeList = NullNode;
+	size_t m_LeafCount = 0;
+
+	// Traversal scratch kept between calls
+	std::vector<int32_t> m_Stack;
+	std::vector<int32_t> m_InsideStack;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator over one block: allocating advances an offset, and Reset()
+// frees everything at once. Nothing is freed individually and no destructors
+// run, so it holds only trivially destructible data.
+//
+// Running out does not fail: the allocation comes from an overflow block on
+// the heap, and the next Reset() grows the main block to the peak use seen,
+// so a workload settles to a single block within a frame or two.
+class LinearArena
+{
+public:
+	explicit LinearArena(size_t capacity = 0);
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	// Uninitialised storage for 'count' objects of a trivial type
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Arena memory is released without running destructors");
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Release every allocation, growing the block first if the last round overflowed
+	void Reset();
+
+	size_t GetUsed() const { return m_Offset + m_OverflowBytes; }
+	size_t GetCapacity() const { return m_Capacity; }
+	size_t GetPeak() const { return m_Peak; }
+	uint32_t GetOverflowCount() const { return m_OverflowCount; }	// Allocations that missed the block, ever
+
+private:
+	std::unique_ptr<uint8_t[]> m_Block;
+	size_t m_Capacity = 0;
+	size_t m_Offset = 0;
+
+	std::vector<std::unique_ptr<uint8_t[]>> m_Overflow;
+	size_t m_OverflowBytes = 0;
+	size_t m_Peak = 0;
+	uint32_t m_OverflowCount = 0;
+};
+
+// Per-frame scratch: everything allocated during a frame is released when
+// the next one begins, so nothing in it may be kept across frames.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t capacity = 0);
+
+	// Start a frame, releasing the last one's allocations
+	void BeginFrame();
+
+	LinearArena& GetCurrent() { return m_Arena; }
+
+	template <typename T>
+	T* AllocateArray(size_t count) { return m_Arena.AllocateArray<T>(count); }
+
+private:
+	LinearArena m_Arena;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+enum class PacingMode
+{
+	VSync,		// Swap interval 1: the display paces frames
+	Uncapped,	// Swap interval 0 and no waiting
+	Limited,	// Swap interval 0, frames started on a fixed-rate schedule
+	LowLatency,	// Swap interval 1, frames started as late as their cost allows, GPU queue drained after each swap
+};
+
+const char* GetPacingModeName(PacingMode mode);
+bool ParsePacingMode(const char* name, PacingMode& mode);
+
+// Decides when frames start and how far the GPU may run behind, and measures
+// how evenly frames are presented and how old their input is by then.
+//
+// The frame loop calls BeginFrame() before sampling input, MarkInputSampled()
+// right after, and EndFrame() once the frame has been swapped.
+//
+// Limited mode waits for each frame's start time by sleeping in 1 ms steps
+// while the deadline is further off than a sleep has been seen to overshoot,
+// then yielding in a loop for the rest; sleeps alone miss by a millisecond or
+// more, spinning alone starves the other threads on the cores.
+//
+// LowLatency mode predicts a frame's cost from the mean and deviation of the
+// recent ones, including the wait for the GPU, and starts it that long before
+// the next refresh, so input is sampled as late as possible. After the swap it
+// waits on a fence for the GPU to finish the frame, so the driver never queues
+// frames ahead.
+//
+// Without a display (headless) there is no refresh to lock to: VSync and
+// LowLatency hold each present until the next tick of a virtual display
+// running at the target rate.
+class FramePacer
+{
+public:
+	struct Stats
+	{
+		size_t Frames = 0;
+		double TargetIntervalMs = 0.0;		// 0 when uncapped
+		double MeanIntervalMs = 0.0;		// Between presents
+		double JitterMs = 0.0;				// Standard deviation of the present interval
+		double P99DeviationMs = 0.0;		// Of the present interval from the target, or from the mean when uncapped
+		uint32_t Missed = 0;				// Presents more than half an interval late
+		double MeanWaitMs = 0.0;			// Spent in BeginFrame() and EndFrame() holding frames back
+		double MeanDrainMs = 0.0;			// Spent in EndFrame() waiting for the GPU to finish (LowLatency)
+		double MeanInputLatencyMs = 0.0;	// Input sampled to present: the swap returning, or the virtual refresh
+		double P99InputLatencyMs = 0.0;
+		double MeanGpuLatencyMs = 0.0;		// Input sampled to the GPU finishing the frame
+		double P99GpuLatencyMs = 0.0;
+	};
+
+	FramePacer() = default;
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// 'rate' is the frame rate for Limited, and the display refresh for VSync
+	// and LowLatency. 'virtualDisplay' makes those two hold presents to a
+	// virtual refresh at 'rate' instead of relying on the swap interval.
+	// Requires a current context.
+	bool Initialize(PacingMode mode, double rate, bool virtualDisplay);
+
+	PacingMode GetMode() const { return m_Mode; }
+	double GetRate() const { return m_Period > 0.0 ? 1.0 / m_Period : 0.0; }
+
+	// Swap interval to set on the window
+	int GetSwapInterval() const { return m_Mode == PacingMode::VSync || m_Mode == PacingMode::LowLatency ? 1 : 0; }
+
+	// Wait until the frame should start
+	void BeginFrame();
+	void MarkInputSampled();
+
+	// Call right after the swap: takes the present time, drains the GPU queue
+	// in LowLatency mode, waits for the virtual refresh, and records the
+	// frame's timings
+	void EndFrame();
+
+	// Record the timings of the next 'frameCount' frames, dropping any recorded so far
+	void BeginMeasurement(size_t frameCount);
+
+	// Summarise the measured frames, waiting for the GPU timings still pending
+	Stats Summarize();
+
+private:
+	static constexpr uint32_t TimestampQueries = 8;
+
+	static double Now();
+	void WaitUntil(double deadline);
+	double GetNextRefresh(double after) const;
+
+	// Read back finished timestamps, first waiting until at most 'maxPending' are outstanding
+	void ResolveTimestamps(uint32_t maxPending);
+
+	PacingMode m_Mode = PacingMode::Uncapped;
+	double m_Period = 0.0;					// Seconds per frame; 0 when uncapped
+	bool m_VirtualDisplay = false;
+
+	// Limited: when the next frame starts
+	double m_NextStart = 0.0;
+
+	// VSync and LowLatency: a refresh happened at m_RefreshOrigin, and every m_Period since
+	double m_RefreshOrigin = 0.0;
+
+	// LowLatency: how long a frame takes from its start to the GPU finishing it,
+	// as exponentially weighted mean and mean absolute deviation
+	double m_CostMean = 0.0;
+	double m_CostDeviation = 0.0;
+	double m_CostFrom = 0.0;
+
+	// Observed length of a 1 ms sleep (Welford), to know when to stop sleeping
+	double m_SleepEstimate = 0.005;
+	double m_SleepMean = 0.005;
+	double m_SleepM2 = 0.0;
+	uint32_t m_SleepCount = 1;
+
+	double m_FrameStart = 0.0;
+	double m_InputTime = 0.0;
+	double m_LastPresent = 0.0;
+	double m_FrameWait = 0.0;
+
+	// GPU completion of each measured frame, read back a few frames later
+	GLuint m_Queries[TimestampQueries] = {};
+	double m_PendingInputTimes[TimestampQueries] = {};
+	uint32_t m_PendingBegin = 0;
+	uint32_t m_PendingCount = 0;
+	double m_CpuMinusGpu = 0.0;				// Seconds to add to a GL timestamp to get Now()
+
+	bool m_Measuring = false;
+	std::vector<double> m_IntervalsMs;
+	std::vector<double> m_WaitsMs;
+	std::vector<double> m_DrainsMs;
+	std::vector<double> m_InputLatenciesMs;
+	std::vector<double> m_GpuLatenciesMs;
+};
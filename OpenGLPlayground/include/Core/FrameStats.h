@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Collects per-frame CPU times and summarizes them for benchmark reports.
+class FrameStats
+{
+public:
+	struct Summary
+	{
+		size_t FrameCount = 0;
+		double MinMs = 0.0;
+		double MeanMs = 0.0;
+		double P50Ms = 0.0;
+		double P99Ms = 0.0;
+		double MaxMs = 0.0;
+		double Fps = 0.0;
+	};
+
+	void Reserve(size_t frameCount) { m_FrameTimesMs.reserve(frameCount); }
+	void AddFrame(double frameTimeMs) { m_FrameTimesMs.push_back(frameTimeMs); }
+	void Clear() { m_FrameTimesMs.clear(); }
+
+	Summary Summarize() const;
+
+	// Writes the summary to 'path'. The format is picked from the extension
+	// (.json, otherwise CSV). Returns false if the file cannot be written.
+	bool WriteReport(const std::string& path, const std::string& label) const;
+
+	// One-line human readable summary for the console.
+	std::string ToString() const;
+
+private:
+	std::vector<double> m_FrameTimesMs;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// 64-bit FNV-1a. Used to key on-disk caches on content, not for security.
+constexpr uint64_t HashSeed = 0xCBF29CE484222325ull;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HashSeed)
+{
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+inline uint64_t HashString(std::string_view text, uint64_t hash = HashSeed)
+{
+	return HashBytes(text.data(), text.size(), hash);
+}
+
+template <typename T>
+inline uint64_t HashValue(const T& value, uint64_t hash = HashSeed)
+{
+	return HashBytes(&value, sizeof(T), hash);
+}
+
+// Name, without extension, of the cooked file for 'sourcePath': its stem and a
+// hash of the whole path, so "a/wall.png", "b/wall.png" and "a/wall.jpg" cook
+// to different files. The path is normalised first ("./a//wall.png" matches
+// "a/wall.png"), so cookers must be given sources the way the loader names them.
+inline std::string GetCookedFileStem(const std::string& sourcePath)
+{
+	const std::filesystem::path path = std::filesystem::path(sourcePath).lexically_normal();
+	char hash[17];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(HashString(path.generic_string())));
+	return path.stem().string() + "-" + hash;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Creates an OpenGL 4.5 core context without a window or display server,
+// using EGL's surfaceless platform (e.g. Mesa llvmpipe on a headless box).
+// Since there is no default framebuffer, rendering goes into an offscreen FBO.
+class HeadlessContext
+{
+public:
+	HeadlessContext() = default;
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// Create the context, make it current and load OpenGL through GLAD.
+	bool Initialize(int width, int height);
+
+	// Create the offscreen framebuffer. Requires a current context.
+	bool CreateFramebuffer();
+
+	// Bind the offscreen framebuffer as the draw/read target.
+	void BindFramebuffer() const;
+
+	// Stand-in for a swap: fences the frame and waits on the one submitted
+	// 'maxFramesInFlight' frames ago, so the CPU cannot queue work unboundedly.
+	void Present();
+
+	GLuint GetFramebuffer() const { return m_FBO; }
+
+	static constexpr int MaxFramesInFlight = 2;
+
+private:
+	void Destroy();
+
+	int m_Width = 0;
+	int m_Height = 0;
+
+	void* m_Display = nullptr; // EGLDisplay
+	void* m_Context = nullptr; // EGLContext
+
+	GLuint m_FBO = 0;
+	GLuint m_ColorRenderbuffer = 0;
+	GLuint m_DepthRenderbuffer = 0;
+
+	GLsync m_FrameFences[MaxFramesInFlight] = {};
+	int m_FrameIndex = 0;
+};
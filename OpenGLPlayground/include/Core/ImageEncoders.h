@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encoders for writing rendered frames to disk. Sources are RGBA8 images with
+// 'rowBytes' bytes per row; 'bottomUp' marks the first row as the bottom of
+// the image, as glReadPixels returns it.
+//
+// Both are self-contained and thread-safe, so frames can be encoded on worker
+// threads in parallel.
+namespace ImageEncoders
+{
+	// PNG with the per-row filter that minimises the filtered bytes, compressed
+	// by a greedy LZ77 with fixed Huffman codes. Built for speed rather than
+	// size: rendered frames come out about 1.4x the size zlib's fastest level
+	// gives. 'alpha' keeps the alpha channel; otherwise the PNG is RGB.
+	void EncodePng(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowBytes, bool bottomUp, bool alpha,
+		std::vector<uint8_t>& png);
+
+	bool WritePng(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowBytes,
+		bool bottomUp, bool alpha);
+
+	// YUV4MPEG2 stream header for 4:2:0 frames. Each frame follows as the
+	// "FRAME\n" marker and GetYuv420Size() bytes from ConvertToYuv420().
+	std::string GetY4mHeader(uint32_t width, uint32_t height, uint32_t framesPerSecond);
+
+	size_t GetYuv420Size(uint32_t width, uint32_t height);
+
+	// Full-range BT.601 planar Y, then U and V subsampled 2x2 (odd sizes round
+	// up). Players take this as Y4M's "C420jpeg" colour space.
+	void ConvertToYuv420(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowBytes, bool bottomUp,
+		uint8_t* yuv);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CPU image kernels for texture preparation, operating on 8-bit pixels.
+//
+// Each kernel has a scalar implementation and, on x86, SSE and AVX2 versions
+// selected at runtime from the CPU's features. All paths produce bit-identical
+// results, so the choice only affects speed.
+namespace ImageOps
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		SSE,	// SSE2 + SSSE3
+		AVX2,
+	};
+
+	// Best level supported by this CPU
+	SimdLevel GetSupportedSimdLevel();
+
+	// Level currently used by the kernels. Defaults to the supported level.
+	SimdLevel GetSimdLevel();
+
+	// Force a lower level, e.g. to compare paths in a benchmark. Levels above
+	// the supported one are clamped.
+	void SetSimdLevel(SimdLevel level);
+
+	const char* GetSimdLevelName(SimdLevel level);
+
+	enum class MipFilter
+	{
+		Box,	// 2x2 average
+		Kaiser,	// 8-tap Kaiser-windowed sinc, sharper minification
+	};
+
+	// Tightly packed RGB -> RGBA with a constant alpha. 'rgb' and 'rgba' must not overlap.
+	void ExpandRGBToRGBA(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount, uint8_t alpha = 255);
+
+	// In place: rgb = rgb * a / 255, rounded to nearest.
+	void PremultiplyAlpha(uint8_t* rgba, size_t pixelCount);
+
+	// Per-component conversion between sRGB-encoded bytes and linear floats in [0, 1].
+	// Apply to colour channels only; alpha is always linear.
+	void SRGBToLinear(const uint8_t* srgb, float* linear, size_t count);
+	void LinearToSRGB(const float* linear, uint8_t* srgb, size_t count);
+
+	// In place vertical flip of an image with 'rowBytes' bytes per row.
+	void FlipVertically(uint8_t* pixels, size_t rowBytes, uint32_t height);
+
+	// Size of the next mip level
+	inline uint32_t MipSize(uint32_t size) { return size > 1 ? size / 2 : 1; }
+
+	// Downsample an RGBA8 image to MipSize(width) x MipSize(height).
+	// With 'srgb' the colour channels are filtered in linear light.
+	void Downsample(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination,
+		MipFilter filter = MipFilter::Box, bool srgb = false);
+
+	// Bytes needed for a full RGBA8 mip chain starting at width x height
+	size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t* levelCount = nullptr);
+
+	// Fill levels 1..N of a mip chain laid out back to back after level 0.
+	void GenerateMipChain(uint8_t* chain, uint32_t width, uint32_t height,
+		MipFilter filter = MipFilter::Box, bool srgb = false);
+}
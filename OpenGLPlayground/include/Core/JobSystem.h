@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class JobSystem;
+
+// Counts jobs that have not finished yet. Owned by whoever waits: typically a
+// local in the function that spawns the jobs, or a member of a system whose
+// jobs outlive a call.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return m_Count.load(std::memory_order_acquire) == 0; }
+	uint32_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+
+private:
+	friend class JobSystem;
+	std::atomic<uint32_t> m_Count{ 0 };
+};
+
+enum class JobPriority
+{
+	Normal,		// Frame work: run by any thread, including ones waiting in Wait()
+	Background,	// Long jobs such as file loading: run only by worker threads with nothing else to do
+};
+
+// A unit of work and its callable, stored inline. Created by JobSystem::CreateJob().
+struct Job
+{
+	static constexpr size_t PayloadSize = 64;
+	static constexpr uint32_t MaxContinuations = 6;
+
+	void (*Function)(Job&) = nullptr;
+	JobCounter* Counter = nullptr;
+	std::atomic<uint32_t> Dependencies{ 0 };	// Unfinished jobs this one waits for, plus one until it is Run()
+	uint32_t ContinuationCount = 0;
+	JobPriority Priority = JobPriority::Normal;
+	std::atomic<bool> Done{ true };				// The slot may be reused
+	Job* Continuations[MaxContinuations] = {};
+	alignas(std::max_align_t) unsigned char Payload[PayloadSize];
+};
+
+// Lock-free work-stealing deque of Chase and Lev, in the C11 formulation of
+// Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+// The owning thread pushes and pops at the bottom; other threads steal from the
+// top. Fixed capacity: Push() fails when full.
+class WorkStealingDeque
+{
+public:
+	explicit WorkStealingDeque(size_t capacity = 4096);
+
+	// Owner only
+	bool Push(Job* job);
+	Job* Pop();
+
+	// Any thread
+	Job* Steal();
+	bool IsEmpty() const;
+
+private:
+	alignas(64) std::atomic<int64_t> m_Top{ 0 };
+	alignas(64) std::atomic<int64_t> m_Bottom{ 0 };
+	alignas(64) std::unique_ptr<std::atomic<Job*>[]> m_Buffer;
+	int64_t m_Mask = 0;
+};
+
+// Work-stealing job scheduler shared by every system that runs work in parallel.
+//
+// Each worker thread owns a WorkStealingDeque: jobs it spawns go to the bottom
+// of its own deque and are popped from there, newest first, while idle workers
+// steal the oldest from the top of others'. The thread that creates the system
+// owns one too, and runs jobs itself while it waits in Wait(). Other threads
+// submit through a shared queue. Idle workers spin briefly, then sleep until
+// new jobs arrive.
+//
+// Jobs are fine-grained: a job is a function pointer and up to PayloadSize
+// bytes of callable, placed in a per-thread ring of job slots, so spawning one
+// allocates nothing. A job may name other jobs it depends on (AddDependency);
+// it becomes runnable when they have all finished. Completion is tracked by
+// JobCounters rather than job handles, since job slots are recycled.
+//
+// A system of one thread has no workers: jobs run only inside Wait(), on the
+// waiting thread.
+class JobSystem
+{
+public:
+	// threadCount == 0 uses one thread per core including the caller, and at
+	// least two, so that Background jobs always have a worker to run on.
+	explicit JobSystem(unsigned threadCount = 0, const char* threadName = "Worker");
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Create a job that calls 'function' when run. 'counter', if given, is
+	// incremented now and decremented once the job has finished. The job does
+	// nothing until Run().
+	template <typename F>
+	Job* CreateJob(F&& function, JobCounter* counter = nullptr, JobPriority priority = JobPriority::Normal)
+	{
+		using Callable = std::decay_t<F>;
+		static_assert(sizeof(Callable) <= Job::PayloadSize, "Job callable is too large; capture by reference");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "Job callable is over-aligned");
+
+		Job* job = AllocateJob(counter, priority);
+		new (job->Payload) Callable(std::forward<F>(function));
+		job->Function = [](Job& self)
+		{
+			Callable& callable = *std::launder(reinterpret_cast<Callable*>(self.Payload));
+			callable();
+			callable.~Callable();
+		};
+		return job;
+	}
+
+	// 'after' does not start before 'before' has finished. Call before running
+	// either job. Past Job::MaxContinuations dependents, 'before' is run and
+	// waited for on the spot, so add its own dependencies first.
+	void AddDependency(Job* before, Job* after);
+
+	// Queue the job; it starts as soon as its dependencies have finished.
+	void Run(Job* job);
+
+	// Create and queue a job in one step
+	template <typename F>
+	void Run(F&& function, JobCounter* counter = nullptr, JobPriority priority = JobPriority::Normal)
+	{
+		Run(CreateJob(std::forward<F>(function), counter, priority));
+	}
+
+	// Run other jobs until every job counted by 'counter' has finished.
+	void Wait(const JobCounter& counter);
+
+	// Call function(begin, end) on disjoint subranges covering [0, count), each
+	// at most 'grain' long, and return when all are done. Ranges are split in
+	// halves on demand, so idle threads steal large pieces first.
+	template <typename F>
+	void ParallelFor(size_t count, size_t grain, const F& function);
+
+	// Threads that run jobs, including the one that created the system
+	unsigned GetThreadCount() const { return static_cast<unsigned>(m_Deques.size()); }
+	unsigned GetWorkerCount() const { return static_cast<unsigned>(m_Workers.size()); }
+
+	// Jobs executed by each thread since construction, for load balance reports
+	uint64_t GetExecutedCount(unsigned threadIndex) const { return m_Executed[threadIndex].Count.load(std::memory_order_relaxed); }
+	uint64_t GetStolenCount() const { return m_Stolen.load(std::memory_order_relaxed); }
+
+private:
+	struct alignas(64) ExecutedCounter
+	{
+		std::atomic<uint64_t> Count{ 0 };
+	};
+
+	template <typename F>
+	struct RangeJob
+	{
+		JobSystem* System;
+		const F* Function;
+		JobCounter* Counter;
+		size_t Begin;
+		size_t End;
+		size_t Grain;
+
+		void operator()() const;
+	};
+
+	Job* AllocateJob(JobCounter* counter, JobPriority priority);
+	void Submit(Job* job);
+	void Execute(Job* job);
+	void Finish(Job* job);
+	Job* FindJob(bool takeBackground);
+	void WakeWorkers();
+	void WorkerMain(unsigned threadIndex);
+
+	// Index of the calling thread in this system, or -1 for outside threads
+	int GetThreadIndex() const;
+
+	const char* m_ThreadName;
+	std::vector<std::thread> m_Workers;
+	std::vector<std::unique_ptr<WorkStealingDeque>> m_Deques;	// One per thread; 0 is the creating thread
+	std::unique_ptr<ExecutedCounter[]> m_Executed;
+	std::thread::id m_OwnerThread;
+
+	// Jobs from outside threads, and Background jobs
+	std::mutex m_SharedMutex;
+	std::deque<Job*> m_SharedJobs;
+	std::deque<Job*> m_BackgroundJobs;
+	std::atomic<uint32_t> m_SharedCount{ 0 };
+	std::atomic<uint32_t> m_BackgroundCount{ 0 };
+
+	// Idle workers sleep on m_WakeGeneration
+	std::atomic<uint32_t> m_WakeGeneration{ 0 };
+	std::atomic<uint32_t> m_SleepingCount{ 0 };
+	std::atomic<bool> m_WakePending{ false };	// Woken but not yet running
+	std::atomic<bool> m_Stop{ false };
+
+	std::atomic<uint64_t> m_Stolen{ 0 };
+};
+
+template <typename F>
+void JobSystem::RangeJob<F>::operator()() const
+{
+	// Hand off the upper half until the rest is small enough to run here
+	size_t end = End;
+	while (end - Begin > Grain)
+	{
+		const size_t middle = Begin + (end - Begin) / 2;
+		System->Run(RangeJob{ System, Function, Counter, middle, end, Grain }, Counter);
+		end = middle;
+	}
+	(*Function)(Begin, end);
+}
+
+template <typename F>
+void JobSystem::ParallelFor(size_t count, size_t grain, const F& function)
+{
+	if (count == 0)
+		return;
+
+	grain = grain > 0 ? grain : 1;
+	if (count <= grain || GetThreadCount() == 1)
+	{
+		function(size_t(0), count);
+		return;
+	}
+
+	JobCounter counter;
+	RangeJob<F>{ this, &function, &counter, 0, count, grain }();
+	Wait(counter);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Fixed number of T slots addressed by index, allocated once. Allocate() and
+// Free() are O(1) and never touch the heap, so indices make cheap handles for
+// objects that come and go at run time.
+//
+// Freed slots are reused newest first. Slots never handed out sit above
+// GetHighWater(), so a scan for live slots can stop there.
+template <typename T>
+class PoolAllocator
+{
+public:
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+	explicit PoolAllocator(uint32_t capacity = 0) { Reset(capacity); }
+
+	PoolAllocator(const PoolAllocator&) = delete;
+	PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+	// Replace the storage with 'capacity' free slots
+	void Reset(uint32_t capacity)
+	{
+		m_Items = capacity > 0 ? std::make_unique<T[]>(capacity) : nullptr;
+		m_Next = capacity > 0 ? std::make_unique<uint32_t[]>(capacity) : nullptr;
+		m_Capacity = capacity;
+		m_HighWater = 0;
+		m_Count = 0;
+		m_FreeList = InvalidIndex;
+	}
+
+	// A slot holding a default-constructed T, or InvalidIndex when all are in use
+	uint32_t Allocate()
+	{
+		uint32_t index = m_FreeList;
+		if (index != InvalidIndex)
+			m_FreeList = m_Next[index];
+		else if (m_HighWater < m_Capacity)
+			index = m_HighWater++;
+		else
+			return InvalidIndex;
+
+		m_Next[index] = Allocated;
+		m_Items[index] = T();
+		++m_Count;
+		return index;
+	}
+
+	void Free(uint32_t index)
+	{
+		if (!IsAllocated(index))
+			return;
+
+		m_Next[index] = m_FreeList;
+		m_FreeList = index;
+		--m_Count;
+	}
+
+	bool IsAllocated(uint32_t index) const { return index < m_HighWater && m_Next[index] == Allocated; }
+
+	T& operator[](uint32_t index) { return m_Items[index]; }
+	const T& operator[](uint32_t index) const { return m_Items[index]; }
+
+	uint32_t GetCapacity() const { return m_Capacity; }
+	uint32_t GetCount() const { return m_Count; }
+	uint32_t GetHighWater() const { return m_HighWater; }
+
+private:
+	// Free-list link of a slot that is in use
+	static constexpr uint32_t Allocated = UINT32_MAX - 1;
+
+	std::unique_ptr<T[]> m_Items;
+	std::unique_ptr<uint32_t[]> m_Next;		// Next free slot, or Allocated
+	uint32_t m_Capacity = 0;
+	uint32_t m_HighWater = 0;
+	uint32_t m_Count = 0;
+	uint32_t m_FreeList = InvalidIndex;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Frame profiler with CPU and GPU zones, saved as Chrome trace JSON (open in
+// chrome://tracing or https://ui.perfetto.dev).
+//
+// CPU zones go into a buffer owned by the thread that runs them. Only that
+// thread writes to it and publishes events with an atomic count, so recording
+// takes no locks. GPU zones bracket GL commands with GL_TIMESTAMP queries
+// (which, unlike GL_TIME_ELAPSED, may nest). Each frame's queries are read
+// back GpuQueryFrames frames later and only if they are already available, so
+// the profiler never waits on the GPU; late frames are dropped instead.
+//
+// Outside a capture a zone costs one relaxed atomic load. Use the OGLP_PROFILE_*
+// macros rather than the classes: without OGLP_PROFILE they compile to nothing.
+namespace Profiler
+{
+	// Query sets in flight; a frame's GPU zones are resolved this many frames later
+	constexpr int GpuQueryFrames = 2;
+
+	struct CaptureStats
+	{
+		uint32_t CpuEvents = 0;
+		uint32_t GpuEvents = 0;
+		uint32_t DroppedEvents = 0;		// Thread buffer full
+		uint32_t DroppedGpuFrames = 0;	// Queries not ready when their set was reused
+	};
+
+	// Nanoseconds since the profiler's epoch
+	uint64_t Now();
+
+	// Label the calling thread in captures.
+	void SetThreadName(const char* name);
+
+	// Start recording zones on every thread.
+	void BeginCapture();
+
+	// Stop recording and write the capture to 'path'. Call on the thread that
+	// called BeginCapture(), outside any GPU zone; if GPU zones were used, that
+	// must be the GL thread.
+	bool EndCapture(const std::string& path, CaptureStats* stats = nullptr);
+
+	bool IsCapturing();
+
+	// GL thread, once per frame before any GPU zone: collects finished queries
+	// and re-syncs the GPU clock with the CPU clock.
+	void BeginGpuFrame();
+
+	// Delete the query objects. GL thread, while the context is current.
+	void ShutdownGpu();
+
+	// 'name' must outlive the capture: a string literal or __func__
+	class CpuZone
+	{
+	public:
+		explicit CpuZone(const char* name);
+		~CpuZone();
+
+		CpuZone(const CpuZone&) = delete;
+		CpuZone& operator=(const CpuZone&) = delete;
+
+	private:
+		const char* m_Name;
+		uint64_t m_Start = 0;
+		bool m_Active = false;
+	};
+
+	class GpuZone
+	{
+	public:
+		explicit GpuZone(const char* name);
+		~GpuZone();
+
+		GpuZone(const GpuZone&) = delete;
+		GpuZone& operator=(const GpuZone&) = delete;
+
+	private:
+		int m_Zone = -1;
+	};
+}
+
+#ifdef OGLP_PROFILE
+#define OGLP_PROFILE_CONCAT_INNER(a, b) a##b
+#define OGLP_PROFILE_CONCAT(a, b) OGLP_PROFILE_CONCAT_INNER(a, b)
+
+#define OGLP_PROFILE_SCOPE(name) Profiler::CpuZone OGLP_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define OGLP_PROFILE_FUNCTION() OGLP_PROFILE_SCOPE(__func__)
+#define OGLP_PROFILE_GPU_SCOPE(name) Profiler::GpuZone OGLP_PROFILE_CONCAT(profileGpuZone, __LINE__)(name)
+#define OGLP_PROFILE_GPU_FRAME() Profiler::BeginGpuFrame()
+#define OGLP_PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define OGLP_PROFILE_SCOPE(name)
+#define OGLP_PROFILE_FUNCTION()
+#define OGLP_PROFILE_GPU_SCOPE(name)
+#define OGLP_PROFILE_GPU_FRAME()
+#define OGLP_PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Packs rectangles into a fixed-size page with the skyline bottom-left
+// heuristic: the page is described by the top edge of everything placed so
+// far, and each rectangle goes where its top ends up lowest. Fast (linear in
+// the number of skyline segments) and typically 80-90% full on mixed sizes.
+//
+// Rectangles cannot be removed individually; owners track what they freed and
+// Reset() and re-insert the survivors to reclaim the space.
+class SkylinePacker
+{
+public:
+	SkylinePacker() = default;
+	SkylinePacker(uint32_t width, uint32_t height) { Reset(width, height); }
+
+	// Empty the page
+	void Reset(uint32_t width, uint32_t height);
+
+	// Place a width x height rectangle; returns false when it does not fit
+	bool Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+
+	// Area of every rectangle inserted since the last Reset()
+	uint64_t GetUsedArea() const { return m_UsedArea; }
+
+private:
+	struct Segment
+	{
+		uint32_t X;
+		uint32_t Y;			// Top of the skyline over [X, X + Width)
+		uint32_t Width;
+	};
+
+	// Lowest y at which a rectangle starting at segment 'index' fits, or false
+	bool Fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const;
+
+	std::vector<Segment> m_Skyline;
+	uint32_t m_Width = 0;
+	uint32_t m_Height = 0;
+	uint64_t m_UsedArea = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded queue for exactly one producer thread and one consumer thread. Push
+// and pop never block or allocate; TryPush() fails when the queue is full.
+// 'Capacity' must be a power of two.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	// Producer thread
+	bool TryPush(const T& value)
+	{
+		const size_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		m_Items[head & (Capacity - 1)] = value;
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread
+	bool TryPop(T& value)
+	{
+		const size_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail == m_Head.load(std::memory_order_acquire))
+			return false;
+
+		value = m_Items[tail & (Capacity - 1)];
+		m_Tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// Producer and consumer indices on separate cache lines
+	alignas(64) std::atomic<size_t> m_Head{ 0 };
+	alignas(64) std::atomic<size_t> m_Tail{ 0 };
+	T m_Items[Capacity];
+};
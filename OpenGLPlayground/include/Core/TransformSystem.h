@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class JobSystem;
+
+// Index of a transform in its TransformSystem
+using TransformHandle = uint32_t;
+constexpr TransformHandle InvalidTransformHandle = 0xFFFFFFFF;
+
+// Local transforms (position, rotation, scale) in structure-of-arrays form,
+// composed into world matrices by Update().
+//
+// A transform's parent must be created before it, so handles are already in
+// topological order. Transforms are also listed by depth in the hierarchy;
+// Update() walks the levels in order, and every transform in a level can be
+// computed in parallel, as jobs, because its parent is in an earlier level.
+//
+// Setters only mark a transform dirty. Update() rebuilds the local matrices of
+// dirty transforms four at a time with SSE, straight from the SoA arrays, then
+// recomputes the world matrix of every transform that is dirty or has a dirty
+// ancestor. Untouched subtrees cost one flag test per transform.
+class TransformSystem
+{
+public:
+	struct Stats
+	{
+		uint32_t LocalUpdated = 0;	// Local matrices rebuilt
+		uint32_t WorldUpdated = 0;	// World matrices recomputed
+		double UpdateMs = 0.0;
+	};
+
+	// Without a job system, Update() runs on the calling thread alone.
+	explicit TransformSystem(JobSystem* jobs = nullptr);
+
+	TransformSystem(const TransformSystem&) = delete;
+	TransformSystem& operator=(const TransformSystem&) = delete;
+
+	void Reserve(size_t count);
+	void Clear();
+
+	// Add an identity transform under 'parent'
+	TransformHandle Create(TransformHandle parent = InvalidTransformHandle);
+
+	void SetPosition(TransformHandle handle, const glm::vec3& position);
+	void SetRotation(TransformHandle handle, const glm::quat& rotation);
+	void SetScale(TransformHandle handle, const glm::vec3& scale);
+	void SetLocal(TransformHandle handle, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+	glm::vec3 GetPosition(TransformHandle handle) const;
+	glm::quat GetRotation(TransformHandle handle) const;
+	glm::vec3 GetScale(TransformHandle handle) const;
+	TransformHandle GetParent(TransformHandle handle) const { return m_Parent[handle]; }
+
+	// Bring every world matrix up to date.
+	void Update();
+
+	// Valid after Update(); indexed by handle
+	const glm::mat4& GetWorld(TransformHandle handle) const { return m_World[handle]; }
+	const std::vector<glm::mat4>& GetWorldMatrices() const { return m_World; }
+
+	size_t GetCount() const { return m_Parent.size(); }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	// Fewer transforms per thread than this run on the calling thread
+	static constexpr size_t MinTransformsPerThread = 4096;
+
+	void MarkDirty(TransformHandle handle) { m_LocalDirty[handle] = 1; }
+
+	void UpdateLocal(size_t begin, size_t end, uint32_t& updated);
+	void UpdateLevel(const std::vector<TransformHandle>& level, bool roots, size_t begin, size_t end, uint32_t& updated);
+
+	JobSystem* m_Jobs;
+
+	// Local transform, one array per component
+	std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+	std::vector<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+	std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+
+	std::vector<TransformHandle> m_Parent;
+	std::vector<uint8_t> m_LocalDirty;	// Set by the setters, cleared by Update()
+	std::vector<uint8_t> m_WorldDirty;	// Recomputed this update; read by children
+
+	// Handles by depth: roots first, then their children, and so on
+	std::vector<std::vector<TransformHandle>> m_Levels;
+	std::vector<uint32_t> m_Depth;
+
+	std::vector<glm::mat4> m_Local;
+	std::vector<glm::mat4> m_World;
+
+	// Counted per slice
+	std::vector<uint32_t> m_ThreadLocalUpdated;
+	std::vector<uint32_t> m_ThreadWorldUpdated;
+
+	Stats m_Stats;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread without
+// locks or waiting.
+//
+// The writer fills GetWriteBuffer() and calls Publish(); the reader calls
+// Update() and then reads GetReadBuffer(). Each side owns one of the three
+// buffers and the third sits between them: publishing swaps the writer's buffer
+// with it, and the reader swaps it out only when it holds something new. The
+// reader always sees a complete value and the writer never waits, at the cost
+// of dropping values the reader was too slow to take.
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Writer thread
+	T& GetWriteBuffer() { return m_Buffers[m_Write]; }
+
+	void Publish()
+	{
+		const uint8_t previous = m_Middle.exchange(static_cast<uint8_t>(m_Write | FreshBit), std::memory_order_acq_rel);
+		m_Write = previous & IndexMask;
+	}
+
+	// Reader thread: take the most recently published value. Returns false if
+	// nothing was published since the last call.
+	bool Update()
+	{
+		if (!(m_Middle.load(std::memory_order_relaxed) & FreshBit))
+			return false;
+
+		const uint8_t previous = m_Middle.exchange(m_Read, std::memory_order_acq_rel);
+		m_Read = previous & IndexMask;
+		return true;
+	}
+
+	const T& GetReadBuffer() const { return m_Buffers[m_Read]; }
+
+private:
+	static constexpr uint8_t IndexMask = 0x3;
+	static constexpr uint8_t FreshBit = 0x4;	// Middle buffer was published and not read yet
+
+	T m_Buffers[3];
+
+	// Each side's index on its own cache line
+	alignas(64) uint8_t m_Write = 0;
+	alignas(64) std::atomic<uint8_t> m_Middle{ 1 };
+	alignas(64) uint8_t m_Read = 2;
+};
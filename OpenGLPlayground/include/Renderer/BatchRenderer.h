@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ShaderLibrary.h"
+#include "TextureAtlas.h"
+
+class GLStateCache;
+
+// Draws large numbers of textured, tinted quads with a handful of GL calls.
+//
+// SubmitQuad() writes per-instance data (an affine transform, UV rectangle and
+// colour) straight into a persistently mapped buffer. Consecutive quads using
+// the same texture form a batch, and each batch is a single instanced draw of
+// a shared unit quad. Quads drawn from a TextureAtlas all share its array
+// texture, so any mix of atlas images still makes a single batch. The buffer is split into three segments used round-robin
+// and fenced per flush, so the CPU fills one segment while the GPU is still
+// reading the previous ones.
+class BatchRenderer
+{
+public:
+	struct Stats
+	{
+		uint32_t Quads = 0;
+		uint32_t DrawCalls = 0;
+		uint32_t Flushes = 0;
+		uint32_t FenceWaits = 0;	// Times the CPU had to wait for the GPU to release a segment
+	};
+
+	static constexpr int SegmentCount = 3;
+
+	BatchRenderer() = default;
+	~BatchRenderer();
+
+	BatchRenderer(const BatchRenderer&) = delete;
+	BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+	// Load the shaders, create the quad geometry and instance buffer. Requires
+	// a current context. Bindings go through 'state' and programs come from
+	// 'shaders', which needs UniformBlocks.glsl registered; both must outlive
+	// the renderer.
+	bool Initialize(GLStateCache& state, ShaderLibrary& shaders, uint32_t maxQuadsPerSegment = 128 * 1024);
+
+	// Start a frame. Resets the stats. Quads are transformed by the camera
+	// bound to UniformBinding::Camera when they are drawn.
+	void Begin();
+
+	// 'transform' maps the unit quad [-0.5, 0.5]^2 into world space. 'uvRect' is
+	// (u, v, width, height) in texture coordinates.
+	void SubmitQuad(const glm::mat4& transform, const glm::vec4& color, const glm::vec4& uvRect, GLuint texture);
+
+	// 2D sprite in the z = 0 plane, rotated by 'rotation' radians around its centre.
+	void SubmitQuad(const glm::vec2& position, const glm::vec2& size, float rotation,
+		const glm::vec4& color, const glm::vec4& uvRect, GLuint texture);
+
+	// 2D sprite showing 'image' from 'atlas'.
+	void SubmitQuad(const glm::vec2& position, const glm::vec2& size, float rotation,
+		const glm::vec4& color, const TextureAtlas& atlas, AtlasHandle image);
+
+	// Draw everything submitted since Begin().
+	void End();
+
+	const Stats& GetStats() const { return m_Stats; }
+	uint32_t GetCapacity() const { return m_SegmentCapacity; }
+
+private:
+	// One quad as the vertex shader sees it: rows of a 3x4 affine transform,
+	// the UV rectangle, an RGBA8 colour and the layer for array textures
+	struct QuadInstance
+	{
+		glm::vec4 Row0;
+		glm::vec4 Row1;
+		glm::vec4 Row2;
+		glm::vec4 UVRect;
+		uint32_t Color;
+		uint32_t Layer;
+	};
+	static_assert(sizeof(QuadInstance) == 72, "QuadInstance must be tightly packed");
+
+	struct Batch
+	{
+		GLenum Target = GL_TEXTURE_2D;
+		GLuint Texture = 0;
+		uint32_t First = 0;
+		uint32_t Count = 0;
+	};
+
+	QuadInstance* AllocateQuad(GLenum target, GLuint texture);
+	void Flush();
+	void WaitForSegment();
+
+	GLStateCache* m_State = nullptr;
+	ShaderLibrary* m_Shaders = nullptr;
+
+	// Same vertex shader; one samples a 2D texture, the other a layer of an array
+	ShaderHandle m_Shader = InvalidShaderHandle;
+	ShaderHandle m_ArrayShader = InvalidShaderHandle;
+
+	GLuint m_VAO = 0;
+	GLuint m_VBO = 0;
+	GLuint m_EBO = 0;
+
+	GLuint m_InstanceBuffer = 0;
+	QuadInstance* m_Instances = nullptr;
+	uint32_t m_SegmentCapacity = 0;
+	GLsync m_SegmentFences[SegmentCount] = {};
+	int m_Segment = 0;
+
+	uint32_t m_QuadCount = 0;		// Quads written to the current segment
+	std::vector<Batch> m_Batches;
+
+	Stats m_Stats;
+};
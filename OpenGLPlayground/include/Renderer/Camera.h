@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Perspective or orthographic camera that rebuilds its matrices only when
+// something changed.
+//
+// Setters compare against the current values, so calling them every frame
+// with the same arguments is free. Update() recomputes whatever is dirty and
+// bumps the version, which lets consumers (e.g. UniformBuffers) skip uploads
+// when the camera has not moved.
+class Camera
+{
+public:
+	void SetLookAt(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up);
+	void SetPerspective(float fovYRadians, float nearPlane, float farPlane);
+
+	// Orthographic projection of the given view-space box, e.g. pixel
+	// coordinates for screen-space drawing. Replaces the perspective one.
+	void SetOrthographic(float left, float right, float bottom, float top, float nearPlane = -1.0f, float farPlane = 1.0f);
+	void SetViewportSize(int width, int height);
+
+	// Recompute dirty matrices. Returns true if anything was rebuilt.
+	bool Update();
+
+	const glm::mat4& GetView() const { return m_View; }
+	const glm::mat4& GetProjection() const { return m_Projection; }
+	const glm::mat4& GetViewProjection() const { return m_ViewProjection; }
+	const glm::vec3& GetPosition() const { return m_Position; }
+
+	// Incremented every time Update() rebuilds the matrices
+	uint32_t GetVersion() const { return m_Version; }
+
+private:
+	glm::vec3 m_Position = glm::vec3(0.0f, 0.0f, 3.0f);
+	glm::vec3 m_Target = glm::vec3(0.0f);
+	glm::vec3 m_Up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	float m_FovY = glm::radians(45.0f);
+	float m_Near = 0.1f;
+	float m_Far = 100.0f;
+	float m_Aspect = 1.0f;
+
+	bool m_Orthographic = false;
+	glm::vec4 m_OrthographicBounds = glm::vec4(0.0f);	// left, right, bottom, top
+
+	bool m_ViewDirty = true;
+	bool m_ProjectionDirty = true;
+
+	glm::mat4 m_View = glm::mat4(1.0f);
+	glm::mat4 m_Projection = glm::mat4(1.0f);
+	glm::mat4 m_ViewProjection = glm::mat4(1.0f);
+	uint32_t m_Version = 0;
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+class GLStateCache;
+
+// 64-bit draw order, compared as an integer:
+//   bits 63..60 pass | 59..48 program | 47..24 material | 23..0 depth
+// Within a pass, draws group by program, then by material, so executing in key
+// order changes programs and textures as rarely as possible.
+namespace SortKey
+{
+	constexpr uint32_t MaxPass = (1u << 4) - 1;
+	constexpr uint32_t MaxProgram = (1u << 12) - 1;
+	constexpr uint32_t MaxMaterial = (1u << 24) - 1;
+	constexpr uint32_t MaxDepth = (1u << 24) - 1;
+
+	// Fields wider than their slot are truncated
+	inline uint64_t Make(uint32_t pass, uint32_t program, uint32_t material, uint32_t depth)
+	{
+		return (static_cast<uint64_t>(pass & MaxPass) << 60)
+			| (static_cast<uint64_t>(program & MaxProgram) << 48)
+			| (static_cast<uint64_t>(material & MaxMaterial) << 24)
+			| (depth & MaxDepth);
+	}
+
+	// 'depth' in [0, 1] (0 = near). Opaque passes sort front to back; transparent
+	// passes pass backToFront to draw the farthest first.
+	uint32_t QuantizeDepth(float depth, bool backToFront = false);
+}
+
+// One uniform set right before a draw, at an explicit location
+struct UniformValue
+{
+	enum class Type : uint8_t { Int, Float, Vec4, Mat4 };
+
+	GLint Location = -1;
+	Type Kind = Type::Float;
+	union
+	{
+		GLint Int;
+		float Float[16];
+	};
+
+	static UniformValue MakeInt(GLint location, GLint value);
+	static UniformValue MakeFloat(GLint location, float value);
+	static UniformValue MakeVec4(GLint location, const glm::vec4& value);
+	static UniformValue MakeMat4(GLint location, const glm::mat4& value);
+};
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t BaseVertex;
+	uint32_t BaseInstance;
+};
+
+// Everything needed to issue one indexed draw, or a batch of indirect ones
+struct DrawPacket
+{
+	static constexpr uint32_t MaxTextures = 4;
+
+	GLuint Program = 0;
+	GLuint VertexArray = 0;
+	GLuint Textures[MaxTextures] = {};		// 2D texture per unit; 0 leaves the unit alone
+	bool Blend = false;						// SRC_ALPHA, ONE_MINUS_SRC_ALPHA
+	bool DepthTest = false;
+
+	GLenum Mode = GL_TRIANGLES;
+	GLenum IndexType = GL_UNSIGNED_INT;
+	uint32_t IndexCount = 0;
+	uint32_t FirstIndex = 0;
+	int32_t BaseVertex = 0;
+	uint32_t InstanceCount = 1;
+
+	// With DrawCount > 0, issue DrawCount commands from IndirectBuffer, starting
+	// at byte IndirectOffset, in one glMultiDrawElementsIndirect. The index
+	// range and instance fields above are then taken from the commands.
+	GLuint IndirectBuffer = 0;
+	uint32_t IndirectOffset = 0;
+	uint32_t DrawCount = 0;
+
+	UniformValue* Uniforms = nullptr;		// Allocated with the packet
+	uint32_t UniformCount = 0;
+};
+
+// Draw packets recorded by one thread. Packets and their uniforms come from a
+// linear allocator that Reset() rewinds without freeing, so steady-state
+// recording does not allocate. Blocks are BlockSize bytes, or as large as a
+// single request that does not fit in one.
+class CommandBuffer
+{
+public:
+	struct Entry
+	{
+		uint64_t Key;
+		const DrawPacket* Packet;
+	};
+
+	CommandBuffer() = default;
+
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+	// Add a packet with room for 'uniformCount' uniforms and return it to fill in.
+	// The packet stays valid until Reset().
+	DrawPacket& AddDraw(uint64_t key, uint32_t uniformCount = 0);
+
+	void Reset();
+
+	const std::vector<Entry>& GetEntries() const { return m_Entries; }
+
+private:
+	static constexpr size_t BlockSize = 64 * 1024;
+
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> Data;
+		size_t Size = 0;
+	};
+
+	// 'alignment' is at most alignof(std::max_align_t)
+	void* Allocate(size_t size, size_t alignment);
+
+	std::vector<Block> m_Blocks;
+	size_t m_Block = 0;		// Block being filled
+	size_t m_Offset = 0;	// Bytes used in it
+
+	std::vector<Entry> m_Entries;
+};
+
+// Records draws on several threads, merges them by sort key and executes them
+// on the GL thread.
+//
+// Work is split into one slice per job system thread, run as jobs. Each slice
+// records into its own CommandBuffer, so recording takes no locks. Sort()
+// concatenates every buffer and orders the packets with a stable LSD radix sort
+// on the keys, split the same way: per pass, one round of jobs histograms the
+// slices and a second scatters them. Byte positions that are equal in every
+// key are skipped. Execute() then walks the packets in order through a
+// GLStateCache.
+class CommandQueue
+{
+public:
+	struct Stats
+	{
+		uint32_t Draws = 0;
+		uint32_t SortPasses = 0;	// Radix passes actually run (of 8)
+		double RecordMs = 0.0;
+		double SortMs = 0.0;
+		double ExecuteMs = 0.0;
+	};
+
+	// Start a job system of 'threadCount' threads for this queue alone; 0 uses
+	// one thread per core, including the caller.
+	explicit CommandQueue(unsigned threadCount = 0);
+	// Record and sort as jobs of a system shared with others. The system must
+	// outlive the queue.
+	explicit CommandQueue(JobSystem& jobs);
+	~CommandQueue();
+
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	// Clear every buffer and the stats for a new frame.
+	void Reset();
+
+	// Call record(buffer, begin, end) for every slice of [0, itemCount), each
+	// with its own buffer, in parallel. Returns when all slices are recorded.
+	// For draws issued one packet each, as in CommandBufferBenchmark; the
+	// application records its few packets on the GL thread via GetBuffer().
+	void Record(uint32_t itemCount, const std::function<void(CommandBuffer&, uint32_t, uint32_t)>& record);
+
+	// Buffer of slice 'index', for recording without Record()
+	CommandBuffer& GetBuffer(unsigned index) { return *m_Buffers[index]; }
+	unsigned GetThreadCount() const { return m_ThreadCount; }	// Slices, one per job system thread
+
+	// Merge all buffers and sort by key. Packets with equal keys keep their
+	// buffer order and their recording order within a buffer.
+	void Sort();
+
+	// Issue the sorted draws. GL thread.
+	void Execute(GLStateCache& state);
+
+	const std::vector<CommandBuffer::Entry>& GetSorted() const { return *m_Sorted; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	// Slices smaller than this are not worth spawning jobs for
+	static constexpr size_t MinEntriesPerThread = 4096;
+
+	void CreateThreadData();
+	void MergeSlice(unsigned slice, unsigned sliceCount);
+	void HistogramSlice(unsigned slice, unsigned sliceCount, const CommandBuffer::Entry* source, unsigned shift);
+	void ScatterSlice(unsigned slice, unsigned sliceCount, const CommandBuffer::Entry* source,
+		CommandBuffer::Entry* destination, unsigned shift);
+
+	// Run function(slice) for every slice in [0, sliceCount) as jobs
+	template <typename F>
+	void ForEachSlice(unsigned sliceCount, const F& function);
+
+	std::unique_ptr<JobSystem> m_OwnedJobs;
+	JobSystem& m_Jobs;
+	unsigned m_ThreadCount = 1;
+	std::vector<std::unique_ptr<CommandBuffer>> m_Buffers;
+
+	// Merge and radix sort scratch, reused every frame
+	std::vector<CommandBuffer::Entry> m_EntriesA;
+	std::vector<CommandBuffer::Entry> m_EntriesB;
+	std::vector<CommandBuffer::Entry>* m_Sorted = &m_EntriesA;
+	std::vector<size_t> m_MergeOffsets;
+	std::vector<uint32_t> m_Histograms;		// 256 per slice
+	std::vector<uint64_t> m_KeyAnd;			// Per slice, to find constant bytes
+	std::vector<uint64_t> m_KeyOr;
+
+	Stats m_Stats;
+};
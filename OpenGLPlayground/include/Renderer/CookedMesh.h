@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+
+// Binary container for precooked meshes (".oglm").
+//
+// Layout: a fixed-size header followed by one block that becomes the GPU
+// buffer as is: the index data first, then the vertices, each on a 16-byte
+// boundary. The runtime maps the file and hands the whole block to a single
+// glNamedBufferStorage, and the same buffer serves as vertex and element
+// buffer.
+//
+// Vertices are 16 bytes instead of the 32 of the float layout:
+//   0  position   4 x snorm16 within the mesh bounds, or 4 x half float (w unused)
+//   8  color      4 x unorm8
+//   12 texcoord   2 x unorm16, clamped to 0..1
+// Indices are 16-bit whenever the mesh has at most 65536 vertices.
+
+enum class CookedPositionFormat : uint32_t
+{
+	Snorm16 = 0,	// Exact to 1/65535 of the bounds; needs GetDequantizeTransform()
+	Half = 1,		// Used as is, but loses precision far from the origin
+};
+
+struct CookedMeshVertex
+{
+	uint64_t Position = 0;
+	uint32_t Color = 0;
+	uint32_t TexCoord = 0;
+};
+
+static_assert(sizeof(CookedMeshVertex) == 16, "Cooked vertex layout is part of the file format");
+
+struct CookedMeshHeader
+{
+	static constexpr uint32_t MagicValue = 0x4D4C474F; // "OGLM"
+	static constexpr uint32_t CurrentVersion = 1;
+
+	uint32_t Magic = MagicValue;
+	uint32_t Version = CurrentVersion;
+	CookedPositionFormat PositionFormat = CookedPositionFormat::Snorm16;
+	uint32_t IndexSize = 4;			// 2 or 4 bytes
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	uint32_t VertexStride = sizeof(CookedMeshVertex);
+	uint32_t Reserved = 0;
+	uint64_t SourceHash = 0;		// Hash of the source file plus cook settings
+	uint64_t DataOffset = 0;		// From the start of the file
+	uint64_t DataSize = 0;
+	uint64_t IndexOffset = 0;		// From the start of the data block
+	uint64_t VertexOffset = 0;		// From the start of the data block
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+};
+
+static_assert(sizeof(CookedMeshHeader) == 96, "Cooked mesh header layout is part of the file format");
+
+const char* GetCookedPositionFormatName(CookedPositionFormat format);
+bool ParseCookedPositionFormat(const std::string& name, CookedPositionFormat& format);
+
+// Where the cooker puts the cooked version of 'sourcePath': <directory>/<stem>-<path hash>.oglm
+std::string GetCookedMeshPath(const std::string& cookedDirectory, const std::string& sourcePath);
+
+// Describe the cooked vertex layout on attributes 0 (position), 1 (color) and
+// 2 (texcoord) of 'vertexArray', fed from 'binding'
+void SetCookedVertexFormat(GLuint vertexArray, GLuint binding, CookedPositionFormat format);
+
+// Read-only view of a cooked mesh backed by a memory mapping.
+class CookedMesh
+{
+public:
+	// Map and validate the file. Nothing is read beyond the header.
+	bool Open(const std::string& path);
+
+	// Use a cooked image that is already in memory, e.g. one cooked at
+	// startup. The bytes are not copied and must outlive this object.
+	bool OpenMemory(const unsigned char* data, size_t size);
+
+	const CookedMeshHeader& GetHeader() const { return *m_Header; }
+	const unsigned char* GetIndexData() const { return m_Data + m_Header->DataOffset + m_Header->IndexOffset; }
+	const CookedMeshVertex* GetVertices() const;
+
+	GLenum GetIndexType() const { return m_Header->IndexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
+	// Draw offset of the first index in the buffer from CreateGLBuffer()
+	uint32_t GetFirstIndex() const { return static_cast<uint32_t>(m_Header->IndexOffset / m_Header->IndexSize); }
+
+	// Maps snorm16 positions back into model space; fold it into the model
+	// matrix. Identity for half-float positions.
+	glm::mat4 GetDequantizeTransform() const;
+
+	// Allocate immutable storage for indices and vertices in one buffer and
+	// upload them straight from the mapping; returns the buffer.
+	GLuint CreateGLBuffer() const;
+
+	// Vertex array reading everything from 'buffer' (see CreateGLBuffer())
+	GLuint CreateGLVertexArray(GLuint buffer) const;
+
+	size_t GetFileSize() const { return m_Size; }
+
+private:
+	bool Validate(const std::string& name);
+
+	MappedFile m_File;
+	const unsigned char* m_Data = nullptr;
+	size_t m_Size = 0;
+	const CookedMeshHeader* m_Header = nullptr;
+};
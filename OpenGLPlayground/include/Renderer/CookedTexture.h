@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "MappedFile.h"
+
+// Binary container for precooked textures (".oglt").
+//
+// Layout: a fixed-size header followed by every mip level, largest first,
+// each starting on a 16-byte boundary. Level data is already in its final
+// GPU format, so the runtime maps the file and passes pointers into it to
+// glCompressedTexSubImage2D / glTexSubImage2D without decoding or copying.
+
+enum class CookedFormat : uint32_t
+{
+	RGBA8 = 0,
+	BC1 = 1,	// RGB, 1-bit alpha, 8 bytes per 4x4 block
+	BC3 = 2,	// RGBA, 16 bytes per 4x4 block
+	BC7 = 3,	// RGBA, 16 bytes per 4x4 block
+};
+
+struct CookedMipLevel
+{
+	uint64_t Offset = 0;	// From the start of the file
+	uint64_t Size = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+};
+
+struct CookedTextureHeader
+{
+	static constexpr uint32_t MagicValue = 0x544C474F; // "OGLT"
+	static constexpr uint32_t CurrentVersion = 1;
+	static constexpr uint32_t MaxMipLevels = 16;
+
+	uint32_t Magic = MagicValue;
+	uint32_t Version = CurrentVersion;
+	CookedFormat Format = CookedFormat::RGBA8;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	uint64_t SourceHash = 0;	// Hash of the source file plus cook settings
+	CookedMipLevel Mips[MaxMipLevels];
+};
+
+static_assert(sizeof(CookedTextureHeader) == 416, "Cooked texture header layout is part of the file format");
+
+// S3TC enums are an extension and are not part of the core GLAD loader
+constexpr GLenum GL_COMPRESSED_RGBA_S3TC_DXT1 = 0x83F1;
+constexpr GLenum GL_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+const char* GetCookedFormatName(CookedFormat format);
+bool ParseCookedFormat(const std::string& name, CookedFormat& format);
+
+bool IsBlockCompressed(CookedFormat format);
+GLenum GetGLInternalFormat(CookedFormat format);
+
+// Bytes needed to store one mip level of the given size
+size_t GetCookedLevelSize(CookedFormat format, uint32_t width, uint32_t height);
+
+// Where the cooker puts the cooked version of 'sourcePath': <directory>/<stem>-<path hash>.oglt
+std::string GetCookedTexturePath(const std::string& cookedDirectory, const std::string& sourcePath);
+
+// Read-only view of a cooked texture backed by a memory mapping.
+class CookedTexture
+{
+public:
+	// Map and validate the file. Nothing is read beyond the header.
+	bool Open(const std::string& path);
+
+	const CookedTextureHeader& GetHeader() const { return *m_Header; }
+	const unsigned char* GetLevelData(uint32_t level) const;
+
+	// Allocate immutable storage for all levels and upload them; returns the texture.
+	GLuint CreateGLTexture() const;
+
+	size_t GetFileSize() const { return m_File.GetSize(); }
+
+private:
+	MappedFile m_File;
+	const CookedTextureHeader* m_Header = nullptr;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+enum class CaptureFormat
+{
+	Png,	// One numbered file per frame
+	Y4m,	// One uncompressed YUV 4:2:0 video stream
+};
+
+struct FrameCaptureSettings
+{
+	CaptureFormat Format = CaptureFormat::Png;
+	std::string Path;				// Directory for frame_000000.png, ...; or the .y4m file
+	uint32_t FramesPerSecond = 60;	// Written into the Y4M header
+	unsigned EncoderThreads = 0;	// 0 picks one per core, leaving one for the GL thread
+	uint32_t ReadbackSlots = 0;		// Frames of readback memory; 0 picks enough to cover the pipeline
+	bool DropWhenBusy = false;		// Skip frames instead of waiting when the encoders fall behind
+	bool Alpha = false;				// Keep the alpha channel in PNGs
+};
+
+// Captures rendered frames to disk without stalling the GL thread.
+//
+// Capture() only queues a glReadPixels into one slot of a persistently mapped
+// pixel-pack buffer and fences it. The copy runs on the GPU after the frame's
+// draws, and the slot is handed to an encoder thread once a later Capture()
+// finds its fence signalled, typically two frames on. Encoders read the pixels
+// straight from the mapping, so frames are never copied on the GL thread, and
+// return the slot when done.
+//
+// Capture() waits only when every slot is still being read back or encoded,
+// i.e. when the encoders cannot keep up; with DropWhenBusy the frame is
+// skipped instead. Frames that are captured are always written in order.
+class FrameCapture
+{
+public:
+	struct Stats
+	{
+		uint64_t Captured = 0;		// Readbacks issued
+		uint64_t Written = 0;
+		uint64_t Dropped = 0;		// Skipped with DropWhenBusy
+		uint64_t Failed = 0;		// Encoded but not written
+		uint64_t Stalls = 0;		// Capture() calls that waited for a slot
+		double StallMs = 0.0;
+		double EncodeMs = 0.0;		// Summed over the encoder threads
+		uint64_t Bytes = 0;			// Written to disk
+	};
+
+	FrameCapture() = default;
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// Allocate the readback slots, open the output and start the encoders.
+	// Requires a current context.
+	bool Initialize(int width, int height, const FrameCaptureSettings& settings);
+
+	// Queue a readback of colour attachment 0 of 'framebuffer' (0 for the
+	// window). Call after the frame is drawn and before it is presented.
+	void Capture(GLuint framebuffer);
+
+	// Wait until every captured frame is written. Returns false if any failed.
+	bool Finish();
+
+	Stats GetStats() const;
+	uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_Slots.size()); }
+	unsigned GetEncoderCount() const { return static_cast<unsigned>(m_Encoders.size()); }
+
+private:
+	enum class SlotState
+	{
+		Free,
+		Reading,	// Readback queued on the GPU
+		Encoding,	// Owned by an encoder thread
+	};
+
+	struct Slot
+	{
+		SlotState State = SlotState::Free;
+		GLsync Fence = nullptr;
+		uint64_t Frame = 0;
+	};
+
+	// Hand slots whose readback completed to the encoders. With 'wait', block
+	// until the oldest one completes.
+	void RetireReadbacks(bool wait);
+	void EncoderMain();
+	bool Encode(uint32_t slot, uint64_t frame, std::vector<uint8_t>& scratch);
+
+	FrameCaptureSettings m_Settings;
+	int m_Width = 0;
+	int m_Height = 0;
+	size_t m_FrameBytes = 0;
+
+	GLuint m_Buffer = 0;
+	const uint8_t* m_Mapped = nullptr;
+
+	std::vector<Slot> m_Slots;
+	uint32_t m_NextSlot = 0;
+	std::deque<uint32_t> m_Reading;		// Slots in readback order; only touched on the GL thread
+	uint64_t m_NextFrame = 0;
+
+	std::vector<std::thread> m_Encoders;
+	bool m_StopEncoders = false;
+
+	// Guards slot states, the job queue, the Y4M write order and the stats
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_JobCondition;
+	std::condition_variable m_SlotCondition;	// A slot was freed or a frame written
+	std::deque<uint32_t> m_Jobs;
+	uint32_t m_Unwritten = 0;				// Handed to the encoders and not yet on disk
+
+	std::ofstream m_Stream;				// Y4M output
+	uint64_t m_NextStreamFrame = 0;		// Frames are appended to the stream in capture order
+
+	Stats m_Stats;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Shadows the GL state the renderer sets every frame and drops calls that
+// would not change anything.
+//
+// Draw code states what it needs (program, VAO, textures, blend, depth)
+// without restoring defaults afterwards; only real changes reach the driver.
+// Everything starts out unknown, so the first call for each piece of state is
+// always issued. Code that changes tracked state behind the cache's back must
+// call Invalidate() afterwards.
+//
+// Not tracked: the element array buffer (it belongs to the bound VAO) and the
+// pixel pack/unpack buffers, which their owners bind and release around each
+// transfer.
+class GLStateCache
+{
+public:
+	// Calls that reached the driver vs. calls dropped as redundant
+	struct Counters
+	{
+		uint32_t Issued = 0;
+		uint32_t Elided = 0;
+	};
+
+	static constexpr GLuint MaxTextureUnits = 32;
+	static constexpr GLuint MaxBufferBindings = 16;	// Indexed uniform and shader storage bindings
+
+	GLStateCache() { Invalidate(); }
+
+	// Forget everything; the next call for each piece of state is issued.
+	void Invalidate();
+
+	// Start counting a new frame. The finished frame's counters move to GetLastFrame().
+	void BeginFrame();
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vertexArray);
+
+	// GL_ARRAY_BUFFER and GL_DRAW_INDIRECT_BUFFER are cached; other targets are passed through.
+	void BindBuffer(GLenum target, GLuint buffer);
+
+	// Indexed GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER binding.
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+	// Bind to a specific unit; glActiveTexture is only issued when the bind is.
+	// GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D and GL_TEXTURE_CUBE_MAP
+	// are cached; other targets are passed through.
+	void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	// Call before deleting 'texture': units that hold it become unknown, so a
+	// new texture that reuses the name is bound rather than dropped.
+	void ForgetTexture(GLuint texture);
+
+	void SetBlend(bool enabled);
+	void SetBlendFunc(GLenum source, GLenum destination);
+
+	void SetDepthTest(bool enabled);
+	void SetDepthWrite(bool enabled);
+	void SetDepthFunc(GLenum func);
+
+	void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	const Counters& GetFrame() const { return m_Frame; }
+	const Counters& GetLastFrame() const { return m_LastFrame; }
+	const Counters& GetTotal() const { return m_Total; }
+
+private:
+	static constexpr GLuint Unknown = 0xFFFFFFFFu;
+	static constexpr int TextureTargetCount = 4;
+
+	// Store 'value' and count the call; false means it was already set
+	bool Change(GLuint& cached, GLuint value);
+	void CountIssued();
+	void CountElided();
+
+	static int GetTextureTargetIndex(GLenum target);
+	static int GetIndexedTargetIndex(GLenum target);
+
+	GLuint m_Program;
+	GLuint m_VertexArray;
+	GLuint m_ArrayBuffer;
+	GLuint m_DrawIndirectBuffer;
+	GLuint m_IndexedBuffers[2][MaxBufferBindings];
+
+	GLuint m_ActiveTexture;
+	GLuint m_Textures[MaxTextureUnits][TextureTargetCount];
+
+	GLuint m_Blend;
+	GLuint m_BlendSource;
+	GLuint m_BlendDestination;
+
+	GLuint m_DepthTest;
+	GLuint m_DepthWrite;
+	GLuint m_DepthFunc;
+
+	GLint m_Viewport[4];
+	bool m_ViewportKnown;
+
+	Counters m_Frame;
+	Counters m_LastFrame;
+	Counters m_Total;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "PoolAllocator.h"
+#include "SkylinePacker.h"
+
+class GLStateCache;
+
+using AtlasHandle = uint32_t;
+constexpr AtlasHandle InvalidAtlasHandle = UINT32_MAX;
+
+// Where an image lives in the atlas: a layer of the array texture, and
+// (u, v, width, height) within it in texture coordinates
+struct AtlasRegion
+{
+	uint32_t Layer = 0;
+	glm::vec4 UVRect = glm::vec4(0.0f);
+};
+
+// Packs many same-format images into the layers of one GL_TEXTURE_2D_ARRAY,
+// so draws that use different images still share a texture binding and can
+// be batched together. Shaders sample with (uv, layer) from GetRegion().
+//
+// Each layer is filled by a SkylinePacker. Images are copied in with a border
+// of repeated edge texels so linear filtering never blends in a neighbour;
+// there is a single mip level, as the atlas is meant for sprites drawn close
+// to their native size. An image as large as a layer simply fills one.
+//
+// Image records live in a fixed pool sized at initialisation, and handles are
+// indices into it, so adding and removing images never allocates records.
+// Removing an image leaves a hole. When an image does not fit anywhere, the
+// most wasteful layer is repacked on the GPU with glCopyImageSubData, and if
+// that does not help the array grows by reallocating it with more layers.
+// Both move images or replace the texture, so look up GetRegion() and
+// GetTexture() when drawing rather than keeping them. Growing deletes the old
+// texture and makes the GLStateCache given to Initialize() forget it.
+class TextureAtlas
+{
+public:
+	struct Stats
+	{
+		uint32_t Layers = 0;
+		uint32_t Images = 0;
+		uint64_t LiveTexels = 0;		// Including borders
+		uint64_t WastedTexels = 0;		// Held by removed images until their layer is repacked
+		uint32_t Defragmentations = 0;
+		uint32_t MovedImages = 0;
+		uint32_t Reallocations = 0;
+	};
+
+	TextureAtlas() = default;
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// Create the array texture with one layer. 'internalFormat' is GL_RGBA8 or
+	// GL_SRGB8_ALPHA8; images are always passed as RGBA8. At most 'maxImages'
+	// images are held at once. 'state' must outlive the atlas. Requires a
+	// current context.
+	bool Initialize(GLStateCache& state, uint32_t layerSize = 2048, uint32_t maxLayers = 64, uint32_t padding = 1, GLenum internalFormat = GL_RGBA8,
+		uint32_t maxImages = 16384);
+
+	// Copy an RGBA8 image into the atlas. Returns InvalidAtlasHandle if it is
+	// larger than a layer or the atlas is full.
+	AtlasHandle Add(const uint8_t* pixels, uint32_t width, uint32_t height);
+	void Remove(AtlasHandle handle);
+
+	AtlasRegion GetRegion(AtlasHandle handle) const;
+	bool IsValid(AtlasHandle handle) const { return m_Images.IsAllocated(handle); }
+
+	// Repack every layer where removed images hold at least 'minWastedFraction'
+	// of the packed area. Returns the number of images moved.
+	uint32_t Defragment(float minWastedFraction = 0.25f);
+
+	GLuint GetTexture() const { return m_Texture; }
+	uint32_t GetLayerSize() const { return m_LayerSize; }
+	Stats GetStats() const;
+
+private:
+	struct Image
+	{
+		uint32_t Layer = 0;
+		uint32_t X = 0;			// Corner of the padded rectangle
+		uint32_t Y = 0;
+		uint32_t Width = 0;		// Without padding
+		uint32_t Height = 0;
+	};
+
+	struct Layer
+	{
+		SkylinePacker Packer;
+		uint64_t WastedArea = 0;
+	};
+
+	bool Allocate(uint32_t paddedWidth, uint32_t paddedHeight, uint32_t& layer, uint32_t& x, uint32_t& y);
+	bool TryLayers(uint32_t paddedWidth, uint32_t paddedHeight, uint32_t& layer, uint32_t& x, uint32_t& y);
+	bool GrowLayers();
+
+	// Repack one layer's live images tightly and return how many moved. Leaves
+	// the layer alone (and its waste in place) if the new order would not fit.
+	uint32_t RepackLayer(uint32_t layer);
+
+	GLuint CreateArrayTexture(uint32_t layerCount) const;
+
+	GLStateCache* m_State = nullptr;
+	GLuint m_Texture = 0;
+	GLuint m_Scratch = 0;			// One layer, for moving images while repacking
+	GLenum m_InternalFormat = GL_RGBA8;
+	uint32_t m_LayerSize = 0;
+	uint32_t m_MaxLayers = 0;
+	uint32_t m_Padding = 0;
+
+	std::vector<Layer> m_Layers;		// One per layer of m_Texture
+	PoolAllocator<Image> m_Images;		// Indexed by handle
+	std::vector<uint8_t> m_PaddedPixels;
+
+	uint32_t m_Defragmentations = 0;
+	uint32_t m_MovedImages = 0;
+	uint32_t m_Reallocations = 0;
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CookedTexture.h"
+#include "ImageOps.h"
+#include "JobSystem.h"
+
+using TextureHandle = uint32_t;
+constexpr TextureHandle InvalidTextureHandle = UINT32_MAX;
+
+// CPU-side preparation applied by the worker that decodes the image
+struct TextureLoadOptions
+{
+	bool GenerateMips = true;		// Build the mip chain on the worker (RGB/RGBA); otherwise glGenerateMipmap does
+	bool SRGB = false;				// Colour is sRGB encoded: filter in linear light, sample as GL_SRGB8_ALPHA8
+	bool PremultiplyAlpha = false;
+	bool FlipVertically = false;	// Bottom row first, as GL expects
+	ImageOps::MipFilter Filter = ImageOps::MipFilter::Box;
+};
+
+// Loads textures without blocking the GL thread.
+//
+// Load() returns a handle right away and queues the file for decoding by
+// Background jobs, so images decode in parallel on the job system's workers
+// whenever frame work leaves them idle. There is at most one decode job per
+// worker; each one takes the next request when it finishes, so a burst of
+// loads does not fill the caller's job ring. Update() runs once per frame on
+// the GL thread and streams finished images to the GPU through a persistently
+// mapped pixel-buffer-object ring. Ring regions are guarded by fences so the
+// CPU never overwrites staging memory the GPU is still reading.
+//
+// Workers also prepare the pixels (see ImageOps): RGB images are expanded to
+// RGBA so uploads need no driver-side repacking, and the mip chain is built on
+// the CPU instead of with glGenerateMipmap on the GL thread.
+//
+// If a cooked directory is set and it holds a cooked version of the requested
+// image (see TextureCooker), the worker maps that file instead of decoding, and
+// its prebuilt mip chain is uploaded straight from the mapping.
+//
+// Until a texture is uploaded, GetTexture() returns a shared placeholder.
+class TextureLoader
+{
+public:
+	struct Stats
+	{
+		uint32_t Requested = 0;
+		uint32_t Decoded = 0;
+		uint32_t Uploaded = 0;
+		uint32_t Failed = 0;
+		uint32_t Cooked = 0;		// Served from cooked files rather than decoded
+		uint64_t DecodedBytes = 0;
+	};
+
+	// Start a job system with 'workerCount' workers for this loader alone;
+	// 0 picks one per core, leaving one for the GL thread.
+	explicit TextureLoader(unsigned workerCount = 0);
+	// Decode on a job system shared with other systems. The system must
+	// outlive the loader.
+	explicit TextureLoader(JobSystem& jobs);
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// Create the placeholder texture and the staging ring. Requires a current context.
+	bool Initialize(size_t stagingBytes = 32 * 1024 * 1024);
+
+	// Prefer <directory>/<stem>-<path hash>.oglt over decoding the source image.
+	// Set before the first Load().
+	void SetCookedDirectory(const std::string& directory) { m_CookedDirectory = directory; }
+
+	// Queue an image file for loading. Safe to call from any thread.
+	TextureHandle Load(const std::string& path, const TextureLoadOptions& options = {});
+
+	// Upload decoded images, spending at most 'uploadBudgetBytes' of staging
+	// memory per call (at least one image is always uploaded). GL thread only.
+	void Update(size_t uploadBudgetBytes = 4 * 1024 * 1024);
+
+	// Texture object to bind for 'handle': the placeholder until it is ready.
+	// GL thread only, and lock-free: textures are published by Update().
+	GLuint GetTexture(TextureHandle handle) const;
+	bool IsReady(TextureHandle handle) const;
+
+	// Textures requested but not yet uploaded (or failed).
+	uint32_t GetPendingCount() const;
+
+	Stats GetStats() const;
+	unsigned GetWorkerCount() const { return m_Jobs.GetWorkerCount(); }
+
+private:
+	struct DecodeRequest
+	{
+		TextureHandle Handle = InvalidTextureHandle;
+		std::string Path;
+		TextureLoadOptions Options;
+	};
+
+	struct DecodedImage
+	{
+		TextureHandle Handle = InvalidTextureHandle;
+		std::vector<uint8_t> Pixels;	// Level 0, followed by the rest of the chain when LevelCount > 1
+		int Width = 0;
+		int Height = 0;
+		int Channels = 0;
+		uint32_t LevelCount = 1;
+		bool SRGB = false;
+
+		// Set instead of Pixels when the image came from a cooked file
+		std::unique_ptr<CookedTexture> Cooked;
+	};
+
+	// A range of the staging ring that a pending upload is still reading from
+	struct StagingRegion
+	{
+		size_t Begin = 0;
+		size_t End = 0;
+		GLsync Fence = nullptr;
+	};
+
+	// Body of a decode job: takes the oldest queued request, then queues
+	// another job while requests remain
+	void DecodeNext();
+
+	bool Decode(const DecodeRequest& request, DecodedImage& image);
+	void Upload(const DecodedImage& image);
+	void Publish(TextureHandle handle, GLuint texture);
+	bool AllocateStaging(size_t size, size_t& offset);
+	void RetireStaging();
+
+	GLuint CreatePlaceholderTexture();
+
+	std::string m_CookedDirectory;
+
+	std::unique_ptr<JobSystem> m_OwnedJobs;
+	JobSystem& m_Jobs;
+	JobCounter m_DecodeJobs;		// Queued and running decode jobs
+
+	std::mutex m_RequestMutex;
+	std::deque<DecodeRequest> m_Requests;
+	TextureHandle m_NextHandle = 0;
+	unsigned m_DecodeChains = 0;	// Jobs working through m_Requests, at most m_MaxDecodeChains
+	unsigned m_MaxDecodeChains = 1;
+	bool m_StopDecoding = false;
+
+	std::mutex m_DecodedMutex;
+	std::deque<DecodedImage> m_Decoded;
+
+	// Indexed by handle, 0 until uploaded; GL thread only, grown as uploads arrive
+	std::vector<GLuint> m_Textures;
+
+	GLuint m_Placeholder = 0;
+
+	GLuint m_StagingBuffer = 0;
+	unsigned char* m_StagingPtr = nullptr;
+	size_t m_StagingSize = 0;
+	size_t m_StagingHead = 0;
+	std::deque<StagingRegion> m_StagingInFlight;
+
+	std::atomic<uint32_t> m_Requested{ 0 };
+	std::atomic<uint32_t> m_DecodedCount{ 0 };
+	std::atomic<uint32_t> m_Failed{ 0 };
+	std::atomic<uint32_t> m_CookedCount{ 0 };
+	std::atomic<uint64_t> m_DecodedBytes{ 0 };
+	uint32_t m_Uploaded = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Camera;
+class GLStateCache;
+
+// Fixed uniform buffer binding points shared by every shader program. Shaders
+// declare the blocks with layout(binding = N), so no per-program lookups or
+// glUniformBlockBinding calls are needed.
+namespace UniformBinding
+{
+	constexpr GLuint Frame = 0;
+	constexpr GLuint Camera = 1;
+}
+
+// std140 mirrors of the GLSL blocks in UniformBlockSource
+struct FrameBlock
+{
+	float Time = 0.0f;			// Seconds since startup
+	float DeltaTime = 0.0f;		// Seconds since the previous frame
+	float Padding[2] = {};
+};
+static_assert(sizeof(FrameBlock) == 16, "FrameBlock must match the std140 layout");
+
+struct CameraBlock
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::vec4 Position;			// w unused
+};
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock must match the std140 layout");
+
+// GLSL declarations of the blocks above. Shaders loaded through ShaderLibrary
+// get them with #include "UniformBlocks.glsl".
+extern const char* const UniformBlockSource;
+
+// Owns the Frame and Camera uniform buffers and keeps them bound to their
+// binding points. Each camera passed to SetCamera() gets a buffer of its own,
+// so switching between the scene camera and a screen-space one only rebinds;
+// camera data is uploaded only when that camera has changed. Bindings go
+// through the GLStateCache, so rebinding the camera already bound is dropped.
+class UniformBuffers
+{
+public:
+	struct Stats
+	{
+		uint32_t FrameUploads = 0;
+		uint32_t CameraUploads = 0;
+		uint32_t CameraUploadsSkipped = 0;
+	};
+
+	UniformBuffers() = default;
+	~UniformBuffers();
+
+	UniformBuffers(const UniformBuffers&) = delete;
+	UniformBuffers& operator=(const UniformBuffers&) = delete;
+
+	// Create both buffers and bind them. 'state' must outlive this object.
+	// Requires a current context.
+	bool Initialize(GLStateCache& state);
+
+	// Upload per-frame values. Call once per frame.
+	void SetFrame(float time, float deltaTime);
+
+	// Update the camera's matrices if needed, upload them if they changed, and
+	// bind the camera's buffer for the draws that follow.
+	void SetCamera(Camera& camera);
+
+	// Re-attach both buffers to their binding points
+	void Bind();
+
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	static constexpr uint32_t MaxCameras = 4;
+
+	struct CameraSlot
+	{
+		const Camera* Owner = nullptr;
+		uint32_t Version = 0;			// Of the camera when last uploaded
+		GLuint Buffer = 0;
+	};
+
+	GLStateCache* m_State = nullptr;
+	GLuint m_FrameBuffer = 0;
+	CameraSlot m_Cameras[MaxCameras];
+	uint32_t m_BoundCamera = 0;
+
+	Stats m_Stats;
+};
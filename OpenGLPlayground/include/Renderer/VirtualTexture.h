@@ -0,0 +1,258 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CookedTexture.h"
+
+class GLStateCache;
+
+// Page file for virtual textures (".oglv").
+//
+// The image and its mip chain are cut into tiles of TileSize x TileSize
+// texels. Each tile is stored with a Border of neighbouring texels (repeated
+// at the image edge) as one PageSize x PageSize page, so bilinear filtering
+// never reads outside it. Pages are already in their GPU format and all the
+// same size: tile i starts at DataOffset + i * PageBytes. Levels are stored
+// largest first, each row by row, and the chain ends at the first level that
+// fits in a single tile.
+
+struct VirtualTextureLevel
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t TilesX = 0;
+	uint32_t TilesY = 0;
+	uint32_t FirstTile = 0;		// Index of the level's first tile in the file
+	uint32_t Reserved = 0;
+};
+
+struct VirtualTextureHeader
+{
+	static constexpr uint32_t MagicValue = 0x564C474F; // "OGLV"
+	static constexpr uint32_t CurrentVersion = 1;
+	static constexpr uint32_t MaxLevels = 16;
+
+	uint32_t Magic = MagicValue;
+	uint32_t Version = CurrentVersion;
+	CookedFormat Format = CookedFormat::RGBA8;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t TileSize = 0;
+	uint32_t Border = 0;
+	uint32_t PageSize = 0;		// TileSize + 2 * Border
+	uint32_t LevelCount = 0;
+	uint32_t TileCount = 0;
+	uint64_t PageBytes = 0;
+	uint64_t SourceHash = 0;	// Hash of the source plus cook settings
+	uint64_t DataOffset = 0;
+	VirtualTextureLevel Levels[MaxLevels];
+};
+
+static_assert(sizeof(VirtualTextureHeader) == 448, "Virtual texture header layout is part of the file format");
+
+// Read and validate the header at the start of 'file'
+bool ReadVirtualTextureHeader(std::istream& file, VirtualTextureHeader& header);
+
+// Where the cooker puts the page file for 'sourcePath': <directory>/<stem>-<path hash>.oglv
+std::string GetVirtualTexturePath(const std::string& directory, const std::string& sourcePath);
+
+struct VirtualTextureSettings
+{
+	uint64_t GpuBudgetBytes = 64ull * 1024 * 1024;	// Page cache texture plus page table
+	uint64_t HostBudgetBytes = 8ull * 1024 * 1024;	// Staging for tiles being read, plus bookkeeping
+	uint32_t MaxUploadsPerFrame = 32;
+	unsigned LoaderThreads = 2;
+};
+
+// Streams the tiles of a page file into a fixed-size cache texture as the
+// view needs them, so images far larger than memory can be drawn.
+//
+// Each frame the caller reports the tiles it is about to sample, with
+// RequestTile() or with RequestQuad() (a CPU-side feedback pass for a
+// textured plane), then calls Update(). Loader threads read requested tiles
+// that are not resident straight into a persistently mapped staging buffer,
+// coarsest level first, and Update() uploads up to MaxUploadsPerFrame of them
+// into free pages of the cache. When the cache is full the least recently
+// requested page is evicted; pages requested this frame never are, so a view
+// that needs more pages than the cache holds draws the excess from coarser
+// levels instead of thrashing.
+//
+// The page table is a shader storage buffer with an entry for every tile of
+// every level. A tile that is not resident points at its nearest resident
+// ancestor, and the coarsest level is loaded by Initialize() and never
+// evicted, so every lookup finds a page. Shaders sample through ShaderSource.
+//
+// All memory is allocated by Initialize(): the cache holds as many pages as
+// fit in the GPU budget, and as many tiles are read at once as fit in the
+// host budget, whatever the size of the source image. Tiles are read with
+// ordinary file reads rather than a mapping, so the page file never becomes
+// part of the process's resident memory.
+class VirtualTexture
+{
+public:
+	struct Stats
+	{
+		uint32_t Requested = 0;		// Distinct tiles requested this frame
+		uint32_t Missing = 0;		// Of those, not resident after Update()
+		uint32_t Uploaded = 0;		// This frame
+		uint32_t Evicted = 0;		// This frame
+		uint32_t Dropped = 0;		// Read this frame, but every page was in use
+		uint32_t Loading = 0;		// Reads queued, in flight or waiting for upload
+		uint32_t ResidentPages = 0;
+		uint32_t PageCapacity = 0;
+		uint64_t TotalUploaded = 0;
+		uint64_t TotalEvicted = 0;
+		double MeanLatencyMs = 0.0;	// From the read being queued to the upload, over the run
+		uint64_t GpuBytes = 0;
+		uint64_t HostBytes = 0;
+	};
+
+	// GLSL for #include. Declares the page table block and
+	//   vec4 SampleVirtualTexture(sampler2D cache, vec2 uv)
+	// which picks a level from the derivatives of 'uv' the same way
+	// RequestQuad() does and samples the best resident page for it.
+	static const char* const ShaderSource;
+
+	// Shader storage binding of the page table
+	static constexpr GLuint PageTableBinding = 0;
+
+	VirtualTexture() = default;
+	~VirtualTexture();
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	// Open a page file, allocate the cache within the budgets and load the
+	// coarsest level. Requires a current context.
+	bool Initialize(const std::string& path, const VirtualTextureSettings& settings = {});
+
+	// Start collecting this frame's requests
+	void BeginFrame();
+
+	void RequestTile(uint32_t level, uint32_t tileX, uint32_t tileY);
+
+	// Request what the texture needs when mapped onto the unit quad
+	// [-0.5, 0.5]^2 in z = 0 (uv = position + 0.5) and drawn with
+	// 'modelViewProjection' into a viewport of 'viewportSize' pixels.
+	void RequestQuad(const glm::mat4& modelViewProjection, const glm::vec2& viewportSize);
+
+	// Upload finished reads, queue reads for missing tiles and refresh the
+	// page table. GL thread, after this frame's requests.
+	void Update();
+
+	// Bind the cache to 'textureUnit' and the page table to PageTableBinding
+	void Bind(GLStateCache& state, GLuint textureUnit) const;
+
+	GLuint GetCacheTexture() const { return m_Cache; }
+	GLuint GetPageTable() const { return m_PageTable; }
+	const VirtualTextureHeader& GetHeader() const { return m_Header; }
+
+	// Cache page holding the tile, or false if it is not resident
+	bool GetResidentPage(uint32_t level, uint32_t tileX, uint32_t tileY, uint32_t& pageX, uint32_t& pageY) const;
+
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	static constexpr uint32_t NoPage = UINT32_MAX;
+	static constexpr uint32_t NoTile = UINT32_MAX;
+
+	struct Tile
+	{
+		uint32_t Page = NoPage;
+		uint32_t RequestFrame = 0;
+		bool Loading = false;
+	};
+
+	// Pages form a list from least to most recently requested; pinned pages
+	// hold the coarsest level and are not in it
+	struct Page
+	{
+		uint32_t Tile = NoTile;
+		uint32_t Previous = NoPage;
+		uint32_t Next = NoPage;
+		uint32_t LastUsed = 0;
+		bool Pinned = false;
+	};
+
+	struct TileRead
+	{
+		uint32_t Tile = NoTile;
+		uint32_t Slot = 0;
+		bool Succeeded = false;
+		std::chrono::steady_clock::time_point Queued;
+	};
+
+	void LoaderMain();
+
+	bool LoadPinnedLevel();
+	uint32_t AllocatePage();
+	void UploadPage(uint32_t page, const void* pixels);
+	void Touch(uint32_t page);
+	void Unlink(uint32_t page);
+	void RebuildPageTable();
+
+	uint32_t GetTileIndex(uint32_t level, uint32_t tileX, uint32_t tileY) const
+	{
+		const VirtualTextureLevel& info = m_Header.Levels[level];
+		return info.FirstTile + tileY * info.TilesX + tileX;
+	}
+
+	std::string m_Path;
+	VirtualTextureHeader m_Header;
+	VirtualTextureSettings m_Settings;
+	GLenum m_InternalFormat = GL_RGBA8;
+
+	GLuint m_Cache = 0;
+	uint32_t m_PagesX = 0;
+	uint32_t m_PagesY = 0;
+
+	// Page table: a fixed block of parameters, then one entry per tile
+	GLuint m_PageTable = 0;
+	std::vector<uint32_t> m_Entries;
+	bool m_PageTableDirty = false;
+
+	std::vector<Tile> m_Tiles;
+	std::vector<Page> m_Pages;
+	std::vector<uint32_t> m_FreePages;
+	uint32_t m_LeastRecent = NoPage;
+	uint32_t m_MostRecent = NoPage;
+
+	uint32_t m_Frame = 0;
+	std::vector<uint32_t> m_Requested;		// Tiles requested this frame
+	std::vector<uint32_t> m_Missing;
+	std::vector<glm::vec4> m_FeedbackCorners;	// Clip-space grid used by RequestQuad()
+
+	// Staging slots of PageBytes each. A slot is reused once the upload that
+	// read it has finished on the GPU.
+	GLuint m_StagingBuffer = 0;
+	unsigned char* m_StagingPtr = nullptr;
+	std::deque<uint32_t> m_FreeSlots;
+	std::vector<GLsync> m_SlotFences;
+
+	std::vector<std::thread> m_Loaders;
+	bool m_StopLoaders = false;
+
+	std::mutex m_ReadMutex;
+	std::condition_variable m_ReadCondition;
+	std::deque<TileRead> m_Reads;
+
+	std::mutex m_FinishedMutex;
+	std::deque<TileRead> m_Finished;
+
+	std::deque<TileRead> m_ReadyToUpload;	// Finished reads past this frame's upload limit
+
+	Stats m_Stats;
+	uint32_t m_LoadingCount = 0;
+	double m_TotalLatencyMs = 0.0;
+};
@@ -0,0 +1,12 @@
+#version 450 core
+
+layout(binding = 0) uniform sampler2D uTexture;
+
+in vec2 vTexCoord;
+in vec4 vColor;
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = texture(uTexture, vTexCoord) * vColor;
+}
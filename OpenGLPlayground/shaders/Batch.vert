@@ -0,0 +1,28 @@
+#version 450 core
+
+#include "UniformBlocks.glsl"
+
+// Corner of the shared unit quad
+layout(location = 0) in vec2 aCorner;
+
+// Per instance: rows of a 3x4 affine transform, UV rectangle, colour and array layer
+layout(location = 1) in vec4 iRow0;
+layout(location = 2) in vec4 iRow1;
+layout(location = 3) in vec4 iRow2;
+layout(location = 4) in vec4 iUVRect;
+layout(location = 5) in vec4 iColor;
+layout(location = 6) in uint iLayer;
+
+out vec2 vTexCoord;
+out vec4 vColor;
+flat out uint vLayer;
+
+void main()
+{
+	vec4 corner = vec4(aCorner, 0.0, 1.0);
+	vec3 world = vec3(dot(iRow0, corner), dot(iRow1, corner), dot(iRow2, corner));
+	gl_Position = uViewProjection * vec4(world, 1.0);
+	vTexCoord = iUVRect.xy + (aCorner + 0.5) * iUVRect.zw;
+	vColor = iColor;
+	vLayer = iLayer;
+}
@@ -0,0 +1,14 @@
+#version 450 core
+
+// Atlas images are layers of one array texture
+layout(binding = 0) uniform sampler2DArray uTexture;
+
+in vec2 vTexCoord;
+in vec4 vColor;
+flat in uint vLayer;
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = texture(uTexture, vec3(vTexCoord, float(vLayer))) * vColor;
+}
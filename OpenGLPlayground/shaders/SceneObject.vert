@@ -0,0 +1,21 @@
+#version 450 core
+
+#include "UniformBlocks.glsl"
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 2) in vec2 aTexCoord;
+
+// Advances once per instance; each indirect command's baseInstance selects
+// the object's matrix
+layout(location = 3) in mat4 aModel;
+
+out vec3 vColor;
+out vec2 vTexCoord;
+
+void main()
+{
+	gl_Position = uViewProjection * aModel * vec4(aPos, 1.0);
+	vColor = aColor;
+	vTexCoord = aTexCoord;
+}
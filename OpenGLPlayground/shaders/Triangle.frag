@@ -0,0 +1,16 @@
+#version 450 core
+
+#include "UniformBlocks.glsl"
+
+layout(binding = 0) uniform sampler2D uTexture;
+
+in vec3 vColor; // from vertex shader
+in vec2 vTexCoord; // from vertex shader
+out vec4 FragColor;
+
+void main()
+{
+	float factor = 0.5 + 0.5 * sin(uTime);
+	vec4 texColor = texture(uTexture, vTexCoord);
+	FragColor = vec4(vColor * factor, 1.0) * texColor;
+}
@@ -0,0 +1,19 @@
+#version 450 core
+
+#include "UniformBlocks.glsl"
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 2) in vec2 aTexCoord;
+
+out vec3 vColor; // to pass to fragment shader
+out vec2 vTexCoord; // to pass texture coord to fragment shader
+
+layout(location = 0) uniform mat4 uModel;
+
+void main()
+{
+	gl_Position = uViewProjection * uModel * vec4(aPos, 1.0);
+	vColor = aColor; // pass color to fragment shader
+	vTexCoord = aTexCoord; // pass texture coord to fragment shader
+}
@@ -0,0 +1,16 @@
+#version 450 core
+
+#include "UniformBlocks.glsl"
+#include "VirtualTexture.glsl"
+
+// Page cache; the page table is the storage block from VirtualTexture.glsl
+layout(binding = 0) uniform sampler2D uCache;
+
+in vec3 vColor; // from vertex shader
+in vec2 vTexCoord; // from vertex shader
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = SampleVirtualTexture(uCache, vTexCoord);
+}
@@ -0,0 +1,287 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	uint16_t PackRGB565(int r, int g, int b)
+	{
+		return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+	}
+
+	void UnpackRGB565(uint16_t color, int rgb[3])
+	{
+		const int r = (color >> 11) & 31;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	int DistanceSquared(const int* a, const uint8_t* b, int channels)
+	{
+		int sum = 0;
+		for (int c = 0; c < channels; ++c)
+		{
+			const int d = a[c] - b[c];
+			sum += d * d;
+		}
+		return sum;
+	}
+
+	void WriteLE16(uint8_t* out, uint16_t value)
+	{
+		out[0] = static_cast<uint8_t>(value);
+		out[1] = static_cast<uint8_t>(value >> 8);
+	}
+
+	void WriteLE32(uint8_t* out, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+			out[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+
+	// Little-endian bit writer for the 128-bit BC7 block
+	struct BitWriter
+	{
+		uint8_t* Out;
+		int Position = 0;
+
+		void Write(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++Position)
+			{
+				if (value & (1u << i))
+					Out[Position / 8] |= static_cast<uint8_t>(1u << (Position % 8));
+			}
+		}
+	};
+}
+
+void EncodeBC1Block(const uint8_t rgba[64], uint8_t out[8])
+{
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			minColor[c] = std::min<int>(minColor[c], rgba[i * 4 + c]);
+			maxColor[c] = std::max<int>(maxColor[c], rgba[i * 4 + c]);
+		}
+	}
+
+	// Pull the endpoints in slightly so the interpolated colours land inside the box
+	for (int c = 0; c < 3; ++c)
+	{
+		const int inset = (maxColor[c] - minColor[c]) / 16;
+		minColor[c] = std::min(255, minColor[c] + inset);
+		maxColor[c] = std::max(0, maxColor[c] - inset);
+	}
+
+	uint16_t color0 = PackRGB565(maxColor[0], maxColor[1], maxColor[2]);
+	uint16_t color1 = PackRGB565(minColor[0], minColor[1], minColor[2]);
+
+	// color0 > color1 selects the opaque 4-colour mode
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t best = 0;
+			int bestDistance = DistanceSquared(palette[0], &rgba[i * 4], 3);
+			for (uint32_t p = 1; p < 4; ++p)
+			{
+				const int distance = DistanceSquared(palette[p], &rgba[i * 4], 3);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (2 * i);
+		}
+	}
+
+	WriteLE16(out, color0);
+	WriteLE16(out + 2, color1);
+	WriteLE32(out + 4, indices);
+}
+
+void EncodeBC3Block(const uint8_t rgba[64], uint8_t out[16])
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		minAlpha = std::min<int>(minAlpha, rgba[i * 4 + 3]);
+		maxAlpha = std::max<int>(maxAlpha, rgba[i * 4 + 3]);
+	}
+
+	// alpha0 > alpha1 selects the 8-value interpolation mode
+	out[0] = static_cast<uint8_t>(maxAlpha);
+	out[1] = static_cast<uint8_t>(minAlpha);
+
+	uint64_t alphaIndices = 0;
+	if (maxAlpha != minAlpha)
+	{
+		int palette[8];
+		palette[0] = maxAlpha;
+		palette[1] = minAlpha;
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			uint64_t best = 0;
+			int bestDistance = 256;
+			for (uint64_t p = 0; p < 8; ++p)
+			{
+				const int distance = std::abs(palette[p] - rgba[i * 4 + 3]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			alphaIndices |= best << (3 * i);
+		}
+	}
+
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = static_cast<uint8_t>(alphaIndices >> (8 * i));
+
+	EncodeBC1Block(rgba, out + 8);
+}
+
+void EncodeBC7Block(const uint8_t rgba[64], uint8_t out[16])
+{
+	static constexpr int Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	int endpoints[2][4] = { { 255, 255, 255, 255 }, { 0, 0, 0, 0 } };
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = std::min<int>(endpoints[0][c], rgba[i * 4 + c]);
+			endpoints[1][c] = std::max<int>(endpoints[1][c], rgba[i * 4 + c]);
+		}
+	}
+
+	// Endpoints are 7 bits per channel plus a shared p-bit as the low bit.
+	// Pick the p-bit that reproduces each endpoint most closely.
+	int quantized[2][4];
+	int pBits[2];
+	int decoded[2][4];
+	for (int e = 0; e < 2; ++e)
+	{
+		int bestError = -1;
+		for (int p = 0; p < 2; ++p)
+		{
+			int error = 0;
+			int candidate[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = std::clamp((endpoints[e][c] - p + 1) >> 1, 0, 127);
+				const int d = ((candidate[c] << 1) | p) - endpoints[e][c];
+				error += d * d;
+			}
+
+			if (bestError < 0 || error < bestError)
+			{
+				bestError = error;
+				pBits[e] = p;
+				std::memcpy(quantized[e], candidate, sizeof(candidate));
+			}
+		}
+
+		for (int c = 0; c < 4; ++c)
+			decoded[e][c] = (quantized[e][c] << 1) | pBits[e];
+	}
+
+	int palette[16][4];
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+			palette[i][c] = ((64 - Weights[i]) * decoded[0][c] + Weights[i] * decoded[1][c] + 32) >> 6;
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		int best = 0;
+		int bestDistance = DistanceSquared(palette[0], &rgba[i * 4], 4);
+		for (int p = 1; p < 16; ++p)
+		{
+			const int distance = DistanceSquared(palette[p], &rgba[i * 4], 4);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = p;
+			}
+		}
+		indices[i] = best;
+	}
+
+	// The anchor index is stored with its top bit implied zero; swap endpoints if needed
+	if (indices[0] & 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (int& index : indices)
+			index = 15 - index;
+	}
+
+	std::memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.Write(1u << 6, 7); // Mode 6
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.Write(static_cast<uint32_t>(quantized[0][c]), 7);
+		writer.Write(static_cast<uint32_t>(quantized[1][c]), 7);
+	}
+	writer.Write(static_cast<uint32_t>(pBits[0]), 1);
+	writer.Write(static_cast<uint32_t>(pBits[1]), 1);
+	writer.Write(static_cast<uint32_t>(indices[0]), 3);
+	for (int i = 1; i < 16; ++i)
+		writer.Write(static_cast<uint32_t>(indices[i]), 4);
+}
+
+void EncodeImageBlocks(const uint8_t* rgba, uint32_t width, uint32_t height,
+	BlockEncoder encoder, uint32_t blockBytes, uint8_t* out)
+{
+	uint8_t block[64];
+	for (uint32_t by = 0; by < height; by += 4)
+	{
+		for (uint32_t bx = 0; bx < width; bx += 4)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint32_t sy = std::min(by + y, height - 1);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint32_t sx = std::min(bx + x, width - 1);
+					std::memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+				}
+			}
+
+			encoder(block, out);
+			out += blockBytes;
+		}
+	}
+}
@@ -0,0 +1,364 @@
+#include "MeshCooker.h"
+
+#include "Hash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Parse up to 'maxCount' floats; returns how many there were
+	int ParseFloats(const char*& cursor, float* values, int maxCount)
+	{
+		int count = 0;
+		while (count < maxCount)
+		{
+			char* end = nullptr;
+			const float value = std::strtof(cursor, &end);
+			if (end == cursor)
+				break;
+			values[count++] = value;
+			cursor = end;
+		}
+		return count;
+	}
+
+	// OBJ indices are 1-based, or negative to count back from the latest element
+	bool ResolveIndex(long index, size_t count, uint32_t& resolved)
+	{
+		const long long value = index < 0 ? static_cast<long long>(count) + index : index - 1;
+		if (value < 0 || value >= static_cast<long long>(count))
+			return false;
+		resolved = static_cast<uint32_t>(value);
+		return true;
+	}
+
+	bool ParseObj(const std::string& text, const std::string& name, MeshData& mesh)
+	{
+		mesh.Vertices.clear();
+		mesh.Indices.clear();
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<glm::vec2> texCoords;
+
+		// (position, texcoord) pairs already turned into vertices
+		std::unordered_map<uint64_t, uint32_t> shared;
+		std::vector<uint32_t> face;
+		std::string line;
+
+		size_t lineStart = 0;
+		size_t lineNumber = 0;
+		while (lineStart < text.size())
+		{
+			size_t lineEnd = text.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = text.size();
+			line.assign(text, lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 1;
+			++lineNumber;
+
+			const char* cursor = line.c_str();
+			while (*cursor == ' ' || *cursor == '\t')
+				++cursor;
+
+			if (cursor[0] == 'v' && cursor[1] == ' ')
+			{
+				cursor += 2;
+				float values[6];
+				const int count = ParseFloats(cursor, values, 6);
+				if (count < 3)
+				{
+					std::cerr << name << ":" << lineNumber << ": vertex needs three coordinates" << std::endl;
+					return false;
+				}
+				positions.emplace_back(values[0], values[1], values[2]);
+				colors.push_back(count >= 6 ? glm::vec3(values[3], values[4], values[5]) : glm::vec3(1.0f));
+			}
+			else if (cursor[0] == 'v' && cursor[1] == 't' && cursor[2] == ' ')
+			{
+				cursor += 3;
+				float values[2] = {};
+				if (ParseFloats(cursor, values, 2) < 1)
+				{
+					std::cerr << name << ":" << lineNumber << ": texture coordinate has no values" << std::endl;
+					return false;
+				}
+				texCoords.emplace_back(values[0], values[1]);
+			}
+			else if (cursor[0] == 'f' && cursor[1] == ' ')
+			{
+				cursor += 2;
+				face.clear();
+				while (true)
+				{
+					while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')
+						++cursor;
+					if (*cursor == '\0')
+						break;
+
+					// p, p/t, p//n or p/t/n; normals are not used
+					char* end = nullptr;
+					uint32_t position = 0;
+					if (!ResolveIndex(std::strtol(cursor, &end, 10), positions.size(), position) || end == cursor)
+					{
+						std::cerr << name << ":" << lineNumber << ": bad position index" << std::endl;
+						return false;
+					}
+					cursor = end;
+
+					uint32_t texCoord = ~0u;
+					if (*cursor == '/' && cursor[1] != '/')
+					{
+						++cursor;
+						if (!ResolveIndex(std::strtol(cursor, &end, 10), texCoords.size(), texCoord) || end == cursor)
+						{
+							std::cerr << name << ":" << lineNumber << ": bad texture coordinate index" << std::endl;
+							return false;
+						}
+						cursor = end;
+					}
+					while (*cursor != '\0' && !std::isspace(static_cast<unsigned char>(*cursor)))
+						++cursor;
+
+					const uint64_t key = (static_cast<uint64_t>(position) << 32) | texCoord;
+					auto [it, inserted] = shared.try_emplace(key, static_cast<uint32_t>(mesh.Vertices.size()));
+					if (inserted)
+					{
+						MeshVertex vertex;
+						vertex.Position = positions[position];
+						vertex.Color = colors[position];
+						if (texCoord != ~0u)
+							vertex.TexCoord = texCoords[texCoord];
+						mesh.Vertices.push_back(vertex);
+					}
+					face.push_back(it->second);
+				}
+
+				// Fan out polygons
+				for (size_t corner = 2; corner < face.size(); ++corner)
+				{
+					mesh.Indices.push_back(face[0]);
+					mesh.Indices.push_back(face[corner - 1]);
+					mesh.Indices.push_back(face[corner]);
+				}
+			}
+		}
+
+		if (mesh.Indices.empty())
+		{
+			std::cerr << name << ": no faces" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool IsUpToDate(const std::string& outputPath, uint64_t sourceHash)
+	{
+		std::ifstream file(outputPath, std::ios::binary);
+		CookedMeshHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+
+		return header.Magic == CookedMeshHeader::MagicValue
+			&& header.Version == CookedMeshHeader::CurrentVersion
+			&& header.SourceHash == sourceHash;
+	}
+}
+
+bool LoadObjMesh(const std::string& path, MeshData& mesh)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open source mesh: " << path << std::endl;
+		return false;
+	}
+
+	const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return ParseObj(text, path, mesh);
+}
+
+std::vector<unsigned char> CookMeshData(MeshData& mesh, const MeshCookSettings& settings, uint64_t sourceHash, MeshCookStats* stats)
+{
+	const size_t indexCount = mesh.Indices.size() / 3 * 3;
+	mesh.Indices.resize(indexCount);
+
+	if (stats)
+	{
+		*stats = MeshCookStats();
+		stats->Before = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), indexCount, mesh.Vertices.size());
+	}
+
+	// The overdraw pass only moves whole cache-friendly runs, so it needs the cache pass first
+	if (settings.OptimizeVertexCache)
+	{
+		MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), indexCount, mesh.Vertices.size());
+
+		if (settings.OptimizeOverdraw)
+		{
+			std::vector<glm::vec3> positions(mesh.Vertices.size());
+			for (size_t i = 0; i < positions.size(); ++i)
+				positions[i] = mesh.Vertices[i].Position;
+
+			MeshOptimizer::OptimizeOverdraw(mesh.Indices.data(), indexCount, positions.data(), positions.size(),
+				settings.OverdrawThreshold);
+		}
+	}
+
+	// Vertices in first-use order; unreferenced ones are dropped
+	std::vector<uint32_t> remap(mesh.Vertices.size());
+	const size_t vertexCount = MeshOptimizer::OptimizeVertexFetch(mesh.Indices.data(), indexCount, mesh.Vertices.size(), remap.data());
+	{
+		std::vector<MeshVertex> reordered(vertexCount);
+		for (size_t i = 0; i < remap.size(); ++i)
+		{
+			if (remap[i] != MeshOptimizer::UnusedVertex)
+				reordered[remap[i]] = mesh.Vertices[i];
+		}
+		mesh.Vertices = std::move(reordered);
+	}
+
+	if (stats)
+		stats->After = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), indexCount, vertexCount);
+
+	glm::vec3 boundsMin(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	if (vertexCount > 0)
+	{
+		boundsMin = boundsMax = mesh.Vertices[0].Position;
+		for (const MeshVertex& vertex : mesh.Vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.Position);
+			boundsMax = glm::max(boundsMax, vertex.Position);
+		}
+	}
+
+	CookedMeshHeader header;
+	header.PositionFormat = settings.PositionFormat;
+	header.IndexSize = vertexCount <= 65536 ? 2 : 4;
+	header.VertexCount = static_cast<uint32_t>(vertexCount);
+	header.IndexCount = static_cast<uint32_t>(indexCount);
+	header.SourceHash = sourceHash;
+	header.DataOffset = AlignUp(sizeof(CookedMeshHeader), 16);
+	header.IndexOffset = 0;
+	header.VertexOffset = AlignUp(indexCount * header.IndexSize, 16);
+	header.DataSize = header.VertexOffset + vertexCount * sizeof(CookedMeshVertex);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.BoundsMin[axis] = boundsMin[axis];
+		header.BoundsMax[axis] = boundsMax[axis];
+	}
+
+	std::vector<unsigned char> output(header.DataOffset + header.DataSize, 0);
+	std::memcpy(output.data(), &header, sizeof(header));
+
+	unsigned char* indexData = output.data() + header.DataOffset + header.IndexOffset;
+	if (header.IndexSize == 2)
+	{
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const uint16_t index = static_cast<uint16_t>(mesh.Indices[i]);
+			std::memcpy(indexData + i * 2, &index, 2);
+		}
+	}
+	else
+	{
+		std::memcpy(indexData, mesh.Indices.data(), indexCount * 4);
+	}
+
+	// Same centre and extent as CookedMesh::GetDequantizeTransform()
+	const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	const glm::vec3 extent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-20f));
+
+	auto* vertices = reinterpret_cast<CookedMeshVertex*>(output.data() + header.DataOffset + header.VertexOffset);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const MeshVertex& source = mesh.Vertices[i];
+		CookedMeshVertex& cooked = vertices[i];
+
+		if (settings.PositionFormat == CookedPositionFormat::Half)
+			cooked.Position = glm::packHalf4x16(glm::vec4(source.Position, 0.0f));
+		else
+			cooked.Position = glm::packSnorm4x16(glm::vec4((source.Position - center) / extent, 0.0f));
+
+		cooked.Color = glm::packUnorm4x8(glm::vec4(source.Color, 1.0f));
+
+		const glm::vec2 texCoord = glm::clamp(source.TexCoord, glm::vec2(0.0f), glm::vec2(1.0f));
+		if (stats && texCoord != source.TexCoord)
+			++stats->ClampedTexCoords;
+		cooked.TexCoord = glm::packUnorm2x16(texCoord);
+	}
+
+	return output;
+}
+
+CookResult CookMesh(const std::string& sourcePath, const std::string& outputPath, const MeshCookSettings& settings, MeshCookStats* stats)
+{
+	std::ifstream sourceFile(sourcePath, std::ios::binary);
+	if (!sourceFile)
+	{
+		std::cerr << "Failed to open source mesh: " << sourcePath << std::endl;
+		return CookResult::Failed;
+	}
+
+	const std::string source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+
+	// Key on content and every setting that affects the output
+	uint64_t hash = HashBytes(source.data(), source.size());
+	hash = HashValue(settings.PositionFormat, hash);
+	hash = HashValue(settings.OptimizeVertexCache, hash);
+	hash = HashValue(settings.OptimizeOverdraw, hash);
+	hash = HashValue(settings.OverdrawThreshold, hash);
+	hash = HashValue(CookedMeshHeader::CurrentVersion, hash);
+
+	if (!settings.Force && IsUpToDate(outputPath, hash))
+		return CookResult::UpToDate;
+
+	MeshData mesh;
+	if (!ParseObj(source, sourcePath, mesh))
+		return CookResult::Failed;
+
+	const std::vector<unsigned char> cooked = CookMeshData(mesh, settings, hash, stats);
+
+	std::filesystem::path outputDirectory = std::filesystem::path(outputPath).parent_path();
+	if (!outputDirectory.empty())
+		std::filesystem::create_directories(outputDirectory);
+
+	// Write to a temporary file first so a running game never maps a half-written mesh
+	const std::string tempPath = outputPath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(cooked.data()), static_cast<std::streamsize>(cooked.size()));
+
+		if (!out)
+		{
+			std::cerr << "Failed to write cooked mesh: " << outputPath << std::endl;
+			return CookResult::Failed;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, outputPath, error);
+	if (error)
+	{
+		std::cerr << "Failed to move cooked mesh into place: " << outputPath << std::endl;
+		return CookResult::Failed;
+	}
+
+	return CookResult::Cooked;
+}
@@ -0,0 +1,384 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	// FIFO cache keyed on when each vertex was last loaded
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint32_t cacheSize)
+			: m_Timestamps(vertexCount, 0), m_CacheSize(cacheSize), m_Time(cacheSize + 1)
+		{
+		}
+
+		// Returns the number of misses for one triangle
+		uint32_t Access(const uint32_t* triangle)
+		{
+			uint32_t misses = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = triangle[corner];
+				if (m_Time - m_Timestamps[vertex] > m_CacheSize)
+				{
+					m_Timestamps[vertex] = m_Time++;
+					++misses;
+				}
+			}
+			return misses;
+		}
+
+		// Forget everything, as if the triangles that follow started a new draw
+		void Flush() { m_Time += m_CacheSize + 1; }
+
+	private:
+		std::vector<uint32_t> m_Timestamps;
+		uint32_t m_CacheSize;
+		uint32_t m_Time;
+	};
+
+	// Forsyth's scoring, for an LRU of 32 entries
+	constexpr int ForsythCacheSize = 32;
+	constexpr int ForsythMaxValence = 64;
+
+	struct ForsythTables
+	{
+		float Cache[ForsythCacheSize + 3];
+		float Valence[ForsythMaxValence];
+
+		ForsythTables()
+		{
+			for (int position = 0; position < ForsythCacheSize + 3; ++position)
+			{
+				if (position < 3)
+				{
+					// The last triangle's vertices score the same whichever order it used
+					Cache[position] = 0.75f;
+				}
+				else if (position < ForsythCacheSize)
+				{
+					const float scale = 1.0f / (ForsythCacheSize - 3);
+					Cache[position] = std::pow(1.0f - (position - 3) * scale, 1.5f);
+				}
+				else
+				{
+					Cache[position] = 0.0f;
+				}
+			}
+
+			// Favour vertices with few triangles left, so they leave the mesh early
+			for (int valence = 0; valence < ForsythMaxValence; ++valence)
+				Valence[valence] = valence == 0 ? 0.0f : 2.0f / std::sqrt(static_cast<float>(valence));
+		}
+
+		float Score(int cachePosition, uint32_t remaining) const
+		{
+			if (remaining == 0)
+				return -1.0f;
+
+			const float cacheScore = cachePosition < 0 ? 0.0f : Cache[cachePosition];
+			return cacheScore + Valence[std::min<uint32_t>(remaining, ForsythMaxValence - 1)];
+		}
+	};
+}
+
+namespace MeshOptimizer
+{
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStats stats;
+		if (indexCount < 3)
+			return stats;
+
+		FifoCache cache(vertexCount, cacheSize);
+		std::vector<bool> referenced(vertexCount, false);
+		size_t misses = 0;
+		size_t unique = 0;
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			misses += cache.Access(indices + i);
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (!referenced[indices[i + corner]])
+				{
+					referenced[indices[i + corner]] = true;
+					++unique;
+				}
+			}
+		}
+
+		stats.Acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+		stats.Atvr = static_cast<float>(misses) / static_cast<float>(unique);
+		return stats;
+	}
+
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+	{
+		static const ForsythTables tables;
+
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Triangles around each vertex, packed
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			++remaining[indices[i]];
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+			adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + remaining[vertex];
+
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+					adjacency[fill[indices[triangle * 3 + corner]]++] = static_cast<uint32_t>(triangle);
+			}
+		}
+
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+			vertexScores[vertex] = tables.Score(-1, remaining[vertex]);
+
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			const uint32_t* corners = indices + triangle * 3;
+			triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+		}
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3);
+
+		// Three more than the cache, for the vertices of the triangle being added
+		uint32_t cache[ForsythCacheSize + 3];
+		uint32_t newCache[ForsythCacheSize + 3];
+		int cacheCount = 0;
+
+		size_t scanCursor = 0;
+		size_t bestTriangle = 0;
+		float bestScore = triangleScores[0];
+		for (size_t triangle = 1; triangle < triangleCount; ++triangle)
+		{
+			if (triangleScores[triangle] > bestScore)
+			{
+				bestScore = triangleScores[triangle];
+				bestTriangle = triangle;
+			}
+		}
+
+		for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+		{
+			if (bestScore < 0.0f)
+			{
+				// Nothing in the cache touches a live triangle: take the next one in input order
+				while (emitted[scanCursor])
+					++scanCursor;
+				bestTriangle = scanCursor;
+			}
+
+			const uint32_t* corners = indices + bestTriangle * 3;
+			output.insert(output.end(), corners, corners + 3);
+			emitted[bestTriangle] = true;
+
+			// Its vertices move to the front; the rest keep their order behind them
+			int newCount = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = corners[corner];
+				newCache[newCount++] = vertex;
+
+				// Drop the triangle from the vertex's list of live triangles
+				uint32_t* first = adjacency.data() + adjacencyOffsets[vertex];
+				uint32_t* last = first + remaining[vertex];
+				*std::find(first, last, static_cast<uint32_t>(bestTriangle)) = *(last - 1);
+				--remaining[vertex];
+			}
+			for (int i = 0; i < cacheCount; ++i)
+			{
+				const uint32_t vertex = cache[i];
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+					newCache[newCount++] = vertex;
+			}
+
+			// Rescore everything that was or is in the cache, and the triangles around it
+			for (int i = 0; i < newCount; ++i)
+			{
+				const uint32_t vertex = newCache[i];
+				const int position = i < ForsythCacheSize ? i : -1;
+
+				const float score = tables.Score(position, remaining[vertex]);
+				const float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				const uint32_t* live = adjacency.data() + adjacencyOffsets[vertex];
+				for (uint32_t t = 0; t < remaining[vertex]; ++t)
+					triangleScores[live[t]] += delta;
+			}
+
+			// The next triangle is the best one touching the cache
+			bestScore = -1.0f;
+			for (int i = 0; i < std::min(newCount, ForsythCacheSize); ++i)
+			{
+				const uint32_t vertex = newCache[i];
+				const uint32_t* live = adjacency.data() + adjacencyOffsets[vertex];
+				for (uint32_t t = 0; t < remaining[vertex]; ++t)
+				{
+					if (triangleScores[live[t]] > bestScore)
+					{
+						bestScore = triangleScores[live[t]];
+						bestTriangle = live[t];
+					}
+				}
+			}
+
+			cacheCount = std::min(newCount, ForsythCacheSize);
+			std::copy(newCache, newCache + cacheCount, cache);
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, float threshold)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+			return;
+
+		constexpr uint32_t CacheSize = 16;
+
+		// Hard boundaries: triangles where the cache misses on every corner,
+		// so drawing from there on costs the same wherever it goes
+		std::vector<size_t> hardBoundaries;
+		{
+			FifoCache cache(vertexCount, CacheSize);
+			for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+			{
+				if (cache.Access(indices + triangle * 3) == 3)
+					hardBoundaries.push_back(triangle);
+			}
+		}
+		hardBoundaries.push_back(triangleCount);
+
+		// Soft boundaries: split a run again wherever its prefix, drawn from a
+		// cold cache, is within 'threshold' of the whole run's ACMR
+		std::vector<size_t> clusters;
+		{
+			FifoCache cache(vertexCount, CacheSize);
+			for (size_t run = 0; run + 1 < hardBoundaries.size(); ++run)
+			{
+				const size_t begin = hardBoundaries[run];
+				const size_t end = hardBoundaries[run + 1];
+
+				cache.Flush();
+				size_t runMisses = 0;
+				for (size_t triangle = begin; triangle < end; ++triangle)
+					runMisses += cache.Access(indices + triangle * 3);
+				const float target = threshold * static_cast<float>(runMisses) / static_cast<float>(end - begin);
+
+				cache.Flush();
+				size_t clusterStart = begin;
+				size_t misses = 0;
+				clusters.push_back(begin);
+				for (size_t triangle = begin; triangle + 1 < end; ++triangle)
+				{
+					misses += cache.Access(indices + triangle * 3);
+					const size_t drawn = triangle + 1 - clusterStart;
+					if (static_cast<float>(misses) <= target * static_cast<float>(drawn))
+					{
+						cache.Flush();
+						clusterStart = triangle + 1;
+						misses = 0;
+						clusters.push_back(clusterStart);
+					}
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		// Mesh centre, weighted by triangle area
+		glm::dvec3 meshCenter(0.0);
+		double meshArea = 0.0;
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			const glm::vec3& a = positions[indices[triangle * 3 + 0]];
+			const glm::vec3& b = positions[indices[triangle * 3 + 1]];
+			const glm::vec3& c = positions[indices[triangle * 3 + 2]];
+			const double area = glm::length(glm::cross(b - a, c - a));
+			meshCenter += glm::dvec3((a + b + c) / 3.0f) * area;
+			meshArea += area;
+		}
+		meshCenter = meshArea > 0.0 ? meshCenter / meshArea : glm::dvec3(0.0);
+
+		// Clusters that sit far out along their own average normal are likely
+		// to cover others, so they go first
+		struct Cluster
+		{
+			size_t Begin;
+			size_t End;
+			float Key;
+		};
+		std::vector<Cluster> sorted;
+		sorted.reserve(clusters.size() - 1);
+		for (size_t cluster = 0; cluster + 1 < clusters.size(); ++cluster)
+		{
+			const size_t begin = clusters[cluster];
+			const size_t end = clusters[cluster + 1];
+
+			glm::dvec3 center(0.0);
+			glm::dvec3 normal(0.0);
+			double area = 0.0;
+			for (size_t triangle = begin; triangle < end; ++triangle)
+			{
+				const glm::vec3& a = positions[indices[triangle * 3 + 0]];
+				const glm::vec3& b = positions[indices[triangle * 3 + 1]];
+				const glm::vec3& c = positions[indices[triangle * 3 + 2]];
+				const glm::dvec3 areaNormal = glm::dvec3(glm::cross(b - a, c - a));
+				const double triangleArea = glm::length(areaNormal);
+				center += glm::dvec3((a + b + c) / 3.0f) * triangleArea;
+				normal += areaNormal;
+				area += triangleArea;
+			}
+
+			float key = 0.0f;
+			const double normalLength = glm::length(normal);
+			if (area > 0.0 && normalLength > 0.0)
+				key = static_cast<float>(glm::dot(center / area - meshCenter, normal / normalLength));
+
+			sorted.push_back({ begin, end, key });
+		}
+
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.Key > b.Key; });
+
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3);
+		for (const Cluster& cluster : sorted)
+			output.insert(output.end(), indices + cluster.Begin * 3, indices + cluster.End * 3);
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t* remap)
+	{
+		std::fill(remap, remap + vertexCount, UnusedVertex);
+
+		uint32_t next = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t& index = indices[i];
+			if (remap[index] == UnusedVertex)
+				remap[index] = next++;
+			index = remap[index];
+		}
+
+		return next;
+	}
+}
@@ -0,0 +1,177 @@
+#include "TextureCooker.h"
+
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "ImageOps.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include <stb_image.h>
+
+namespace
+{
+	struct Image
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		std::vector<uint8_t> Pixels; // RGBA8
+	};
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	Image Downsample(const Image& source, ImageOps::MipFilter filter)
+	{
+		Image result;
+		result.Width = ImageOps::MipSize(source.Width);
+		result.Height = ImageOps::MipSize(source.Height);
+		result.Pixels.resize(static_cast<size_t>(result.Width) * result.Height * 4);
+
+		ImageOps::Downsample(source.Pixels.data(), source.Width, source.Height, result.Pixels.data(), filter);
+		return result;
+	}
+
+	std::vector<uint8_t> EncodeLevel(const Image& level, CookedFormat format)
+	{
+		std::vector<uint8_t> data(GetCookedLevelSize(format, level.Width, level.Height));
+		switch (format)
+		{
+		case CookedFormat::BC1:
+			EncodeImageBlocks(level.Pixels.data(), level.Width, level.Height, EncodeBC1Block, 8, data.data());
+			break;
+		case CookedFormat::BC3:
+			EncodeImageBlocks(level.Pixels.data(), level.Width, level.Height, EncodeBC3Block, 16, data.data());
+			break;
+		case CookedFormat::BC7:
+			EncodeImageBlocks(level.Pixels.data(), level.Width, level.Height, EncodeBC7Block, 16, data.data());
+			break;
+		default:
+			data = level.Pixels;
+			break;
+		}
+		return data;
+	}
+
+	bool IsUpToDate(const std::string& outputPath, uint64_t sourceHash)
+	{
+		std::ifstream file(outputPath, std::ios::binary);
+		CookedTextureHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+
+		return header.Magic == CookedTextureHeader::MagicValue
+			&& header.Version == CookedTextureHeader::CurrentVersion
+			&& header.SourceHash == sourceHash;
+	}
+}
+
+CookResult CookTexture(const std::string& sourcePath, const std::string& outputPath, const TextureCookSettings& settings)
+{
+	std::ifstream sourceFile(sourcePath, std::ios::binary);
+	if (!sourceFile)
+	{
+		std::cerr << "Failed to open source image: " << sourcePath << std::endl;
+		return CookResult::Failed;
+	}
+
+	const std::vector<uint8_t> source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+
+	// Key on content and every setting that affects the output
+	uint64_t hash = HashBytes(source.data(), source.size());
+	hash = HashValue(settings.Format, hash);
+	hash = HashValue(settings.GenerateMips, hash);
+	hash = HashValue(settings.Filter, hash);
+	hash = HashValue(CookedTextureHeader::CurrentVersion, hash);
+
+	if (!settings.Force && IsUpToDate(outputPath, hash))
+		return CookResult::UpToDate;
+
+	// Match the runtime loader, which unpremultiplies on load
+	stbi_set_unpremultiply_on_load_thread(1);
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		std::cerr << "Failed to decode " << sourcePath << " (" << stbi_failure_reason() << ")" << std::endl;
+		return CookResult::Failed;
+	}
+
+	std::vector<Image> levels(1);
+	levels[0].Width = static_cast<uint32_t>(width);
+	levels[0].Height = static_cast<uint32_t>(height);
+	levels[0].Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+
+	if (settings.GenerateMips)
+	{
+		while ((levels.back().Width > 1 || levels.back().Height > 1) && levels.size() < CookedTextureHeader::MaxMipLevels)
+		{
+			levels.push_back(Downsample(levels.back(), settings.Filter));
+		}
+	}
+
+	CookedTextureHeader header;
+	header.Format = settings.Format;
+	header.Width = levels[0].Width;
+	header.Height = levels[0].Height;
+	header.MipCount = static_cast<uint32_t>(levels.size());
+	header.SourceHash = hash;
+
+	std::vector<std::vector<uint8_t>> encoded;
+	size_t offset = AlignUp(sizeof(CookedTextureHeader), 16);
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		encoded.push_back(EncodeLevel(levels[i], settings.Format));
+
+		CookedMipLevel& mip = header.Mips[i];
+		mip.Offset = offset;
+		mip.Size = encoded.back().size();
+		mip.Width = levels[i].Width;
+		mip.Height = levels[i].Height;
+
+		offset = AlignUp(offset + encoded.back().size(), 16);
+	}
+
+	std::filesystem::path outputDirectory = std::filesystem::path(outputPath).parent_path();
+	if (!outputDirectory.empty())
+		std::filesystem::create_directories(outputDirectory);
+
+	// Write to a temporary file first so a running game never maps a half-written texture
+	const std::string tempPath = outputPath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (size_t i = 0; i < encoded.size(); ++i)
+		{
+			out.seekp(static_cast<std::streamoff>(header.Mips[i].Offset));
+			out.write(reinterpret_cast<const char*>(encoded[i].data()), static_cast<std::streamsize>(encoded[i].size()));
+		}
+
+		if (!out)
+		{
+			std::cerr << "Failed to write cooked texture: " << outputPath << std::endl;
+			return CookResult::Failed;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, outputPath, error);
+	if (error)
+	{
+		std::cerr << "Failed to move cooked texture into place: " << outputPath << std::endl;
+		return CookResult::Failed;
+	}
+
+	return CookResult::Cooked;
+}
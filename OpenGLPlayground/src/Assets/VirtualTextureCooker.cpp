@@ -0,0 +1,346 @@
+#include "VirtualTextureCooker.h"
+
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "ImageOps.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <stb_image.h>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	uint64_t HashSettings(uint64_t sourceHash, uint32_t width, uint32_t height, const VirtualTextureCookSettings& settings)
+	{
+		uint64_t hash = HashValue(width, sourceHash);
+		hash = HashValue(height, hash);
+		hash = HashValue(settings.Format, hash);
+		hash = HashValue(settings.PageSize, hash);
+		hash = HashValue(settings.Border, hash);
+		return HashValue(VirtualTextureHeader::CurrentVersion, hash);
+	}
+
+	bool IsUpToDate(const std::string& outputPath, uint64_t hash)
+	{
+		std::ifstream file(outputPath, std::ios::binary);
+		VirtualTextureHeader header;
+		return ReadVirtualTextureHeader(file, header) && header.SourceHash == hash;
+	}
+
+	// Writes encoded pages to their fixed place in the page file
+	class PageWriter
+	{
+	public:
+		PageWriter(std::ofstream& out, const VirtualTextureHeader& header)
+			: m_Out(out), m_Header(header), m_Encoded(header.PageBytes)
+		{
+		}
+
+		void Write(uint32_t tileIndex, const uint8_t* page)
+		{
+			const uint32_t size = m_Header.PageSize;
+			const uint8_t* data = page;
+			switch (m_Header.Format)
+			{
+			case CookedFormat::BC1:
+				EncodeImageBlocks(page, size, size, EncodeBC1Block, 8, m_Encoded.data());
+				data = m_Encoded.data();
+				break;
+			case CookedFormat::BC3:
+				EncodeImageBlocks(page, size, size, EncodeBC3Block, 16, m_Encoded.data());
+				data = m_Encoded.data();
+				break;
+			case CookedFormat::BC7:
+				EncodeImageBlocks(page, size, size, EncodeBC7Block, 16, m_Encoded.data());
+				data = m_Encoded.data();
+				break;
+			default:
+				break;
+			}
+
+			m_Out.seekp(static_cast<std::streamoff>(m_Header.DataOffset + tileIndex * m_Header.PageBytes));
+			m_Out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(m_Header.PageBytes));
+		}
+
+	private:
+		std::ofstream& m_Out;
+		const VirtualTextureHeader& m_Header;
+		std::vector<uint8_t> m_Encoded;
+	};
+
+	// One level of the chain, fed a row at a time. Keeps the rows of the tile
+	// row being built plus its borders, writes the tile row's pages once its
+	// last row arrives, and passes box-filtered rows on to the next level.
+	class LevelBuilder
+	{
+	public:
+		LevelBuilder(const VirtualTextureHeader& header, uint32_t level, PageWriter& writer, LevelBuilder* next)
+			: m_Header(header), m_Info(header.Levels[level]), m_Writer(writer), m_Next(next),
+			m_RowBytes(static_cast<size_t>(m_Info.Width) * 4),
+			m_Page(static_cast<size_t>(header.PageSize) * header.PageSize * 4)
+		{
+			if (m_Next)
+			{
+				m_RowPair.resize(m_RowBytes * 2);
+				m_NextRow.resize(static_cast<size_t>(m_Next->m_Info.Width) * 4);
+			}
+		}
+
+		void PushRow(const uint8_t* row)
+		{
+			const uint32_t y = m_RowCount++;
+			m_Rows.emplace_back(row, row + m_RowBytes);
+
+			if (m_Next)
+			{
+				// Pairs of rows make one row of the next level; a single-row
+				// level still makes one, and an odd last row is dropped
+				std::memcpy(m_RowPair.data() + (y % 2) * m_RowBytes, row, m_RowBytes);
+				if (m_Info.Height == 1 || y % 2 == 1)
+				{
+					ImageOps::Downsample(m_RowPair.data(), m_Info.Width, m_Info.Height == 1 ? 1 : 2, m_NextRow.data());
+					m_Next->PushRow(m_NextRow.data());
+				}
+			}
+
+			while (m_TileRow < m_Info.TilesY && y >= GetLastRow(m_TileRow))
+			{
+				WriteTileRow(m_TileRow++);
+
+				// Rows above the next tile row's top border are done with
+				const int64_t keepFrom = static_cast<int64_t>(m_TileRow) * m_Header.TileSize - m_Header.Border;
+				while (!m_Rows.empty() && static_cast<int64_t>(m_FirstRow) < keepFrom)
+				{
+					m_Rows.pop_front();
+					++m_FirstRow;
+				}
+			}
+		}
+
+	private:
+		// Last source row a tile row's pages read, bottom border included
+		uint32_t GetLastRow(uint32_t tileRow) const
+		{
+			const uint64_t last = static_cast<uint64_t>(tileRow + 1) * m_Header.TileSize + m_Header.Border - 1;
+			return static_cast<uint32_t>(std::min<uint64_t>(last, m_Info.Height - 1));
+		}
+
+		void WriteTileRow(uint32_t tileY)
+		{
+			const int64_t tileSize = m_Header.TileSize;
+			const int64_t border = m_Header.Border;
+			const uint32_t pageSize = m_Header.PageSize;
+
+			for (uint32_t tileX = 0; tileX < m_Info.TilesX; ++tileX)
+			{
+				// Texels outside the level repeat its edge
+				for (uint32_t py = 0; py < pageSize; ++py)
+				{
+					const int64_t sourceY = std::clamp<int64_t>(tileY * tileSize + py - border, 0, m_Info.Height - 1);
+					const uint8_t* row = m_Rows[static_cast<size_t>(sourceY - m_FirstRow)].data();
+					uint8_t* out = m_Page.data() + static_cast<size_t>(py) * pageSize * 4;
+
+					const int64_t firstX = tileX * tileSize - border;
+					const int64_t begin = std::clamp<int64_t>(firstX, 0, m_Info.Width);
+					const int64_t end = std::clamp<int64_t>(firstX + pageSize, 0, m_Info.Width);
+					for (int64_t x = firstX; x < begin; ++x)
+						std::memcpy(out + (x - firstX) * 4, row, 4);
+					std::memcpy(out + (begin - firstX) * 4, row + begin * 4, static_cast<size_t>(end - begin) * 4);
+					for (int64_t x = end; x < firstX + pageSize; ++x)
+						std::memcpy(out + (x - firstX) * 4, row + (m_Info.Width - 1) * 4, 4);
+				}
+
+				m_Writer.Write(m_Info.FirstTile + tileY * m_Info.TilesX + tileX, m_Page.data());
+			}
+		}
+
+		const VirtualTextureHeader& m_Header;
+		const VirtualTextureLevel& m_Info;
+		PageWriter& m_Writer;
+		LevelBuilder* m_Next;
+		size_t m_RowBytes;
+
+		std::deque<std::vector<uint8_t>> m_Rows;
+		uint32_t m_FirstRow = 0;	// Level row held in m_Rows.front()
+		uint32_t m_RowCount = 0;
+		uint32_t m_TileRow = 0;
+
+		std::vector<uint8_t> m_RowPair;
+		std::vector<uint8_t> m_NextRow;
+		std::vector<uint8_t> m_Page;
+	};
+}
+
+CookResult CookVirtualTexture(uint32_t width, uint32_t height, const ImageRowSource& source, uint64_t sourceHash,
+	const std::string& outputPath, const VirtualTextureCookSettings& settings)
+{
+	if (width == 0 || height == 0 || settings.PageSize % 4 != 0 || settings.Border * 2 >= settings.PageSize)
+	{
+		std::cerr << "Invalid virtual texture settings for " << outputPath << std::endl;
+		return CookResult::Failed;
+	}
+
+	const uint64_t hash = HashSettings(sourceHash, width, height, settings);
+	if (!settings.Force && IsUpToDate(outputPath, hash))
+		return CookResult::UpToDate;
+
+	VirtualTextureHeader header;
+	header.Format = settings.Format;
+	header.Width = width;
+	header.Height = height;
+	header.TileSize = settings.PageSize - 2 * settings.Border;
+	header.Border = settings.Border;
+	header.PageSize = settings.PageSize;
+	header.PageBytes = GetCookedLevelSize(settings.Format, settings.PageSize, settings.PageSize);
+	header.SourceHash = hash;
+	header.DataOffset = AlignUp(sizeof(VirtualTextureHeader), 4096);
+
+	// Halve until a level fits in one tile
+	uint64_t tileCount = 0;
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	for (;;)
+	{
+		VirtualTextureLevel& level = header.Levels[header.LevelCount++];
+		level.Width = levelWidth;
+		level.Height = levelHeight;
+		level.TilesX = (levelWidth + header.TileSize - 1) / header.TileSize;
+		level.TilesY = (levelHeight + header.TileSize - 1) / header.TileSize;
+		level.FirstTile = static_cast<uint32_t>(tileCount);
+		tileCount += static_cast<uint64_t>(level.TilesX) * level.TilesY;
+
+		if ((levelWidth <= header.TileSize && levelHeight <= header.TileSize) || header.LevelCount == VirtualTextureHeader::MaxLevels)
+			break;
+
+		levelWidth = ImageOps::MipSize(levelWidth);
+		levelHeight = ImageOps::MipSize(levelHeight);
+	}
+
+	if (tileCount > UINT32_MAX)
+	{
+		std::cerr << "Too many tiles for a virtual texture: " << outputPath << std::endl;
+		return CookResult::Failed;
+	}
+	header.TileCount = static_cast<uint32_t>(tileCount);
+
+	std::filesystem::path outputDirectory = std::filesystem::path(outputPath).parent_path();
+	if (!outputDirectory.empty())
+		std::filesystem::create_directories(outputDirectory);
+
+	// Write to a temporary file first so a running game never opens a half-written page file
+	const std::string tempPath = outputPath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		PageWriter writer(out, header);
+		std::vector<std::unique_ptr<LevelBuilder>> levels(header.LevelCount);
+		for (uint32_t level = header.LevelCount; level-- > 0;)
+		{
+			LevelBuilder* next = level + 1 < header.LevelCount ? levels[level + 1].get() : nullptr;
+			levels[level] = std::make_unique<LevelBuilder>(header, level, writer, next);
+		}
+
+		std::vector<uint8_t> row(static_cast<size_t>(width) * 4);
+		for (uint32_t y = 0; y < height && out; ++y)
+		{
+			source(y, row.data());
+			levels[0]->PushRow(row.data());
+		}
+
+		if (!out)
+		{
+			std::cerr << "Failed to write virtual texture: " << outputPath << std::endl;
+			return CookResult::Failed;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, outputPath, error);
+	if (error)
+	{
+		std::cerr << "Failed to move virtual texture into place: " << outputPath << std::endl;
+		return CookResult::Failed;
+	}
+
+	return CookResult::Cooked;
+}
+
+CookResult CookVirtualTexture(const std::string& sourcePath, const std::string& outputPath, const VirtualTextureCookSettings& settings)
+{
+	std::ifstream sourceFile(sourcePath, std::ios::binary);
+	if (!sourceFile)
+	{
+		std::cerr << "Failed to open source image: " << sourcePath << std::endl;
+		return CookResult::Failed;
+	}
+
+	const std::vector<uint8_t> source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+	const uint64_t sourceHash = HashBytes(source.data(), source.size());
+
+	// The size is part of the key but is only known after decoding; read it from the header
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	if (!stbi_info_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels))
+	{
+		std::cerr << "Failed to decode " << sourcePath << " (" << stbi_failure_reason() << ")" << std::endl;
+		return CookResult::Failed;
+	}
+
+	if (!settings.Force && IsUpToDate(outputPath, HashSettings(sourceHash, static_cast<uint32_t>(width), static_cast<uint32_t>(height), settings)))
+		return CookResult::UpToDate;
+
+	// Match the runtime loader, which unpremultiplies on load
+	stbi_set_unpremultiply_on_load_thread(1);
+
+	unsigned char* pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		std::cerr << "Failed to decode " << sourcePath << " (" << stbi_failure_reason() << ")" << std::endl;
+		return CookResult::Failed;
+	}
+
+	const size_t rowBytes = static_cast<size_t>(width) * 4;
+	const CookResult result = CookVirtualTexture(static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+		[&](uint32_t y, uint8_t* row) { std::memcpy(row, pixels + y * rowBytes, rowBytes); },
+		sourceHash, outputPath, settings);
+
+	stbi_image_free(pixels);
+	return result;
+}
+
+void GetTestPatternRow(uint32_t width, uint32_t height, uint32_t y, uint8_t* row)
+{
+	for (uint32_t x = 0; x < width; ++x)
+	{
+		// Gradients across the whole image, a colour per 1024-texel cell, grid
+		// lines every 64 texels and a faint 8-texel checker
+		const uint32_t cell = (x / 1024) * 7 + (y / 1024) * 13;
+		const bool line = x % 64 == 0 || y % 64 == 0;
+		const int checker = ((x / 8 + y / 8) & 1) ? 16 : -16;
+
+		const int r = static_cast<int>(static_cast<uint64_t>(x) * 255 / std::max(width - 1, 1u));
+		const int g = static_cast<int>(static_cast<uint64_t>(y) * 255 / std::max(height - 1, 1u));
+		const int b = static_cast<int>(cell * 37 % 256);
+
+		uint8_t* texel = row + static_cast<size_t>(x) * 4;
+		texel[0] = static_cast<uint8_t>(line ? r / 4 : std::clamp(r + checker, 0, 255));
+		texel[1] = static_cast<uint8_t>(line ? g / 4 : std::clamp(g + checker, 0, 255));
+		texel[2] = static_cast<uint8_t>(line ? b / 4 : std::clamp(b + checker, 0, 255));
+		texel[3] = 255;
+	}
+}
@@ -0,0 +1,385 @@
+#include "FrameCapture.h"
+#include "FrameStats.h"
+#include "HeadlessContext.h"
+#include "ImageEncoders.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stb_image.h>
+
+// Measures what capturing every rendered frame costs the render loop. Usage:
+//   CaptureBenchmark [--size WxH] [--frames N] [--triangles N] [--encoders N] [--validate N]
+// The same animated scene is rendered in four modes:
+//   none   no capture
+//   sync   glReadPixels into client memory after each frame, the naive way
+//   png    FrameCapture writing a PNG per frame to cache/capture/png
+//   y4m    FrameCapture writing one Y4M stream to cache/capture/capture.y4m
+// For each, the table shows frame times and the slowdown against "none". The
+// asynchronous modes also report how long Capture() waited for a free slot
+// and the encoders' time per frame, which on a machine with spare cores runs
+// beside the render loop instead of in it.
+//
+// Afterwards the first N frames (default 8) are rendered again and read back
+// synchronously; the PNGs must decode to exactly those pixels, and the Y4M
+// frames must match their conversion.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const char* const PngDirectory = "cache/capture/png";
+	const char* const Y4mPath = "cache/capture/capture.y4m";
+
+	enum class Mode
+	{
+		None,
+		Sync,
+		Png,
+		Y4m,
+	};
+
+	const char* GetModeName(Mode mode)
+	{
+		switch (mode)
+		{
+		case Mode::None: return "none";
+		case Mode::Sync: return "sync";
+		case Mode::Png:  return "png";
+		case Mode::Y4m:  return "y4m";
+		}
+		return "";
+	}
+
+	GLuint CompileProgram()
+	{
+		// Spinning triangles scattered by instance, coloured by gradients, so
+		// frames have both flat areas and detail for the encoders
+		const char* vertexSource = R"(
+			#version 450 core
+			layout(location = 0) uniform float uFrame;
+			out vec3 vColor;
+			float Hash(float n) { return fract(sin(n) * 43758.5453); }
+			void main()
+			{
+				const float id = float(gl_InstanceID);
+				const vec2 center = vec2(Hash(id), Hash(id + 17.0)) * 2.2 - 1.1;
+				const float angle = uFrame * (0.01 + 0.05 * Hash(id + 31.0)) + float(gl_VertexID) * 2.0944;
+				const float size = 0.02 + 0.08 * Hash(id + 47.0);
+				gl_Position = vec4(center + size * vec2(cos(angle), sin(angle)), Hash(id + 59.0), 1.0);
+				vColor = vec3(Hash(id + 71.0), float(gl_VertexID) * 0.5, Hash(id + 83.0));
+			}
+		)";
+		const char* fragmentSource = R"(
+			#version 450 core
+			in vec3 vColor;
+			out vec4 FragColor;
+			void main()
+			{
+				FragColor = vec4(vColor, 1.0);
+			}
+		)";
+
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+		glCompileShader(vertexShader);
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+		glCompileShader(fragmentShader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[1024];
+			glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+			std::cerr << "Capture benchmark shader failed to link:\n" << infoLog << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	struct Scene
+	{
+		HeadlessContext* Context = nullptr;
+		GLuint Program = 0;
+		GLuint VertexArray = 0;
+		int Triangles = 0;
+	};
+
+	void DrawFrame(const Scene& scene, int frame)
+	{
+		scene.Context->BindFramebuffer();
+		glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+		glUseProgram(scene.Program);
+		glBindVertexArray(scene.VertexArray);
+		glProgramUniform1f(scene.Program, 0, static_cast<float>(frame));
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 3, scene.Triangles);
+	}
+
+	void ReadFrame(const Scene& scene, int width, int height, std::vector<uint8_t>& pixels)
+	{
+		pixels.resize(static_cast<size_t>(width) * height * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, scene.Context->GetFramebuffer());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	}
+
+	struct RunResult
+	{
+		FrameStats::Summary Summary;
+		FrameCapture::Stats Capture;
+		double FinishMs = 0.0;
+		unsigned Encoders = 0;
+	};
+
+	bool Run(const Scene& scene, Mode mode, int width, int height, int frames, unsigned encoders, RunResult& result)
+	{
+		FrameCapture capture;
+		if (mode == Mode::Png || mode == Mode::Y4m)
+		{
+			FrameCaptureSettings settings;
+			settings.Format = mode == Mode::Png ? CaptureFormat::Png : CaptureFormat::Y4m;
+			settings.Path = mode == Mode::Png ? PngDirectory : Y4mPath;
+			settings.EncoderThreads = encoders;
+			if (!capture.Initialize(width, height, settings))
+				return false;
+		}
+
+		std::vector<uint8_t> pixels;
+		FrameStats stats;
+		stats.Reserve(static_cast<size_t>(frames));
+
+		glFinish();
+		Clock::time_point last = Clock::now();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			DrawFrame(scene, frame);
+
+			if (mode == Mode::Sync)
+				ReadFrame(scene, width, height, pixels);
+			else if (mode != Mode::None)
+				capture.Capture(scene.Context->GetFramebuffer());
+
+			scene.Context->Present();
+
+			const Clock::time_point now = Clock::now();
+			stats.AddFrame(std::chrono::duration<double, std::milli>(now - last).count());
+			last = now;
+		}
+
+		const Clock::time_point finishStart = Clock::now();
+		const bool written = mode == Mode::None || mode == Mode::Sync || capture.Finish();
+		result.FinishMs = std::chrono::duration<double, std::milli>(Clock::now() - finishStart).count();
+		result.Summary = stats.Summarize();
+		result.Capture = capture.GetStats();
+		result.Encoders = capture.GetEncoderCount();
+		return written;
+	}
+
+	bool ComparePixels(const uint8_t* expected, const uint8_t* actual, size_t size, const std::string& what)
+	{
+		if (std::memcmp(expected, actual, size) != 0)
+		{
+			std::cerr << what << " does not match the synchronous readback" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// Render frames again with a blocking readback, and compare with what was captured
+	bool Validate(const Scene& scene, int width, int height, int frames)
+	{
+		const uint32_t w = static_cast<uint32_t>(width);
+		const uint32_t h = static_cast<uint32_t>(height);
+		const size_t rowBytes = w * 4;
+		const size_t yuvSize = ImageEncoders::GetYuv420Size(w, h);
+		const std::string y4mHeader = ImageEncoders::GetY4mHeader(w, h, 60);
+
+		std::ifstream y4m(Y4mPath, std::ios::binary);
+		std::string header(y4mHeader.size(), '\0');
+		y4m.read(header.data(), static_cast<std::streamsize>(header.size()));
+		if (header != y4mHeader)
+		{
+			std::cerr << "Y4M header is wrong" << std::endl;
+			return false;
+		}
+
+		std::vector<uint8_t> reference;
+		std::vector<uint8_t> expectedRgb(static_cast<size_t>(w) * h * 3);
+		std::vector<uint8_t> expectedYuv(yuvSize);
+		std::vector<uint8_t> capturedYuv(yuvSize);
+
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			DrawFrame(scene, frame);
+			ReadFrame(scene, width, height, reference);
+
+			// PNGs are top row first and RGB
+			for (uint32_t y = 0; y < h; ++y)
+			{
+				const uint8_t* source = reference.data() + (h - 1 - y) * rowBytes;
+				for (uint32_t x = 0; x < w; ++x)
+				{
+					expectedRgb[(static_cast<size_t>(y) * w + x) * 3 + 0] = source[x * 4 + 0];
+					expectedRgb[(static_cast<size_t>(y) * w + x) * 3 + 1] = source[x * 4 + 1];
+					expectedRgb[(static_cast<size_t>(y) * w + x) * 3 + 2] = source[x * 4 + 2];
+				}
+			}
+
+			char name[32];
+			std::snprintf(name, sizeof(name), "frame_%06d.png", frame);
+			const std::string path = (std::filesystem::path(PngDirectory) / name).string();
+			int pngWidth = 0;
+			int pngHeight = 0;
+			int channels = 0;
+			unsigned char* png = stbi_load(path.c_str(), &pngWidth, &pngHeight, &channels, 3);
+			if (!png || pngWidth != width || pngHeight != height)
+			{
+				std::cerr << "Failed to decode " << path << std::endl;
+				stbi_image_free(png);
+				return false;
+			}
+			const bool pngMatches = ComparePixels(expectedRgb.data(), png, expectedRgb.size(), path);
+			stbi_image_free(png);
+			if (!pngMatches)
+				return false;
+
+			ImageEncoders::ConvertToYuv420(reference.data(), w, h, rowBytes, true, expectedYuv.data());
+			char marker[6] = {};
+			y4m.read(marker, sizeof(marker));
+			y4m.read(reinterpret_cast<char*>(capturedYuv.data()), static_cast<std::streamsize>(yuvSize));
+			if (!y4m || std::memcmp(marker, "FRAME\n", sizeof(marker)) != 0)
+			{
+				std::cerr << "Y4M frame " << frame << " is missing" << std::endl;
+				return false;
+			}
+			if (!ComparePixels(expectedYuv.data(), capturedYuv.data(), yuvSize, "Y4M frame " + std::to_string(frame)))
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int width = 1280;
+	int height = 720;
+	int frames = 300;
+	int triangles = 20000;
+	unsigned encoders = 0;
+	int validateFrames = 8;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+		{
+			if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+				return -1;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc)
+			triangles = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--encoders") == 0 && i + 1 < argc)
+			encoders = static_cast<unsigned>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--validate") == 0 && i + 1 < argc)
+			validateFrames = std::atoi(argv[++i]);
+		else
+		{
+			std::cout << "Usage: CaptureBenchmark [--size WxH] [--frames N] [--triangles N] [--encoders N] [--validate N]" << std::endl;
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (width <= 0 || height <= 0 || frames <= 0 || triangles <= 0)
+		return -1;
+	validateFrames = std::min(validateFrames, frames);
+
+	HeadlessContext context;
+	if (!context.Initialize(width, height))
+		return -1;
+
+	Scene scene;
+	scene.Context = &context;
+	scene.Program = CompileProgram();
+	scene.Triangles = triangles;
+	if (!scene.Program)
+		return -1;
+	glCreateVertexArrays(1, &scene.VertexArray);
+
+	std::filesystem::remove_all(PngDirectory);
+
+	std::printf("%dx%d, %d triangles, %d frames\n\n", width, height, triangles, frames);
+	std::printf("%-6s %10s %10s %10s %10s %10s %12s %12s %10s\n", "mode", "mean ms", "p99 ms", "fps", "slowdown",
+		"stalls", "stall ms/f", "encode ms/f", "MB/frame");
+
+	double baselineMs = 0.0;
+	bool succeeded = true;
+	unsigned encoderCount = 0;
+	for (Mode mode : { Mode::None, Mode::Sync, Mode::Png, Mode::Y4m })
+	{
+		RunResult result;
+		if (!Run(scene, mode, width, height, frames, encoders, result))
+		{
+			std::cerr << "Capture in " << GetModeName(mode) << " mode failed" << std::endl;
+			succeeded = false;
+			continue;
+		}
+
+		encoderCount = std::max(encoderCount, result.Encoders);
+		if (mode == Mode::None)
+			baselineMs = result.Summary.MeanMs;
+
+		const FrameCapture::Stats& capture = result.Capture;
+		const double capturedFrames = capture.Captured > 0 ? static_cast<double>(capture.Captured) : 1.0;
+		std::printf("%-6s %10.3f %10.3f %10.1f %9.1f%% %10llu %12.3f %12.3f %10.2f\n", GetModeName(mode),
+			result.Summary.MeanMs, result.Summary.P99Ms, result.Summary.Fps,
+			100.0 * (result.Summary.MeanMs / baselineMs - 1.0), static_cast<unsigned long long>(capture.Stalls),
+			capture.StallMs / frames, capture.EncodeMs / capturedFrames, capture.Bytes / capturedFrames / (1024.0 * 1024.0));
+
+		if (mode == Mode::Png || mode == Mode::Y4m)
+		{
+			if (capture.Written != static_cast<uint64_t>(frames))
+			{
+				std::cerr << GetModeName(mode) << ": " << capture.Written << " of " << frames << " frames written" << std::endl;
+				succeeded = false;
+			}
+		}
+	}
+
+	std::printf("\n%u encoder threads, %u cores\n", encoderCount, std::thread::hardware_concurrency());
+
+	if (succeeded && validateFrames > 0)
+	{
+		succeeded = Validate(scene, width, height, validateFrames);
+		if (succeeded)
+			std::printf("First %d frames: PNG and Y4M output matches a synchronous readback\n", validateFrames);
+	}
+
+	glDeleteVertexArrays(1, &scene.VertexArray);
+	glDeleteProgram(scene.Program);
+
+	if (!succeeded || glGetError() != GL_NO_ERROR)
+		return -1;
+	return 0;
+}
@@ -0,0 +1,356 @@
+#include "CommandBuffer.h"
+#include "GLStateCache.h"
+#include "HeadlessContext.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Records N draw packets per frame through CommandQueue and sorts them, with
+// 1, 2, 4, ... threads up to --threads, and reports the mean record and sort
+// times. Then executes one frame sorted and one in recording order, to show
+// how many state changes the sort key saves. Before any of that, checks that
+// packets with more uniforms than fit in one allocator block record intact.
+// Usage:
+//   CommandBufferBenchmark [--draws N] [--frames N] [--threads N]
+//                          [--programs N] [--materials N] [--execute-frames N]
+// Draws pick a random program and material, as an unsorted scene traversal would.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Object
+	{
+		glm::vec3 Position;
+		float Depth;
+		uint32_t Program;
+		uint32_t Material;
+	};
+
+	struct Resources
+	{
+		std::vector<GLuint> Programs;
+		std::vector<GLuint> Textures;
+		GLuint VAO = 0;
+		GLuint VBO = 0;
+		GLuint EBO = 0;
+	};
+
+	GLuint CompileProgram(int variant)
+	{
+		const char* vertexSource = R"(
+#version 450 core
+layout(location = 0) in vec2 aPos;
+layout(location = 0) uniform mat4 uModel;
+out vec2 vUV;
+void main()
+{
+	vUV = aPos + 0.5;
+	gl_Position = uModel * vec4(aPos, 0.0, 1.0);
+}
+)";
+		// Each variant is a distinct program object with the same interface
+		const std::string fragmentSource = std::string(R"(
+#version 450 core
+in vec2 vUV;
+layout(binding = 0) uniform sampler2D uTexture;
+out vec4 FragColor;
+void main()
+{
+	FragColor = texture(uTexture, vUV) * )") + std::to_string(0.5f + 0.5f * static_cast<float>(variant % 2)) + ";\n}\n";
+		const char* fragment = fragmentSource.c_str();
+
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+		glCompileShader(vertexShader);
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragment, nullptr);
+		glCompileShader(fragmentShader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			std::cerr << "Benchmark shader failed to link" << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+
+	bool CreateResources(Resources& resources, int programCount, int materialCount)
+	{
+		for (int i = 0; i < programCount; ++i)
+		{
+			const GLuint program = CompileProgram(i);
+			if (!program)
+				return false;
+			resources.Programs.push_back(program);
+		}
+
+		resources.Textures.resize(static_cast<size_t>(materialCount));
+		glCreateTextures(GL_TEXTURE_2D, materialCount, resources.Textures.data());
+		for (int i = 0; i < materialCount; ++i)
+		{
+			const uint32_t pixel = 0xFF000000u | (static_cast<uint32_t>(i) * 0x9E3779B9u >> 8);
+			glTextureStorage2D(resources.Textures[i], 1, GL_RGBA8, 1, 1);
+			glTextureSubImage2D(resources.Textures[i], 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &pixel);
+		}
+
+		const float corners[] = { -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+		const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+		glCreateBuffers(1, &resources.VBO);
+		glNamedBufferStorage(resources.VBO, sizeof(corners), corners, 0);
+		glCreateBuffers(1, &resources.EBO);
+		glNamedBufferStorage(resources.EBO, sizeof(indices), indices, 0);
+
+		glCreateVertexArrays(1, &resources.VAO);
+		glVertexArrayVertexBuffer(resources.VAO, 0, resources.VBO, 0, 2 * sizeof(float));
+		glVertexArrayElementBuffer(resources.VAO, resources.EBO);
+		glVertexArrayAttribFormat(resources.VAO, 0, 2, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(resources.VAO, 0, 0);
+		glEnableVertexArrayAttrib(resources.VAO, 0);
+
+		return true;
+	}
+
+	void DestroyResources(Resources& resources)
+	{
+		for (GLuint program : resources.Programs)
+			glDeleteProgram(program);
+		glDeleteTextures(static_cast<GLsizei>(resources.Textures.size()), resources.Textures.data());
+		glDeleteVertexArrays(1, &resources.VAO);
+		glDeleteBuffers(1, &resources.VBO);
+		glDeleteBuffers(1, &resources.EBO);
+	}
+
+	std::vector<Object> CreateObjects(int count, int programCount, int materialCount)
+	{
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<Object> objects(static_cast<size_t>(count));
+		for (Object& object : objects)
+		{
+			object.Position = glm::vec3(unit(random) * 2.0f - 1.0f, unit(random) * 2.0f - 1.0f, 0.0f);
+			object.Depth = unit(random);
+			object.Program = static_cast<uint32_t>(random() % static_cast<uint32_t>(programCount));
+			object.Material = static_cast<uint32_t>(random() % static_cast<uint32_t>(materialCount));
+		}
+		return objects;
+	}
+
+	void RecordObjects(CommandBuffer& buffer, const std::vector<Object>& objects, const Resources& resources,
+		uint32_t begin, uint32_t end, float time, bool keyed)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const Object& object = objects[i];
+
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), object.Position);
+			model = glm::rotate(model, time + object.Depth * 6.0f, glm::vec3(0.0f, 0.0f, 1.0f));
+			model = glm::scale(model, glm::vec3(0.02f));
+
+			// All-zero keys leave the packets in recording order
+			const uint64_t key = keyed
+				? SortKey::Make(0, object.Program, object.Material, SortKey::QuantizeDepth(object.Depth))
+				: 0;
+
+			DrawPacket& packet = buffer.AddDraw(key, 1);
+			packet.Program = resources.Programs[object.Program];
+			packet.VertexArray = resources.VAO;
+			packet.Textures[0] = resources.Textures[object.Material];
+			packet.IndexCount = 6;
+			packet.Uniforms[0] = UniformValue::MakeMat4(0, model);
+		}
+	}
+
+	// Packets with more uniforms than fit in one allocator block, between
+	// ordinary ones; the second frame needs a larger block than the first
+	bool CheckOversizedPayloads()
+	{
+		CommandBuffer buffer;
+		for (const uint32_t uniformCount : { 2000u, 3000u })
+		{
+			buffer.Reset();
+			DrawPacket& before = buffer.AddDraw(0);
+			before.IndexCount = 6;
+
+			DrawPacket& large = buffer.AddDraw(1, uniformCount);
+			for (uint32_t i = 0; i < uniformCount; ++i)
+				large.Uniforms[i] = UniformValue::MakeInt(static_cast<GLint>(i), static_cast<GLint>(uniformCount - i));
+
+			DrawPacket& after = buffer.AddDraw(2);
+			after.IndexCount = 3;
+
+			if (before.IndexCount != 6 || after.IndexCount != 3 || large.UniformCount != uniformCount)
+				return false;
+
+			for (uint32_t i = 0; i < uniformCount; ++i)
+			{
+				const UniformValue& uniform = large.Uniforms[i];
+				if (uniform.Location != static_cast<GLint>(i) || uniform.Int != static_cast<GLint>(uniformCount - i))
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int drawCount = 50000;
+	int frames = 50;
+	int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	int programCount = 8;
+	int materialCount = 64;
+	int executeFrames = 3;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--draws") == 0 && hasValue)
+			drawCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+			maxThreads = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--programs") == 0 && hasValue)
+			programCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--materials") == 0 && hasValue)
+			materialCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--execute-frames") == 0 && hasValue)
+			executeFrames = std::atoi(argv[++i]);
+		else
+		{
+			std::cout << "Usage: CommandBufferBenchmark [--draws N] [--frames N] [--threads N] "
+				"[--programs N] [--materials N] [--execute-frames N]" << std::endl;
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (drawCount <= 0 || frames <= 0 || maxThreads <= 0 || programCount <= 0 || materialCount <= 0)
+		return -1;
+
+	if (!CheckOversizedPayloads())
+	{
+		std::cerr << "Packets larger than an allocator block were recorded wrongly" << std::endl;
+		return -1;
+	}
+
+	HeadlessContext context;
+	if (!context.Initialize(256, 256))
+		return -1;
+
+	Resources resources;
+	if (!CreateResources(resources, programCount, materialCount))
+		return -1;
+
+	const std::vector<Object> objects = CreateObjects(drawCount, programCount, materialCount);
+
+	std::printf("%d draws, %d programs, %d materials, %u cores\n", drawCount, programCount, materialCount,
+		std::thread::hardware_concurrency());
+	std::printf("%-8s %10s %10s %10s %8s\n", "threads", "record_ms", "sort_ms", "total_ms", "passes");
+
+	for (int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+	{
+		CommandQueue queue(static_cast<unsigned>(threads));
+		double recordMs = 0.0;
+		double sortMs = 0.0;
+
+		for (int frame = 0; frame < frames + 2; ++frame)
+		{
+			queue.Reset();
+			queue.Record(static_cast<uint32_t>(drawCount), [&](CommandBuffer& buffer, uint32_t begin, uint32_t end)
+			{
+				RecordObjects(buffer, objects, resources, begin, end, static_cast<float>(frame), true);
+			});
+			queue.Sort();
+
+			// The first frames grow the buffers
+			if (frame >= 2)
+			{
+				recordMs += queue.GetStats().RecordMs;
+				sortMs += queue.GetStats().SortMs;
+			}
+		}
+
+		const std::vector<CommandBuffer::Entry>& sorted = queue.GetSorted();
+		const bool ordered = std::is_sorted(sorted.begin(), sorted.end(),
+			[](const CommandBuffer::Entry& a, const CommandBuffer::Entry& b) { return a.Key < b.Key; });
+		if (!ordered || sorted.size() != static_cast<size_t>(drawCount))
+		{
+			std::cerr << "Sort produced a wrong result with " << threads << " threads" << std::endl;
+			return -1;
+		}
+
+		std::printf("%-8d %10.3f %10.3f %10.3f %8u\n", threads, recordMs / frames, sortMs / frames,
+			(recordMs + sortMs) / frames, queue.GetStats().SortPasses);
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	if (executeFrames <= 0)
+	{
+		DestroyResources(resources);
+		return 0;
+	}
+
+	// Execution happens on the GL thread only, so one queue is enough
+	std::printf("\n%-10s %12s %14s %14s\n", "order", "execute_ms", "state_issued", "state_elided");
+
+	CommandQueue queue;
+	GLStateCache state;
+	for (const bool keyed : { false, true })
+	{
+		double executeMs = 0.0;
+		GLStateCache::Counters counters;
+
+		for (int frame = 0; frame < executeFrames; ++frame)
+		{
+			context.BindFramebuffer();
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			state.BeginFrame();
+			queue.Reset();
+			queue.Record(static_cast<uint32_t>(drawCount), [&](CommandBuffer& buffer, uint32_t begin, uint32_t end)
+			{
+				RecordObjects(buffer, objects, resources, begin, end, static_cast<float>(frame), keyed);
+			});
+			queue.Sort();
+			queue.Execute(state);
+			glFinish();
+
+			executeMs += queue.GetStats().ExecuteMs;
+			counters = state.GetFrame();
+			context.Present();
+		}
+
+		std::printf("%-10s %12.3f %14u %14u\n", keyed ? "sorted" : "recorded", executeMs / executeFrames,
+			counters.Issued, counters.Elided);
+	}
+
+	DestroyResources(resources);
+	return 0;
+}
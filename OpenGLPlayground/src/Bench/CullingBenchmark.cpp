@@ -0,0 +1,373 @@
+#include "Bvh.h"
+#include "CommandBuffer.h"
+#include "HeadlessContext.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Scatters N boxes through a cube around a camera that turns a little every
+// frame, and culls them against its frustum three ways: a scalar loop over
+// every box, Culling::CullAabbs() four boxes at a time, and a DynamicBvh. Then
+// moves 1% of the objects per frame through Move() and Refit(), and draws the
+// visible objects once with a draw call each and once with a single
+// glMultiDrawElementsIndirect. Usage:
+//   CullingBenchmark [--objects N] [--frames N] [--execute-frames N]
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr float WorldSize = 500.0f;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Camera at the centre of the world, turning a little every frame
+	glm::mat4 CameraViewProjection(int frame)
+	{
+		const float yaw = static_cast<float>(frame) * 0.05f;
+		const glm::vec3 forward(std::sin(yaw), 0.1f, -std::cos(yaw));
+		return glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f)
+			* glm::lookAt(glm::vec3(0.0f), forward, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	// Reference test, one box and one plane at a time
+	size_t CullScalar(const Frustum& frustum, const std::vector<Aabb>& boxes, uint32_t* visible)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < boxes.size(); ++i)
+		{
+			const Aabb& box = boxes[i];
+			bool outside = false;
+			for (const glm::vec4& plane : frustum.Planes)
+			{
+				const glm::vec3 farCorner(plane.x >= 0.0f ? box.Max.x : box.Min.x, plane.y >= 0.0f ? box.Max.y : box.Min.y,
+					plane.z >= 0.0f ? box.Max.z : box.Min.z);
+				if (glm::dot(glm::vec3(plane), farCorner) + plane.w < 0.0f)
+				{
+					outside = true;
+					break;
+				}
+			}
+
+			if (!outside)
+				visible[count++] = static_cast<uint32_t>(i);
+		}
+		return count;
+	}
+
+	GLuint CompileProgram(const char* vertexSource)
+	{
+		const char* fragmentSource = R"(
+#version 450 core
+out vec4 FragColor;
+void main()
+{
+	FragColor = vec4(1.0, 0.5, 0.2, 1.0);
+}
+)";
+
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+		glCompileShader(vertexShader);
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+		glCompileShader(fragmentShader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			std::cerr << "Benchmark shader failed to link" << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int objectCount = 500000;
+	int frames = 30;
+	int executeFrames = 3;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--objects") == 0 && hasValue)
+			objectCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--execute-frames") == 0 && hasValue)
+			executeFrames = std::atoi(argv[++i]);
+		else
+		{
+			std::cout << "Usage: CullingBenchmark [--objects N] [--frames N] [--execute-frames N]" << std::endl;
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (objectCount <= 0 || frames <= 0)
+		return -1;
+
+	std::mt19937 random(31337);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<Aabb> boxes(static_cast<size_t>(objectCount));
+	for (Aabb& box : boxes)
+	{
+		const glm::vec3 center = (glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f) * WorldSize;
+		const glm::vec3 extent = glm::vec3(0.25f + unit(random) * 0.75f);
+		box = { center - extent, center + extent };
+	}
+
+	DynamicBvh bvh(0.2f);
+	std::vector<int32_t> proxies(boxes.size());
+	const Clock::time_point buildStart = Clock::now();
+	bvh.Reserve(boxes.size());
+	for (size_t i = 0; i < boxes.size(); ++i)
+		proxies[i] = bvh.Insert(boxes[i], static_cast<uint32_t>(i));
+	const double buildMs = MillisecondsSince(buildStart);
+
+	std::printf("%d objects, BVH built by insertion in %.1f ms, height %d\n", objectCount, buildMs, bvh.GetHeight());
+	std::printf("%-10s %10s %10s %12s\n", "method", "cull_ms", "visible", "nodes_tested");
+
+	std::vector<uint32_t> visible(boxes.size());
+	std::vector<uint32_t> bvhVisible;
+	bvhVisible.reserve(boxes.size());
+	std::vector<uint8_t> isVisible(boxes.size());
+
+	double scalarMs = 0.0, simdMs = 0.0, bvhMs = 0.0;
+	size_t scalarCount = 0, simdCount = 0;
+	DynamicBvh::CullStats bvhStats;
+
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		const Frustum frustum = Frustum::FromMatrix(CameraViewProjection(frame));
+
+		Clock::time_point start = Clock::now();
+		scalarCount = CullScalar(frustum, boxes, visible.data());
+		scalarMs += MillisecondsSince(start);
+
+		start = Clock::now();
+		simdCount = Culling::CullAabbs(frustum, boxes.data(), boxes.size(), visible.data());
+		simdMs += MillisecondsSince(start);
+
+		start = Clock::now();
+		bvhVisible.clear();
+		bvh.Cull(frustum, bvhVisible, &bvhStats);
+		bvhMs += MillisecondsSince(start);
+
+		// The tree holds grown boxes, so it may keep a few extra objects but must not lose any
+		std::fill(isVisible.begin(), isVisible.end(), 0);
+		for (uint32_t index : bvhVisible)
+			isVisible[index] = 1;
+		for (size_t i = 0; i < simdCount; ++i)
+		{
+			if (!isVisible[visible[i]])
+			{
+				std::cerr << "BVH culled visible object " << visible[i] << std::endl;
+				return -1;
+			}
+		}
+		if (simdCount != scalarCount)
+		{
+			std::cerr << "SIMD and scalar culling disagree: " << simdCount << " vs " << scalarCount << std::endl;
+			return -1;
+		}
+	}
+
+	std::printf("%-10s %10.3f %10zu %12d\n", "scalar", scalarMs / frames, scalarCount, objectCount);
+	std::printf("%-10s %10.3f %10zu %12d\n", "simd", simdMs / frames, simdCount, objectCount);
+	std::printf("%-10s %10.3f %10u %12u\n", "bvh", bvhMs / frames, bvhStats.Visible, bvhStats.NodesTested);
+
+	// Dynamic updates: the same objects drift every frame, through each update path
+	const size_t movers = std::max<size_t>(1, boxes.size() / 100);
+	for (const bool refit : { false, true })
+	{
+		double updateMs = 0.0;
+		uint32_t reinserted = 0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			const Clock::time_point start = Clock::now();
+			for (size_t n = 0; n < movers; ++n)
+			{
+				const size_t i = n * 97 % boxes.size();
+				const glm::vec3 step = glm::vec3(unit(random), unit(random), unit(random)) * 0.2f - 0.1f;
+				boxes[i].Min += step;
+				boxes[i].Max += step;
+
+				if (refit)
+					bvh.Refit(proxies[i], boxes[i]);
+				else
+					reinserted += bvh.Move(proxies[i], boxes[i]) ? 1 : 0;
+			}
+			updateMs += MillisecondsSince(start);
+		}
+
+		if (refit)
+			std::printf("Refit %zu objects/frame: %.3f ms\n", movers, updateMs / frames);
+		else
+			std::printf("Move %zu objects/frame: %.3f ms (%.1f reinserted per frame)\n", movers, updateMs / frames,
+				static_cast<double>(reinserted) / frames);
+	}
+
+	if (executeFrames <= 0)
+		return 0;
+
+	HeadlessContext context;
+	if (!context.Initialize(640, 360))
+		return -1;
+
+	const GLuint uniformProgram = CompileProgram(R"(
+#version 450 core
+layout(location = 0) in vec3 aPos;
+layout(location = 0) uniform mat4 uModelViewProjection;
+void main()
+{
+	gl_Position = uModelViewProjection * vec4(aPos, 1.0);
+}
+)");
+	const GLuint instancedProgram = CompileProgram(R"(
+#version 450 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in mat4 aModelViewProjection;
+void main()
+{
+	gl_Position = aModelViewProjection * vec4(aPos, 1.0);
+}
+)");
+	if (!uniformProgram || !instancedProgram)
+		return -1;
+
+	// A unit cube per object, scaled to its box
+	const float corners[] = {
+		-1, -1, -1,  1, -1, -1,  1, 1, -1,  -1, 1, -1,
+		-1, -1, 1,   1, -1, 1,   1, 1, 1,   -1, 1, 1,
+	};
+	const uint32_t indices[] = {
+		0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+		3, 6, 2, 3, 7, 6,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5,
+	};
+
+	GLuint buffers[4];
+	glCreateBuffers(4, buffers);
+	const GLuint vertexBuffer = buffers[0], indexBuffer = buffers[1], matrixBuffer = buffers[2], indirectBuffer = buffers[3];
+	glNamedBufferStorage(vertexBuffer, sizeof(corners), corners, 0);
+	glNamedBufferStorage(indexBuffer, sizeof(indices), indices, 0);
+	glNamedBufferStorage(matrixBuffer, static_cast<GLsizeiptr>(boxes.size() * sizeof(glm::mat4)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(indirectBuffer, static_cast<GLsizeiptr>(boxes.size() * sizeof(DrawElementsIndirectCommand)), nullptr,
+		GL_DYNAMIC_STORAGE_BIT);
+
+	GLuint vertexArray = 0;
+	glCreateVertexArrays(1, &vertexArray);
+	glVertexArrayVertexBuffer(vertexArray, 0, vertexBuffer, 0, 3 * sizeof(float));
+	glVertexArrayElementBuffer(vertexArray, indexBuffer);
+	glVertexArrayAttribFormat(vertexArray, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(vertexArray, 0, 0);
+	glEnableVertexArrayAttrib(vertexArray, 0);
+	glVertexArrayVertexBuffer(vertexArray, 1, matrixBuffer, 0, sizeof(glm::mat4));
+	glVertexArrayBindingDivisor(vertexArray, 1, 1);
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glVertexArrayAttribFormat(vertexArray, 1 + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+		glVertexArrayAttribBinding(vertexArray, 1 + column, 1);
+	}
+
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	glEnable(GL_DEPTH_TEST);
+
+	std::vector<glm::mat4> matrices;
+	std::vector<DrawElementsIndirectCommand> commands;
+	matrices.reserve(boxes.size());
+	commands.reserve(boxes.size());
+
+	std::printf("\n%-12s %12s %12s\n", "submission", "draw_calls", "execute_ms");
+	for (const bool indirect : { false, true })
+	{
+		double executeMs = 0.0;
+		size_t drawCalls = 0;
+
+		for (int frame = 0; frame < executeFrames; ++frame)
+		{
+			const glm::mat4 viewProjection = CameraViewProjection(frame);
+			bvhVisible.clear();
+			bvh.Cull(Frustum::FromMatrix(viewProjection), bvhVisible);
+
+			context.BindFramebuffer();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			const Clock::time_point start = Clock::now();
+
+			matrices.clear();
+			commands.clear();
+			for (uint32_t index : bvhVisible)
+			{
+				const Aabb& box = boxes[index];
+				const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), (box.Min + box.Max) * 0.5f),
+					(box.Max - box.Min) * 0.5f);
+				matrices.push_back(viewProjection * model);
+				commands.push_back({ 36, 1, 0, 0, static_cast<uint32_t>(commands.size()) });
+			}
+
+			if (indirect)
+			{
+				for (GLuint column = 0; column < 4; ++column)
+					glEnableVertexArrayAttrib(vertexArray, 1 + column);
+				glUseProgram(instancedProgram);
+				glNamedBufferSubData(matrixBuffer, 0, static_cast<GLsizeiptr>(matrices.size() * sizeof(glm::mat4)), matrices.data());
+				glNamedBufferSubData(indirectBuffer, 0,
+					static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand)), commands.data());
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands.size()),
+					sizeof(DrawElementsIndirectCommand));
+				drawCalls = 1;
+			}
+			else
+			{
+				for (GLuint column = 0; column < 4; ++column)
+					glDisableVertexArrayAttrib(vertexArray, 1 + column);
+				glUseProgram(uniformProgram);
+				for (const glm::mat4& matrix : matrices)
+				{
+					glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(matrix));
+					glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+				}
+				drawCalls = matrices.size();
+			}
+
+			glFinish();
+			executeMs += MillisecondsSince(start);
+			context.Present();
+		}
+
+		std::printf("%-12s %12zu %12.3f\n", indirect ? "multi-draw" : "per-object", drawCalls, executeMs / executeFrames);
+	}
+
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteBuffers(4, buffers);
+	glDeleteProgram(uniformProgram);
+	glDeleteProgram(instancedProgram);
+	return 0;
+}
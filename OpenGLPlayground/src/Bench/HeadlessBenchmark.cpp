@@ -0,0 +1,167 @@
+#include "Application.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Renders the playground scene offscreen for a fixed number of frames and
+// reports frame-time statistics. Usage:
+//   OpenGLPlaygroundBench [--frames N] [--warmup N] [--size WxH]
+//                         [--report out.csv|out.json] [--label name] [--sprites N]
+//                         [--draws N] [--trace trace.json] [--pipelined]
+//                         [--sim-rate HZ] [--sim-cost US] [--virtual-texture file.oglv]
+//                         [--capture out.y4m|directory] [--assert-no-allocations]
+//                         [--pacing vsync|uncapped|limited|low-latency] [--pacing-rate HZ]
+//                         [--max-missed PERCENT]
+// --sprites adds N animated quads drawn through the batch renderer.
+// --draws adds N quads, each its own draw, recorded through the command queue.
+// --pipelined runs the simulation on its own thread; --sim-rate sets its fixed
+// step rate and --sim-cost burns US microseconds of CPU in every step.
+// --virtual-texture draws a floor streamed from a page file cooked by the
+// VirtualTextureCooker tool.
+// --capture saves the timed frames as a Y4M video or as numbered PNGs, read
+// back asynchronously and encoded on worker threads.
+// --assert-no-allocations fails the run if any timed frame allocates on the
+// render thread (needs an OGLP_TRACK_ALLOCATIONS build).
+// --pacing picks how frames are paced (uncapped by default); vsync and
+// low-latency lock to a virtual display refreshing at --pacing-rate, which is
+// also the frame rate limited holds to (60 by default). Pacing jitter and
+// input latency are reported for every mode. --max-missed fails the run if
+// more than PERCENT of the timed frames miss their refresh; 0 checks that a
+// paced mode keeps up with a steady display.
+// --trace writes a Chrome trace of the timed frames (open in chrome://tracing or Perfetto).
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: OpenGLPlaygroundBench [--frames N] [--warmup N] [--size WxH] "
+			"[--report out.csv|out.json] [--label name] [--sprites N] [--draws N] [--trace trace.json] "
+			"[--pipelined] [--sim-rate HZ] [--sim-cost US] [--virtual-texture file.oglv] [--capture out.y4m|directory] "
+			"[--assert-no-allocations] [--pacing vsync|uncapped|limited|low-latency] [--pacing-rate HZ] [--max-missed PERCENT]" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int width = 1280;
+	int height = 720;
+	HeadlessSettings settings;
+	int spriteCount = 0;
+	int drawCount = 0;
+	bool pipelined = false;
+	double simulationRate = 120.0;
+	double simulationCost = 0.0;
+	std::string virtualTexturePath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--frames") == 0 && hasValue)
+		{
+			settings.FrameCount = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--warmup") == 0 && hasValue)
+		{
+			settings.WarmupFrames = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--size") == 0 && hasValue)
+		{
+			if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(arg, "--report") == 0 && hasValue)
+		{
+			settings.ReportPath = argv[++i];
+		}
+		else if (std::strcmp(arg, "--label") == 0 && hasValue)
+		{
+			settings.Label = argv[++i];
+		}
+		else if (std::strcmp(arg, "--sprites") == 0 && hasValue)
+		{
+			spriteCount = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--draws") == 0 && hasValue)
+		{
+			drawCount = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--trace") == 0 && hasValue)
+		{
+			settings.TracePath = argv[++i];
+		}
+		else if (std::strcmp(arg, "--pipelined") == 0)
+		{
+			pipelined = true;
+		}
+		else if (std::strcmp(arg, "--sim-rate") == 0 && hasValue)
+		{
+			simulationRate = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--sim-cost") == 0 && hasValue)
+		{
+			simulationCost = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--capture") == 0 && hasValue)
+		{
+			settings.CapturePath = argv[++i];
+		}
+		else if (std::strcmp(arg, "--virtual-texture") == 0 && hasValue)
+		{
+			virtualTexturePath = argv[++i];
+		}
+		else if (std::strcmp(arg, "--assert-no-allocations") == 0)
+		{
+			settings.AssertNoAllocations = true;
+		}
+		else if (std::strcmp(arg, "--pacing") == 0 && hasValue)
+		{
+			if (!ParsePacingMode(argv[++i], settings.Pacing))
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(arg, "--pacing-rate") == 0 && hasValue)
+		{
+			settings.PacingRate = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(arg, "--max-missed") == 0 && i + 1 < argc)
+		{
+			settings.MaxMissedPercent = std::atof(argv[++i]);
+		}
+		else
+		{
+			PrintUsage();
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (settings.FrameCount <= 0 || width <= 0 || height <= 0 || simulationRate <= 0.0 || settings.PacingRate <= 0.0)
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	Application app(width, height, "OpenGL Playground (headless)");
+	app.SetHeadless(settings);
+	app.SetSpriteCount(spriteCount);
+	app.SetDrawCount(drawCount);
+	app.SetPipelined(pipelined);
+	app.SetSimulationRate(simulationRate);
+	app.SetSimulationCost(simulationCost);
+	app.SetVirtualTexture(virtualTexturePath);
+
+	if (!app.Initialize())
+	{
+		return -1;
+	}
+
+	return app.Run();
+}
@@ -0,0 +1,243 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Measures the cost of the job system itself, then how a parallel loop scales
+// with it. Usage:
+//   JobSystemBenchmark [--jobs N] [--items N] [--work N] [--grain N] [--frames N] [--threads N]
+//
+// Spawn overhead: --jobs empty jobs spawned and waited for, from the thread
+// that owns the system, from inside a job on a worker, and as one ParallelFor
+// with a grain of one; std::async and std::thread per job are shown for scale.
+//
+// Scaling: ParallelFor over --items elements, each --work rounds of integer
+// hashing, on 1, 2, 4, ... threads up to --threads. Every run's checksum must
+// match the serial loop's.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// splitmix64 finaliser, iterated; cheap, serial and impossible to vectorise away
+	uint64_t Hash(uint64_t value, int rounds)
+	{
+		for (int i = 0; i < rounds; ++i)
+		{
+			value += 0x9E3779B97F4A7C15ull;
+			value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+			value ^= value >> 31;
+		}
+		return value;
+	}
+
+	uint64_t Checksum(const std::vector<uint64_t>& values)
+	{
+		uint64_t sum = 0;
+		for (uint64_t value : values)
+			sum += value;
+		return sum;
+	}
+
+	void PrintSpawn(const char* method, int jobs, double ms)
+	{
+		std::printf("%-18s %10d %12.3f %12.1f\n", method, jobs, ms, ms * 1e6 / jobs);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int jobCount = 100000;
+	int itemCount = 1 << 20;
+	int work = 64;
+	int grain = 1024;
+	int frames = 10;
+	int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--jobs") == 0 && hasValue)
+			jobCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--items") == 0 && hasValue)
+			itemCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--work") == 0 && hasValue)
+			work = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--grain") == 0 && hasValue)
+			grain = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+			maxThreads = std::atoi(argv[++i]);
+		else
+		{
+			std::cout << "Usage: JobSystemBenchmark [--jobs N] [--items N] [--work N] [--grain N] [--frames N] "
+				"[--threads N]" << std::endl;
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (jobCount <= 0 || itemCount <= 0 || work <= 0 || grain <= 0 || frames <= 0 || maxThreads <= 0)
+		return -1;
+
+	std::printf("%u cores\n", std::thread::hardware_concurrency());
+	std::printf("%-18s %10s %12s %12s\n", "spawn", "jobs", "total_ms", "ns_per_job");
+
+	{
+		JobSystem jobs;
+		std::atomic<int> ran{ 0 };
+
+		// From the owning thread: jobs go to its own deque, and it runs them
+		// itself in Wait() alongside the thieves
+		{
+			const Clock::time_point start = Clock::now();
+			JobCounter counter;
+			for (int i = 0; i < jobCount; ++i)
+				jobs.Run([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			jobs.Wait(counter);
+			PrintSpawn("owner thread", jobCount, MillisecondsSince(start));
+		}
+
+		// From inside a job, so the spawning thread is usually a worker
+		{
+			const Clock::time_point start = Clock::now();
+			JobCounter counter;
+			jobs.Run([&]
+			{
+				for (int i = 0; i < jobCount; ++i)
+					jobs.Run([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			}, &counter);
+			jobs.Wait(counter);
+			PrintSpawn("inside a job", jobCount, MillisecondsSince(start));
+		}
+
+		// Split on demand: one job per element with a grain of one
+		{
+			const Clock::time_point start = Clock::now();
+			jobs.ParallelFor(static_cast<size_t>(jobCount), 1, [&ran](size_t begin, size_t end)
+			{
+				ran.fetch_add(static_cast<int>(end - begin), std::memory_order_relaxed);
+			});
+			PrintSpawn("parallel_for", jobCount, MillisecondsSince(start));
+		}
+
+		if (ran.load() != jobCount * 3)
+		{
+			std::cerr << "Ran " << ran.load() << " jobs instead of " << jobCount * 3 << std::endl;
+			return -1;
+		}
+
+		std::printf("%-18s %10s %12s %12llu\n", "(stolen)", "-", "-",
+			static_cast<unsigned long long>(jobs.GetStolenCount()));
+	}
+
+	// Thread creation costs far more per job; fewer keep the run short
+	{
+		const int count = std::min(jobCount, 2000);
+		std::atomic<int> ran{ 0 };
+
+		Clock::time_point start = Clock::now();
+		std::vector<std::future<void>> futures;
+		futures.reserve(count);
+		for (int i = 0; i < count; ++i)
+			futures.push_back(std::async(std::launch::async, [&ran] { ran.fetch_add(1, std::memory_order_relaxed); }));
+		for (std::future<void>& future : futures)
+			future.get();
+		PrintSpawn("std::async", count, MillisecondsSince(start));
+
+		start = Clock::now();
+		for (int i = 0; i < count; ++i)
+		{
+			std::thread thread([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+			thread.join();
+		}
+		PrintSpawn("std::thread", count, MillisecondsSince(start));
+
+		if (ran.load() != count * 2)
+			return -1;
+	}
+
+	const size_t items = static_cast<size_t>(itemCount);
+	std::vector<uint64_t> values(items);
+
+	// Serial reference
+	double serialMs = 0.0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		const Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < items; ++i)
+			values[i] = Hash(i, work);
+		serialMs += MillisecondsSince(start);
+	}
+	const uint64_t reference = Checksum(values);
+
+	std::printf("\n%d items x %d rounds, grain %d, %d frames\n", itemCount, work, grain, frames);
+	std::printf("%-8s %10s %10s %12s %10s %10s\n", "threads", "ms", "speedup", "efficiency", "stolen", "balance");
+	std::printf("%-8s %10.3f %10s %12s %10s %10s\n", "serial", serialMs / frames, "-", "-", "-", "-");
+
+	double oneThreadMs = 0.0;
+	for (int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+	{
+		JobSystem jobs(static_cast<unsigned>(threads));
+		double ms = 0.0;
+
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			std::fill(values.begin(), values.end(), 0ull);
+
+			const Clock::time_point start = Clock::now();
+			jobs.ParallelFor(items, static_cast<size_t>(grain), [&values, work](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					values[i] = Hash(i, work);
+			});
+			ms += MillisecondsSince(start);
+
+			if (Checksum(values) != reference)
+			{
+				std::cerr << "ParallelFor produced a wrong result with " << threads << " threads" << std::endl;
+				return -1;
+			}
+		}
+
+		if (threads == 1)
+			oneThreadMs = ms;
+
+		// Share of the jobs run by the busiest thread; 1/threads is perfect
+		uint64_t executed = 0;
+		uint64_t busiest = 0;
+		for (unsigned t = 0; t < jobs.GetThreadCount(); ++t)
+		{
+			executed += jobs.GetExecutedCount(t);
+			busiest = std::max(busiest, jobs.GetExecutedCount(t));
+		}
+
+		const double speedup = oneThreadMs / ms;
+		char balance[16] = "-";
+		if (executed > 0)
+			std::snprintf(balance, sizeof(balance), "%.2f", static_cast<double>(busiest) / executed);
+
+		std::printf("%-8d %10.3f %10.2f %11.0f%% %10llu %10s\n", threads, ms / frames, speedup,
+			speedup / threads * 100.0, static_cast<unsigned long long>(jobs.GetStolenCount()), balance);
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	return 0;
+}
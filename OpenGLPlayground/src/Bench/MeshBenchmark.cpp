@@ -0,0 +1,539 @@
+#include "CookedMesh.h"
+#include "HeadlessContext.h"
+#include "MeshCooker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Compares meshes in the float vertex layout with cooked ones: file size,
+// load time (read and upload vs. map and one glNamedBufferStorage), vertex
+// cache efficiency, overdraw and draw time. Usage:
+//   MeshBenchmark [--vertices N] [--loads N] [--draws N] [--obj path]
+// Without --obj, two bumpy spheres are generated: one small enough for 16-bit
+// indices and one of about N vertices. Their triangles are shuffled, the way
+// a tool that does not optimize for the GPU might leave them.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	constexpr int TargetSize = 512;
+
+	MeshData MakeSphere(size_t targetVertices)
+	{
+		// (rings + 1) * (2 * rings + 1) vertices, seam included
+		const uint32_t rings = std::max<uint32_t>(2, static_cast<uint32_t>(std::sqrt(targetVertices / 2.0)));
+		const uint32_t segments = rings * 2;
+
+		MeshData mesh;
+		mesh.Vertices.reserve(static_cast<size_t>(rings + 1) * (segments + 1));
+		for (uint32_t ring = 0; ring <= rings; ++ring)
+		{
+			const float theta = glm::pi<float>() * ring / rings;
+			for (uint32_t segment = 0; segment <= segments; ++segment)
+			{
+				const float phi = glm::two_pi<float>() * segment / segments;
+				const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				const float radius = 1.0f + 0.25f * std::sin(theta * 9.0f) * std::sin(phi * 7.0f);
+
+				MeshVertex vertex;
+				vertex.Position = normal * radius;
+				vertex.Color = normal * 0.5f + 0.5f;
+				vertex.TexCoord = glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+				mesh.Vertices.push_back(vertex);
+			}
+		}
+
+		std::vector<uint32_t> triangles;
+		for (uint32_t ring = 0; ring < rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				const uint32_t a = ring * (segments + 1) + segment;
+				const uint32_t b = a + segments + 1;
+				triangles.insert(triangles.end(), { a, a + 1, b, a + 1, b + 1, b });
+			}
+		}
+
+		std::vector<uint32_t> order(triangles.size() / 3);
+		for (uint32_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+		mesh.Indices.reserve(triangles.size());
+		for (uint32_t triangle : order)
+			mesh.Indices.insert(mesh.Indices.end(), triangles.begin() + triangle * 3, triangles.begin() + triangle * 3 + 3);
+		return mesh;
+	}
+
+	// The uncooked file: counts, float vertices, 32-bit indices
+	bool WriteFloatMesh(const std::string& path, const MeshData& mesh)
+	{
+		std::ofstream out(path, std::ios::binary);
+		const uint32_t counts[2] = { static_cast<uint32_t>(mesh.Vertices.size()), static_cast<uint32_t>(mesh.Indices.size()) };
+		out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+		out.write(reinterpret_cast<const char*>(mesh.Vertices.data()), static_cast<std::streamsize>(mesh.Vertices.size() * sizeof(MeshVertex)));
+		out.write(reinterpret_cast<const char*>(mesh.Indices.data()), static_cast<std::streamsize>(mesh.Indices.size() * sizeof(uint32_t)));
+		return static_cast<bool>(out);
+	}
+
+	bool WriteFile(const std::string& path, const std::vector<unsigned char>& data)
+	{
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return static_cast<bool>(out);
+	}
+
+	struct GpuMesh
+	{
+		GLuint VertexArray = 0;
+		GLuint Buffers[2] = {};
+		GLenum IndexType = GL_UNSIGNED_INT;
+		GLsizei IndexCount = 0;
+		glm::mat4 Dequantize = glm::mat4(1.0f);
+
+		void Destroy()
+		{
+			glDeleteVertexArrays(1, &VertexArray);
+			glDeleteBuffers(2, Buffers);
+			*this = GpuMesh();
+		}
+	};
+
+	// What the renderer did before meshes were cooked: read into memory, then copy into two buffers
+	GpuMesh LoadFloatMesh(const std::string& path)
+	{
+		GpuMesh gpu;
+		std::ifstream file(path, std::ios::binary);
+		uint32_t counts[2] = {};
+		if (!file.read(reinterpret_cast<char*>(counts), sizeof(counts)))
+			return gpu;
+
+		std::vector<MeshVertex> vertices(counts[0]);
+		std::vector<uint32_t> indices(counts[1]);
+		file.read(reinterpret_cast<char*>(vertices.data()), static_cast<std::streamsize>(vertices.size() * sizeof(MeshVertex)));
+		file.read(reinterpret_cast<char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+		if (!file)
+			return gpu;
+
+		glCreateBuffers(2, gpu.Buffers);
+		glNamedBufferData(gpu.Buffers[0], static_cast<GLsizeiptr>(vertices.size() * sizeof(MeshVertex)), vertices.data(), GL_STATIC_DRAW);
+		glNamedBufferData(gpu.Buffers[1], static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), indices.data(), GL_STATIC_DRAW);
+
+		glCreateVertexArrays(1, &gpu.VertexArray);
+		glVertexArrayVertexBuffer(gpu.VertexArray, 0, gpu.Buffers[0], 0, sizeof(MeshVertex));
+		glVertexArrayElementBuffer(gpu.VertexArray, gpu.Buffers[1]);
+		const GLuint offsets[] = { offsetof(MeshVertex, Position), offsetof(MeshVertex, Color), offsetof(MeshVertex, TexCoord) };
+		const GLint components[] = { 3, 3, 2 };
+		for (GLuint attribute = 0; attribute < 3; ++attribute)
+		{
+			glVertexArrayAttribFormat(gpu.VertexArray, attribute, components[attribute], GL_FLOAT, GL_FALSE, offsets[attribute]);
+			glVertexArrayAttribBinding(gpu.VertexArray, attribute, 0);
+			glEnableVertexArrayAttrib(gpu.VertexArray, attribute);
+		}
+
+		gpu.IndexCount = static_cast<GLsizei>(indices.size());
+		return gpu;
+	}
+
+	GpuMesh LoadCookedMesh(const std::string& path)
+	{
+		GpuMesh gpu;
+		CookedMesh mesh;
+		if (!mesh.Open(path))
+			return gpu;
+
+		gpu.Buffers[0] = mesh.CreateGLBuffer();
+		gpu.VertexArray = mesh.CreateGLVertexArray(gpu.Buffers[0]);
+		gpu.IndexType = mesh.GetIndexType();
+		gpu.IndexCount = static_cast<GLsizei>(mesh.GetHeader().IndexCount);
+		gpu.Dequantize = mesh.GetDequantizeTransform();
+		return gpu;
+	}
+
+	// Median of 'loads' runs, each including the wait for the upload to finish
+	template <typename Load>
+	double TimeLoad(int loads, Load load)
+	{
+		std::vector<double> times;
+		for (int i = 0; i < loads; ++i)
+		{
+			const Clock::time_point start = Clock::now();
+			GpuMesh gpu = load();
+			glFinish();
+			times.push_back(MillisecondsSince(start));
+			gpu.Destroy();
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	GLuint CompileProgram()
+	{
+		const char* vertexSource = R"(
+#version 450 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 0) uniform mat4 uTransform;
+out vec3 vColor;
+void main()
+{
+	gl_Position = uTransform * vec4(aPos, 1.0);
+	vColor = aColor;
+}
+)";
+		const char* fragmentSource = R"(
+#version 450 core
+in vec3 vColor;
+out vec4 FragColor;
+void main()
+{
+	FragColor = vec4(vColor, 1.0);
+}
+)";
+
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+		glCompileShader(vertexShader);
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+		glCompileShader(fragmentShader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			std::cerr << "Benchmark shader failed to link" << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+
+	// Views down each axis, fitted to a unit-ish mesh
+	glm::mat4 ViewProjection(int view)
+	{
+		static const glm::vec3 directions[6] = {
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		const glm::vec3 eye = directions[view] * 4.0f;
+		const glm::vec3 up = view == 2 || view == 3 ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+		return glm::perspective(glm::radians(45.0f), 1.0f, 0.5f, 10.0f) * glm::lookAt(eye, glm::vec3(0.0f), up);
+	}
+
+	// Fragments shaded per covered pixel, over six views, with back faces culled
+	double MeasureOverdraw(const GpuMesh& gpu, GLuint program, const glm::mat4& model)
+	{
+		GLuint query = 0;
+		glCreateQueries(GL_SAMPLES_PASSED, 1, &query);
+		std::vector<float> depth(static_cast<size_t>(TargetSize) * TargetSize);
+
+		uint64_t shaded = 0;
+		uint64_t covered = 0;
+		glBindVertexArray(gpu.VertexArray);
+		for (int view = 0; view < 6; ++view)
+		{
+			const glm::mat4 transform = ViewProjection(view) * model;
+			glProgramUniformMatrix4fv(program, 0, 1, GL_FALSE, glm::value_ptr(transform));
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			GLuint64 samples = 0;
+			glBeginQuery(GL_SAMPLES_PASSED, query);
+			glDrawElements(GL_TRIANGLES, gpu.IndexCount, gpu.IndexType, nullptr);
+			glEndQuery(GL_SAMPLES_PASSED);
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &samples);
+			shaded += samples;
+
+			glReadPixels(0, 0, TargetSize, TargetSize, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+			covered += static_cast<uint64_t>(std::count_if(depth.begin(), depth.end(), [](float d) { return d < 1.0f; }));
+		}
+
+		glDeleteQueries(1, &query);
+		return covered > 0 ? static_cast<double>(shaded) / static_cast<double>(covered) : 0.0;
+	}
+
+	double TimeDraws(const GpuMesh& gpu, GLuint program, const glm::mat4& model, int draws)
+	{
+		glBindVertexArray(gpu.VertexArray);
+		glProgramUniformMatrix4fv(program, 0, 1, GL_FALSE, glm::value_ptr(ViewProjection(4) * model));
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glFinish();
+
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < draws; ++i)
+			glDrawElements(GL_TRIANGLES, gpu.IndexCount, gpu.IndexType, nullptr);
+		glFinish();
+		return MillisecondsSince(start) / draws;
+	}
+
+	// A triangle as its corner positions, rotated so the smallest comes first
+	struct TriangleKey
+	{
+		glm::vec3 Corners[3];
+
+		bool operator<(const TriangleKey& other) const
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					if (Corners[corner][axis] != other.Corners[corner][axis])
+						return Corners[corner][axis] < other.Corners[corner][axis];
+				}
+			}
+			return false;
+		}
+	};
+
+	std::vector<TriangleKey> GetTriangleKeys(const MeshData& mesh)
+	{
+		std::vector<TriangleKey> keys(mesh.Indices.size() / 3);
+		for (size_t triangle = 0; triangle < keys.size(); ++triangle)
+		{
+			TriangleKey key;
+			for (int corner = 0; corner < 3; ++corner)
+				key.Corners[corner] = mesh.Vertices[mesh.Indices[triangle * 3 + corner]].Position;
+
+			// Rotating keeps the winding
+			TriangleKey best = key;
+			for (int rotation = 1; rotation < 3; ++rotation)
+			{
+				TriangleKey rotated;
+				for (int corner = 0; corner < 3; ++corner)
+					rotated.Corners[corner] = key.Corners[(corner + rotation) % 3];
+				if (rotated < best)
+					best = rotated;
+			}
+			keys[triangle] = best;
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	// The optimized mesh must draw the same triangles, and the cooked file must
+	// decode to the optimized mesh within quantization error
+	bool Validate(const MeshData& source, const MeshData& optimized, const std::string& cookedPath)
+	{
+		const std::vector<TriangleKey> sourceKeys = GetTriangleKeys(source);
+		const std::vector<TriangleKey> optimizedKeys = GetTriangleKeys(optimized);
+		if (sourceKeys.size() != optimizedKeys.size()
+			|| !std::equal(sourceKeys.begin(), sourceKeys.end(), optimizedKeys.begin(),
+				[](const TriangleKey& a, const TriangleKey& b) { return !(a < b) && !(b < a); }))
+		{
+			std::cerr << "Optimized mesh does not draw the same triangles as the source" << std::endl;
+			return false;
+		}
+
+		CookedMesh cooked;
+		if (!cooked.Open(cookedPath))
+			return false;
+
+		const CookedMeshHeader& header = cooked.GetHeader();
+		if (header.VertexCount != optimized.Vertices.size() || header.IndexCount != optimized.Indices.size())
+		{
+			std::cerr << "Cooked mesh has the wrong counts" << std::endl;
+			return false;
+		}
+
+		const unsigned char* indexData = cooked.GetIndexData();
+		for (size_t i = 0; i < optimized.Indices.size(); ++i)
+		{
+			uint32_t index = 0;
+			if (header.IndexSize == 2)
+			{
+				uint16_t shortIndex = 0;
+				std::memcpy(&shortIndex, indexData + i * 2, 2);
+				index = shortIndex;
+			}
+			else
+			{
+				std::memcpy(&index, indexData + i * 4, 4);
+			}
+
+			if (index != optimized.Indices[i])
+			{
+				std::cerr << "Cooked index " << i << " differs" << std::endl;
+				return false;
+			}
+		}
+
+		const glm::mat4 dequantize = cooked.GetDequantizeTransform();
+		const glm::vec3 extent = glm::vec3(header.BoundsMax[0] - header.BoundsMin[0], header.BoundsMax[1] - header.BoundsMin[1],
+			header.BoundsMax[2] - header.BoundsMin[2]);
+		const float tolerance = glm::max(extent.x, glm::max(extent.y, extent.z)) / 32767.0f;
+		for (size_t i = 0; i < optimized.Vertices.size(); ++i)
+		{
+			const CookedMeshVertex& vertex = cooked.GetVertices()[i];
+			const glm::vec3 position = glm::vec3(dequantize * glm::vec4(glm::vec3(glm::unpackSnorm4x16(vertex.Position)), 1.0f));
+			const glm::vec3 color = glm::vec3(glm::unpackUnorm4x8(vertex.Color));
+			const glm::vec2 texCoord = glm::unpackUnorm2x16(vertex.TexCoord);
+
+			const MeshVertex& expected = optimized.Vertices[i];
+			if (glm::any(glm::greaterThan(glm::abs(position - expected.Position), glm::vec3(tolerance)))
+				|| glm::any(glm::greaterThan(glm::abs(color - expected.Color), glm::vec3(0.5f / 255.0f + 1e-6f)))
+				|| glm::any(glm::greaterThan(glm::abs(texCoord - expected.TexCoord), glm::vec2(0.5f / 65535.0f + 1e-6f))))
+			{
+				std::cerr << "Cooked vertex " << i << " is outside quantization error" << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool RunMesh(const std::string& name, const MeshData& source, const std::string& directory, int loads, int draws, GLuint program)
+	{
+		MeshData optimized = source;
+		MeshCookStats stats;
+		const Clock::time_point cookStart = Clock::now();
+		const std::vector<unsigned char> cooked = CookMeshData(optimized, MeshCookSettings(), 0, &stats);
+		const double cookMs = MillisecondsSince(cookStart);
+
+		// The float layout twice: in source order, and in the cooked order to
+		// separate what the index order buys from what the smaller vertices do
+		const std::string sourcePath = directory + "/" + name + ".float";
+		const std::string optimizedPath = directory + "/" + name + "_optimized.float";
+		const std::string cookedPath = directory + "/" + name + ".oglm";
+		if (!WriteFloatMesh(sourcePath, source) || !WriteFloatMesh(optimizedPath, optimized) || !WriteFile(cookedPath, cooked))
+		{
+			std::cerr << "Failed to write meshes to " << directory << std::endl;
+			return false;
+		}
+
+		if (!Validate(source, optimized, cookedPath))
+			return false;
+
+		const MeshOptimizer::VertexCacheStats sourceCache = stats.Before;
+		const MeshOptimizer::VertexCacheStats optimizedCache = stats.After;
+		const int indexBits = cooked.size() > 0 && reinterpret_cast<const CookedMeshHeader*>(cooked.data())->IndexSize == 2 ? 16 : 32;
+
+		std::printf("\n%s: %zu vertices, %zu triangles, cooked in %.0f ms, %d-bit indices\n", name.c_str(),
+			optimized.Vertices.size(), optimized.Indices.size() / 3, cookMs, indexBits);
+		std::printf("%-18s %10s %10s %8s %8s %10s %10s\n", "layout", "file_kb", "load_ms", "acmr", "atvr", "overdraw", "draw_ms");
+
+		struct Row
+		{
+			const char* Label;
+			std::string Path;
+			bool Cooked;
+			MeshOptimizer::VertexCacheStats Cache;
+		};
+		const Row rows[] = {
+			{ "float, source", sourcePath, false, sourceCache },
+			{ "float, optimized", optimizedPath, false, optimizedCache },
+			{ "cooked", cookedPath, true, optimizedCache },
+		};
+
+		for (const Row& row : rows)
+		{
+			auto load = [&row]() { return row.Cooked ? LoadCookedMesh(row.Path) : LoadFloatMesh(row.Path); };
+			const double loadMs = TimeLoad(loads, load);
+
+			GpuMesh gpu = load();
+			if (!gpu.VertexArray)
+			{
+				std::cerr << "Failed to load " << row.Path << std::endl;
+				return false;
+			}
+
+			const double overdraw = MeasureOverdraw(gpu, program, gpu.Dequantize);
+			const double drawMs = TimeDraws(gpu, program, gpu.Dequantize, draws);
+			gpu.Destroy();
+
+			std::printf("%-18s %10.0f %10.2f %8.3f %8.3f %10.3f %10.3f\n", row.Label,
+				static_cast<double>(std::filesystem::file_size(row.Path)) / 1024.0, loadMs,
+				row.Cache.Acmr, row.Cache.Atvr, overdraw, drawMs);
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int vertexCount = 1000000;
+	int loads = 9;
+	int draws = 20;
+	std::string objPath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--vertices") == 0 && hasValue)
+			vertexCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--loads") == 0 && hasValue)
+			loads = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--draws") == 0 && hasValue)
+			draws = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--obj") == 0 && hasValue)
+			objPath = argv[++i];
+		else
+		{
+			std::cout << "Usage: MeshBenchmark [--vertices N] [--loads N] [--draws N] [--obj path]" << std::endl;
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (vertexCount <= 0 || loads <= 0 || draws <= 0)
+		return -1;
+
+	HeadlessContext context;
+	if (!context.Initialize(TargetSize, TargetSize) || !context.CreateFramebuffer())
+		return -1;
+	context.BindFramebuffer();
+	glViewport(0, 0, TargetSize, TargetSize);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+
+	const GLuint program = CompileProgram();
+	if (!program)
+		return -1;
+	glUseProgram(program);
+
+	const std::string directory = (std::filesystem::temp_directory_path() / "oglp_mesh_bench").string();
+	std::filesystem::create_directories(directory);
+
+	bool ok = true;
+	if (!objPath.empty())
+	{
+		MeshData mesh;
+		ok = LoadObjMesh(objPath, mesh) && RunMesh(std::filesystem::path(objPath).stem().string(), mesh, directory, loads, draws, program);
+	}
+	else
+	{
+		ok = RunMesh("sphere_small", MakeSphere(60000), directory, loads, draws, program)
+			&& RunMesh("sphere_large", MakeSphere(static_cast<size_t>(vertexCount)), directory, loads, draws, program);
+	}
+
+	glDeleteProgram(program);
+	return ok ? 0 : -1;
+}
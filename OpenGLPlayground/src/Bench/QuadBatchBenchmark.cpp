@@ -0,0 +1,486 @@
+#include "BatchRenderer.h"
+#include "Camera.h"
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "HeadlessContext.h"
+#include "ShaderLibrary.h"
+#include "TextureAtlas.h"
+#include "UniformBuffers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Draws N animated quads per frame, once with one glDrawElements plus
+// per-quad uniform uploads (the way Application draws its quad), once
+// through BatchRenderer with a texture per image, and once through
+// BatchRenderer with every image packed into a TextureAtlas, and reports
+// frame times for each. Usage:
+//   QuadBatchBenchmark [--quads N] [--frames N] [--textures N] [--naive-max N] [--interleaved]
+// Quad counts of 1k, 10k and so on up to --quads are measured; the naive path
+// is skipped above --naive-max since it needs one draw call per quad. Quads
+// are grouped by texture unless --interleaved, which gives each quad a random
+// one and so breaks the per-texture batches up about as often as possible.
+//
+// Before timing, one frame of the atlas path is read back and compared with
+// the per-texture path, which samples the same images.
+//
+// record_ms is the time spent writing quads into the instance buffer and
+// submit_ms the whole submission including driver calls. On a software
+// rasterizer such as llvmpipe the driver shades vertices inside the draw
+// calls, so submit_ms there includes what would be GPU time elsewhere.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr int Width = 1280;
+	constexpr int Height = 720;
+
+	struct Quad
+	{
+		glm::vec2 Center;
+		float Radius;
+		float Speed;
+		float Phase;
+		float Size;
+		glm::vec4 Color;
+		uint32_t Texture;
+	};
+
+	struct NaivePipeline
+	{
+		GLuint Program = 0;
+		GLuint VAO = 0;
+		GLuint VBO = 0;
+		GLuint EBO = 0;
+		GLint ModelLocation = -1;
+		GLint ColorLocation = -1;
+		GLint ViewProjectionLocation = -1;
+	};
+
+	GLuint CompileProgram(const char* vertexSource, const char* fragmentSource)
+	{
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+		glCompileShader(vertexShader);
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+		glCompileShader(fragmentShader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			std::cerr << "Naive quad shader failed to link" << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	bool CreateNaivePipeline(NaivePipeline& pipeline)
+	{
+		const char* vertexSource = R"(
+			#version 450 core
+			layout(location = 0) in vec2 aCorner;
+			out vec2 vTexCoord;
+			uniform mat4 uModel;
+			uniform mat4 uViewProjection;
+			void main()
+			{
+				gl_Position = uViewProjection * uModel * vec4(aCorner, 0.0, 1.0);
+				vTexCoord = aCorner + 0.5;
+			}
+		)";
+
+		const char* fragmentSource = R"(
+			#version 450 core
+			uniform sampler2D uTexture;
+			uniform vec4 uColor;
+			in vec2 vTexCoord;
+			out vec4 FragColor;
+			void main()
+			{
+				FragColor = texture(uTexture, vTexCoord) * uColor;
+			}
+		)";
+
+		pipeline.Program = CompileProgram(vertexSource, fragmentSource);
+		if (!pipeline.Program)
+			return false;
+
+		pipeline.ModelLocation = glGetUniformLocation(pipeline.Program, "uModel");
+		pipeline.ColorLocation = glGetUniformLocation(pipeline.Program, "uColor");
+		pipeline.ViewProjectionLocation = glGetUniformLocation(pipeline.Program, "uViewProjection");
+
+		const float corners[] = { -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+		const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+		glGenVertexArrays(1, &pipeline.VAO);
+		glBindVertexArray(pipeline.VAO);
+		glGenBuffers(1, &pipeline.VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, pipeline.VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glGenBuffers(1, &pipeline.EBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pipeline.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		return true;
+	}
+
+	void DestroyNaivePipeline(NaivePipeline& pipeline)
+	{
+		glDeleteVertexArrays(1, &pipeline.VAO);
+		glDeleteBuffers(1, &pipeline.VBO);
+		glDeleteBuffers(1, &pipeline.EBO);
+		glDeleteProgram(pipeline.Program);
+	}
+
+	constexpr int ImageSize = 16;
+
+	void FillImage(int index, std::vector<unsigned char>& pixels)
+	{
+		pixels.resize(ImageSize * ImageSize * 4);
+		for (int i = 0; i < ImageSize * ImageSize; ++i)
+		{
+			pixels[i * 4 + 0] = static_cast<unsigned char>(80 + index * 40);
+			pixels[i * 4 + 1] = static_cast<unsigned char>(((i / ImageSize + i % ImageSize) & 1) ? 255 : 128);
+			pixels[i * 4 + 2] = static_cast<unsigned char>(255 - index * 40);
+			pixels[i * 4 + 3] = 255;
+		}
+	}
+
+	std::vector<GLuint> CreateTextures(int count)
+	{
+		std::vector<GLuint> textures(static_cast<size_t>(count));
+		glGenTextures(count, textures.data());
+
+		std::vector<unsigned char> pixels;
+		for (int t = 0; t < count; ++t)
+		{
+			FillImage(t, pixels);
+
+			// Clamped like the atlas, so both paths filter the edges the same way
+			glBindTexture(GL_TEXTURE_2D, textures[t]);
+			glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, ImageSize, ImageSize);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ImageSize, ImageSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		return textures;
+	}
+
+	// The same images as CreateTextures, packed into small layers so larger
+	// counts spill onto several
+	std::vector<AtlasHandle> CreateAtlasImages(TextureAtlas& atlas, int count)
+	{
+		std::vector<AtlasHandle> images(static_cast<size_t>(count));
+		std::vector<unsigned char> pixels;
+		for (int t = 0; t < count; ++t)
+		{
+			FillImage(t, pixels);
+			images[t] = atlas.Add(pixels.data(), ImageSize, ImageSize);
+			if (images[t] == InvalidAtlasHandle)
+				return {};
+		}
+		return images;
+	}
+
+	std::vector<Quad> CreateQuads(int count, int textureCount, bool interleaved)
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<Quad> quads(static_cast<size_t>(count));
+		for (int i = 0; i < count; ++i)
+		{
+			Quad& quad = quads[i];
+			quad.Center = glm::vec2(unit(random) * Width, unit(random) * Height);
+			quad.Radius = 5.0f + unit(random) * 40.0f;
+			quad.Speed = 0.5f + unit(random) * 2.0f;
+			quad.Phase = unit(random) * 6.2831853f;
+			quad.Size = 3.0f + unit(random) * 6.0f;
+			quad.Color = glm::vec4(unit(random), unit(random), unit(random), 0.8f);
+
+			// Grouped by texture as a sprite layer sorted by material would be, or random
+			quad.Texture = interleaved
+				? static_cast<uint32_t>(random() % static_cast<uint32_t>(textureCount))
+				: static_cast<uint32_t>(static_cast<int64_t>(i) * textureCount / count);
+		}
+		return quads;
+	}
+
+	struct RunResult
+	{
+		FrameStats::Summary Summary;
+		double SubmitMs = 0.0;		// Mean time spent issuing the quads, including driver work
+		double RecordMs = 0.0;		// Part of SubmitMs spent writing instance data (batched only)
+		uint32_t DrawCalls = 0;
+		uint32_t FenceWaits = 0;
+	};
+
+	template <typename DrawFrame>
+	RunResult RunFrames(HeadlessContext& context, int frames, DrawFrame&& drawFrame)
+	{
+		RunResult result;
+		FrameStats stats;
+		stats.Reserve(static_cast<size_t>(frames));
+
+		const int warmupFrames = 5;
+		Clock::time_point last = Clock::now();
+		for (int frame = 0; frame < warmupFrames + frames; ++frame)
+		{
+			context.BindFramebuffer();
+			glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			const Clock::time_point submitStart = Clock::now();
+			drawFrame(static_cast<float>(frame) / 60.0f, result);
+			const Clock::time_point submitEnd = Clock::now();
+
+			context.Present();
+
+			const Clock::time_point now = Clock::now();
+			if (frame >= warmupFrames)
+			{
+				stats.AddFrame(std::chrono::duration<double, std::milli>(now - last).count());
+				result.SubmitMs += std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+			}
+			last = now;
+		}
+
+		glFinish();
+		result.Summary = stats.Summarize();
+		result.SubmitMs /= warmupFrames + frames;
+		result.RecordMs /= warmupFrames + frames;
+		return result;
+	}
+
+	glm::vec2 QuadPosition(const Quad& quad, float time, float& angle)
+	{
+		angle = quad.Phase + time * quad.Speed;
+		return quad.Center + quad.Radius * glm::vec2(std::cos(angle), std::sin(angle));
+	}
+
+	std::vector<unsigned char> ReadFrame()
+	{
+		std::vector<unsigned char> pixels(static_cast<size_t>(Width) * Height * 4);
+		glReadPixels(0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		return pixels;
+	}
+
+	void PrintRow(const char* mode, int quads, const RunResult& r)
+	{
+		std::printf("%-8s %-8d %10.3f %10.3f %10.3f %10.3f %10.1f %10u %8u\n", mode, quads,
+			r.RecordMs, r.SubmitMs, r.Summary.MeanMs, r.Summary.P99Ms, r.Summary.Fps, r.DrawCalls, r.FenceWaits);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int maxQuads = 100000;
+	int frames = 100;
+	int textureCount = 4;
+	int naiveMax = 10000;
+	bool interleaved = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--quads") == 0 && i + 1 < argc)
+			maxQuads = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--textures") == 0 && i + 1 < argc)
+			textureCount = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--naive-max") == 0 && i + 1 < argc)
+			naiveMax = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--interleaved") == 0)
+			interleaved = true;
+		else
+		{
+			std::cout << "Usage: QuadBatchBenchmark [--quads N] [--frames N] [--textures N] [--naive-max N] [--interleaved]" << std::endl;
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (maxQuads <= 0 || frames <= 0 || textureCount <= 0)
+		return -1;
+
+	HeadlessContext context;
+	if (!context.Initialize(Width, Height))
+		return -1;
+
+	glViewport(0, 0, Width, Height);
+
+	NaivePipeline naive;
+	GLStateCache state;
+	BatchRenderer batch;
+	UniformBuffers uniforms;
+	ShaderLibrary shaders;
+	if (!CreateNaivePipeline(naive) || !uniforms.Initialize(state) || !shaders.Initialize("cache/shaders"))
+		return -1;
+
+	shaders.AddIncludeSource("UniformBlocks.glsl", UniformBlockSource);
+	if (!batch.Initialize(state, shaders))
+		return -1;
+
+	const std::vector<GLuint> textures = CreateTextures(textureCount);
+
+	TextureAtlas atlas;
+	if (!atlas.Initialize(state, 256))
+		return -1;
+
+	const std::vector<AtlasHandle> images = CreateAtlasImages(atlas, textureCount);
+	if (images.empty())
+	{
+		std::cerr << "Atlas cannot hold " << textureCount << " images" << std::endl;
+		return -1;
+	}
+	const glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(Width), 0.0f, static_cast<float>(Height));
+
+	// The batch renderer reads the same projection from the camera block
+	Camera camera;
+	camera.SetLookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.SetOrthographic(0.0f, static_cast<float>(Width), 0.0f, static_cast<float>(Height));
+	uniforms.SetCamera(camera);
+	const glm::vec4 fullRect(0.0f, 0.0f, 1.0f, 1.0f);
+
+	std::vector<int> counts;
+	for (int n = 1000; n < maxQuads; n *= 10)
+		counts.push_back(n);
+	counts.push_back(maxQuads);
+
+	std::printf("%dx%d, %d frames, %d textures (%s), %u atlas layers\n", Width, Height, frames, textureCount,
+		interleaved ? "interleaved" : "grouped", atlas.GetStats().Layers);
+	std::printf("%-8s %-8s %10s %10s %10s %10s %10s %10s %8s\n", "mode", "quads", "record_ms", "submit_ms", "mean_ms", "p99_ms", "fps", "draws", "waits");
+
+	for (int count : counts)
+	{
+		const std::vector<Quad> quads = CreateQuads(count, textureCount, interleaved);
+
+		if (count <= naiveMax)
+		{
+			const RunResult r = RunFrames(context, frames, [&](float time, RunResult& result)
+			{
+				glUseProgram(naive.Program);
+				glUniformMatrix4fv(naive.ViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				glBindVertexArray(naive.VAO);
+				glActiveTexture(GL_TEXTURE0);
+
+				for (const Quad& quad : quads)
+				{
+					float angle = 0.0f;
+					const glm::vec2 position = QuadPosition(quad, time, angle);
+					glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f));
+					model = glm::rotate(model, angle * 2.0f, glm::vec3(0.0f, 0.0f, 1.0f));
+					model = glm::scale(model, glm::vec3(quad.Size, quad.Size, 1.0f));
+
+					glBindTexture(GL_TEXTURE_2D, textures[quad.Texture]);
+					glUniformMatrix4fv(naive.ModelLocation, 1, GL_FALSE, glm::value_ptr(model));
+					glUniform4fv(naive.ColorLocation, 1, glm::value_ptr(quad.Color));
+					glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+				}
+
+				glBindVertexArray(0);
+				glDisable(GL_BLEND);
+				result.DrawCalls = static_cast<uint32_t>(quads.size());
+			});
+			PrintRow("naive", count, r);
+		}
+
+		// The naive path binds with raw GL calls
+		state.Invalidate();
+
+		auto drawBatched = [&](float time, RunResult& result)
+		{
+			const Clock::time_point recordStart = Clock::now();
+			batch.Begin();
+			for (const Quad& quad : quads)
+			{
+				float angle = 0.0f;
+				const glm::vec2 position = QuadPosition(quad, time, angle);
+				batch.SubmitQuad(position, glm::vec2(quad.Size), angle * 2.0f, quad.Color, fullRect, textures[quad.Texture]);
+			}
+			result.RecordMs += std::chrono::duration<double, std::milli>(Clock::now() - recordStart).count();
+			batch.End();
+
+			result.DrawCalls = batch.GetStats().DrawCalls;
+			result.FenceWaits += batch.GetStats().FenceWaits;
+		};
+
+		auto drawAtlas = [&](float time, RunResult& result)
+		{
+			const Clock::time_point recordStart = Clock::now();
+			batch.Begin();
+			for (const Quad& quad : quads)
+			{
+				float angle = 0.0f;
+				const glm::vec2 position = QuadPosition(quad, time, angle);
+				batch.SubmitQuad(position, glm::vec2(quad.Size), angle * 2.0f, quad.Color, atlas, images[quad.Texture]);
+			}
+			result.RecordMs += std::chrono::duration<double, std::milli>(Clock::now() - recordStart).count();
+			batch.End();
+
+			result.DrawCalls = batch.GetStats().DrawCalls;
+			result.FenceWaits += batch.GetStats().FenceWaits;
+		};
+
+		// Both paths draw the same frame; they may differ by rounding in the
+		// texture coordinates
+		{
+			RunResult unused;
+			context.BindFramebuffer();
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawBatched(0.0f, unused);
+			const std::vector<unsigned char> reference = ReadFrame();
+
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawAtlas(0.0f, unused);
+			const std::vector<unsigned char> frame = ReadFrame();
+
+			int maxError = 0;
+			for (size_t i = 0; i < frame.size(); ++i)
+				maxError = std::max(maxError, std::abs(static_cast<int>(frame[i]) - static_cast<int>(reference[i])));
+			if (maxError > 8)
+			{
+				std::cerr << "Atlas frame differs from the per-texture frame by up to " << maxError << std::endl;
+				return -1;
+			}
+		}
+
+		PrintRow("batched", count, RunFrames(context, frames, drawBatched));
+		PrintRow("atlas", count, RunFrames(context, frames, drawAtlas));
+	}
+
+	glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+	DestroyNaivePipeline(naive);
+
+	return 0;
+}
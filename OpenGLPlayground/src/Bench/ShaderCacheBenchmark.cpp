@@ -0,0 +1,179 @@
+#include "HeadlessContext.h"
+#include "ShaderLibrary.h"
+#include "UniformBuffers.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Startup cost of building N shader programs through ShaderLibrary: a cold
+// run with an empty program binary cache, then a warm run that reads the
+// binaries the cold run wrote. Usage:
+//   ShaderCacheBenchmark [--programs N] [--dir path]
+// Mesa's own shader disk cache is pointed at an empty directory so the cold
+// run really compiles (disabling it outright also disables program binaries).
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	bool WriteFile(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << text;
+		return static_cast<bool>(file);
+	}
+
+	// Distinct programs that share an include, roughly the size of a simple lit material
+	bool WriteShaderSources(const std::filesystem::path& directory, int count)
+	{
+		std::filesystem::create_directories(directory);
+
+		const std::string common = R"(
+vec3 ApplyFog(vec3 color, float distance, vec3 fogColor)
+{
+	float fog = clamp(exp(-distance * 0.05), 0.0, 1.0);
+	return mix(fogColor, color, fog);
+}
+
+vec3 Lambert(vec3 normal, vec3 lightDirection, vec3 albedo)
+{
+	return albedo * max(dot(normalize(normal), -lightDirection), 0.0);
+}
+)";
+		if (!WriteFile(directory / "Common.glsl", common))
+			return false;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const std::string variant = std::to_string(i);
+
+			const std::string vertex =
+				"#version 450 core\n"
+				"#include \"UniformBlocks.glsl\"\n"
+				"layout(location = 0) in vec3 aPos;\n"
+				"layout(location = 1) in vec3 aNormal;\n"
+				"layout(location = 0) uniform mat4 uModel;\n"
+				"out vec3 vNormal;\n"
+				"out vec3 vWorld;\n"
+				"void main()\n"
+				"{\n"
+				"	vec4 world = uModel * vec4(aPos * " + variant + ".0, 1.0);\n"
+				"	vWorld = world.xyz;\n"
+				"	vNormal = mat3(uModel) * aNormal;\n"
+				"	gl_Position = uViewProjection * world;\n"
+				"}\n";
+
+			const std::string fragment =
+				"#version 450 core\n"
+				"#include \"UniformBlocks.glsl\"\n"
+				"#include \"Common.glsl\"\n"
+				"in vec3 vNormal;\n"
+				"in vec3 vWorld;\n"
+				"out vec4 FragColor;\n"
+				"void main()\n"
+				"{\n"
+				"	vec3 albedo = vec3(0.2, 0.4, 0.6) * float(" + variant + " % 7 + 1) / 7.0;\n"
+				"	vec3 color = vec3(0.0);\n"
+				"	for (int light = 0; light < 4; ++light)\n"
+				"	{\n"
+				"		vec3 direction = normalize(vec3(cos(float(light) + uTime), -1.0, sin(float(light))));\n"
+				"		color += Lambert(vNormal, direction, albedo);\n"
+				"	}\n"
+				"	color = ApplyFog(color, length(vWorld - uCameraPosition.xyz), vec3(0.5));\n"
+				"	FragColor = vec4(color, 1.0);\n"
+				"}\n";
+
+			if (!WriteFile(directory / ("Program" + variant + ".vert"), vertex)
+				|| !WriteFile(directory / ("Program" + variant + ".frag"), fragment))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void RunStartup(const char* label, const std::filesystem::path& sources, const std::filesystem::path& cache, int count)
+	{
+		const Clock::time_point start = Clock::now();
+
+		ShaderLibrary library;
+		library.Initialize(cache.string());
+		library.AddIncludeSource("UniformBlocks.glsl", UniformBlockSource);
+
+		int built = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const std::string base = (sources / ("Program" + std::to_string(i))).string();
+			const ShaderHandle handle = library.Load(base + ".vert", base + ".frag");
+			built += library.GetProgram(handle) != 0 ? 1 : 0;
+		}
+
+		const double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		const ShaderLibrary::Stats& stats = library.GetStats();
+
+		std::printf("%-6s %8d %10.2f %12.3f %10.2f %10.2f %6u %6u\n", label, built, totalMs, totalMs / count,
+			stats.CompileMs, stats.CacheLoadMs, stats.CacheHits, stats.CacheMisses);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int count = 100;
+	std::string directory;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--programs") == 0 && i + 1 < argc)
+			count = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+			directory = argv[++i];
+		else
+		{
+			std::cout << "Usage: ShaderCacheBenchmark [--programs N] [--dir path]" << std::endl;
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (count <= 0)
+		return -1;
+
+	if (directory.empty())
+		directory = (std::filesystem::temp_directory_path() / "oglp_shader_bench").string();
+
+	const std::filesystem::path sources = std::filesystem::path(directory) / "src";
+	const std::filesystem::path cache = std::filesystem::path(directory) / "cache";
+	const std::filesystem::path driverCache = std::filesystem::path(directory) / "driver_cache";
+	std::filesystem::remove_all(cache);
+	std::filesystem::remove_all(driverCache);
+
+	if (!WriteShaderSources(sources, count))
+	{
+		std::cerr << "Failed to write shader sources to " << sources.string() << std::endl;
+		return -1;
+	}
+
+	// Must be set before the driver loads
+	setenv("MESA_SHADER_CACHE_DIR", driverCache.string().c_str(), 1);
+	setenv("MESA_GLSL_CACHE_DIR", driverCache.string().c_str(), 1);
+
+	HeadlessContext context;
+	if (!context.Initialize(64, 64))
+		return -1;
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	std::printf("%d programs, %d program binary format(s)\n", count, formatCount);
+	std::printf("%-6s %8s %10s %12s %10s %10s %6s %6s\n", "run", "programs", "total_ms", "per_prog_ms",
+		"compile_ms", "load_ms", "hits", "misses");
+
+	RunStartup("cold", sources, cache, count);
+	RunStartup("warm", sources, cache, count);
+
+	return 0;
+}
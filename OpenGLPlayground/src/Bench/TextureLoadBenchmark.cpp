@@ -0,0 +1,253 @@
+#include "HeadlessContext.h"
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures the async texture loader: time to first frame after queueing N
+// textures, and decode/upload throughput for 1..N worker threads. Usage:
+//   TextureLoadBenchmark [--count N] [--size S] [--dir path] [--cooked path]
+// Without --dir, a set of synthetic PNG files is generated in a temp directory.
+// With --cooked, images that have a cooked version in that directory skip decoding.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+	{
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc ^= data[i];
+			for (int k = 0; k < 8; ++k)
+				crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+		return ~crc;
+	}
+
+	void PutU32(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back(static_cast<unsigned char>(value >> 24));
+		out.push_back(static_cast<unsigned char>(value >> 16));
+		out.push_back(static_cast<unsigned char>(value >> 8));
+		out.push_back(static_cast<unsigned char>(value));
+	}
+
+	void PutChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		PutU32(out, static_cast<uint32_t>(data.size()));
+		const size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		PutU32(out, Crc32(&out[start], out.size() - start));
+	}
+
+	// Writes an RGB PNG using stored (uncompressed) deflate blocks and the Sub
+	// row filter, so decoding still exercises inflate and unfiltering.
+	bool WriteSyntheticPng(const std::string& path, int size, unsigned seed)
+	{
+		std::vector<unsigned char> raw;
+		raw.reserve(static_cast<size_t>(size) * (size * 3 + 1));
+		for (int y = 0; y < size; ++y)
+		{
+			raw.push_back(1); // Sub filter
+			unsigned char previous[3] = { 0, 0, 0 };
+			for (int x = 0; x < size; ++x)
+			{
+				const unsigned char pixel[3] = {
+					static_cast<unsigned char>(x ^ y ^ seed),
+					static_cast<unsigned char>((x * 3 + seed) & 0xFF),
+					static_cast<unsigned char>((y * 5 + seed * 7) & 0xFF)
+				};
+				for (int c = 0; c < 3; ++c)
+				{
+					raw.push_back(static_cast<unsigned char>(pixel[c] - previous[c]));
+					previous[c] = pixel[c];
+				}
+			}
+		}
+
+		std::vector<unsigned char> zlib = { 0x78, 0x01 };
+		for (size_t offset = 0; offset < raw.size(); offset += 65535)
+		{
+			const size_t length = std::min<size_t>(65535, raw.size() - offset);
+			zlib.push_back(offset + length == raw.size() ? 1 : 0);
+			zlib.push_back(static_cast<unsigned char>(length));
+			zlib.push_back(static_cast<unsigned char>(length >> 8));
+			zlib.push_back(static_cast<unsigned char>(~length));
+			zlib.push_back(static_cast<unsigned char>(~length >> 8));
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+		}
+
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (unsigned char value : raw)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+		PutU32(zlib, (b << 16) | a);
+
+		std::vector<unsigned char> header;
+		PutU32(header, static_cast<uint32_t>(size));
+		PutU32(header, static_cast<uint32_t>(size));
+		header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB
+
+		std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		PutChunk(png, "IHDR", header);
+		PutChunk(png, "IDAT", zlib);
+		PutChunk(png, "IEND", {});
+
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+		return static_cast<bool>(file);
+	}
+
+	std::vector<std::string> CollectImages(const std::string& directory)
+	{
+		std::vector<std::string> paths;
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+		{
+			const std::string extension = entry.path().extension().string();
+			if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+				paths.push_back(entry.path().string());
+		}
+		std::sort(paths.begin(), paths.end());
+		return paths;
+	}
+
+	struct RunResult
+	{
+		double FirstFrameMs = 0.0;
+		double TotalMs = 0.0;
+		TextureLoader::Stats Stats;
+	};
+
+	RunResult RunLoad(const std::vector<std::string>& images, const std::string& cookedDirectory, int count, unsigned threads)
+	{
+		RunResult result;
+
+		TextureLoader loader(threads);
+		loader.Initialize();
+		loader.SetCookedDirectory(cookedDirectory);
+
+		const Clock::time_point start = Clock::now();
+
+		for (int i = 0; i < count; ++i)
+		{
+			loader.Load(images[static_cast<size_t>(i) % images.size()]);
+		}
+
+		// First frame: one Update() like Application::Render does
+		loader.Update();
+		glFinish();
+		result.FirstFrameMs = MillisecondsSince(start);
+
+		while (loader.GetPendingCount() > 0)
+		{
+			loader.Update();
+			std::this_thread::yield();
+		}
+		glFinish();
+
+		result.TotalMs = MillisecondsSince(start);
+		result.Stats = loader.GetStats();
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int count = 500;
+	int size = 512;
+	std::string directory;
+	std::string cookedDirectory;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+			count = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			size = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+			directory = argv[++i];
+		else if (std::strcmp(argv[i], "--cooked") == 0 && i + 1 < argc)
+			cookedDirectory = argv[++i];
+		else
+		{
+			std::cout << "Usage: TextureLoadBenchmark [--count N] [--size S] [--dir path] [--cooked path]" << std::endl;
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (count <= 0 || size <= 0)
+		return -1;
+
+	if (directory.empty())
+	{
+		directory = (std::filesystem::temp_directory_path() / "oglp_texture_bench").string();
+		std::filesystem::create_directories(directory);
+		for (unsigned i = 0; i < 16; ++i)
+		{
+			const std::string path = directory + "/synthetic_" + std::to_string(size) + "_" + std::to_string(i) + ".png";
+			if (!std::filesystem::exists(path) && !WriteSyntheticPng(path, size, i))
+			{
+				std::cerr << "Failed to write " << path << std::endl;
+				return -1;
+			}
+		}
+	}
+
+	std::vector<std::string> images = CollectImages(directory);
+	if (images.empty())
+	{
+		std::cerr << "No images found in " << directory << std::endl;
+		return -1;
+	}
+
+	HeadlessContext context;
+	if (!context.Initialize(64, 64))
+		return -1;
+
+	const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned> threadCounts;
+	for (unsigned threads = 1; threads < cores; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(cores);
+
+	// Warm up driver paths (shader JIT for mipmap generation, first allocations)
+	RunLoad(images, cookedDirectory, 4, 1);
+
+	std::printf("%-8s %-8s %14s %12s %12s %10s %8s\n", "threads", "count", "first_frame_ms", "total_ms", "images/s", "MB/s", "cooked");
+
+	for (unsigned threads : threadCounts)
+	{
+		for (int n : { 1, count })
+		{
+			const RunResult r = RunLoad(images, cookedDirectory, n, threads);
+			const double seconds = r.TotalMs / 1000.0;
+			std::printf("%-8u %-8d %14.3f %12.2f %12.1f %10.1f %8u\n",
+				threads, n, r.FirstFrameMs, r.TotalMs,
+				r.Stats.Decoded / seconds,
+				static_cast<double>(r.Stats.DecodedBytes) / (1024.0 * 1024.0) / seconds,
+				r.Stats.Cooked);
+		}
+	}
+
+	return 0;
+}
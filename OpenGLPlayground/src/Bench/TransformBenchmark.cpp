@@ -0,0 +1,186 @@
+#include "JobSystem.h"
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Updates a forest of transforms (1/16 of them roots, three children per node,
+// four levels deep) through TransformSystem with 1, 2, 4, ... threads up to
+// --threads and reports nanoseconds per transform, for a frame where every
+// transform moved and one where only --dirty percent of the roots did. A
+// single-threaded glm::mat4 loop over the same hierarchy is the baseline and
+// checks the results. Usage:
+//   TransformBenchmark [--transforms N] [--frames N] [--threads N] [--dirty PERCENT]
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Local
+	{
+		glm::vec3 Position;
+		glm::quat Rotation;
+		glm::vec3 Scale;
+	};
+
+	TransformHandle ParentOf(size_t index, size_t rootCount)
+	{
+		return index < rootCount ? InvalidTransformHandle : static_cast<TransformHandle>((index - rootCount) / 3);
+	}
+
+	glm::quat RandomRotation(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		return glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+	}
+
+	std::vector<Local> CreateLocals(size_t count)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<Local> locals(count);
+		for (Local& local : locals)
+		{
+			local.Position = glm::vec3(unit(random), unit(random), unit(random)) * 10.0f;
+			local.Rotation = RandomRotation(random);
+			local.Scale = glm::vec3(1.0f + unit(random) * 0.1f);
+		}
+		return locals;
+	}
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int transformCount = 1000000;
+	int frames = 20;
+	int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	double dirtyPercent = 1.0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--transforms") == 0 && hasValue)
+			transformCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+			maxThreads = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--dirty") == 0 && hasValue)
+			dirtyPercent = std::atof(argv[++i]);
+		else
+		{
+			std::cout << "Usage: TransformBenchmark [--transforms N] [--frames N] [--threads N] [--dirty PERCENT]" << std::endl;
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (transformCount < 16 || frames <= 0 || maxThreads <= 0 || dirtyPercent < 0.0)
+		return -1;
+
+	const size_t count = static_cast<size_t>(transformCount);
+	const size_t rootCount = count / 16;
+	const size_t dirtyRoots = std::max<size_t>(1, static_cast<size_t>(rootCount * dirtyPercent / 100.0));
+	const std::vector<Local> locals = CreateLocals(count);
+
+	// Baseline: one glm::mat4 per transform, composed and multiplied in order
+	std::vector<glm::mat4> reference(count);
+	double referenceMs = 0.0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		const Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Local& local = locals[i];
+			const glm::mat4 matrix = glm::translate(glm::mat4(1.0f), local.Position) * glm::mat4_cast(local.Rotation)
+				* glm::scale(glm::mat4(1.0f), local.Scale);
+
+			const TransformHandle parent = ParentOf(i, rootCount);
+			reference[i] = parent == InvalidTransformHandle ? matrix : reference[parent] * matrix;
+		}
+		referenceMs += MillisecondsSince(start);
+	}
+
+	std::printf("%zu transforms (%zu roots), %d frames, %u cores\n", count, rootCount, frames,
+		std::thread::hardware_concurrency());
+	std::printf("%-8s %12s %12s %14s %14s\n", "threads", "all_ns", "all_ms", "dirty_ns", "dirty_updated");
+	std::printf("%-8s %12.2f %12.3f %14s %14s\n", "glm", referenceMs * 1e6 / frames / count, referenceMs / frames,
+		"-", "-");
+
+	for (int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+	{
+		JobSystem jobs(static_cast<unsigned>(threads));
+		TransformSystem transforms(&jobs);
+		transforms.Reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const TransformHandle handle = transforms.Create(ParentOf(i, rootCount));
+			transforms.SetLocal(handle, locals[i].Position, locals[i].Rotation, locals[i].Scale);
+		}
+
+		// Every transform moved; the setters are not timed
+		double allMs = 0.0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (size_t i = 0; i < count; ++i)
+				transforms.SetRotation(static_cast<TransformHandle>(i), locals[i].Rotation);
+
+			transforms.Update();
+			allMs += transforms.GetStats().UpdateMs;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* a = &transforms.GetWorld(static_cast<TransformHandle>(i))[0][0];
+			const float* b = &reference[i][0][0];
+			for (int e = 0; e < 16; ++e)
+			{
+				if (std::fabs(a[e] - b[e]) > 1e-3f * std::max(1.0f, std::fabs(b[e])))
+				{
+					std::cerr << "World matrix " << i << " differs from glm with " << threads << " threads" << std::endl;
+					return -1;
+				}
+			}
+		}
+
+		// A few roots moved; only their subtrees are recomputed
+		double dirtyMs = 0.0;
+		uint32_t dirtyUpdated = 0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (size_t n = 0; n < dirtyRoots; ++n)
+			{
+				const TransformHandle root = static_cast<TransformHandle>((n * 7919 + static_cast<size_t>(frame)) % rootCount);
+				transforms.SetRotation(root, locals[root].Rotation);
+			}
+
+			transforms.Update();
+			dirtyMs += transforms.GetStats().UpdateMs;
+			dirtyUpdated = transforms.GetStats().WorldUpdated;
+		}
+
+		std::printf("%-8d %12.2f %12.3f %14.2f %14u\n", threads, allMs * 1e6 / frames / count, allMs / frames,
+			dirtyMs * 1e6 / frames / count, dirtyUpdated);
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,393 @@
+#include "FrameStats.h"
+#include "GLStateCache.h"
+#include "Hash.h"
+#include "HeadlessContext.h"
+#include "VirtualTexture.h"
+#include "VirtualTextureCooker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Flies a camera low over a plane textured with a large virtual texture and
+// reports what streaming its tiles costs under fixed memory budgets. Usage:
+//   VirtualTextureBenchmark [--size N] [--frames N] [--gpu-budget MB] [--host-budget MB]
+//                           [--uploads N] [--threads N] [--format rgba8|bc1|bc3|bc7]
+// An N x N test pattern is cooked to cache/virtual first, unless an up to
+// date page file is already there; the default 16384 makes a file of about
+// 1.4 GB in RGBA8, far more than the default budgets.
+//
+// Each frame runs the CPU feedback pass, Update() and one draw of the plane.
+// The table shows the streaming state every tenth of the run: tiles the view
+// requested, how many of those were still missing (drawn from a coarser
+// level), pages uploaded and evicted since the last row, and cache use.
+//
+// At the end the camera holds still until every requested tile is resident.
+// Each resident page is then read back from the cache and compared with the
+// page file, and every page table entry is checked against the tile's own
+// page or its nearest resident ancestor.
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr int Width = 1280;
+	constexpr int Height = 720;
+	constexpr float PlaneSize = 100.0f;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	GLuint CompileProgram()
+	{
+		const char* vertexSource = R"(
+			#version 450 core
+			layout(location = 0) uniform mat4 uModelViewProjection;
+			out vec2 vTexCoord;
+			void main()
+			{
+				// Unit quad from the vertex index, as two triangles
+				const vec2 corners[6] = vec2[](vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(0, 0), vec2(1, 1), vec2(0, 1));
+				vTexCoord = corners[gl_VertexID];
+				gl_Position = uModelViewProjection * vec4(vTexCoord - 0.5, 0.0, 1.0);
+			}
+		)";
+
+		const std::string fragmentSource = std::string("#version 450 core\n") + VirtualTexture::ShaderSource + R"(
+			layout(binding = 0) uniform sampler2D uCache;
+			in vec2 vTexCoord;
+			out vec4 FragColor;
+			void main()
+			{
+				FragColor = SampleVirtualTexture(uCache, vTexCoord);
+			}
+		)";
+		const char* fragmentPointer = fragmentSource.c_str();
+
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+		glCompileShader(vertexShader);
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentPointer, nullptr);
+		glCompileShader(fragmentShader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[1024];
+			glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+			std::cerr << "Virtual texture shader failed to link:\n" << infoLog << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	// Camera skimming the plane at 't' in [0, 1]: forward along it, weaving
+	// sideways and rising and falling, so both near detail and the horizon change
+	glm::mat4 GetViewProjection(float t)
+	{
+		const float travel = PlaneSize * 0.4f;
+		const glm::vec3 eye(std::sin(t * 9.0f) * travel * 0.3f, 1.5f + std::sin(t * 5.0f), travel - 2.0f * travel * t);
+		const glm::vec3 target = eye + glm::vec3(std::cos(t * 7.0f) * 0.5f, -0.6f, -1.0f);
+		const glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::perspective(glm::radians(60.0f), static_cast<float>(Width) / Height, 0.1f, 500.0f);
+		return projection * view;
+	}
+
+	// Every resident page must hold exactly the bytes stored for its tile
+	bool ValidatePages(const VirtualTexture& texture, const std::string& path, uint32_t& checked)
+	{
+		const VirtualTextureHeader& header = texture.GetHeader();
+		GLint cacheWidth = 0;
+		GLint cacheHeight = 0;
+		glGetTextureLevelParameteriv(texture.GetCacheTexture(), 0, GL_TEXTURE_WIDTH, &cacheWidth);
+		glGetTextureLevelParameteriv(texture.GetCacheTexture(), 0, GL_TEXTURE_HEIGHT, &cacheHeight);
+
+		const bool compressed = IsBlockCompressed(header.Format);
+		const size_t cacheBytes = GetCookedLevelSize(header.Format, static_cast<uint32_t>(cacheWidth), static_cast<uint32_t>(cacheHeight));
+		std::vector<uint8_t> cache(cacheBytes);
+		if (compressed)
+			glGetCompressedTextureImage(texture.GetCacheTexture(), 0, static_cast<GLsizei>(cacheBytes), cache.data());
+		else
+			glGetTextureImage(texture.GetCacheTexture(), 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<GLsizei>(cacheBytes), cache.data());
+
+		// Rows of texels, or of 4x4 blocks
+		const uint32_t rows = compressed ? header.PageSize / 4 : header.PageSize;
+		const size_t rowBytes = header.PageBytes / rows;
+		const size_t cacheStride = rowBytes * (static_cast<uint32_t>(cacheWidth) / header.PageSize);
+
+		std::ifstream file(path, std::ios::binary);
+		std::vector<uint8_t> page(header.PageBytes);
+		checked = 0;
+
+		for (uint32_t level = 0; level < header.LevelCount; ++level)
+		{
+			const VirtualTextureLevel& info = header.Levels[level];
+			for (uint32_t tileY = 0; tileY < info.TilesY; ++tileY)
+			{
+				for (uint32_t tileX = 0; tileX < info.TilesX; ++tileX)
+				{
+					uint32_t pageX = 0;
+					uint32_t pageY = 0;
+					if (!texture.GetResidentPage(level, tileX, tileY, pageX, pageY))
+						continue;
+
+					const uint64_t tileIndex = info.FirstTile + tileY * info.TilesX + tileX;
+					file.seekg(static_cast<std::streamoff>(header.DataOffset + tileIndex * header.PageBytes));
+					file.read(reinterpret_cast<char*>(page.data()), static_cast<std::streamsize>(page.size()));
+
+					for (uint32_t row = 0; row < rows; ++row)
+					{
+						const uint8_t* cached = cache.data() + (static_cast<size_t>(pageY) * rows + row) * cacheStride + pageX * rowBytes;
+						if (std::memcmp(cached, page.data() + row * rowBytes, rowBytes) != 0)
+						{
+							std::cerr << "Page of tile " << tileIndex << " (level " << level << ") differs from the page file" << std::endl;
+							return false;
+						}
+					}
+					++checked;
+				}
+			}
+		}
+		return static_cast<bool>(file);
+	}
+
+	// Each entry must name the tile's own page, or else that of its nearest resident ancestor
+	bool ValidatePageTable(const VirtualTexture& texture)
+	{
+		const VirtualTextureHeader& header = texture.GetHeader();
+		std::vector<uint32_t> entries(header.TileCount);
+		glGetNamedBufferSubData(texture.GetPageTable(), 288, static_cast<GLsizeiptr>(entries.size() * sizeof(uint32_t)), entries.data());
+
+		for (uint32_t level = 0; level < header.LevelCount; ++level)
+		{
+			const VirtualTextureLevel& info = header.Levels[level];
+			for (uint32_t tileY = 0; tileY < info.TilesY; ++tileY)
+			{
+				for (uint32_t tileX = 0; tileX < info.TilesX; ++tileX)
+				{
+					uint32_t ancestorLevel = level;
+					uint32_t ancestorX = tileX;
+					uint32_t ancestorY = tileY;
+					uint32_t pageX = 0;
+					uint32_t pageY = 0;
+					while (!texture.GetResidentPage(ancestorLevel, ancestorX, ancestorY, pageX, pageY))
+					{
+						++ancestorLevel;
+						ancestorX = std::min(ancestorX / 2, header.Levels[ancestorLevel].TilesX - 1);
+						ancestorY = std::min(ancestorY / 2, header.Levels[ancestorLevel].TilesY - 1);
+					}
+
+					const uint32_t expected = pageX | pageY << 8 | ancestorLevel << 16;
+					if (entries[info.FirstTile + tileY * info.TilesX + tileX] != expected)
+					{
+						std::cerr << "Page table entry for level " << level << " tile " << tileX << "," << tileY << " is wrong" << std::endl;
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t size = 16384;
+	int frames = 600;
+	VirtualTextureSettings settings;
+	VirtualTextureCookSettings cookSettings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			size = static_cast<uint32_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+			settings.GpuBudgetBytes = static_cast<uint64_t>(std::atof(argv[++i]) * 1024 * 1024);
+		else if (std::strcmp(argv[i], "--host-budget") == 0 && i + 1 < argc)
+			settings.HostBudgetBytes = static_cast<uint64_t>(std::atof(argv[++i]) * 1024 * 1024);
+		else if (std::strcmp(argv[i], "--uploads") == 0 && i + 1 < argc)
+			settings.MaxUploadsPerFrame = static_cast<uint32_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			settings.LoaderThreads = static_cast<unsigned>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc && ParseCookedFormat(argv[i + 1], cookSettings.Format))
+			++i;
+		else
+		{
+			std::cout << "Usage: VirtualTextureBenchmark [--size N] [--frames N] [--gpu-budget MB] [--host-budget MB] "
+				"[--uploads N] [--threads N] [--format rgba8|bc1|bc3|bc7]" << std::endl;
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+	}
+
+	if (size == 0 || frames <= 0)
+		return -1;
+
+	const std::string name = "test_pattern_" + std::to_string(size) + "x" + std::to_string(size);
+	const std::string path = GetVirtualTexturePath("cache/virtual", name);
+
+	const Clock::time_point cookStart = Clock::now();
+	const CookResult cooked = CookVirtualTexture(size, size,
+		[size](uint32_t y, uint8_t* row) { GetTestPatternRow(size, size, y, row); },
+		HashString("test pattern"), path, cookSettings);
+	if (cooked == CookResult::Failed)
+		return -1;
+
+	const uint64_t fileBytes = std::filesystem::file_size(path);
+	std::printf("%ux%u test pattern, %s: %.1f MB page file (%s in %.0f ms)\n", size, size, GetCookedFormatName(cookSettings.Format),
+		fileBytes / (1024.0 * 1024.0), cooked == CookResult::Cooked ? "cooked" : "up to date", MillisecondsSince(cookStart));
+
+	HeadlessContext context;
+	if (!context.Initialize(Width, Height))
+		return -1;
+
+	GLStateCache state;
+	VirtualTexture texture;
+	const GLuint program = CompileProgram();
+	if (!program || !texture.Initialize(path, settings))
+		return -1;
+
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+
+	const VirtualTexture::Stats& stats = texture.GetStats();
+	const VirtualTextureHeader& header = texture.GetHeader();
+	std::printf("%u levels, %u tiles of %u texels; cache of %u pages (%.1f MB GPU of %.1f), %.1f MB host of %.1f, %u loader threads\n",
+		header.LevelCount, header.TileCount, header.TileSize, stats.PageCapacity,
+		stats.GpuBytes / (1024.0 * 1024.0), settings.GpuBudgetBytes / (1024.0 * 1024.0),
+		stats.HostBytes / (1024.0 * 1024.0), settings.HostBudgetBytes / (1024.0 * 1024.0), settings.LoaderThreads);
+
+	// Plane in y = 0, facing up
+	const glm::mat4 model = glm::scale(glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(PlaneSize));
+
+	FrameStats frameStats;
+	frameStats.Reserve(static_cast<size_t>(frames));
+	double feedbackMs = 0.0;
+	double updateMs = 0.0;
+	uint64_t requestedSum = 0;
+	uint64_t missingSum = 0;
+
+	auto runFrame = [&](float t)
+	{
+		const glm::mat4 modelViewProjection = GetViewProjection(t) * model;
+
+		Clock::time_point start = Clock::now();
+		texture.BeginFrame();
+		texture.RequestQuad(modelViewProjection, glm::vec2(Width, Height));
+		feedbackMs += MillisecondsSince(start);
+
+		start = Clock::now();
+		texture.Update();
+		updateMs += MillisecondsSince(start);
+
+		context.BindFramebuffer();
+		glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		state.UseProgram(program);
+		state.BindVertexArray(vao);
+		texture.Bind(state, 0);
+		glProgramUniformMatrix4fv(program, 0, 1, GL_FALSE, glm::value_ptr(modelViewProjection));
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		context.Present();
+	};
+
+	std::printf("%-7s %10s %10s %10s %10s %10s %12s\n", "frame", "requested", "missing", "uploaded", "evicted", "loading", "resident");
+
+	uint64_t uploadedSinceRow = 0;
+	uint64_t evictedSinceRow = 0;
+	Clock::time_point last = Clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		runFrame(static_cast<float>(frame) / frames);
+
+		const Clock::time_point now = Clock::now();
+		frameStats.AddFrame(std::chrono::duration<double, std::milli>(now - last).count());
+		last = now;
+
+		requestedSum += stats.Requested;
+		missingSum += stats.Missing;
+		uploadedSinceRow += stats.Uploaded;
+		evictedSinceRow += stats.Evicted;
+
+		if ((frame + 1) % std::max(frames / 10, 1) == 0)
+		{
+			std::printf("%-7d %10u %10u %10llu %10llu %10u %6u/%-5u\n", frame + 1, stats.Requested, stats.Missing,
+				static_cast<unsigned long long>(uploadedSinceRow), static_cast<unsigned long long>(evictedSinceRow),
+				stats.Loading, stats.ResidentPages, stats.PageCapacity);
+			uploadedSinceRow = 0;
+			evictedSinceRow = 0;
+		}
+	}
+
+	const FrameStats::Summary summary = frameStats.Summarize();
+	std::printf("frames: mean %.3f ms, p99 %.3f ms; feedback %.3f ms, update %.3f ms per frame\n",
+		summary.MeanMs, summary.P99Ms, feedbackMs / frames, updateMs / frames);
+	std::printf("streaming: %llu uploads, %llu evictions, %.2f ms mean read-to-upload latency, %.1f%% of requested tiles missing on average\n",
+		static_cast<unsigned long long>(stats.TotalUploaded), static_cast<unsigned long long>(stats.TotalEvicted),
+		stats.MeanLatencyMs, requestedSum > 0 ? 100.0 * missingSum / requestedSum : 0.0);
+
+	// Hold still until the view is complete
+	const float finalT = 1.0f;
+	int settleFrames = 0;
+	for (; settleFrames < 2000; ++settleFrames)
+	{
+		runFrame(finalT);
+		if (stats.Missing == 0 && stats.Loading == 0)
+			break;
+		if (stats.Loading > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	uint32_t checkedPages = 0;
+	const bool complete = stats.Missing == 0;
+	const bool pagesValid = ValidatePages(texture, path, checkedPages);
+	const bool tableValid = ValidatePageTable(texture);
+	const bool withinBudget = stats.GpuBytes <= settings.GpuBudgetBytes && stats.HostBytes <= settings.HostBudgetBytes;
+	const bool noErrors = glGetError() == GL_NO_ERROR;
+
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	std::printf("settled in %d frames: %u tiles requested, %u missing; %u resident pages match the page file, page table %s\n",
+		settleFrames, stats.Requested, stats.Missing, checkedPages, tableValid ? "correct" : "WRONG");
+	std::printf("memory: %.1f MB GPU, %.1f MB host within budget: %s; peak RSS %.1f MB (includes the driver, which keeps textures in RAM on software renderers)\n",
+		stats.GpuBytes / (1024.0 * 1024.0), stats.HostBytes / (1024.0 * 1024.0), withinBudget ? "yes" : "NO",
+		usage.ru_maxrss / 1024.0);
+
+	glDeleteVertexArrays(1, &vao);
+	glDeleteProgram(program);
+
+	if (!complete || !pagesValid || !tableValid || !withinBudget || !noErrors)
+	{
+		std::cerr << "Virtual texture validation failed" << std::endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef OGLP_TRACK_ALLOCATIONS
+namespace
+{
+	// Constant-initialised, so reading them never runs a thread_local
+	// constructor that could itself allocate
+	thread_local AllocationTracker::Counters t_Counters;
+
+	std::atomic<uint64_t> g_Allocations{ 0 };
+	std::atomic<uint64_t> g_Frees{ 0 };
+	std::atomic<uint64_t> g_Bytes{ 0 };
+
+	void CountAllocation(size_t size)
+	{
+		++t_Counters.Allocations;
+		t_Counters.Bytes += size;
+		g_Allocations.fetch_add(1, std::memory_order_relaxed);
+		g_Bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void CountFree()
+	{
+		++t_Counters.Frees;
+		g_Frees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void* Allocate(size_t size)
+	{
+		CountAllocation(size);
+		return std::malloc(size > 0 ? size : 1);
+	}
+
+	void* AllocateAligned(size_t size, std::align_val_t alignment)
+	{
+		CountAllocation(size);
+
+		// aligned_alloc wants a multiple of the alignment
+		const size_t align = static_cast<size_t>(alignment);
+		const size_t rounded = (size + align - 1) / align * align;
+#ifdef _MSC_VER
+		return _aligned_malloc(rounded > 0 ? rounded : align, align);
+#else
+		return std::aligned_alloc(align, rounded > 0 ? rounded : align);
+#endif
+	}
+
+	void Free(void* pointer)
+	{
+		if (!pointer)
+			return;
+
+		CountFree();
+		std::free(pointer);
+	}
+
+	void FreeAligned(void* pointer)
+	{
+		if (!pointer)
+			return;
+
+		CountFree();
+#ifdef _MSC_VER
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+
+	void* AllocateOrThrow(size_t size)
+	{
+		// Same contract as the standard operator new: retry through the new
+		// handler until it gives up
+		for (;;)
+		{
+			if (void* pointer = Allocate(size))
+				return pointer;
+
+			std::new_handler handler = std::get_new_handler();
+			if (!handler)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void* AllocateAlignedOrThrow(size_t size, std::align_val_t alignment)
+	{
+		for (;;)
+		{
+			if (void* pointer = AllocateAligned(size, alignment))
+				return pointer;
+
+			std::new_handler handler = std::get_new_handler();
+			if (!handler)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+}
+
+void* operator new(size_t size) { return AllocateOrThrow(size); }
+void* operator new[](size_t size) { return AllocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, alignment); }
+
+void operator delete(void* pointer) noexcept { Free(pointer); }
+void operator delete[](void* pointer) noexcept { Free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(pointer); }
+
+bool AllocationTracker::IsEnabled()
+{
+	return true;
+}
+
+AllocationTracker::Counters AllocationTracker::GetThreadCounters()
+{
+	return t_Counters;
+}
+
+AllocationTracker::Counters AllocationTracker::GetTotalCounters()
+{
+	return { g_Allocations.load(std::memory_order_relaxed), g_Frees.load(std::memory_order_relaxed),
+		g_Bytes.load(std::memory_order_relaxed) };
+}
+#else
+bool AllocationTracker::IsEnabled()
+{
+	return false;
+}
+
+AllocationTracker::Counters AllocationTracker::GetThreadCounters()
+{
+	return {};
+}
+
+AllocationTracker::Counters AllocationTracker::GetTotalCounters()
+{
+	return {};
+}
+#endif
@@ -1,38 +1,228 @@
 #include "Application.h"
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
+#include <random>
+
+#include "AllocationTracker.h"
+#include "MeshCooker.h"
+#include "Profiler.h"
+
+#ifdef OGLP_HEADLESS
+#include "HeadlessContext.h"
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+namespace
+{
+	// Explicit locations from the shaders, so no name lookups are needed
+	constexpr GLint ModelUniformLocation = 0;
+	constexpr GLuint DiffuseTextureUnit = 0;
+
+	// First field of every sort key
+	constexpr uint32_t OpaquePass = 0;
+
+	constexpr float CameraFar = 100.0f;
+
+	// The virtual texture floor: a square this wide, this far below the scene
+	constexpr float FloorSize = 40.0f;
+	constexpr float FloorHeight = -1.0f;
+
+	// Distinct procedural sprite images, at most one per sprite
+	constexpr int MaxSpriteImages = 1024;
+	constexpr uint32_t SpriteAtlasLayerSize = 1024;
+
+	// Scene objects are unit quads in the XY plane
+	const Aabb QuadBounds = { glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f) };
+
+	// Scene objects per culling or gathering job
+	constexpr size_t ObjectsPerJob = 1024;
+
+	// Starting size of each frame arena; they grow to the peak use if it is exceeded
+	constexpr size_t FrameArenaSize = 1 << 20;
+
+	// A simulation further behind than this drops the time instead of catching up
+	constexpr double MaxSimulationLag = 0.25;
+}
 
 Application::Application(const int width, const int height, const std::string& title)
-	: m_Width(width), m_Height(height), m_Title(title)
+	: m_Width(width), m_Height(height), m_Title(title), m_StartTime(std::chrono::steady_clock::now())
 {
 }
 
 Application::~Application()
 {
+	StopSimulation();
+
 	if (m_VAO) glDeleteVertexArrays(1, &m_VAO);
 	if (m_VBO) glDeleteBuffers(1, &m_VBO);
-	if (m_EBO) glDeleteBuffers(1, &m_EBO);
-	if (m_Texture) glDeleteTextures(1, &m_Texture);
-
+	if (m_SceneVAO) glDeleteVertexArrays(1, &m_SceneVAO);
+	if (m_ObjectMatrixBuffer) glDeleteBuffers(1, &m_ObjectMatrixBuffer);
+	if (m_IndirectBuffer) glDeleteBuffers(1, &m_IndirectBuffer);
+
+	// GL objects above must be released while the context is still alive
+#ifdef OGLP_PROFILE
+	Profiler::ShutdownGpu();
+#endif
+	m_ShaderLibrary.reset();
+	m_UniformBuffers.reset();
+	m_BatchRenderer.reset();
+	m_SpriteAtlas.reset();
+	m_VirtualTexture.reset();
+	m_FrameCapture.reset();
+	m_TextureLoader.reset();
+	m_CommandQueue.reset();
+	m_Transforms.reset();
+	m_Jobs.reset();
+	m_FramePacer.reset();
+	m_HeadlessContext.reset();
+
+#ifndef OGLP_NO_GLFW
 	if (m_Window)
 	{
 		glfwDestroyWindow(m_Window);
 		m_Window = nullptr;
 	}
 
-	glfwTerminate();
+	if (!m_Headless)
+	{
+		glfwTerminate();
+	}
+#endif
+}
+
+void Application::SetHeadless(const HeadlessSettings& settings)
+{
+	m_Headless = true;
+	m_HeadlessSettings = settings;
 }
 
 
 bool Application::Initialize()
 {
+	OGLP_PROFILE_THREAD("Main");
+
+	if (!(m_Headless ? InitializeHeadless() : InitializeWindow()))
+	{
+		return false;
+	}
+
+	std::cout << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
+
+	if (!InitializePacing())
+	{
+		return false;
+	}
+
+	// Set the initial viewport
+	m_GLState.SetViewport(0, 0, m_Width, m_Height);
+
+	m_LastFrameTime = GetTime();
+
+	// Camera matrices are rebuilt and uploaded only when these change
+	m_Camera.SetLookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	m_Camera.SetPerspective(glm::radians(45.0f), 0.1f, CameraFar);
+	m_Camera.SetViewportSize(m_Width, m_Height);
+
+	m_UniformBuffers = std::make_unique<UniformBuffers>();
+	if (!m_UniformBuffers->Initialize(m_GLState))
+	{
+		std::cerr << "Failed to create uniform buffers." << std::endl;
+		return false;
+	}
+	
+	// Shaders come from files, with linked programs cached on disk between runs
+	m_ShaderLibrary = std::make_unique<ShaderLibrary>();
+	m_ShaderLibrary->Initialize("cache/shaders");
+	m_ShaderLibrary->AddIncludeSource("UniformBlocks.glsl", UniformBlockSource);
+	m_ShaderLibrary->AddIncludeSource("VirtualTexture.glsl", VirtualTexture::ShaderSource);
+
+	m_TriangleShader = m_ShaderLibrary->Load("shaders/Triangle.vert", "shaders/Triangle.frag");
+	if (!m_ShaderLibrary->GetProgram(m_TriangleShader))
+	{
+		std::cerr << "Failed to build the triangle shader." << std::endl;
+		return false;
+	}
+
+	m_SceneObjectShader = m_ShaderLibrary->Load("shaders/SceneObject.vert", "shaders/Triangle.frag");
+	if (!m_ShaderLibrary->GetProgram(m_SceneObjectShader))
+	{
+		std::cerr << "Failed to build the scene object shader." << std::endl;
+		return false;
+	}
+
+	// Edit shaders while the window is open
+	if (!m_Headless)
+	{
+		m_ShaderLibrary->EnableHotReload();
+	}
+	
+	// setup GPU resources for triangle
+	SetupTriangle();
+
+	m_Jobs = std::make_unique<JobSystem>();
+	m_FrameArena = std::make_unique<FrameArena>(FrameArenaSize);
+	m_CommandQueue = std::make_unique<CommandQueue>(*m_Jobs);
+	m_Transforms = std::make_unique<TransformSystem>(m_Jobs.get());
+	SetupSceneObjects();
+
+	// Start loading textures in the background; a placeholder is drawn until they arrive
+	m_TextureLoader = std::make_unique<TextureLoader>(*m_Jobs);
+	if (!m_TextureLoader->Initialize())
+	{
+		std::cerr << "Failed to initialize texture loader." << std::endl;
+		return false;
+	}
+
+	// Output of the TextureCooker tool, used when present
+	m_TextureLoader->SetCookedDirectory("assets/cooked");
+
+	m_Texture = m_TextureLoader->Load("assets/Paper_280S.jpg");
+
+	if (!m_VirtualTexturePath.empty() && !SetupFloor())
+		return false;
+
+	if (m_SpriteCount > 0)
+	{
+		m_BatchRenderer = std::make_unique<BatchRenderer>();
+		if (!m_BatchRenderer->Initialize(m_GLState, *m_ShaderLibrary))
+		{
+			std::cerr << "Failed to initialize batch renderer." << std::endl;
+			return false;
+		}
+
+		if (!SetupSprites())
+			return false;
+	}
+
+	if (m_Headless && !m_HeadlessSettings.CapturePath.empty())
+	{
+		const std::string& path = m_HeadlessSettings.CapturePath;
+		FrameCaptureSettings captureSettings;
+		captureSettings.Path = path;
+		captureSettings.Format = std::filesystem::path(path).extension() == ".y4m" ? CaptureFormat::Y4m : CaptureFormat::Png;
+
+		m_FrameCapture = std::make_unique<FrameCapture>();
+		if (!m_FrameCapture->Initialize(m_Width, m_Height, captureSettings))
+			return false;
+	}
+
+	InitializeSimulation();
+
+	return true;
+}
+
+bool Application::InitializeWindow()
+{
+#ifdef OGLP_NO_GLFW
+	std::cerr << "This build has no GLFW support; only headless mode is available" << std::endl;
+	return false;
+#else
 	if (!glfwInit())
 	{
 		std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -54,6 +244,10 @@ bool Application::Initialize()
 
 	glfwMakeContextCurrent(m_Window);
 
+	// Keys arrive as events, which are forwarded to the simulation
+	glfwSetWindowUserPointer(m_Window, this);
+	glfwSetKeyCallback(m_Window, KeyCallback);
+
 	// Load OpenGL functions using GLAD
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
@@ -61,399 +255,998 @@ bool Application::Initialize()
 		return false;
 	}
 
-	std::cout << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
+	return true;
+#endif
+}
 
-	// Set the initial viewport
-	glViewport(0, 0, m_Width, m_Height);
+bool Application::InitializeHeadless()
+{
+#ifdef OGLP_HEADLESS
+	m_HeadlessContext = std::make_unique<HeadlessContext>();
+	return m_HeadlessContext->Initialize(m_Width, m_Height);
+#else
+	std::cerr << "Headless mode is not supported on this platform" << std::endl;
+	return false;
+#endif
+}
 
-	// Optional: Enable V-Sync
-	glfwSwapInterval(1);
+bool Application::InitializePacing()
+{
+	PacingMode mode = m_PacingMode;
+	double rate = m_PacingRate;
+	if (m_Headless)
+	{
+		mode = m_HeadlessSettings.Pacing;
+		rate = m_HeadlessSettings.PacingRate;
+	}
 
-	m_LastFrameTime = glfwGetTime();
-	
-	// setup GPU resources for triangle
-	SetupTriangle();
+#ifndef OGLP_NO_GLFW
+	// Lock to the monitor unless told otherwise
+	if (!m_Headless && rate <= 0.0)
+	{
+		const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		rate = videoMode && videoMode->refreshRate > 0 ? videoMode->refreshRate : 60.0;
+	}
+#endif
 
-	// Load a texture
-	m_Texture = LoadTextureFromFile("assets/Paper_280S.jpg");
-	if (m_Texture == 0)
+	// Without a display, vsync is emulated by the pacer
+	m_FramePacer = std::make_unique<FramePacer>();
+	if (!m_FramePacer->Initialize(mode, rate, m_Headless))
 	{
-		std::cerr << "Failed to load texture." << std::endl;
 		return false;
 	}
 
-	// Tell the shader to use texture unit 0 for uTexture
-	glUseProgram(m_ShaderProgram);
-	if (m_TextureUniformLocation != -1)
+#ifndef OGLP_NO_GLFW
+	if (m_Window)
 	{
-		glUniform1i(m_TextureUniformLocation, 0); // Texture unit 0
+		glfwSwapInterval(m_FramePacer->GetSwapInterval());
 	}
-
-	glUseProgram(0);
+#endif
 
 	return true;
 }
 
 int Application::Run()
 {
+	if (m_Headless)
+	{
+		return RunHeadless();
+	}
+
+	return RunWindowed();
+}
+
+int Application::RunWindowed()
+{
+#ifdef OGLP_NO_GLFW
+	return -1;
+#else
 	if (!m_Window)
 	{
 		std::cerr << "Application not initialized. Call Initialize() before Run()." << std::endl;
 		return -1;
 	}
 
+	StartSimulation();
+
 	while (!glfwWindowShouldClose(m_Window))
 	{
-		double currentTime = glfwGetTime();
+		OGLP_PROFILE_SCOPE("Frame");
+
+		m_FramePacer->BeginFrame();
+
+		double currentTime = GetTime();
 		float deltaTime = static_cast<float>(currentTime - m_LastFrameTime);
 		m_LastFrameTime = currentTime;
 
 		ProcessInput();
+		m_FramePacer->MarkInputSampled();
+
+		// Follow window resizes; the camera rebuilds its projection only if the aspect changed
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(m_Window, &framebufferWidth, &framebufferHeight);
+		if (framebufferWidth != m_Width || framebufferHeight != m_Height)
+		{
+			m_Width = framebufferWidth;
+			m_Height = framebufferHeight;
+			m_GLState.SetViewport(0, 0, m_Width, m_Height);
+			m_Camera.SetViewportSize(m_Width, m_Height);
+		}
+
+		if (!m_Pipelined)
+		{
+			AdvanceSimulation(currentTime);
+		}
+
 		Render(deltaTime);
 
-		glfwSwapBuffers(m_Window);
-		glfwPollEvents();
+		{
+			OGLP_PROFILE_SCOPE("SwapBuffers");
+			glfwSwapBuffers(m_Window);
+			m_FramePacer->EndFrame();
+		}
+	}
+
+	StopSimulation();
+
+#ifdef OGLP_PROFILE
+	if (Profiler::IsCapturing())
+	{
+		Profiler::EndCapture("trace_" + std::to_string(m_CaptureCount) + ".json");
 	}
+#endif
 
 	return 0;
+#endif
+}
+
+int Application::RunHeadless()
+{
+#ifdef OGLP_HEADLESS
+	if (!m_HeadlessContext)
+	{
+		std::cerr << "Application not initialized. Call Initialize() before Run()." << std::endl;
+		return -1;
+	}
+
+	const int warmupFrames = m_HeadlessSettings.WarmupFrames;
+	const int totalFrames = warmupFrames + m_HeadlessSettings.FrameCount;
+
+	m_FrameStats.Clear();
+	m_FrameStats.Reserve(static_cast<size_t>(m_HeadlessSettings.FrameCount));
+
+	m_LastFrameTime = GetTime();
+	StartSimulation();
+
+#ifdef OGLP_PROFILE
+	const bool trace = !m_HeadlessSettings.TracePath.empty();
+#else
+	if (!m_HeadlessSettings.TracePath.empty())
+	{
+		std::cerr << "Built without OGLP_PROFILE; no trace will be written" << std::endl;
+	}
+#endif
+
+	if (m_HeadlessSettings.AssertNoAllocations && !AllocationTracker::IsEnabled())
+	{
+		std::cerr << "Built without OGLP_TRACK_ALLOCATIONS; allocations cannot be checked" << std::endl;
+		return -1;
+	}
+
+	if (m_HeadlessSettings.MaxMissedPercent >= 0.0 && m_HeadlessSettings.Pacing == PacingMode::Uncapped)
+	{
+		std::cerr << "Uncapped frames have no refresh to miss; pick another pacing mode" << std::endl;
+		return -1;
+	}
+
+	// Allocations made by the frame loop on this thread, and by all threads
+	AllocationTracker::Counters frameAllocations;
+	uint64_t maxFrameAllocations = 0;
+	int allocatingFrames = 0;
+	int firstAllocatingFrame = -1;
+	AllocationTracker::Counters timedTotalStart;
+
+	for (int frame = 0; frame < totalFrames; ++frame)
+	{
+		if (frame == warmupFrames)
+		{
+			m_FramePacer->BeginMeasurement(static_cast<size_t>(m_HeadlessSettings.FrameCount));
+			timedTotalStart = AllocationTracker::GetTotalCounters();
+		}
+
+#ifdef OGLP_PROFILE
+		// Capture exactly the timed frames
+		if (trace && frame == warmupFrames)
+		{
+			Profiler::BeginCapture();
+		}
+#endif
+
+		const AllocationTracker::Counters frameStart = AllocationTracker::GetThreadCounters();
+
+		OGLP_PROFILE_SCOPE("Frame");
+
+		m_FramePacer->BeginFrame();
+
+		double currentTime = GetTime();
+		float deltaTime = static_cast<float>(currentTime - m_LastFrameTime);
+		m_LastFrameTime = currentTime;
+
+		// Frame time is measured start-to-start, so it includes the throttle in
+		// Present() and the pacing waits
+		if (frame > warmupFrames)
+		{
+			m_FrameStats.AddFrame(deltaTime * 1000.0);
+		}
+
+		ProcessInput();
+		m_FramePacer->MarkInputSampled();
+
+		if (!m_Pipelined)
+		{
+			AdvanceSimulation(currentTime);
+		}
+
+		m_HeadlessContext->BindFramebuffer();
+		Render(deltaTime);
+
+		if (m_FrameCapture && frame >= warmupFrames)
+		{
+			m_FrameCapture->Capture(m_HeadlessContext->GetFramebuffer());
+		}
+
+		{
+			OGLP_PROFILE_SCOPE("SwapBuffers");
+			m_HeadlessContext->Present();
+			m_FramePacer->EndFrame();
+		}
+
+		if (frame >= warmupFrames)
+		{
+			const AllocationTracker::Counters allocations = AllocationTracker::GetThreadCounters() - frameStart;
+			frameAllocations.Allocations += allocations.Allocations;
+			frameAllocations.Frees += allocations.Frees;
+			frameAllocations.Bytes += allocations.Bytes;
+			maxFrameAllocations = std::max(maxFrameAllocations, allocations.Allocations);
+			if (allocations.Allocations > 0 && allocatingFrames++ == 0)
+			{
+				firstAllocatingFrame = frame - warmupFrames;
+			}
+		}
+	}
+	const AllocationTracker::Counters timedTotal = AllocationTracker::GetTotalCounters() - timedTotalStart;
+
+	// Close out the last frame so every timed frame has an end point
+	glFinish();
+	m_FrameStats.AddFrame((GetTime() - m_LastFrameTime) * 1000.0);
+
+	StopSimulation();
+
+	std::cout << "[" << m_HeadlessSettings.Label << "] " << m_FrameStats.ToString() << std::endl;
+
+	const UniformBuffers::Stats& uniformStats = m_UniformBuffers->GetStats();
+	std::cout << "Uniform uploads: frame " << uniformStats.FrameUploads << ", camera " << uniformStats.CameraUploads
+		<< " (" << uniformStats.CameraUploadsSkipped << " skipped, camera unchanged)" << std::endl;
+
+	const GLStateCache::Counters& stateCalls = m_GLState.GetFrame();
+	const GLStateCache::Counters& totalStateCalls = m_GLState.GetTotal();
+	std::cout << "GL state calls per frame: " << stateCalls.Issued << " issued, " << stateCalls.Elided << " elided ("
+		<< totalStateCalls.Issued << " issued, " << totalStateCalls.Elided << " elided over the run)" << std::endl;
+
+	const CommandQueue::Stats& commandStats = m_CommandQueue->GetStats();
+	std::cout << "Command queue (last frame): " << commandStats.Draws << " draws on " << m_CommandQueue->GetThreadCount()
+		<< " threads, record " << commandStats.RecordMs << " ms, sort " << commandStats.SortMs << " ms ("
+		<< commandStats.SortPasses << " radix passes), execute " << commandStats.ExecuteMs << " ms" << std::endl;
+
+	if (!m_SceneObjects.empty())
+	{
+		std::cout << "Culling (last frame): " << m_CullStats.Visible << " of " << m_SceneObjects.size()
+			<< " objects visible in " << m_CullMs << " ms (" << m_CullStats.NodesTested << " BVH nodes tested, height "
+			<< m_SceneBvh.GetHeight() << "), drawn with 1 multi-draw" << std::endl;
+	}
+
+	if (m_BatchRenderer)
+	{
+		const BatchRenderer::Stats& batchStats = m_BatchRenderer->GetStats();
+		const TextureAtlas::Stats atlasStats = m_SpriteAtlas->GetStats();
+		std::cout << "Sprites (last frame): " << batchStats.Quads << " quads in " << batchStats.DrawCalls << " draws, "
+			<< atlasStats.Images << " distinct images in " << atlasStats.Layers << " atlas layers" << std::endl;
+	}
+
+	if (m_VirtualTexture)
+	{
+		const VirtualTexture::Stats& virtualStats = m_VirtualTexture->GetStats();
+		std::cout << "Virtual texture: " << virtualStats.TotalUploaded << " pages uploaded, " << virtualStats.TotalEvicted
+			<< " evicted over the run, " << virtualStats.ResidentPages << " of " << virtualStats.PageCapacity
+			<< " resident; last frame " << virtualStats.Missing << " of " << virtualStats.Requested
+			<< " requested tiles missing, " << virtualStats.MeanLatencyMs << " ms mean load latency" << std::endl;
+	}
+
+	const TransformSystem::Stats& transformStats = m_Transforms->GetStats();
+	std::cout << "Transforms (last frame): " << transformStats.WorldUpdated << " of " << m_Transforms->GetCount()
+		<< " world matrices updated in " << transformStats.UpdateMs << " ms" << std::endl;
+
+	std::cout << "Simulation (" << (m_Pipelined ? "pipelined" : "serial") << "): " << m_SimulationSteps << " steps at "
+		<< 1.0 / m_SimulationStep << " Hz, " << m_FreshSnapshotFrames << " frames drew a new snapshot, "
+		<< m_ReusedSnapshotFrames << " redrew the last one" << std::endl;
+
+	const FramePacer::Stats pacing = m_FramePacer->Summarize();
+	std::cout << "Pacing (" << GetPacingModeName(m_FramePacer->GetMode());
+	if (pacing.TargetIntervalMs > 0.0)
+	{
+		std::cout << " at " << m_FramePacer->GetRate() << " Hz";
+	}
+	std::cout << "): present interval " << pacing.MeanIntervalMs << " ms mean, jitter " << pacing.JitterMs
+		<< " ms, p99 deviation " << pacing.P99DeviationMs << " ms, " << pacing.Missed << " missed, "
+		<< pacing.MeanWaitMs << " ms waited and " << pacing.MeanDrainMs << " ms draining the GPU per frame" << std::endl;
+	std::cout << "Latency: input to present " << pacing.MeanInputLatencyMs << " ms mean (p99 " << pacing.P99InputLatencyMs
+		<< "), input to GPU done " << pacing.MeanGpuLatencyMs << " ms mean (p99 " << pacing.P99GpuLatencyMs << ")"
+		<< std::endl;
+
+	// Checks that fail still let the capture, report and trace below be written,
+	// so there is something to diagnose the failure from
+	bool passed = true;
+
+	if (m_HeadlessSettings.MaxMissedPercent >= 0.0
+		&& pacing.Missed > m_HeadlessSettings.MaxMissedPercent / 100.0 * static_cast<double>(pacing.Frames))
+	{
+		std::cerr << "Missed " << pacing.Missed << " of " << pacing.Frames << " refreshes, more than "
+			<< m_HeadlessSettings.MaxMissedPercent << "%" << std::endl;
+		passed = false;
+	}
+
+	const LinearArena& arena = m_FrameArena->GetCurrent();
+	std::cout << "Frame arena: peak " << arena.GetPeak() / 1024 << " KB of " << arena.GetCapacity() / 1024 << " KB, "
+		<< arena.GetOverflowCount() << " overflow allocations" << std::endl;
+
+	if (AllocationTracker::IsEnabled())
+	{
+		// Other threads include the simulation, job workers and loaders, whose
+		// work is not all per frame
+		std::cout << "Allocations (timed frames): " << frameAllocations.Allocations << " on the render thread ("
+			<< frameAllocations.Bytes << " bytes) in " << allocatingFrames << " of " << m_HeadlessSettings.FrameCount
+			<< " frames, at most " << maxFrameAllocations << " per frame; "
+			<< timedTotal.Allocations - frameAllocations.Allocations << " on other threads" << std::endl;
+	}
+
+	if (m_HeadlessSettings.AssertNoAllocations && frameAllocations.Allocations > 0)
+	{
+		std::cerr << "Steady-state frames allocated: " << frameAllocations.Allocations << " allocations, first in timed frame "
+			<< firstAllocatingFrame << std::endl;
+		passed = false;
+	}
+
+	if (m_FrameCapture)
+	{
+		// Outside the timed frames: the last few are still being encoded
+		const bool written = m_FrameCapture->Finish();
+		const FrameCapture::Stats captureStats = m_FrameCapture->GetStats();
+		std::cout << "Capture: " << captureStats.Written << " of " << captureStats.Captured << " frames written to "
+			<< m_HeadlessSettings.CapturePath << " (" << captureStats.Bytes / (1024.0 * 1024.0) << " MB), "
+			<< captureStats.Stalls << " frames waited " << captureStats.StallMs << " ms for the "
+			<< m_FrameCapture->GetEncoderCount() << " encoder threads" << std::endl;
+		if (!written)
+		{
+			passed = false;
+		}
+	}
+
+	if (!m_HeadlessSettings.ReportPath.empty()
+		&& !m_FrameStats.WriteReport(m_HeadlessSettings.ReportPath, m_HeadlessSettings.Label))
+	{
+		passed = false;
+	}
+
+#ifdef OGLP_PROFILE
+	if (trace)
+	{
+		Profiler::CaptureStats traceStats;
+		if (Profiler::EndCapture(m_HeadlessSettings.TracePath, &traceStats))
+		{
+			std::cout << "Trace: " << m_HeadlessSettings.TracePath << " (" << traceStats.CpuEvents << " CPU zones, "
+				<< traceStats.GpuEvents << " GPU zones, " << traceStats.DroppedGpuFrames << " GPU frames dropped)" << std::endl;
+		}
+		else
+		{
+			passed = false;
+		}
+	}
+#endif
+
+	return passed ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
+double Application::GetTime() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
 }
 
 void Application::ProcessInput()
 {
-	if (glfwGetKey(m_Window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	OGLP_PROFILE_FUNCTION();
+
+#ifndef OGLP_NO_GLFW
+	// Dispatches KeyCallback
+	if (m_Window)
+	{
+		glfwPollEvents();
+	}
+#endif
+}
+
+#ifndef OGLP_NO_GLFW
+void Application::KeyCallback(GLFWwindow* window, int key, int, int action, int)
+{
+	Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+	if (!app || action == GLFW_REPEAT)
+	{
+		return;
+	}
+
+	const bool pressed = action == GLFW_PRESS;
+
+	// Keys that act on the window or the GL thread are handled here
+	if (key == GLFW_KEY_ESCAPE && pressed)
+	{
+		glfwSetWindowShouldClose(window, true);
+		return;
+	}
+
+#ifdef OGLP_PROFILE
+	// Toggle a capture on each press; captures are numbered trace_0.json, trace_1.json, ...
+	if (key == GLFW_KEY_F9 && pressed)
 	{
-		glfwSetWindowShouldClose(m_Window, true);
+		if (Profiler::IsCapturing())
+		{
+			const std::string path = "trace_" + std::to_string(app->m_CaptureCount++) + ".json";
+			if (Profiler::EndCapture(path))
+			{
+				std::cout << "Wrote profiler capture " << path << std::endl;
+			}
+		}
+		else
+		{
+			Profiler::BeginCapture();
+		}
+		return;
 	}
+#endif
+
+	// The rest belong to the simulation. A full queue means it has stalled, so the event is dropped.
+	app->m_InputEvents.TryPush({ key, pressed });
 }
+#endif
 
 void Application::Render(float DeltaTime)
 {
-	// For now, delta time is unused, but can be utilized for animations or time-based updates.
-	(void)DeltaTime;
+	OGLP_PROFILE_FUNCTION();
+	OGLP_PROFILE_GPU_FRAME();
+	OGLP_PROFILE_GPU_SCOPE("Render");
+
+	m_GLState.BeginFrame();
+	m_FrameArena->BeginFrame();
+
+	// Upload any textures the loader threads finished decoding, rebuild edited shaders
+	m_TextureLoader->Update();
+	m_ShaderLibrary->Update();
 
 	glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Draw the triangle
-	glUseProgram(m_ShaderProgram);
+	// Take the newest snapshot, if the simulation published one since the last frame
+	if (m_Snapshots.Update())
+	{
+		++m_FreshSnapshotFrames;
+	}
+	else
+	{
+		++m_ReusedSnapshotFrames;
+	}
+	const SceneSnapshot& snapshot = m_Snapshots.GetReadBuffer();
+
+	// Draw one step behind the simulation, between its last two states, so
+	// motion stays smooth whatever the frame rate
+	const double currentTime = GetTime();
+	const float alpha = static_cast<float>(std::clamp((currentTime - snapshot.Time) / m_SimulationStep, 0.0, 1.0));
+
+	float timeValue = static_cast<float>(currentTime);
 
-	// compute time value
-	float timeValue = static_cast<float>(glfwGetTime());
-	float angle = timeValue; // Rotate based on time
+	// Frame data changes every frame; camera data only when the camera does
+	m_UniformBuffers->SetFrame(timeValue, DeltaTime);
+	m_UniformBuffers->SetCamera(m_Camera);
 
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::rotate(model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
+	UpdateSceneTransforms(snapshot, alpha);
 
-	// set the uniform, but only if the location is valid
-	if (m_TimeUniformLocation != -1)
+	m_CommandQueue->Reset();
+
+	// The triangle, recorded on this thread
 	{
-		glUniform1f(m_TimeUniformLocation, timeValue);
+		const float depth = glm::length(m_Camera.GetPosition()) / CameraFar;
+		DrawPacket& packet = m_CommandQueue->GetBuffer(0).AddDraw(
+			SortKey::Make(OpaquePass, m_TriangleShader, m_Texture, SortKey::QuantizeDepth(depth)), 1);
+		packet.Program = m_ShaderLibrary->GetProgram(m_TriangleShader);
+		packet.VertexArray = m_VAO;
+		// Bind texture to texture unit 0 (the loader's placeholder until it is ready)
+		packet.Textures[DiffuseTextureUnit] = m_TextureLoader->GetTexture(m_Texture);
+		packet.DepthTest = true;
+		packet.IndexType = m_QuadMesh.GetIndexType();
+		packet.FirstIndex = m_QuadMesh.GetFirstIndex();
+		packet.IndexCount = m_QuadMesh.GetHeader().IndexCount;
+		packet.Uniforms[0] = UniformValue::MakeMat4(ModelUniformLocation, m_Transforms->GetWorld(m_TriangleTransform));
 	}
 
-	if (m_ModelUniformLocation != -1)
+	if (m_VirtualTexture)
 	{
-		glUniformMatrix4fv(
-			m_ModelUniformLocation, 
-			1,
-			GL_FALSE, 
-			glm::value_ptr(model)
-		);
+		RecordFloor(m_CommandQueue->GetBuffer(0));
 	}
 
-	// Simple view and projection matrices
-	glm::vec3 cameraPos		= glm::vec3(0.0f, 0.0f, 3.0f);
-	glm::vec3 cameraTarget	= glm::vec3(0.0f, 0.0f, 0.0f);
-	glm::vec3 cameraUp		= glm::vec3(0.0f, 1.0f, 0.0f);
+	// Scene objects that survive culling, as one indirect multi-draw
+	if (!m_SceneObjects.empty())
+	{
+		CullSceneObjects();
+		RecordSceneObjects(m_CommandQueue->GetBuffer(0));
+	}
 
-	glm::mat4 view = glm::lookAt(
-		cameraPos,
-		cameraTarget,
-		cameraUp
-	);
+	m_CommandQueue->Sort();
 
-	// Projection matrix
-	float aspect = static_cast<float>(m_Width) / static_cast<float>(m_Height);
-	glm::mat4 projection = glm::perspective(
-		glm::radians(45.0f),
-		aspect,
-		0.1f,
-		100.0f
-	);
+	{
+		OGLP_PROFILE_GPU_SCOPE("Scene");
+		if (m_VirtualTexture)
+		{
+			// Packets bind textures only; the floor's page table goes here
+			m_GLState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, VirtualTexture::PageTableBinding, m_VirtualTexture->GetPageTable());
+		}
+		m_CommandQueue->Execute(m_GLState);
+	}
 
-	// Upload them as uniforms
-	if (m_ViewUniformLocation != -1)
+	if (m_BatchRenderer)
 	{
-		glUniformMatrix4fv(
-			m_ViewUniformLocation,
-			1,
-			GL_FALSE,
-			glm::value_ptr(view)
-		);
+		RenderSprites(snapshot, alpha);
 	}
+}
+
+void Application::InitializeSimulation()
+{
+	m_AnimationTime = 0.0;
+	m_SimulationSteps = 0;
+	ComputeSceneState(m_CurrentState, 0.0f);
+	m_PreviousState = m_CurrentState;
+
+	// The renderer always has a snapshot to draw
+	m_SimulationTime = GetTime();
+	PublishSnapshot();
+	m_Snapshots.Update();
+}
 
-	if (m_ProjectionUniformLocation != -1)
+void Application::StartSimulation()
+{
+	// Don't catch up on the time spent loading
+	m_SimulationTime = GetTime();
+
+	if (m_Pipelined && !m_SimulationThread.joinable())
 	{
-		glUniformMatrix4fv(
-			m_ProjectionUniformLocation,
-			1,
-			GL_FALSE,
-			glm::value_ptr(projection)
-		);
+		m_StopSimulation.store(false, std::memory_order_relaxed);
+		m_SimulationThread = std::thread(&Application::SimulationMain, this);
 	}
+}
 
-	// Bind texture to texture unit 0
-	if (m_Texture != 0)
+void Application::StopSimulation()
+{
+	if (m_SimulationThread.joinable())
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, m_Texture);
+		m_StopSimulation.store(true, std::memory_order_relaxed);
+		m_SimulationThread.join();
 	}
+}
 
-	glBindVertexArray(m_VAO);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+void Application::SimulationMain()
+{
+	OGLP_PROFILE_THREAD("Simulation");
 
-	glUseProgram(0);
+	while (!m_StopSimulation.load(std::memory_order_relaxed))
+	{
+		// Sleep until the next step is due
+		const double time = GetTime();
+		const double nextStep = m_SimulationTime + m_SimulationStep;
+		if (time < nextStep)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - time));
+			continue;
+		}
 
+		AdvanceSimulation(time);
+	}
 }
 
-void Application::SetupTriangle()
+void Application::AdvanceSimulation(double time)
 {
-	// 1. Vertex Data for a simple triangle (positions only)
-	float vertices[] = {
-		// x,      y,      z,     r,    g,    b,     u,    v
-		-0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 0.0f,  0.0f, 0.0f, // bottom-left
-		 0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f, // bottom-right
-		 0.5f,  0.5f, 0.0f,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f, // top-right
-		-0.5f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 1.0f, // top-left
-	};
+	OGLP_PROFILE_FUNCTION();
 
-	// 2. Generate and bind VAO and VBO
-	glGenVertexArrays(1, &m_VAO);
-	glGenBuffers(1, &m_VBO);
+	if (time - m_SimulationTime > MaxSimulationLag)
+	{
+		m_SimulationTime = time - m_SimulationStep;
+	}
 
-	glBindVertexArray(m_VAO);
+	bool stepped = false;
+	while (m_SimulationTime + m_SimulationStep <= time)
+	{
+		StepSimulation();
+		stepped = true;
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	if (stepped)
+	{
+		PublishSnapshot();
+	}
+}
 
-	// Indices for 2 triangles using 4 vertices
-	unsigned int indices[] = {
-		0, 1, 2,  // first triangle
-		0, 2, 3   // second triangle
-	};
+void Application::StepSimulation()
+{
+	InputEvent event;
+	while (m_InputEvents.TryPop(event))
+	{
+		HandleInput(event);
+	}
+
+	m_SimulationTime += m_SimulationStep;
+	if (!m_Paused)
+	{
+		m_AnimationTime += m_SimulationStep;
+	}
+	++m_SimulationSteps;
+
+	// Swapping keeps both states' storage, so steps don't allocate
+	std::swap(m_PreviousState, m_CurrentState);
+	ComputeSceneState(m_CurrentState, static_cast<float>(m_AnimationTime));
 
-	glGenBuffers(1, &m_EBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-
-	// position attribute (location 0)
-	glVertexAttribPointer(
-		0,                  // Attribute location
-		3,                  // Number of components (x, y, z)
-		GL_FLOAT,
-		GL_FALSE,
-		8 * sizeof(float),	// Stride 8 floats per vertex
-		(void*)0			// Offset: start of the vertex data
-	);
-	glEnableVertexAttribArray(0);
-
-	// color attribute (location 1)
-	glVertexAttribPointer(
-		1,                                  // Attribute location
-		3,                                  // Number of components (r, g, b)
-		GL_FLOAT,
-		GL_FALSE,
-		8 * sizeof(float),                  // Stride 8 floats per vertex
-		(void*)(3 * sizeof(float))          // Offset: after the first 3 floats (position)
-	);
-	glEnableVertexAttribArray(1);
-
-	// texture coord attribute (location 2)
-	glVertexAttribPointer(
-		2,                                  // Attribute location
-		2,                                  // Number of components (u, v)
-		GL_FLOAT,
-		GL_FALSE,
-		8 * sizeof(float),                  // Stride 8 floats per vertex
-		(void*)(6 * sizeof(float))          // Offset: after the first 6 floats (position + color)
-	);
-	glEnableVertexAttribArray(2);
-
-	// Unbind for cleanliness
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	// 4, Create shaders (inline sources for now)
-
-	const char* vertexShaderSource = R"(
-		#version 450 core
-		layout(location = 0) in vec3 aPos;
-		layout(location = 1) in vec3 aColor;
-		layout(location = 2) in vec2 aTexCoord;
-
-		out vec3 vColor; // to pass to fragment shader
-		out vec2 vTexCoord; // to pass texture coord to fragment shader
-
-		uniform mat4 uModel;
-		uniform mat4 uView;
-		uniform mat4 uProjection;
-
-		void main()
+	// Stand-in for expensive game logic
+	if (m_SimulationCostUs > 0.0)
+	{
+		const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::micro>(m_SimulationCostUs);
+		while (std::chrono::steady_clock::now() < end)
 		{
-			gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0);
-			vColor = aColor; // pass color to fragment shader
-			vTexCoord = aTexCoord; // pass texture coord to fragment shader
 		}
-	)";
+	}
+}
+
+void Application::HandleInput(const InputEvent& event)
+{
+#ifndef OGLP_NO_GLFW
+	// Space pauses the animation
+	if (event.Key == GLFW_KEY_SPACE && event.Pressed)
+	{
+		m_Paused = !m_Paused;
+	}
+#else
+	(void)event;
+#endif
+}
+
+void Application::ComputeSceneState(SceneState& state, float time) const
+{
+	state.TriangleAngle = time;
+
+	state.Sprites.resize(m_Sprites.size());
+	for (size_t i = 0; i < m_Sprites.size(); ++i)
+	{
+		const Sprite& sprite = m_Sprites[i];
+		const float angle = sprite.Phase + time * sprite.Speed;
+		const glm::vec2 position = sprite.Center + sprite.Radius * glm::vec2(std::cos(angle), std::sin(angle));
+		state.Sprites[i] = glm::vec3(position, angle * 2.0f);
+	}
+
+	state.ObjectAngles.resize(m_SceneObjects.size());
+	for (size_t i = 0; i < m_SceneObjects.size(); ++i)
+	{
+		state.ObjectAngles[i] = time * m_SceneObjects[i].Speed;
+	}
+}
 
-	const char* fragmentShaderSource = R"(
-		#version 450 core
-		uniform float uTime;
-		uniform sampler2D uTexture;
-		in vec3 vColor; // from vertex shader
-		in vec2 vTexCoord; // from vertex shader
-		out vec4 FragColor;
+void Application::PublishSnapshot()
+{
+	// Copy assignment reuses the buffer's storage once it has grown
+	SceneSnapshot& snapshot = m_Snapshots.GetWriteBuffer();
+	snapshot.Previous = m_PreviousState;
+	snapshot.Current = m_CurrentState;
+	snapshot.Time = m_SimulationTime;
+	snapshot.Step = m_SimulationSteps;
+	m_Snapshots.Publish();
+}
+
+bool Application::SetupSprites()
+{
+	// Fixed seed so every benchmark run draws the same scene
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// Sprites are placed in pixels, straight through an orthographic projection
+	m_SpriteCamera.SetLookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-		void main()
+	m_SpriteAtlas = std::make_unique<TextureAtlas>();
+	if (!m_SpriteAtlas->Initialize(m_GLState, SpriteAtlasLayerSize, 64, 1, GL_RGBA8, MaxSpriteImages))
+	{
+		std::cerr << "Failed to initialize sprite atlas." << std::endl;
+		return false;
+	}
+
+	// Soft rings of assorted sizes and tints, each its own image
+	std::vector<AtlasHandle> images(static_cast<size_t>(std::min(m_SpriteCount, MaxSpriteImages)));
+	std::vector<uint8_t> pixels;
+	for (AtlasHandle& image : images)
+	{
+		const uint32_t size = 8 + static_cast<uint32_t>(unit(random) * 56.0f);
+		const glm::vec3 tint = glm::vec3(0.5f) + 0.5f * glm::vec3(unit(random), unit(random), unit(random));
+		const float inner = 0.2f + unit(random) * 0.5f;
+
+		pixels.resize(static_cast<size_t>(size) * size * 4);
+		for (uint32_t y = 0; y < size; ++y)
 		{
-			float factor = 0.5 + 0.5 * sin(uTime);
-			vec4 texColor = texture(uTexture, vTexCoord);
-			FragColor = vec4(vColor * factor, 1.0) * texColor;
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				const glm::vec2 p = (glm::vec2(x, y) + 0.5f) / static_cast<float>(size) * 2.0f - 1.0f;
+				const float r = glm::length(p);
+				const float alpha = glm::clamp((1.0f - r) * size * 0.5f, 0.0f, 1.0f) * glm::clamp((r - inner) * size * 0.5f + 1.0f, 0.0f, 1.0f);
+
+				uint8_t* texel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+				texel[0] = static_cast<uint8_t>(tint.r * 255.0f);
+				texel[1] = static_cast<uint8_t>(tint.g * 255.0f);
+				texel[2] = static_cast<uint8_t>(tint.b * 255.0f);
+				texel[3] = static_cast<uint8_t>(alpha * 255.0f);
+			}
 		}
-	)";
 
-	// Compile vertex shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-	glCompileShader(vertexShader);
+		image = m_SpriteAtlas->Add(pixels.data(), size, size);
+		if (image == InvalidAtlasHandle)
+		{
+			std::cerr << "Sprite atlas is full." << std::endl;
+			return false;
+		}
+	}
 
-	GLint success;
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
+	m_Sprites.resize(static_cast<size_t>(m_SpriteCount));
+	for (Sprite& sprite : m_Sprites)
 	{
-		char infoLog[512];
-		glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-		std::cerr << "Vertex shader compilation failed:\n" << infoLog << std::endl;
+		sprite.Center = glm::vec2(unit(random) * m_Width, unit(random) * m_Height);
+		sprite.Radius = 5.0f + unit(random) * 40.0f;
+		sprite.Speed = 0.5f + unit(random) * 2.0f;
+		sprite.Phase = unit(random) * 6.2831853f;
+		sprite.Size = 4.0f + unit(random) * 12.0f;
+		sprite.Color = glm::vec4(unit(random), unit(random), unit(random), 0.5f + unit(random) * 0.5f);
+		sprite.Image = images[static_cast<size_t>(unit(random) * static_cast<float>(images.size())) % images.size()];
 	}
 
-	// Compile fragment shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-	glCompileShader(fragmentShader);
+	return true;
+}
 
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
+void Application::RenderSprites(const SceneSnapshot& snapshot, float alpha)
+{
+	OGLP_PROFILE_FUNCTION();
+	OGLP_PROFILE_GPU_SCOPE("Sprites");
+
+	// Unchanged unless the window was resized, so normally only a rebind
+	m_SpriteCamera.SetOrthographic(0.0f, static_cast<float>(m_Width), 0.0f, static_cast<float>(m_Height));
+	m_UniformBuffers->SetCamera(m_SpriteCamera);
+
+	m_BatchRenderer->Begin();
+
+	for (size_t i = 0; i < m_Sprites.size(); ++i)
 	{
-		char infoLog[512];
-		glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-		std::cerr << "Fragment shader compilation failed:\n" << infoLog << std::endl;
+		const Sprite& sprite = m_Sprites[i];
+		const glm::vec3 state = glm::mix(snapshot.Previous.Sprites[i], snapshot.Current.Sprites[i], alpha);
+		m_BatchRenderer->SubmitQuad(glm::vec2(state), glm::vec2(sprite.Size), state.z, sprite.Color, *m_SpriteAtlas, sprite.Image);
 	}
 
-	// Link shaders into a program
-	m_ShaderProgram = glCreateProgram();
-	glAttachShader(m_ShaderProgram, vertexShader);
-	glAttachShader(m_ShaderProgram, fragmentShader);
-	glLinkProgram(m_ShaderProgram);
+	m_BatchRenderer->End();
+}
 
-	glGetProgramiv(m_ShaderProgram, GL_LINK_STATUS, &success);
+bool Application::SetupFloor()
+{
+	m_VirtualTexture = std::make_unique<VirtualTexture>();
+	if (!m_VirtualTexture->Initialize(m_VirtualTexturePath))
+	{
+		std::cerr << "Failed to open virtual texture " << m_VirtualTexturePath << std::endl;
+		return false;
+	}
 
-	if (!success)
+	m_FloorShader = m_ShaderLibrary->Load("shaders/Triangle.vert", "shaders/VirtualTexture.frag");
+	if (!m_ShaderLibrary->GetProgram(m_FloorShader))
 	{
-		char infoLog[512];
-		glGetProgramInfoLog(m_ShaderProgram, 512, nullptr, infoLog);
-		std::cerr << "Shader program linking failed:\n" << infoLog << std::endl;
+		std::cerr << "Failed to build the virtual texture shader." << std::endl;
+		return false;
 	}
 
-	// NEW: Get uniform location for time
-	m_TimeUniformLocation = glGetUniformLocation(m_ShaderProgram, "uTime");
-	if (m_TimeUniformLocation == -1)
+	// The unit quad laid flat, facing up
+	m_FloorModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, FloorHeight, 0.0f));
+	m_FloorModel = glm::rotate(m_FloorModel, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	m_FloorModel = glm::scale(m_FloorModel, glm::vec3(FloorSize));
+	return true;
+}
+
+void Application::RecordFloor(CommandBuffer& buffer)
+{
+	OGLP_PROFILE_FUNCTION();
+
+	// Work out which tiles this view samples and stream them in; until they
+	// arrive the shader falls back to the nearest coarser level that is resident
+	m_VirtualTexture->BeginFrame();
+	m_VirtualTexture->RequestQuad(m_Camera.GetViewProjection() * m_FloorModel, glm::vec2(m_Width, m_Height));
+	m_VirtualTexture->Update();
+
+	DrawPacket& packet = buffer.AddDraw(SortKey::Make(OpaquePass, m_FloorShader, 0, 0), 1);
+	packet.Program = m_ShaderLibrary->GetProgram(m_FloorShader);
+	packet.VertexArray = m_VAO;
+	packet.Textures[DiffuseTextureUnit] = m_VirtualTexture->GetCacheTexture();
+	packet.DepthTest = true;
+	packet.IndexType = m_QuadMesh.GetIndexType();
+	packet.FirstIndex = m_QuadMesh.GetFirstIndex();
+	packet.IndexCount = m_QuadMesh.GetHeader().IndexCount;
+	packet.Uniforms[0] = UniformValue::MakeMat4(ModelUniformLocation, m_FloorModel);
+}
+
+void Application::SetupSceneObjects()
+{
+	// Fixed seed so every benchmark run draws the same scene
+	std::mt19937 random(4321);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	m_Transforms->Reserve(static_cast<size_t>(m_DrawCount) + 1);
+	m_TriangleTransform = m_Transforms->Create();
+
+	m_SceneObjects.resize(static_cast<size_t>(m_DrawCount));
+	for (SceneObject& object : m_SceneObjects)
 	{
-		std::cerr << "Failed to get uniform location for uTime" << std::endl;
+		object.Position = glm::vec3(unit(random) * 4.0f - 2.0f, unit(random) * 3.0f - 1.5f, unit(random) * -4.0f);
+		object.Scale = 0.02f + unit(random) * 0.08f;
+		object.Speed = unit(random) * 4.0f - 2.0f;
+
+		object.Transform = m_Transforms->Create();
+		m_Transforms->SetLocal(object.Transform, object.Position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(object.Scale));
 	}
 
-	m_ModelUniformLocation = glGetUniformLocation(m_ShaderProgram, "uModel");
-	if (m_ModelUniformLocation == -1)
+	if (m_SceneObjects.empty())
 	{
-		std::cerr << "Failed to get uniform location for uModel" << std::endl;
+		return;
 	}
 
-	m_TextureUniformLocation = glGetUniformLocation(m_ShaderProgram, "uTexture");
-	if (m_TextureUniformLocation == -1)
+	// Bounds as of the first frame; Render() keeps them up to date
+	m_Transforms->Update();
+	m_SceneBvh.Reserve(m_SceneObjects.size());
+	for (size_t i = 0; i < m_SceneObjects.size(); ++i)
 	{
-		std::cerr << "Failed to get uniform location for uTexture" << std::endl;
+		SceneObject& object = m_SceneObjects[i];
+		object.Proxy = m_SceneBvh.Insert(Aabb::Transform(QuadBounds, m_Transforms->GetWorld(object.Transform)),
+			static_cast<uint32_t>(i));
 	}
 
-	m_ViewUniformLocation = glGetUniformLocation(m_ShaderProgram, "uView");
-	if (m_ViewUniformLocation == -1)
+	m_VisibleObjects.reserve(m_SceneObjects.size());
+
+	// Room for every object to be visible
+	glCreateBuffers(1, &m_ObjectMatrixBuffer);
+	glNamedBufferStorage(m_ObjectMatrixBuffer, static_cast<GLsizeiptr>(m_SceneObjects.size() * sizeof(glm::mat4)),
+		nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &m_IndirectBuffer);
+	glNamedBufferStorage(m_IndirectBuffer,
+		static_cast<GLsizeiptr>(m_SceneObjects.size() * sizeof(DrawElementsIndirectCommand)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	// The triangle's quad, plus the model matrix as four instanced vec4 attributes
+	glCreateVertexArrays(1, &m_SceneVAO);
+	const CookedMeshHeader& quad = m_QuadMesh.GetHeader();
+	glVertexArrayVertexBuffer(m_SceneVAO, 0, m_VBO, static_cast<GLintptr>(quad.VertexOffset), quad.VertexStride);
+	glVertexArrayElementBuffer(m_SceneVAO, m_VBO);
+	SetCookedVertexFormat(m_SceneVAO, 0, quad.PositionFormat);
+
+	glVertexArrayVertexBuffer(m_SceneVAO, 1, m_ObjectMatrixBuffer, 0, sizeof(glm::mat4));
+	glVertexArrayBindingDivisor(m_SceneVAO, 1, 1);
+	for (GLuint column = 0; column < 4; ++column)
 	{
-		std::cerr << "Failed to get uniform location for uView" << std::endl;
+		const GLuint attribute = 3 + column;
+		glVertexArrayAttribFormat(m_SceneVAO, attribute, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+		glVertexArrayAttribBinding(m_SceneVAO, attribute, 1);
+		glEnableVertexArrayAttrib(m_SceneVAO, attribute);
 	}
+}
+
+void Application::UpdateSceneTransforms(const SceneSnapshot& snapshot, float alpha)
+{
+	OGLP_PROFILE_FUNCTION();
+
+	const glm::vec3 axis(0.0f, 0.0f, 1.0f);
 
-	m_ProjectionUniformLocation = glGetUniformLocation(m_ShaderProgram, "uProjection");
-	if (m_ProjectionUniformLocation == -1)
+	const float triangleAngle = glm::mix(snapshot.Previous.TriangleAngle, snapshot.Current.TriangleAngle, alpha);
+	m_Transforms->SetRotation(m_TriangleTransform, glm::angleAxis(triangleAngle, axis));
+
+	for (size_t i = 0; i < m_SceneObjects.size(); ++i)
 	{
-		std::cerr << "Failed to get uniform location for uProjection" << std::endl;
+		const float angle = glm::mix(snapshot.Previous.ObjectAngles[i], snapshot.Current.ObjectAngles[i], alpha);
+		m_Transforms->SetRotation(m_SceneObjects[i].Transform, glm::angleAxis(angle, axis));
 	}
 
-	// Shaders are now linked into the program; we can delete the individual objects
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	m_Transforms->Update();
 }
 
-GLuint Application::LoadTextureFromFile(const char* path)
+void Application::CullSceneObjects()
 {
-	int width = 0;
-	int height = 0;
-	int nrChannels = 0;
+	OGLP_PROFILE_FUNCTION();
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-	// Flip vertically so the image's origin matches OpenGL's texture coordinates
-	stbi_set_unpremultiply_on_load(1);
+	// Bounds are independent per object; the tree is not thread-safe, so the
+	// moves that follow stay on this thread
+	Aabb* bounds = m_FrameArena->AllocateArray<Aabb>(m_SceneObjects.size());
+	m_Jobs->ParallelFor(m_SceneObjects.size(), ObjectsPerJob, [this, bounds](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			bounds[i] = Aabb::Transform(QuadBounds, m_Transforms->GetWorld(m_SceneObjects[i].Transform));
+	});
 
-	unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-	if (!data)
+	// Leaves are only reinserted once an object leaves its margin
+	for (size_t i = 0; i < m_SceneObjects.size(); ++i)
 	{
-		std::cerr << "Failed to load texture image: " << path << std::endl;
-		return 0;
+		m_SceneBvh.Move(m_SceneObjects[i].Proxy, bounds[i]);
 	}
 
-	GLenum format = GL_RGB;
-	if (nrChannels == 1)
-		format = GL_RED;
-	else if (nrChannels == 3)
-		format = GL_RGB;
-	else if (nrChannels == 4)
-		format = GL_RGBA;
+	m_VisibleObjects.clear();
+	m_SceneBvh.Cull(Frustum::FromMatrix(m_Camera.GetViewProjection()), m_VisibleObjects, &m_CullStats);
+
+	m_CullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Application::RecordSceneObjects(CommandBuffer& buffer)
+{
+	OGLP_PROFILE_FUNCTION();
+
+	if (m_VisibleObjects.empty())
+	{
+		m_LastCommandCount = 0;
+		return;
+	}
+
+	// One command per visible object; baseInstance picks its matrix
+	const size_t visibleCount = m_VisibleObjects.size();
+	glm::mat4* matrices = m_FrameArena->AllocateArray<glm::mat4>(visibleCount);
+	DrawElementsIndirectCommand* commands = m_FrameArena->AllocateArray<DrawElementsIndirectCommand>(visibleCount);
+	const uint32_t indexCount = m_QuadMesh.GetHeader().IndexCount;
+	const uint32_t firstIndex = m_QuadMesh.GetFirstIndex();
+	m_Jobs->ParallelFor(visibleCount, ObjectsPerJob, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint32_t instance = static_cast<uint32_t>(i);
+			matrices[i] = m_Transforms->GetWorld(m_SceneObjects[m_VisibleObjects[i]].Transform);
+			commands[i] = { indexCount, 1, firstIndex, 0, instance };
+		}
+	});
 
-	GLuint textureID = 0;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	// Last frame's draws may still be reading these; invalidating lets the driver hand out fresh storage
+	glInvalidateBufferData(m_ObjectMatrixBuffer);
+	glNamedBufferSubData(m_ObjectMatrixBuffer, 0, static_cast<GLsizeiptr>(visibleCount * sizeof(glm::mat4)), matrices);
 
-	// Set texture parameters (wrapping and filtering)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Command i only depends on i, so the buffer already holds these unless the count changed
+	if (visibleCount != m_LastCommandCount)
+	{
+		glInvalidateBufferData(m_IndirectBuffer);
+		glNamedBufferSubData(m_IndirectBuffer, 0,
+			static_cast<GLsizeiptr>(visibleCount * sizeof(DrawElementsIndirectCommand)), commands);
+		m_LastCommandCount = visibleCount;
+	}
 
-	// Upload piexel data
-	glTexImage2D(
-		GL_TEXTURE_2D,
-		0,
-		format,
-		width,
-		height,
-		0,
-		format,
-		GL_UNSIGNED_BYTE,
-		data
-	);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	DrawPacket& packet = buffer.AddDraw(SortKey::Make(OpaquePass, m_SceneObjectShader, m_Texture, 0));
+	packet.Program = m_ShaderLibrary->GetProgram(m_SceneObjectShader);
+	packet.VertexArray = m_SceneVAO;
+	packet.Textures[DiffuseTextureUnit] = m_TextureLoader->GetTexture(m_Texture);
+	packet.DepthTest = true;
+	packet.IndexType = m_QuadMesh.GetIndexType();
+	packet.IndirectBuffer = m_IndirectBuffer;
+	packet.DrawCount = static_cast<uint32_t>(visibleCount);
+}
 
-	// Cleanup CPU image data
-	stbi_image_free(data);
+void Application::SetupTriangle()
+{
+	// A quad of two triangles, cooked in memory like meshes from the MeshCooker
+	// tool: 16-byte vertices and 16-bit indices instead of 32 and 32. Half-float
+	// positions hold the corners exactly, so no dequantize transform is needed.
+	MeshData quad;
+	quad.Vertices = {
+		// position,                  color,                        texcoord
+		{ { -0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } }, // bottom-left
+		{ {  0.5f, -0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } }, // bottom-right
+		{ {  0.5f,  0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f } }, // top-right
+		{ { -0.5f,  0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } }, // top-left
+	};
+	quad.Indices = {
+		0, 1, 2,  // first triangle
+		0, 2, 3   // second triangle
+	};
 
-	// Optional: unbind
-	glBindTexture(GL_TEXTURE_2D, 0);
+	MeshCookSettings settings;
+	settings.PositionFormat = CookedPositionFormat::Half;
+	m_QuadMeshData = CookMeshData(quad, settings);
+	m_QuadMesh.OpenMemory(m_QuadMeshData.data(), m_QuadMeshData.size());
 
-	return textureID;
+	// One immutable buffer for indices and vertices; created with DSA, so no bindings change
+	m_VBO = m_QuadMesh.CreateGLBuffer();
+	m_VAO = m_QuadMesh.CreateGLVertexArray(m_VBO);
 }
@@ -0,0 +1,137 @@
+#include "Bounds.h"
+
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGLP_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+Aabb Aabb::Transform(const Aabb& box, const glm::mat4& matrix)
+{
+	// Centre and extents: the new extent on each axis is the sum of the
+	// absolute contributions of the old ones
+	const glm::vec3 center = (box.Min + box.Max) * 0.5f;
+	const glm::vec3 extent = (box.Max - box.Min) * 0.5f;
+
+	const glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+	const glm::vec3 newExtent = glm::abs(glm::vec3(matrix[0])) * extent.x
+		+ glm::abs(glm::vec3(matrix[1])) * extent.y
+		+ glm::abs(glm::vec3(matrix[2])) * extent.z;
+
+	return { newCenter - newExtent, newCenter + newExtent };
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection)
+{
+	// Gribb-Hartmann: each plane is the fourth row plus or minus another row
+	const glm::mat4 m = glm::transpose(viewProjection);
+
+	Frustum frustum;
+	frustum.Planes[0] = m[3] + m[0];	// Left
+	frustum.Planes[1] = m[3] - m[0];	// Right
+	frustum.Planes[2] = m[3] + m[1];	// Bottom
+	frustum.Planes[3] = m[3] - m[1];	// Top
+	frustum.Planes[4] = m[3] + m[2];	// Near
+	frustum.Planes[5] = m[3] - m[2];	// Far
+
+	for (glm::vec4& plane : frustum.Planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	return frustum;
+}
+
+namespace Culling
+{
+	uint32_t TestAabbs4(const Frustum& frustum, const Aabb* const boxes[4], uint32_t& inside)
+	{
+#ifdef OGLP_CULLING_SSE
+		// Boxes to lanes
+		const __m128 minX = _mm_setr_ps(boxes[0]->Min.x, boxes[1]->Min.x, boxes[2]->Min.x, boxes[3]->Min.x);
+		const __m128 minY = _mm_setr_ps(boxes[0]->Min.y, boxes[1]->Min.y, boxes[2]->Min.y, boxes[3]->Min.y);
+		const __m128 minZ = _mm_setr_ps(boxes[0]->Min.z, boxes[1]->Min.z, boxes[2]->Min.z, boxes[3]->Min.z);
+		const __m128 maxX = _mm_setr_ps(boxes[0]->Max.x, boxes[1]->Max.x, boxes[2]->Max.x, boxes[3]->Max.x);
+		const __m128 maxY = _mm_setr_ps(boxes[0]->Max.y, boxes[1]->Max.y, boxes[2]->Max.y, boxes[3]->Max.y);
+		const __m128 maxZ = _mm_setr_ps(boxes[0]->Max.z, boxes[1]->Max.z, boxes[2]->Max.z, boxes[3]->Max.z);
+
+		__m128 outsideAny = _mm_setzero_ps();
+		__m128 crossesAny = _mm_setzero_ps();
+		const __m128 zero = _mm_setzero_ps();
+
+		for (const glm::vec4& plane : frustum.Planes)
+		{
+			// The corner furthest along the normal decides whether the box is
+			// outside, the nearest one whether it is entirely inside
+			const __m128 farX = plane.x >= 0.0f ? maxX : minX;
+			const __m128 farY = plane.y >= 0.0f ? maxY : minY;
+			const __m128 farZ = plane.z >= 0.0f ? maxZ : minZ;
+			const __m128 nearX = plane.x >= 0.0f ? minX : maxX;
+			const __m128 nearY = plane.y >= 0.0f ? minY : maxY;
+			const __m128 nearZ = plane.z >= 0.0f ? minZ : maxZ;
+
+			const __m128 nx = _mm_set1_ps(plane.x);
+			const __m128 ny = _mm_set1_ps(plane.y);
+			const __m128 nz = _mm_set1_ps(plane.z);
+			const __m128 w = _mm_set1_ps(plane.w);
+
+			const __m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, farX), _mm_mul_ps(ny, farY)),
+				_mm_add_ps(_mm_mul_ps(nz, farZ), w));
+			const __m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nearX), _mm_mul_ps(ny, nearY)),
+				_mm_add_ps(_mm_mul_ps(nz, nearZ), w));
+
+			outsideAny = _mm_or_ps(outsideAny, _mm_cmplt_ps(farDistance, zero));
+			crossesAny = _mm_or_ps(crossesAny, _mm_cmplt_ps(nearDistance, zero));
+		}
+
+		const uint32_t outside = static_cast<uint32_t>(_mm_movemask_ps(outsideAny));
+		const uint32_t crosses = static_cast<uint32_t>(_mm_movemask_ps(crossesAny));
+		inside = ~crosses & 0xF;
+		return ~outside & 0xF;
+#else
+		uint32_t visible = 0;
+		inside = 0;
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			const Aabb& box = *boxes[lane];
+			bool outside = false;
+			bool crosses = false;
+			for (const glm::vec4& plane : frustum.Planes)
+			{
+				const glm::vec3 normal(plane);
+				const glm::vec3 farCorner = glm::mix(box.Min, box.Max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+				const glm::vec3 nearCorner = glm::mix(box.Max, box.Min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+				outside |= glm::dot(normal, farCorner) + plane.w < 0.0f;
+				crosses |= glm::dot(normal, nearCorner) + plane.w < 0.0f;
+			}
+			visible |= outside ? 0u : 1u << lane;
+			inside |= crosses ? 0u : 1u << lane;
+		}
+		return visible;
+#endif
+	}
+
+	size_t CullAabbs(const Frustum& frustum, const Aabb* boxes, size_t count, uint32_t* visible)
+	{
+		size_t visibleCount = 0;
+		uint32_t inside = 0;
+
+		for (size_t i = 0; i < count; i += 4)
+		{
+			// The last group repeats its final box; the duplicates are masked off
+			const size_t lanes = count - i < 4 ? count - i : 4;
+			const Aabb* group[4];
+			for (size_t lane = 0; lane < 4; ++lane)
+				group[lane] = &boxes[i + (lane < lanes ? lane : lanes - 1)];
+
+			uint32_t mask = TestAabbs4(frustum, group, inside) & ((1u << lanes) - 1);
+			while (mask)
+			{
+				const uint32_t lane = static_cast<uint32_t>(std::countr_zero(mask));
+				visible[visibleCount++] = static_cast<uint32_t>(i + lane);
+				mask &= mask - 1;
+			}
+		}
+
+		return visibleCount;
+	}
+}
@@ -0,0 +1,342 @@
+#include "Bvh.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+
+DynamicBvh::DynamicBvh(float margin)
+	: m_Margin(margin)
+{
+}
+
+int32_t DynamicBvh::Insert(const Aabb& bounds, uint32_t userData)
+{
+	const int32_t proxy = AllocateNode();
+	m_Nodes[proxy].Bounds = bounds.Expanded(m_Margin);
+	m_Nodes[proxy].UserData = userData;
+	m_Nodes[proxy].Height = 0;
+
+	InsertLeaf(proxy);
+	++m_LeafCount;
+	return proxy;
+}
+
+void DynamicBvh::Remove(int32_t proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--m_LeafCount;
+}
+
+bool DynamicBvh::Move(int32_t proxy, const Aabb& bounds)
+{
+	if (m_Nodes[proxy].Bounds.Contains(bounds))
+		return false;
+
+	RemoveLeaf(proxy);
+	m_Nodes[proxy].Bounds = bounds.Expanded(m_Margin);
+	InsertLeaf(proxy);
+	return true;
+}
+
+void DynamicBvh::Refit(int32_t proxy, const Aabb& bounds)
+{
+	m_Nodes[proxy].Bounds = bounds.Expanded(m_Margin);
+
+	// Stop at the first ancestor whose box does not change
+	for (int32_t node = m_Nodes[proxy].Parent; node != NullNode; node = m_Nodes[node].Parent)
+	{
+		const Aabb fitted = Aabb::Union(m_Nodes[m_Nodes[node].Child1].Bounds, m_Nodes[m_Nodes[node].Child2].Bounds);
+		if (fitted.Min == m_Nodes[node].Bounds.Min && fitted.Max == m_Nodes[node].Bounds.Max)
+			break;
+		m_Nodes[node].Bounds = fitted;
+	}
+}
+
+void DynamicBvh::Clear()
+{
+	m_Nodes.clear();
+	m_Root = NullNode;
+	m_FreeList = NullNode;
+	m_LeafCount = 0;
+}
+
+void DynamicBvh::Reserve(size_t leafCount)
+{
+	// A binary tree with n leaves has n - 1 internal nodes
+	m_Nodes.reserve(leafCount * 2);
+}
+
+void DynamicBvh::Cull(const Frustum& frustum, std::vector<uint32_t>& visible, CullStats* stats)
+{
+	OGLP_PROFILE_FUNCTION();
+
+	const size_t firstVisible = visible.size();
+	uint32_t nodesTested = 0;
+
+	m_Stack.clear();
+	if (m_Root != NullNode)
+		m_Stack.push_back(m_Root);
+
+	while (!m_Stack.empty())
+	{
+		// Up to four nodes per test; a short batch repeats its first node
+		int32_t batch[4] = {};
+		const size_t lanes = std::min<size_t>(4, m_Stack.size());
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			batch[lane] = m_Stack.back();
+			m_Stack.pop_back();
+		}
+		for (size_t lane = lanes; lane < 4; ++lane)
+			batch[lane] = batch[0];
+
+		const Aabb* boxes[4] = { &m_Nodes[batch[0]].Bounds, &m_Nodes[batch[1]].Bounds,
+			&m_Nodes[batch[2]].Bounds, &m_Nodes[batch[3]].Bounds };
+		uint32_t inside = 0;
+		const uint32_t visibleMask = Culling::TestAabbs4(frustum, boxes, inside);
+		nodesTested += static_cast<uint32_t>(lanes);
+
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (!(visibleMask & (1u << lane)))
+				continue;
+
+			const Node& node = m_Nodes[batch[lane]];
+			if (node.IsLeaf())
+			{
+				visible.push_back(node.UserData);
+			}
+			else if (inside & (1u << lane))
+			{
+				// Everything below is visible; collect the leaves without testing
+				m_InsideStack.clear();
+				m_InsideStack.push_back(batch[lane]);
+				while (!m_InsideStack.empty())
+				{
+					const Node& inner = m_Nodes[m_InsideStack.back()];
+					m_InsideStack.pop_back();
+
+					if (inner.IsLeaf())
+					{
+						visible.push_back(inner.UserData);
+					}
+					else
+					{
+						m_InsideStack.push_back(inner.Child1);
+						m_InsideStack.push_back(inner.Child2);
+					}
+				}
+			}
+			else
+			{
+				m_Stack.push_back(node.Child1);
+				m_Stack.push_back(node.Child2);
+			}
+		}
+	}
+
+	if (stats)
+	{
+		stats->NodesTested = nodesTested;
+		stats->Visible = static_cast<uint32_t>(visible.size() - firstVisible);
+	}
+}
+
+int32_t DynamicBvh::AllocateNode()
+{
+	if (m_FreeList == NullNode)
+	{
+		m_Nodes.emplace_back();
+		return static_cast<int32_t>(m_Nodes.size() - 1);
+	}
+
+	const int32_t node = m_FreeList;
+	m_FreeList = m_Nodes[node].Parent;
+	m_Nodes[node] = Node();
+	return node;
+}
+
+void DynamicBvh::FreeNode(int32_t node)
+{
+	m_Nodes[node].Parent = m_FreeList;
+	m_Nodes[node].Height = -1;
+	m_FreeList = node;
+}
+
+void DynamicBvh::InsertLeaf(int32_t leaf)
+{
+	if (m_Root == NullNode)
+	{
+		m_Root = leaf;
+		m_Nodes[leaf].Parent = NullNode;
+		return;
+	}
+
+	// Walk down towards the sibling that adds the least area: stop where a new
+	// parent costs less than descending into either child would
+	const Aabb leafBounds = m_Nodes[leaf].Bounds;
+	int32_t index = m_Root;
+	while (!m_Nodes[index].IsLeaf())
+	{
+		const Node& node = m_Nodes[index];
+		const float area = node.Bounds.GetArea();
+		const float combinedArea = Aabb::Union(node.Bounds, leafBounds).GetArea();
+
+		// A new parent here, and the growth every ancestor below would inherit
+		const float cost = 2.0f * combinedArea;
+		const float inheritance = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		const int32_t children[2] = { node.Child1, node.Child2 };
+		for (int c = 0; c < 2; ++c)
+		{
+			const Node& child = m_Nodes[children[c]];
+			const float unionArea = Aabb::Union(child.Bounds, leafBounds).GetArea();
+			childCosts[c] = (child.IsLeaf() ? unionArea : unionArea - child.Bounds.GetArea()) + inheritance;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	const int32_t sibling = index;
+	const int32_t oldParent = m_Nodes[sibling].Parent;
+	const int32_t newParent = AllocateNode();
+
+	m_Nodes[newParent].Parent = oldParent;
+	m_Nodes[newParent].Bounds = Aabb::Union(leafBounds, m_Nodes[sibling].Bounds);
+	m_Nodes[newParent].Height = m_Nodes[sibling].Height + 1;
+	m_Nodes[newParent].Child1 = sibling;
+	m_Nodes[newParent].Child2 = leaf;
+	m_Nodes[sibling].Parent = newParent;
+	m_Nodes[leaf].Parent = newParent;
+
+	if (oldParent == NullNode)
+	{
+		m_Root = newParent;
+	}
+	else if (m_Nodes[oldParent].Child1 == sibling)
+	{
+		m_Nodes[oldParent].Child1 = newParent;
+	}
+	else
+	{
+		m_Nodes[oldParent].Child2 = newParent;
+	}
+
+	FixUpwards(m_Nodes[leaf].Parent);
+}
+
+void DynamicBvh::RemoveLeaf(int32_t leaf)
+{
+	if (leaf == m_Root)
+	{
+		m_Root = NullNode;
+		return;
+	}
+
+	// The sibling takes the parent's place
+	const int32_t parent = m_Nodes[leaf].Parent;
+	const int32_t grandParent = m_Nodes[parent].Parent;
+	const int32_t sibling = m_Nodes[parent].Child1 == leaf ? m_Nodes[parent].Child2 : m_Nodes[parent].Child1;
+
+	m_Nodes[sibling].Parent = grandParent;
+	FreeNode(parent);
+
+	if (grandParent == NullNode)
+	{
+		m_Root = sibling;
+		return;
+	}
+
+	if (m_Nodes[grandParent].Child1 == parent)
+		m_Nodes[grandParent].Child1 = sibling;
+	else
+		m_Nodes[grandParent].Child2 = sibling;
+
+	FixUpwards(grandParent);
+}
+
+void DynamicBvh::FixUpwards(int32_t node)
+{
+	while (node != NullNode)
+	{
+		node = Balance(node);
+
+		Node& current = m_Nodes[node];
+		const Node& child1 = m_Nodes[current.Child1];
+		const Node& child2 = m_Nodes[current.Child2];
+		current.Height = 1 + std::max(child1.Height, child2.Height);
+		current.Bounds = Aabb::Union(child1.Bounds, child2.Bounds);
+
+		node = current.Parent;
+	}
+}
+
+int32_t DynamicBvh::Balance(int32_t a)
+{
+	Node& nodeA = m_Nodes[a];
+	if (nodeA.IsLeaf() || nodeA.Height < 2)
+		return a;
+
+	const int32_t b = nodeA.Child1;
+	const int32_t c = nodeA.Child2;
+	Node& nodeB = m_Nodes[b];
+	Node& nodeC = m_Nodes[c];
+	const int32_t balance = nodeC.Height - nodeB.Height;
+
+	if (balance > -2 && balance < 2)
+		return a;
+
+	// Rotate the taller child up into A's place; A keeps its shorter child and
+	// takes the shorter of the promoted node's children
+	const bool promoteC = balance > 1;
+	const int32_t up = promoteC ? c : b;
+	const int32_t kept = promoteC ? b : c;
+	Node& nodeUp = m_Nodes[up];
+	const int32_t f = nodeUp.Child1;
+	const int32_t g = nodeUp.Child2;
+	Node& nodeF = m_Nodes[f];
+	Node& nodeG = m_Nodes[g];
+
+	nodeUp.Child1 = a;
+	nodeUp.Parent = nodeA.Parent;
+	nodeA.Parent = up;
+
+	if (nodeUp.Parent == NullNode)
+	{
+		m_Root = up;
+	}
+	else if (m_Nodes[nodeUp.Parent].Child1 == a)
+	{
+		m_Nodes[nodeUp.Parent].Child1 = up;
+	}
+	else
+	{
+		m_Nodes[nodeUp.Parent].Child2 = up;
+	}
+
+	const bool keepF = nodeF.Height > nodeG.Height;
+	const int32_t stays = keepF ? f : g;		// Remains under the promoted node
+	const int32_t moves = keepF ? g : f;		// Goes under A
+
+	nodeUp.Child2 = stays;
+	if (promoteC)
+		nodeA.Child2 = moves;
+	else
+		nodeA.Child1 = moves;
+	m_Nodes[moves].Parent = a;
+
+	const Node& nodeKept = m_Nodes[kept];
+	const Node& nodeMoves = m_Nodes[moves];
+	const Node& nodeStays = m_Nodes[stays];
+	nodeA.Bounds = Aabb::Union(nodeKept.Bounds, nodeMoves.Bounds);
+	nodeA.Height = 1 + std::max(nodeKept.Height, nodeMoves.Height);
+	nodeUp.Bounds = Aabb::Union(nodeA.Bounds, nodeStays.Bounds);
+	nodeUp.Height = 1 + std::max(nodeA.Height, nodeStays.Height);
+
+	return up;
+}
@@ -0,0 +1,68 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+namespace
+{
+	uint8_t* AlignPointer(uint8_t* pointer, size_t alignment)
+	{
+		const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+		return pointer + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+	}
+}
+
+LinearArena::LinearArena(size_t capacity)
+	: m_Capacity(capacity)
+{
+	if (m_Capacity > 0)
+		m_Block.reset(new uint8_t[m_Capacity]);
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	if (m_Block)
+	{
+		uint8_t* base = m_Block.get();
+		uint8_t* aligned = AlignPointer(base + m_Offset, alignment);
+		const size_t end = static_cast<size_t>(aligned - base) + size;
+		if (end <= m_Capacity)
+		{
+			m_Offset = end;
+			m_Peak = std::max(m_Peak, GetUsed());
+			return aligned;
+		}
+	}
+
+	// Sized with room to align, so the same request always fits
+	const size_t overflowSize = size + alignment;
+	m_Overflow.push_back(std::unique_ptr<uint8_t[]>(new uint8_t[overflowSize]));
+	m_OverflowBytes += overflowSize;
+	m_Peak = std::max(m_Peak, GetUsed());
+	++m_OverflowCount;
+	return AlignPointer(m_Overflow.back().get(), alignment);
+}
+
+void LinearArena::Reset()
+{
+	if (!m_Overflow.empty())
+	{
+		// Headroom so a slowly growing workload does not regrow every frame
+		m_Capacity = std::max(m_Capacity, m_Peak + m_Peak / 4);
+		m_Block.reset(new uint8_t[m_Capacity]);
+
+		m_Overflow.clear();
+		m_OverflowBytes = 0;
+	}
+
+	m_Offset = 0;
+}
+
+FrameArena::FrameArena(size_t capacity)
+	: m_Arena(capacity)
+{
+}
+
+void FrameArena::BeginFrame()
+{
+	m_Arena.Reset();
+}
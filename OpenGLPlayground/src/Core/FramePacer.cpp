@@ -0,0 +1,328 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+#include "Profiler.h"
+
+namespace
+{
+	// LowLatency starts a frame this much earlier than its predicted cost
+	// requires, to absorb small misses
+	constexpr double LowLatencyMargin = 0.001;
+
+	// How quickly the frame cost estimate follows new frames
+	constexpr double CostWeight = 0.05;
+
+	// Deviations above the mean cost a frame is given, so ordinary variation does not miss a refresh
+	constexpr double CostDeviations = 3.0;
+
+	// Sleeps measured before the sleep estimate starts over, so it follows changes in load
+	constexpr uint32_t SleepSamples = 1000;
+
+	// Nearest-rank percentile; sorts 'values'
+	double Percentile(std::vector<double>& values, double percent)
+	{
+		if (values.empty())
+			return 0.0;
+
+		std::sort(values.begin(), values.end());
+		size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(values.size())));
+		rank = std::clamp<size_t>(rank, 1, values.size());
+		return values[rank - 1];
+	}
+
+	double Mean(const std::vector<double>& values)
+	{
+		return values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+	}
+}
+
+const char* GetPacingModeName(PacingMode mode)
+{
+	switch (mode)
+	{
+	case PacingMode::VSync: return "vsync";
+	case PacingMode::Uncapped: return "uncapped";
+	case PacingMode::Limited: return "limited";
+	case PacingMode::LowLatency: return "low-latency";
+	}
+	return "unknown";
+}
+
+bool ParsePacingMode(const char* name, PacingMode& mode)
+{
+	for (PacingMode candidate : { PacingMode::VSync, PacingMode::Uncapped, PacingMode::Limited, PacingMode::LowLatency })
+	{
+		if (std::strcmp(name, GetPacingModeName(candidate)) == 0)
+		{
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+FramePacer::~FramePacer()
+{
+	if (m_Queries[0])
+		glDeleteQueries(TimestampQueries, m_Queries);
+}
+
+bool FramePacer::Initialize(PacingMode mode, double rate, bool virtualDisplay)
+{
+	if (mode != PacingMode::Uncapped && !(rate > 0.0))
+	{
+		std::cerr << "Frame pacing mode " << GetPacingModeName(mode) << " needs a positive rate" << std::endl;
+		return false;
+	}
+
+	m_Mode = mode;
+	m_Period = mode == PacingMode::Uncapped ? 0.0 : 1.0 / rate;
+	m_VirtualDisplay = virtualDisplay;
+
+	if (!m_Queries[0])
+		glCreateQueries(GL_TIMESTAMP, TimestampQueries, m_Queries);
+
+	// Current GPU time, without waiting for queued commands
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	const double now = Now();
+	m_CpuMinusGpu = now - static_cast<double>(gpuNow) * 1e-9;
+
+	m_NextStart = now;
+	m_RefreshOrigin = now;
+	m_CostMean = 0.0;
+	m_CostDeviation = 0.0;
+	m_LastPresent = now;
+	return true;
+}
+
+void FramePacer::BeginFrame()
+{
+	OGLP_PROFILE_FUNCTION();
+
+	const double start = Now();
+	m_CostFrom = start;
+
+	if (m_Mode == PacingMode::Limited)
+	{
+		// More than a frame behind: restart the schedule rather than rush to catch up
+		if (start > m_NextStart + m_Period)
+			m_NextStart = start;
+
+		WaitUntil(m_NextStart);
+		m_NextStart += m_Period;
+	}
+	else if (m_Mode == PacingMode::LowLatency)
+	{
+		// Aim for the first refresh the frame can still make, and start just in time for it.
+		// A frame that needs more than a refresh cannot start late, so it starts right away.
+		const double lead = m_CostMean + CostDeviations * m_CostDeviation + LowLatencyMargin;
+		if (lead < m_Period)
+		{
+			m_CostFrom = std::max(start, GetNextRefresh(start + lead) - lead);
+			WaitUntil(m_CostFrom);
+		}
+	}
+
+	m_FrameStart = Now();
+	m_FrameWait = m_FrameStart - start;
+	m_InputTime = m_FrameStart;
+}
+
+void FramePacer::MarkInputSampled()
+{
+	m_InputTime = Now();
+}
+
+void FramePacer::EndFrame()
+{
+	OGLP_PROFILE_FUNCTION();
+
+	// Taken before anything else, so the refresh phase is not skewed by the GPU drain
+	double present = Now();
+	const bool locked = m_Period > 0.0 && GetSwapInterval() == 1;
+	if (locked && !m_VirtualDisplay)
+	{
+		// The swap blocked until a refresh, or close enough after one
+		m_RefreshOrigin = present;
+	}
+
+	if (m_Measuring)
+	{
+		// A timestamp the GPU writes once it has finished the frame
+		if (m_PendingCount == TimestampQueries)
+			ResolveTimestamps(TimestampQueries - 1);
+
+		const uint32_t slot = (m_PendingBegin + m_PendingCount) % TimestampQueries;
+		glQueryCounter(m_Queries[slot], GL_TIMESTAMP);
+		m_PendingInputTimes[slot] = m_InputTime;
+		++m_PendingCount;
+	}
+
+	double drain = 0.0;
+	if (m_Mode == PacingMode::LowLatency)
+	{
+		// Queue depth zero: the next frame samples input only after this one is done
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+
+		// Counted from when the frame was due to start, so waits that overshoot are part of the cost
+		const double drained = Now();
+		drain = drained - present;
+		const double cost = drained - m_CostFrom;
+		const double error = cost - m_CostMean;
+		m_CostMean += error * CostWeight;
+		m_CostDeviation += (std::abs(error) - m_CostDeviation) * CostWeight;
+	}
+	else if (m_Measuring)
+	{
+		// Otherwise the timestamp would wait for the next frame's commands to be submitted
+		glFlush();
+	}
+
+	if (locked && m_VirtualDisplay)
+	{
+		// The virtual display shows the frame at the first refresh after it is complete
+		const double ready = Now();
+		WaitUntil(GetNextRefresh(ready));
+		present = Now();
+		m_FrameWait += present - ready;
+	}
+
+	ResolveTimestamps(TimestampQueries);
+
+	if (m_Measuring)
+	{
+		m_IntervalsMs.push_back((present - m_LastPresent) * 1000.0);
+		m_WaitsMs.push_back(m_FrameWait * 1000.0);
+		m_DrainsMs.push_back(drain * 1000.0);
+		m_InputLatenciesMs.push_back((present - m_InputTime) * 1000.0);
+	}
+	m_LastPresent = present;
+}
+
+void FramePacer::BeginMeasurement(size_t frameCount)
+{
+	for (std::vector<double>* samples : { &m_IntervalsMs, &m_WaitsMs, &m_DrainsMs, &m_InputLatenciesMs, &m_GpuLatenciesMs })
+	{
+		samples->clear();
+		samples->reserve(frameCount);
+	}
+
+	m_Measuring = true;
+}
+
+FramePacer::Stats FramePacer::Summarize()
+{
+	ResolveTimestamps(0);
+
+	Stats stats;
+	stats.Frames = m_IntervalsMs.size();
+	stats.TargetIntervalMs = m_Period * 1000.0;
+	if (m_IntervalsMs.empty())
+		return stats;
+
+	stats.MeanIntervalMs = Mean(m_IntervalsMs);
+
+	double variance = 0.0;
+	std::vector<double> deviations;
+	deviations.reserve(m_IntervalsMs.size());
+	const double expected = stats.TargetIntervalMs > 0.0 ? stats.TargetIntervalMs : stats.MeanIntervalMs;
+	for (double interval : m_IntervalsMs)
+	{
+		variance += (interval - stats.MeanIntervalMs) * (interval - stats.MeanIntervalMs);
+		deviations.push_back(std::abs(interval - expected));
+		if (stats.TargetIntervalMs > 0.0 && interval > stats.TargetIntervalMs * 1.5)
+			++stats.Missed;
+	}
+	stats.JitterMs = std::sqrt(variance / static_cast<double>(m_IntervalsMs.size()));
+	stats.P99DeviationMs = Percentile(deviations, 99.0);
+
+	stats.MeanWaitMs = Mean(m_WaitsMs);
+	stats.MeanDrainMs = Mean(m_DrainsMs);
+
+	std::vector<double> latencies = m_InputLatenciesMs;
+	stats.MeanInputLatencyMs = Mean(latencies);
+	stats.P99InputLatencyMs = Percentile(latencies, 99.0);
+
+	latencies = m_GpuLatenciesMs;
+	stats.MeanGpuLatencyMs = Mean(latencies);
+	stats.P99GpuLatencyMs = Percentile(latencies, 99.0);
+
+	return stats;
+}
+
+double FramePacer::Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FramePacer::WaitUntil(double deadline)
+{
+	// Sleep while the deadline is further off than a sleep tends to take
+	for (;;)
+	{
+		const double start = Now();
+		if (deadline - start <= m_SleepEstimate)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		const double observed = Now() - start;
+
+		if (m_SleepCount >= SleepSamples)
+		{
+			m_SleepCount = 1;
+			m_SleepM2 = 0.0;
+		}
+
+		++m_SleepCount;
+		const double delta = observed - m_SleepMean;
+		m_SleepMean += delta / m_SleepCount;
+		m_SleepM2 += delta * (observed - m_SleepMean);
+		m_SleepEstimate = m_SleepMean + std::sqrt(m_SleepM2 / (m_SleepCount - 1));
+	}
+
+	// Spin out the rest, yielding so other threads on this core still run
+	while (Now() < deadline)
+		std::this_thread::yield();
+}
+
+double FramePacer::GetNextRefresh(double after) const
+{
+	if (m_Period <= 0.0)
+		return after;
+
+	const double refreshes = std::ceil((after - m_RefreshOrigin) / m_Period);
+	return m_RefreshOrigin + std::max(refreshes, 0.0) * m_Period;
+}
+
+void FramePacer::ResolveTimestamps(uint32_t maxPending)
+{
+	while (m_PendingCount > 0)
+	{
+		const uint32_t slot = m_PendingBegin;
+		if (m_PendingCount <= maxPending)
+		{
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(m_Queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+		}
+
+		GLuint64 gpuTime = 0;
+		glGetQueryObjectui64v(m_Queries[slot], GL_QUERY_RESULT, &gpuTime);
+		const double done = static_cast<double>(gpuTime) * 1e-9 + m_CpuMinusGpu;
+		m_GpuLatenciesMs.push_back((done - m_PendingInputTimes[slot]) * 1000.0);
+
+		m_PendingBegin = (slot + 1) % TimestampQueries;
+		--m_PendingCount;
+	}
+}
@@ -0,0 +1,149 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+	// Nearest-rank percentile on an already sorted list
+	double Percentile(const std::vector<double>& sorted, double percent)
+	{
+		if (sorted.empty())
+			return 0.0;
+
+		size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(sorted.size())));
+		rank = std::clamp<size_t>(rank, 1, sorted.size());
+		return sorted[rank - 1];
+	}
+
+	bool EndsWith(const std::string& value, const std::string& suffix)
+	{
+		return value.size() >= suffix.size()
+			&& value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	// Quote, backslash and control characters escaped for a JSON string
+	void WriteJsonEscaped(std::ostream& out, const std::string& text)
+	{
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\')
+				out << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+				out << escaped;
+			}
+			else
+				out << c;
+		}
+	}
+
+	// Fields with a comma, quote or line break are quoted, with quotes doubled
+	void WriteCsvField(std::ostream& out, const std::string& text)
+	{
+		if (text.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			out << text;
+			return;
+		}
+
+		out << '"';
+		for (const char c : text)
+		{
+			if (c == '"')
+				out << '"';
+			out << c;
+		}
+		out << '"';
+	}
+}
+
+FrameStats::Summary FrameStats::Summarize() const
+{
+	Summary summary;
+	if (m_FrameTimesMs.empty())
+		return summary;
+
+	std::vector<double> sorted = m_FrameTimesMs;
+	std::sort(sorted.begin(), sorted.end());
+
+	const double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+
+	summary.FrameCount = sorted.size();
+	summary.MinMs = sorted.front();
+	summary.MaxMs = sorted.back();
+	summary.MeanMs = total / static_cast<double>(sorted.size());
+	summary.P50Ms = Percentile(sorted, 50.0);
+	summary.P99Ms = Percentile(sorted, 99.0);
+	summary.Fps = summary.MeanMs > 0.0 ? 1000.0 / summary.MeanMs : 0.0;
+
+	return summary;
+}
+
+bool FrameStats::WriteReport(const std::string& path, const std::string& label) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open benchmark report: " << path << std::endl;
+		return false;
+	}
+
+	const Summary s = Summarize();
+	file << std::fixed << std::setprecision(4);
+
+	if (EndsWith(path, ".json"))
+	{
+		file << "{\n"
+			<< "  \"label\": \"";
+		WriteJsonEscaped(file, label);
+		file << "\",\n"
+			<< "  \"frames\": " << s.FrameCount << ",\n"
+			<< "  \"min_ms\": " << s.MinMs << ",\n"
+			<< "  \"mean_ms\": " << s.MeanMs << ",\n"
+			<< "  \"p50_ms\": " << s.P50Ms << ",\n"
+			<< "  \"p99_ms\": " << s.P99Ms << ",\n"
+			<< "  \"max_ms\": " << s.MaxMs << ",\n"
+			<< "  \"fps\": " << s.Fps << "\n"
+			<< "}\n";
+	}
+	else
+	{
+		file << "label,frames,min_ms,mean_ms,p50_ms,p99_ms,max_ms,fps\n";
+		WriteCsvField(file, label);
+		file << ','
+			<< s.FrameCount << ','
+			<< s.MinMs << ','
+			<< s.MeanMs << ','
+			<< s.P50Ms << ','
+			<< s.P99Ms << ','
+			<< s.MaxMs << ','
+			<< s.Fps << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
+
+std::string FrameStats::ToString() const
+{
+	const Summary s = Summarize();
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3)
+		<< s.FrameCount << " frames | "
+		<< "min " << s.MinMs << " ms, "
+		<< "mean " << s.MeanMs << " ms, "
+		<< "p50 " << s.P50Ms << " ms, "
+		<< "p99 " << s.P99Ms << " ms, "
+		<< "max " << s.MaxMs << " ms | "
+		<< std::setprecision(1) << s.Fps << " fps";
+	return out.str();
+}
@@ -0,0 +1,161 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+HeadlessContext::~HeadlessContext()
+{
+	Destroy();
+}
+
+bool HeadlessContext::Initialize(const int width, const int height)
+{
+	m_Width = width;
+	m_Height = height;
+
+	// Prefer the surfaceless platform so no X11/Wayland server is needed,
+	// and fall back to the default display otherwise.
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+		eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay)
+	{
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0;
+	EGLint minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cerr << "Failed to initialize EGL display" << std::endl;
+		return false;
+	}
+	m_Display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "EGL does not support desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	// A pbuffer-capable config is only needed when the driver lacks
+	// EGL_KHR_surfaceless_context; with it we never create a surface.
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+	// Request an OpenGL 4.5 core profile context, same as the windowed path
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cerr << "Failed to create EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		return false;
+	}
+	m_Context = context;
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cerr << "Failed to make surfaceless EGL context current" << std::endl;
+		return false;
+	}
+
+	// Load OpenGL functions using GLAD
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+	{
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+
+	return CreateFramebuffer();
+}
+
+bool HeadlessContext::CreateFramebuffer()
+{
+	glGenRenderbuffers(1, &m_ColorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_ColorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_Width, m_Height);
+
+	glGenRenderbuffers(1, &m_DepthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_DepthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthRenderbuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void HeadlessContext::BindFramebuffer() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+}
+
+void HeadlessContext::Present()
+{
+	GLsync& fence = m_FrameFences[m_FrameIndex];
+	if (fence)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+	}
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	m_FrameIndex = (m_FrameIndex + 1) % MaxFramesInFlight;
+}
+
+void HeadlessContext::Destroy()
+{
+	if (m_Context)
+	{
+		for (GLsync& fence : m_FrameFences)
+		{
+			if (fence) glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		if (m_FBO) glDeleteFramebuffers(1, &m_FBO);
+		if (m_ColorRenderbuffer) glDeleteRenderbuffers(1, &m_ColorRenderbuffer);
+		if (m_DepthRenderbuffer) glDeleteRenderbuffers(1, &m_DepthRenderbuffer);
+
+		eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(m_Display, m_Context);
+		m_Context = nullptr;
+	}
+
+	if (m_Display)
+	{
+		eglTerminate(m_Display);
+		m_Display = nullptr;
+	}
+}
@@ -0,0 +1,506 @@
+#include "ImageEncoders.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// ---------------------------------------------------------------------
+	// Deflate with fixed Huffman codes (RFC 1951)
+
+	constexpr uint32_t WindowSize = 32768;
+	constexpr uint32_t MinMatch = 3;
+	constexpr uint32_t MaxMatch = 258;
+	constexpr uint32_t HashBits = 15;
+	constexpr uint32_t MaxChain = 16;		// Candidates tried per position; more compresses little better, much slower
+
+	constexpr uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+		67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+		4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+		513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+		8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	uint32_t ReverseBits(uint32_t value, unsigned count)
+	{
+		uint32_t reversed = 0;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			reversed = (reversed << 1) | (value & 1);
+			value >>= 1;
+		}
+		return reversed;
+	}
+
+	// Codes are stored bit-reversed, since deflate packs Huffman codes from their most significant bit
+	struct FixedCodes
+	{
+		uint16_t Literal[288];
+		uint8_t LiteralBits[288];
+		uint16_t Distance[30];
+		uint8_t LengthCode[MaxMatch + 1];		// Index into LengthBase for each match length
+		uint8_t DistanceCode[512];				// For distances up to 256 by distance - 1, beyond by (distance - 1) >> 7
+
+		FixedCodes()
+		{
+			for (uint32_t symbol = 0; symbol < 288; ++symbol)
+			{
+				uint32_t code = 0;
+				uint8_t bits = 0;
+				if (symbol < 144) { code = 0x30 + symbol; bits = 8; }
+				else if (symbol < 256) { code = 0x190 + symbol - 144; bits = 9; }
+				else if (symbol < 280) { code = symbol - 256; bits = 7; }
+				else { code = 0xC0 + symbol - 280; bits = 8; }
+				Literal[symbol] = static_cast<uint16_t>(ReverseBits(code, bits));
+				LiteralBits[symbol] = bits;
+			}
+
+			for (uint32_t code = 0; code < 30; ++code)
+				Distance[code] = static_cast<uint16_t>(ReverseBits(code, 5));
+
+			for (uint32_t code = 0; code < 29; ++code)
+			{
+				const uint32_t end = code + 1 < 29 ? LengthBase[code + 1] : MaxMatch + 1;
+				for (uint32_t length = LengthBase[code]; length < end; ++length)
+					LengthCode[length] = static_cast<uint8_t>(code);
+			}
+
+			for (uint32_t code = 0; code < 30; ++code)
+			{
+				const uint32_t end = code + 1 < 30 ? DistanceBase[code + 1] : WindowSize + 1;
+				for (uint32_t distance = DistanceBase[code]; distance < end; ++distance)
+				{
+					if (distance <= 256)
+						DistanceCode[distance - 1] = static_cast<uint8_t>(code);
+					else
+						DistanceCode[256 + ((distance - 1) >> 7)] = static_cast<uint8_t>(code);
+				}
+			}
+		}
+
+		uint32_t GetDistanceCode(uint32_t distance) const
+		{
+			return distance <= 256 ? DistanceCode[distance - 1] : DistanceCode[256 + ((distance - 1) >> 7)];
+		}
+	};
+
+	const FixedCodes& GetFixedCodes()
+	{
+		static const FixedCodes codes;
+		return codes;
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& output) : m_Output(output) {}
+
+		void Put(uint32_t value, unsigned count)
+		{
+			m_Bits |= static_cast<uint64_t>(value) << m_Count;
+			m_Count += count;
+			while (m_Count >= 8)
+			{
+				m_Output.push_back(static_cast<uint8_t>(m_Bits));
+				m_Bits >>= 8;
+				m_Count -= 8;
+			}
+		}
+
+		// Pad to a byte boundary
+		void Flush()
+		{
+			if (m_Count > 0)
+				m_Output.push_back(static_cast<uint8_t>(m_Bits));
+			m_Bits = 0;
+			m_Count = 0;
+		}
+
+	private:
+		std::vector<uint8_t>& m_Output;
+		uint64_t m_Bits = 0;
+		unsigned m_Count = 0;
+	};
+
+	uint32_t Hash3(const uint8_t* data)
+	{
+		const uint32_t value = data[0] | data[1] << 8 | data[2] << 16;
+		return (value * 2654435761u) >> (32 - HashBits);
+	}
+
+	// One final fixed-Huffman block holding the whole input
+	void Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& output)
+	{
+		const FixedCodes& codes = GetFixedCodes();
+		BitWriter writer(output);
+		writer.Put(1, 1);	// BFINAL
+		writer.Put(1, 2);	// BTYPE = fixed Huffman
+
+		// Most recent position for each hash, and the previous one with the same
+		// hash for each position in the window
+		std::vector<int32_t> head(size_t(1) << HashBits, -1);
+		std::vector<int32_t> previous(WindowSize, -1);
+
+		auto insert = [&](size_t position)
+		{
+			const uint32_t hash = Hash3(data + position);
+			previous[position & (WindowSize - 1)] = head[hash];
+			head[hash] = static_cast<int32_t>(position);
+		};
+
+		size_t position = 0;
+		while (position < size)
+		{
+			uint32_t bestLength = 0;
+			uint32_t bestDistance = 0;
+
+			if (position + MinMatch <= size)
+			{
+				const uint32_t maxLength = static_cast<uint32_t>(std::min<size_t>(MaxMatch, size - position));
+				int32_t candidate = head[Hash3(data + position)];
+				for (uint32_t chain = 0; chain < MaxChain && candidate >= 0; ++chain)
+				{
+					const size_t distance = position - static_cast<size_t>(candidate);
+					if (distance > WindowSize)
+						break;
+
+					const uint8_t* match = data + candidate;
+					const uint8_t* current = data + position;
+					if (match[bestLength] == current[bestLength])
+					{
+						uint32_t length = 0;
+						while (length < maxLength && match[length] == current[length])
+							++length;
+						if (length > bestLength)
+						{
+							bestLength = length;
+							bestDistance = static_cast<uint32_t>(distance);
+							if (length == maxLength)
+								break;
+						}
+					}
+					candidate = previous[static_cast<size_t>(candidate) & (WindowSize - 1)];
+				}
+			}
+
+			if (bestLength >= MinMatch)
+			{
+				const uint32_t lengthCode = codes.LengthCode[bestLength];
+				const uint32_t symbol = 257 + lengthCode;
+				writer.Put(codes.Literal[symbol], codes.LiteralBits[symbol]);
+				writer.Put(bestLength - LengthBase[lengthCode], LengthExtra[lengthCode]);
+
+				const uint32_t distanceCode = codes.GetDistanceCode(bestDistance);
+				writer.Put(codes.Distance[distanceCode], 5);
+				writer.Put(bestDistance - DistanceBase[distanceCode], DistanceExtra[distanceCode]);
+
+				const size_t end = position + bestLength;
+				for (; position < end; ++position)
+				{
+					if (position + MinMatch <= size)
+						insert(position);
+				}
+			}
+			else
+			{
+				writer.Put(codes.Literal[data[position]], codes.LiteralBits[data[position]]);
+				if (position + MinMatch <= size)
+					insert(position);
+				++position;
+			}
+		}
+
+		writer.Put(codes.Literal[256], codes.LiteralBits[256]);
+		writer.Flush();
+	}
+
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0)
+		{
+			// Largest run before b can overflow 32 bits
+			const size_t run = std::min<size_t>(size, 5552);
+			for (size_t i = 0; i < run; ++i)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data += run;
+			size -= run;
+		}
+		return b << 16 | a;
+	}
+
+	// ---------------------------------------------------------------------
+	// PNG
+
+	const std::array<uint32_t, 256>& GetCrcTable()
+	{
+		static const std::array<uint32_t, 256> table = []
+		{
+			std::array<uint32_t, 256> result = {};
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				result[n] = c;
+			}
+			return result;
+		}();
+		return table;
+	}
+
+	uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		const std::array<uint32_t, 256>& table = GetCrcTable();
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void PutBigEndian(std::vector<uint8_t>& output, uint32_t value)
+	{
+		output.push_back(static_cast<uint8_t>(value >> 24));
+		output.push_back(static_cast<uint8_t>(value >> 16));
+		output.push_back(static_cast<uint8_t>(value >> 8));
+		output.push_back(static_cast<uint8_t>(value));
+	}
+
+	size_t BeginChunk(std::vector<uint8_t>& output, const char* type)
+	{
+		const size_t start = output.size();
+		output.resize(start + 4);
+		output.insert(output.end(), type, type + 4);
+		return start;
+	}
+
+	// Chunks are written in place: BeginChunk() leaves room for the length and
+	// adds the type, the caller appends the data, and FinishChunk() fills in the
+	// length and appends the CRC. Large chunks are never copied.
+	void FinishChunk(std::vector<uint8_t>& output, size_t chunkStart)
+	{
+		const size_t dataSize = output.size() - chunkStart - 8;
+		const uint32_t length = static_cast<uint32_t>(dataSize);
+		output[chunkStart + 0] = static_cast<uint8_t>(length >> 24);
+		output[chunkStart + 1] = static_cast<uint8_t>(length >> 16);
+		output[chunkStart + 2] = static_cast<uint8_t>(length >> 8);
+		output[chunkStart + 3] = static_cast<uint8_t>(length);
+		PutBigEndian(output, Crc32(output.data() + chunkStart + 4, dataSize + 4));
+	}
+
+	// Branch-free form of the PNG spec's predictor, so the filter loop vectorizes
+	inline int Paeth(int a, int b, int c)
+	{
+		const int pa = std::abs(b - c);
+		const int pb = std::abs(a - c);
+		const int pc = std::abs(a + b - 2 * c);
+		const int bOrC = pb <= pc ? b : c;
+		return pa <= pb && pa <= pc ? a : bOrC;
+	}
+
+	// Apply one PNG filter to a row. Each filter has its own loop so the simple
+	// ones vectorize.
+	void ApplyFilter(uint8_t filter, const uint8_t* row, const uint8_t* above, size_t size, unsigned bpp, uint8_t* output)
+	{
+		const size_t first = std::min<size_t>(bpp, size);
+		switch (filter)
+		{
+		case 0:
+			std::memcpy(output, row, size);
+			break;
+		case 1:
+			std::memcpy(output, row, first);
+			for (size_t i = first; i < size; ++i)
+				output[i] = static_cast<uint8_t>(row[i] - row[i - bpp]);
+			break;
+		case 2:
+			for (size_t i = 0; i < size; ++i)
+				output[i] = static_cast<uint8_t>(row[i] - above[i]);
+			break;
+		case 3:
+			for (size_t i = 0; i < first; ++i)
+				output[i] = static_cast<uint8_t>(row[i] - above[i] / 2);
+			for (size_t i = first; i < size; ++i)
+				output[i] = static_cast<uint8_t>(row[i] - (row[i - bpp] + above[i]) / 2);
+			break;
+		default:
+			for (size_t i = 0; i < first; ++i)
+				output[i] = static_cast<uint8_t>(row[i] - above[i]);
+			for (size_t i = first; i < size; ++i)
+				output[i] = static_cast<uint8_t>(row[i] - Paeth(row[i - bpp], above[i], above[i - bpp]));
+			break;
+		}
+	}
+
+	// Filter 'row' with each of the five PNG filters and keep the one whose
+	// output, read as signed bytes, sums smallest: the usual libpng heuristic
+	void FilterRow(const uint8_t* row, const uint8_t* above, size_t size, unsigned bpp, uint8_t* output,
+		std::vector<uint8_t>& scratch)
+	{
+		scratch.resize(size * 5);
+		uint64_t bestCost = UINT64_MAX;
+		uint8_t bestFilter = 0;
+
+		for (uint8_t filter = 0; filter < 5; ++filter)
+		{
+			uint8_t* filtered = scratch.data() + filter * size;
+			ApplyFilter(filter, row, above, size, bpp, filtered);
+
+			uint64_t cost = 0;
+			for (size_t i = 0; i < size; ++i)
+				cost += static_cast<uint64_t>(std::abs(static_cast<int8_t>(filtered[i])));
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestFilter = filter;
+			}
+		}
+
+		output[0] = bestFilter;
+		std::memcpy(output + 1, scratch.data() + bestFilter * size, size);
+	}
+
+	const uint8_t* GetRow(const uint8_t* rgba, uint32_t height, size_t rowBytes, bool bottomUp, uint32_t y)
+	{
+		return rgba + (bottomUp ? height - 1 - y : y) * rowBytes;
+	}
+}
+
+void ImageEncoders::EncodePng(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowBytes, bool bottomUp,
+	bool alpha, std::vector<uint8_t>& png)
+{
+	const unsigned channels = alpha ? 4 : 3;
+	const size_t scanlineSize = static_cast<size_t>(width) * channels;
+
+	// Filter type byte + filtered scanline per row: the data deflate compresses
+	std::vector<uint8_t> filtered(height * (scanlineSize + 1));
+	std::vector<uint8_t> current(scanlineSize);
+	std::vector<uint8_t> above(scanlineSize, 0);
+	std::vector<uint8_t> scratch;
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* source = GetRow(rgba, height, rowBytes, bottomUp, y);
+		if (alpha)
+		{
+			std::memcpy(current.data(), source, scanlineSize);
+		}
+		else
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				current[x * 3 + 0] = source[x * 4 + 0];
+				current[x * 3 + 1] = source[x * 4 + 1];
+				current[x * 3 + 2] = source[x * 4 + 2];
+			}
+		}
+
+		FilterRow(current.data(), above.data(), scanlineSize, channels, filtered.data() + y * (scanlineSize + 1), scratch);
+		current.swap(above);
+	}
+
+	png.clear();
+	png.reserve(filtered.size() / 2 + 1024);
+
+	static const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	png.insert(png.end(), Signature, Signature + 8);
+
+	size_t chunk = BeginChunk(png, "IHDR");
+	PutBigEndian(png, width);
+	PutBigEndian(png, height);
+	png.push_back(8);					// Bits per channel
+	png.push_back(alpha ? 6 : 2);		// RGBA or RGB
+	png.push_back(0);					// Deflate
+	png.push_back(0);					// Adaptive filtering
+	png.push_back(0);					// Not interlaced
+	FinishChunk(png, chunk);
+
+	// zlib stream: header (32K window, no dictionary), deflate data, Adler-32
+	chunk = BeginChunk(png, "IDAT");
+	png.push_back(0x78);
+	png.push_back(0x01);
+	Deflate(filtered.data(), filtered.size(), png);
+	PutBigEndian(png, Adler32(filtered.data(), filtered.size()));
+	FinishChunk(png, chunk);
+
+	chunk = BeginChunk(png, "IEND");
+	FinishChunk(png, chunk);
+}
+
+bool ImageEncoders::WritePng(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height,
+	size_t rowBytes, bool bottomUp, bool alpha)
+{
+	std::vector<uint8_t> png;
+	EncodePng(rgba, width, height, rowBytes, bottomUp, alpha, png);
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+	return static_cast<bool>(file);
+}
+
+std::string ImageEncoders::GetY4mHeader(uint32_t width, uint32_t height, uint32_t framesPerSecond)
+{
+	return "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) + " F" + std::to_string(framesPerSecond)
+		+ ":1 Ip A1:1 C420jpeg\n";
+}
+
+size_t ImageEncoders::GetYuv420Size(uint32_t width, uint32_t height)
+{
+	const size_t chromaSize = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+	return static_cast<size_t>(width) * height + 2 * chromaSize;
+}
+
+void ImageEncoders::ConvertToYuv420(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowBytes, bool bottomUp,
+	uint8_t* yuv)
+{
+	const uint32_t chromaWidth = (width + 1) / 2;
+	const uint32_t chromaHeight = (height + 1) / 2;
+	uint8_t* yPlane = yuv;
+	uint8_t* uPlane = yPlane + static_cast<size_t>(width) * height;
+	uint8_t* vPlane = uPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+	// 8-bit fixed point BT.601; the chroma offset of 128 is folded into the rounding constant
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* row = GetRow(rgba, height, rowBytes, bottomUp, y);
+		uint8_t* luma = yPlane + static_cast<size_t>(y) * width;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint8_t* pixel = row + x * 4;
+			luma[x] = static_cast<uint8_t>((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+		}
+	}
+
+	for (uint32_t cy = 0; cy < chromaHeight; ++cy)
+	{
+		const uint8_t* row0 = GetRow(rgba, height, rowBytes, bottomUp, cy * 2);
+		const uint8_t* row1 = GetRow(rgba, height, rowBytes, bottomUp, std::min(cy * 2 + 1, height - 1));
+		for (uint32_t cx = 0; cx < chromaWidth; ++cx)
+		{
+			const uint32_t x0 = cx * 2 * 4;
+			const uint32_t x1 = std::min(cx * 2 + 1, width - 1) * 4;
+
+			// Average of the 2x2 block, times 4
+			const int r = row0[x0 + 0] + row0[x1 + 0] + row1[x0 + 0] + row1[x1 + 0];
+			const int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+			const int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+
+			const int u = (-43 * r - 85 * g + 128 * b + (32896 << 2)) >> 10;
+			const int v = (128 * r - 107 * g - 21 * b + (32896 << 2)) >> 10;
+			uPlane[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(std::min(u, 255));
+			vPlane[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(std::min(v, 255));
+		}
+	}
+}
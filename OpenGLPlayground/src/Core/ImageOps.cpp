@@ -0,0 +1,796 @@
+#include "ImageOps.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OGLP_IMAGEOPS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit SSSE3/AVX2 instructions in functions that ask for
+// them; MSVC allows the intrinsics anywhere. The dispatcher makes sure these
+// functions only run on CPUs that support them.
+#if defined(__GNUC__) || defined(__clang__)
+#define OGLP_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define OGLP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OGLP_TARGET_SSSE3
+#define OGLP_TARGET_AVX2
+#endif
+
+namespace ImageOps
+{
+	namespace
+	{
+		SimdLevel DetectSimdLevel()
+		{
+#ifdef OGLP_IMAGEOPS_X86
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return SimdLevel::AVX2;
+			if (__builtin_cpu_supports("ssse3"))
+				return SimdLevel::SSE;
+#else
+			int info[4] = {};
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			const bool ssse3 = (info[2] & (1 << 9)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+
+			// AVX2 also needs the OS to save YMM state
+			if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+			{
+				__cpuidex(info, 7, 0);
+				if (info[1] & (1 << 5))
+					return SimdLevel::AVX2;
+			}
+
+			if (ssse3)
+				return SimdLevel::SSE;
+#endif
+#endif
+			return SimdLevel::Scalar;
+		}
+
+		std::atomic<SimdLevel>& CurrentLevel()
+		{
+			static std::atomic<SimdLevel> level{ GetSupportedSimdLevel() };
+			return level;
+		}
+
+		// Conversion tables shared by every path so results match bit for bit
+		struct ConversionTables
+		{
+			float SRGBToLinear[256];
+			float UnormToFloat[256];
+			uint8_t LinearToSRGB[65536]; // Indexed by round(linear * 65535)
+
+			ConversionTables()
+			{
+				for (int i = 0; i < 256; ++i)
+				{
+					const double c = i / 255.0;
+					SRGBToLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+					UnormToFloat[i] = static_cast<float>(c);
+				}
+
+				for (int i = 0; i < 65536; ++i)
+				{
+					const double l = i / 65535.0;
+					const double s = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+					LinearToSRGB[i] = static_cast<uint8_t>(std::clamp(s * 255.0 + 0.5, 0.0, 255.0));
+				}
+			}
+		};
+
+		const ConversionTables& Tables()
+		{
+			static const ConversionTables tables;
+			return tables;
+		}
+
+		inline int LinearIndex(float value)
+		{
+			return static_cast<int>(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f);
+		}
+
+		inline uint8_t FloatToUnorm(float value)
+		{
+			return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+
+		// Separable filter taps for 2:1 reduction. Offsets are relative to source
+		// pixel 2x of output pixel x.
+		struct FilterKernel
+		{
+			int TapCount = 0;
+			int FirstOffset = 0;
+			float Weights[8] = {};
+		};
+
+		double BesselI0(double x)
+		{
+			double sum = 1.0;
+			double term = 1.0;
+			for (int k = 1; k < 32; ++k)
+			{
+				term *= (x / (2.0 * k)) * (x / (2.0 * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		FilterKernel MakeKaiserKernel()
+		{
+			// Low-pass at half the source rate, windowed over +-4 source pixels
+			constexpr double Radius = 4.0;
+			constexpr double Beta = 4.0;
+			constexpr double Pi = 3.14159265358979323846;
+
+			FilterKernel kernel;
+			kernel.TapCount = 8;
+			kernel.FirstOffset = -3;
+
+			double weights[8];
+			double total = 0.0;
+			for (int k = 0; k < 8; ++k)
+			{
+				// Distance from the output pixel's centre (2x + 1) to source pixel centre
+				const double d = (kernel.FirstOffset + k) + 0.5 - 1.0;
+				const double t = d / 2.0;
+				const double sinc = t == 0.0 ? 1.0 : std::sin(Pi * t) / (Pi * t);
+				const double r = d / Radius;
+				const double window = BesselI0(Beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / BesselI0(Beta);
+				weights[k] = sinc * window;
+				total += weights[k];
+			}
+
+			for (int k = 0; k < 8; ++k)
+				kernel.Weights[k] = static_cast<float>(weights[k] / total);
+
+			return kernel;
+		}
+
+		const FilterKernel& GetKernel(MipFilter filter)
+		{
+			static const FilterKernel box = { 2, 0, { 0.5f, 0.5f } };
+			static const FilterKernel kaiser = MakeKaiserKernel();
+			return filter == MipFilter::Kaiser ? kaiser : box;
+		}
+
+		// ---------------------------------------------------------------------
+		// Scalar kernels
+
+		void ExpandRGBToRGBAScalar(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount, uint8_t alpha)
+		{
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				rgba[i * 4 + 0] = rgb[i * 3 + 0];
+				rgba[i * 4 + 1] = rgb[i * 3 + 1];
+				rgba[i * 4 + 2] = rgb[i * 3 + 2];
+				rgba[i * 4 + 3] = alpha;
+			}
+		}
+
+		inline uint8_t MultiplyUnorm(uint32_t a, uint32_t b)
+		{
+			// Exact round(a * b / 255) for 8-bit inputs
+			const uint32_t t = a * b + 128;
+			return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+		}
+
+		void PremultiplyAlphaScalar(uint8_t* rgba, size_t pixelCount)
+		{
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				uint8_t* pixel = rgba + i * 4;
+				const uint32_t a = pixel[3];
+				pixel[0] = MultiplyUnorm(pixel[0], a);
+				pixel[1] = MultiplyUnorm(pixel[1], a);
+				pixel[2] = MultiplyUnorm(pixel[2], a);
+			}
+		}
+
+		void SRGBToLinearScalar(const uint8_t* srgb, float* linear, size_t count)
+		{
+			const float* table = Tables().SRGBToLinear;
+			for (size_t i = 0; i < count; ++i)
+				linear[i] = table[srgb[i]];
+		}
+
+		void LinearToSRGBScalar(const float* linear, uint8_t* srgb, size_t count)
+		{
+			const uint8_t* table = Tables().LinearToSRGB;
+			for (size_t i = 0; i < count; ++i)
+				srgb[i] = table[LinearIndex(linear[i])];
+		}
+
+		// One row of the 2x2 box filter, output pixels [begin, end)
+		void BoxRowScalar(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* out, uint32_t begin, uint32_t end)
+		{
+			for (uint32_t x = begin; x < end; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1) * 4;
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+					out[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+				}
+			}
+		}
+
+		// Horizontal pass of the float filter for output pixels [begin, end)
+		void FilterRowScalar(const float* in, uint32_t width, const FilterKernel& kernel, float* out, uint32_t begin, uint32_t end)
+		{
+			for (uint32_t x = begin; x < end; ++x)
+			{
+				float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (int k = 0; k < kernel.TapCount; ++k)
+				{
+					const int sx = std::clamp(static_cast<int>(x * 2) + kernel.FirstOffset + k, 0, static_cast<int>(width) - 1);
+					for (int c = 0; c < 4; ++c)
+						acc[c] = acc[c] + kernel.Weights[k] * in[sx * 4 + c];
+				}
+				std::memcpy(out + x * 4, acc, sizeof(acc));
+			}
+		}
+
+		// Vertical pass: out[i] = sum_k weight[k] * rows[k][i]
+		void AccumulateRowsScalar(const float* const* rows, const FilterKernel& kernel, float* out, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				float acc = 0.0f;
+				for (int k = 0; k < kernel.TapCount; ++k)
+					acc = acc + kernel.Weights[k] * rows[k][i];
+				out[i] = acc;
+			}
+		}
+
+#ifdef OGLP_IMAGEOPS_X86
+		// ---------------------------------------------------------------------
+		// SSE kernels (SSE2, plus SSSE3 for byte shuffles)
+
+		OGLP_TARGET_SSSE3 void ExpandRGBToRGBASSE(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount, uint8_t alpha)
+		{
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i alphaBits = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+
+			// A 16-byte load covers 4 pixels plus 4 bytes that must still be inside the input
+			size_t i = 0;
+			for (; i + 6 <= pixelCount; i += 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+				v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alphaBits);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), v);
+			}
+
+			ExpandRGBToRGBAScalar(rgb + i * 3, rgba + i * 4, pixelCount - i, alpha);
+		}
+
+		inline __m128i PremultiplyHalfSSE(__m128i pixels16, __m128i colorMask, __m128i alphaOne)
+		{
+			__m128i alpha = _mm_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3));
+			alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+			// Colour lanes multiply by alpha, the alpha lane by 255 (so it is unchanged)
+			const __m128i factor = _mm_or_si128(_mm_and_si128(alpha, colorMask), alphaOne);
+			const __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels16, factor), _mm_set1_epi16(128));
+			return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+		}
+
+		void PremultiplyAlphaSSE(uint8_t* rgba, size_t pixelCount)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+			const __m128i alphaOne = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+
+			size_t i = 0;
+			for (; i + 4 <= pixelCount; i += 4)
+			{
+				__m128i* p = reinterpret_cast<__m128i*>(rgba + i * 4);
+				const __m128i v = _mm_loadu_si128(p);
+				const __m128i lo = PremultiplyHalfSSE(_mm_unpacklo_epi8(v, zero), colorMask, alphaOne);
+				const __m128i hi = PremultiplyHalfSSE(_mm_unpackhi_epi8(v, zero), colorMask, alphaOne);
+				_mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+			}
+
+			PremultiplyAlphaScalar(rgba + i * 4, pixelCount - i);
+		}
+
+		void LinearToSRGBSSE(const float* linear, uint8_t* srgb, size_t count)
+		{
+			const uint8_t* table = Tables().LinearToSRGB;
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 scale = _mm_set1_ps(65535.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+
+			size_t i = 0;
+			alignas(16) int32_t indices[4];
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(linear + i), zero), one);
+				v = _mm_add_ps(_mm_mul_ps(v, scale), half);
+				_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(v));
+				srgb[i + 0] = table[indices[0]];
+				srgb[i + 1] = table[indices[1]];
+				srgb[i + 2] = table[indices[2]];
+				srgb[i + 3] = table[indices[3]];
+			}
+
+			LinearToSRGBScalar(linear + i, srgb + i, count - i);
+		}
+
+		inline __m128i BoxSumSSE(__m128i a, __m128i c)
+		{
+			// a, c: 4 RGBA pixels from two rows. Returns 2 output pixels as 16-bit sums.
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero));
+			const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero));
+			return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+		}
+
+		void BoxRowSSE(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* out, uint32_t outWidth)
+		{
+			// 4 output pixels read 8 full source pixels; the odd last column goes to the scalar path
+			const uint32_t simdEnd = std::min(outWidth, width / 2) & ~3u;
+			const __m128i rounding = _mm_set1_epi16(2);
+
+			for (uint32_t x = 0; x < simdEnd; x += 4)
+			{
+				const uint8_t* a = row0 + x * 8;
+				const uint8_t* c = row1 + x * 8;
+				const __m128i first = BoxSumSSE(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(c)));
+				const __m128i second = BoxSumSSE(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 16)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(c + 16)));
+
+				const __m128i result = _mm_packus_epi16(
+					_mm_srli_epi16(_mm_add_epi16(first, rounding), 2),
+					_mm_srli_epi16(_mm_add_epi16(second, rounding), 2));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), result);
+			}
+
+			BoxRowScalar(row0, row1, width, out, simdEnd, outWidth);
+		}
+
+		void FilterRowSSE(const float* in, uint32_t width, const FilterKernel& kernel, float* out, uint32_t outWidth)
+		{
+			// Interior pixels never need clamping; edges go to the scalar path
+			const int firstInterior = (-kernel.FirstOffset + 1) / 2;
+			const int lastInterior = (static_cast<int>(width) - kernel.FirstOffset - kernel.TapCount) / 2;
+			const uint32_t begin = static_cast<uint32_t>(std::clamp(firstInterior, 0, static_cast<int>(outWidth)));
+			const uint32_t end = static_cast<uint32_t>(std::clamp(lastInterior + 1, static_cast<int>(begin), static_cast<int>(outWidth)));
+
+			FilterRowScalar(in, width, kernel, out, 0, begin);
+
+			for (uint32_t x = begin; x < end; ++x)
+			{
+				const float* source = in + (static_cast<int>(x * 2) + kernel.FirstOffset) * 4;
+				__m128 acc = _mm_setzero_ps();
+				for (int k = 0; k < kernel.TapCount; ++k)
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel.Weights[k]), _mm_loadu_ps(source + k * 4)));
+				_mm_storeu_ps(out + x * 4, acc);
+			}
+
+			FilterRowScalar(in, width, kernel, out, end, outWidth);
+		}
+
+		void AccumulateRowsSSE(const float* const* rows, const FilterKernel& kernel, float* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 acc = _mm_setzero_ps();
+				for (int k = 0; k < kernel.TapCount; ++k)
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel.Weights[k]), _mm_loadu_ps(rows[k] + i)));
+				_mm_storeu_ps(out + i, acc);
+			}
+
+			AccumulateRowsScalar(rows, kernel, out, i, count);
+		}
+
+		// ---------------------------------------------------------------------
+		// AVX2 kernels
+
+		OGLP_TARGET_AVX2 void ExpandRGBToRGBAAVX2(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount, uint8_t alpha)
+		{
+			const __m256i shuffle = _mm256_setr_epi8(
+				0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+				0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m256i alphaBits = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+
+			// Two 16-byte loads, 12 bytes apart, feed 8 pixels; the second reads 4 bytes ahead
+			size_t i = 0;
+			for (; i + 10 <= pixelCount; i += 8)
+			{
+				const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+				const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3 + 12));
+				__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+				v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alphaBits);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), v);
+			}
+
+			ExpandRGBToRGBAScalar(rgb + i * 3, rgba + i * 4, pixelCount - i, alpha);
+		}
+
+		OGLP_TARGET_AVX2 inline __m256i PremultiplyHalfAVX2(__m256i pixels16, __m256i colorMask, __m256i alphaOne)
+		{
+			__m256i alpha = _mm256_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3));
+			alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+			const __m256i factor = _mm256_or_si256(_mm256_and_si256(alpha, colorMask), alphaOne);
+			const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(pixels16, factor), _mm256_set1_epi16(128));
+			return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+		}
+
+		OGLP_TARGET_AVX2 void PremultiplyAlphaAVX2(uint8_t* rgba, size_t pixelCount)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i colorMask = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+			const __m256i alphaOne = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+
+			// Unpack and pack both work per 128-bit lane, so pixel order is preserved
+			size_t i = 0;
+			for (; i + 8 <= pixelCount; i += 8)
+			{
+				__m256i* p = reinterpret_cast<__m256i*>(rgba + i * 4);
+				const __m256i v = _mm256_loadu_si256(p);
+				const __m256i lo = PremultiplyHalfAVX2(_mm256_unpacklo_epi8(v, zero), colorMask, alphaOne);
+				const __m256i hi = PremultiplyHalfAVX2(_mm256_unpackhi_epi8(v, zero), colorMask, alphaOne);
+				_mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+			}
+
+			PremultiplyAlphaSSE(rgba + i * 4, pixelCount - i);
+		}
+
+		OGLP_TARGET_AVX2 void SRGBToLinearAVX2(const uint8_t* srgb, float* linear, size_t count)
+		{
+			const float* table = Tables().SRGBToLinear;
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(srgb + i)));
+				_mm256_storeu_ps(linear + i, _mm256_i32gather_ps(table, indices, 4));
+			}
+
+			SRGBToLinearScalar(srgb + i, linear + i, count - i);
+		}
+
+		OGLP_TARGET_AVX2 inline __m256i BoxSumAVX2(__m256i a, __m256i c)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(c, zero));
+			const __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(c, zero));
+			return _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+		}
+
+		OGLP_TARGET_AVX2 void BoxRowAVX2(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* out, uint32_t outWidth)
+		{
+			const uint32_t simdEnd = std::min(outWidth, width / 2) & ~7u;
+			const __m256i rounding = _mm256_set1_epi16(2);
+
+			for (uint32_t x = 0; x < simdEnd; x += 8)
+			{
+				const uint8_t* a = row0 + x * 8;
+				const uint8_t* c = row1 + x * 8;
+				const __m256i first = BoxSumAVX2(
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c)));
+				const __m256i second = BoxSumAVX2(
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + 32)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + 32)));
+
+				// Per-lane pack leaves 64-bit groups as [0,1 | 4,5 || 2,3 | 6,7]
+				__m256i result = _mm256_packus_epi16(
+					_mm256_srli_epi16(_mm256_add_epi16(first, rounding), 2),
+					_mm256_srli_epi16(_mm256_add_epi16(second, rounding), 2));
+				result = _mm256_permute4x64_epi64(result, _MM_SHUFFLE(3, 1, 2, 0));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 4), result);
+			}
+
+			BoxRowSSE(row0 + simdEnd * 8, row1 + simdEnd * 8, width - simdEnd * 2, out + simdEnd * 4, outWidth - simdEnd);
+		}
+
+		OGLP_TARGET_AVX2 void FilterRowAVX2(const float* in, uint32_t width, const FilterKernel& kernel, float* out, uint32_t outWidth)
+		{
+			const int firstInterior = (-kernel.FirstOffset + 1) / 2;
+			const int lastInterior = (static_cast<int>(width) - kernel.FirstOffset - kernel.TapCount) / 2;
+			const uint32_t begin = static_cast<uint32_t>(std::clamp(firstInterior, 0, static_cast<int>(outWidth)));
+			const uint32_t end = static_cast<uint32_t>(std::clamp(lastInterior + 1, static_cast<int>(begin), static_cast<int>(outWidth)));
+
+			FilterRowScalar(in, width, kernel, out, 0, begin);
+
+			// Two output pixels per register; their taps are 2 source pixels apart
+			uint32_t x = begin;
+			for (; x + 2 <= end; x += 2)
+			{
+				const float* source = in + (static_cast<int>(x * 2) + kernel.FirstOffset) * 4;
+				__m256 acc = _mm256_setzero_ps();
+				for (int k = 0; k < kernel.TapCount; ++k)
+				{
+					const __m256 taps = _mm256_insertf128_ps(
+						_mm256_castps128_ps256(_mm_loadu_ps(source + k * 4)), _mm_loadu_ps(source + k * 4 + 8), 1);
+					acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(kernel.Weights[k]), taps));
+				}
+				_mm256_storeu_ps(out + x * 4, acc);
+			}
+
+			FilterRowScalar(in, width, kernel, out, x, outWidth);
+		}
+
+		OGLP_TARGET_AVX2 void AccumulateRowsAVX2(const float* const* rows, const FilterKernel& kernel, float* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 acc = _mm256_setzero_ps();
+				for (int k = 0; k < kernel.TapCount; ++k)
+					acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(kernel.Weights[k]), _mm256_loadu_ps(rows[k] + i)));
+				_mm256_storeu_ps(out + i, acc);
+			}
+
+			AccumulateRowsScalar(rows, kernel, out, i, count);
+		}
+#endif
+
+		// ---------------------------------------------------------------------
+		// Downsampling drivers
+
+		void DownsampleBoxInteger(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination)
+		{
+			const uint32_t outWidth = MipSize(width);
+			const uint32_t outHeight = MipSize(height);
+			const SimdLevel level = GetSimdLevel();
+
+			for (uint32_t y = 0; y < outHeight; ++y)
+			{
+				const uint8_t* row0 = source + static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4;
+				const uint8_t* row1 = source + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4;
+				uint8_t* out = destination + static_cast<size_t>(y) * outWidth * 4;
+
+#ifdef OGLP_IMAGEOPS_X86
+				if (level == SimdLevel::AVX2)
+				{
+					BoxRowAVX2(row0, row1, width, out, outWidth);
+					continue;
+				}
+				if (level == SimdLevel::SSE)
+				{
+					BoxRowSSE(row0, row1, width, out, outWidth);
+					continue;
+				}
+#endif
+				(void)level;
+				BoxRowScalar(row0, row1, width, out, 0, outWidth);
+			}
+		}
+
+		// Separable float filter; colour is linearized first when 'srgb' is set.
+		// Horizontally filtered rows are kept in a small ring, so memory use is
+		// a few rows regardless of image size.
+		void DownsampleFiltered(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination,
+			const FilterKernel& kernel, bool srgb)
+		{
+			const uint32_t outWidth = MipSize(width);
+			const uint32_t outHeight = MipSize(height);
+			const SimdLevel level = GetSimdLevel();
+			const ConversionTables& tables = Tables();
+			const float* colorTable = srgb ? tables.SRGBToLinear : tables.UnormToFloat;
+
+			const int ringSize = kernel.TapCount;
+			std::vector<float> ring(static_cast<size_t>(ringSize) * outWidth * 4);
+			std::vector<int> ringRows(static_cast<size_t>(ringSize), -1);
+			std::vector<float> sourceRow(static_cast<size_t>(width) * 4);
+			std::vector<float> outRow(static_cast<size_t>(outWidth) * 4);
+			const float* taps[8] = {};
+
+			auto filteredRow = [&](int sy) -> const float*
+			{
+				float* slot = ring.data() + static_cast<size_t>(sy % ringSize) * outWidth * 4;
+				if (ringRows[sy % ringSize] == sy)
+					return slot;
+
+				const uint8_t* in = source + static_cast<size_t>(sy) * width * 4;
+				for (uint32_t i = 0; i < width; ++i)
+				{
+					sourceRow[i * 4 + 0] = colorTable[in[i * 4 + 0]];
+					sourceRow[i * 4 + 1] = colorTable[in[i * 4 + 1]];
+					sourceRow[i * 4 + 2] = colorTable[in[i * 4 + 2]];
+					sourceRow[i * 4 + 3] = tables.UnormToFloat[in[i * 4 + 3]];
+				}
+
+#ifdef OGLP_IMAGEOPS_X86
+				if (level == SimdLevel::AVX2)
+					FilterRowAVX2(sourceRow.data(), width, kernel, slot, outWidth);
+				else if (level == SimdLevel::SSE)
+					FilterRowSSE(sourceRow.data(), width, kernel, slot, outWidth);
+				else
+#endif
+					FilterRowScalar(sourceRow.data(), width, kernel, slot, 0, outWidth);
+
+				ringRows[sy % ringSize] = sy;
+				return slot;
+			};
+
+			for (uint32_t y = 0; y < outHeight; ++y)
+			{
+				for (int k = 0; k < kernel.TapCount; ++k)
+				{
+					const int sy = std::clamp(static_cast<int>(y * 2) + kernel.FirstOffset + k, 0, static_cast<int>(height) - 1);
+					taps[k] = filteredRow(sy);
+				}
+
+				const size_t count = static_cast<size_t>(outWidth) * 4;
+#ifdef OGLP_IMAGEOPS_X86
+				if (level == SimdLevel::AVX2)
+					AccumulateRowsAVX2(taps, kernel, outRow.data(), count);
+				else if (level == SimdLevel::SSE)
+					AccumulateRowsSSE(taps, kernel, outRow.data(), count);
+				else
+#endif
+					AccumulateRowsScalar(taps, kernel, outRow.data(), 0, count);
+
+				uint8_t* out = destination + static_cast<size_t>(y) * outWidth * 4;
+				for (uint32_t x = 0; x < outWidth; ++x)
+				{
+					const float* pixel = &outRow[x * 4];
+					for (int c = 0; c < 3; ++c)
+						out[x * 4 + c] = srgb ? tables.LinearToSRGB[LinearIndex(pixel[c])] : FloatToUnorm(pixel[c]);
+					out[x * 4 + 3] = FloatToUnorm(pixel[3]);
+				}
+			}
+		}
+	}
+
+	SimdLevel GetSupportedSimdLevel()
+	{
+		static const SimdLevel supported = DetectSimdLevel();
+		return supported;
+	}
+
+	SimdLevel GetSimdLevel()
+	{
+		return CurrentLevel().load(std::memory_order_relaxed);
+	}
+
+	void SetSimdLevel(SimdLevel level)
+	{
+		CurrentLevel().store(std::min(level, GetSupportedSimdLevel()), std::memory_order_relaxed);
+	}
+
+	const char* GetSimdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::Scalar: return "scalar";
+		case SimdLevel::SSE:    return "sse";
+		case SimdLevel::AVX2:   return "avx2";
+		}
+		return "unknown";
+	}
+
+	void ExpandRGBToRGBA(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount, uint8_t alpha)
+	{
+#ifdef OGLP_IMAGEOPS_X86
+		switch (GetSimdLevel())
+		{
+		case SimdLevel::AVX2: ExpandRGBToRGBAAVX2(rgb, rgba, pixelCount, alpha); return;
+		case SimdLevel::SSE:  ExpandRGBToRGBASSE(rgb, rgba, pixelCount, alpha); return;
+		default: break;
+		}
+#endif
+		ExpandRGBToRGBAScalar(rgb, rgba, pixelCount, alpha);
+	}
+
+	void PremultiplyAlpha(uint8_t* rgba, size_t pixelCount)
+	{
+#ifdef OGLP_IMAGEOPS_X86
+		switch (GetSimdLevel())
+		{
+		case SimdLevel::AVX2: PremultiplyAlphaAVX2(rgba, pixelCount); return;
+		case SimdLevel::SSE:  PremultiplyAlphaSSE(rgba, pixelCount); return;
+		default: break;
+		}
+#endif
+		PremultiplyAlphaScalar(rgba, pixelCount);
+	}
+
+	void SRGBToLinear(const uint8_t* srgb, float* linear, size_t count)
+	{
+#ifdef OGLP_IMAGEOPS_X86
+		// Without gathers the table lookup is as fast as it gets, so SSE uses the scalar loop
+		if (GetSimdLevel() == SimdLevel::AVX2)
+		{
+			SRGBToLinearAVX2(srgb, linear, count);
+			return;
+		}
+#endif
+		SRGBToLinearScalar(srgb, linear, count);
+	}
+
+	void LinearToSRGB(const float* linear, uint8_t* srgb, size_t count)
+	{
+#ifdef OGLP_IMAGEOPS_X86
+		if (GetSimdLevel() != SimdLevel::Scalar)
+		{
+			LinearToSRGBSSE(linear, srgb, count);
+			return;
+		}
+#endif
+		LinearToSRGBScalar(linear, srgb, count);
+	}
+
+	void FlipVertically(uint8_t* pixels, size_t rowBytes, uint32_t height)
+	{
+		// Pure data movement: memcpy is already vectorized by the C runtime
+		std::vector<uint8_t> temp(rowBytes);
+		for (uint32_t top = 0, bottom = height > 0 ? height - 1 : 0; top < bottom; ++top, --bottom)
+		{
+			uint8_t* a = pixels + top * rowBytes;
+			uint8_t* b = pixels + bottom * rowBytes;
+			std::memcpy(temp.data(), a, rowBytes);
+			std::memcpy(a, b, rowBytes);
+			std::memcpy(b, temp.data(), rowBytes);
+		}
+	}
+
+	void Downsample(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, MipFilter filter, bool srgb)
+	{
+		if (filter == MipFilter::Box && !srgb)
+		{
+			DownsampleBoxInteger(source, width, height, destination);
+			return;
+		}
+
+		DownsampleFiltered(source, width, height, destination, GetKernel(filter), srgb);
+	}
+
+	size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t* levelCount)
+	{
+		size_t size = 0;
+		uint32_t levels = 0;
+		for (;;)
+		{
+			size += static_cast<size_t>(width) * height * 4;
+			++levels;
+			if (width == 1 && height == 1)
+				break;
+			width = MipSize(width);
+			height = MipSize(height);
+		}
+
+		if (levelCount)
+			*levelCount = levels;
+		return size;
+	}
+
+	void GenerateMipChain(uint8_t* chain, uint32_t width, uint32_t height, MipFilter filter, bool srgb)
+	{
+		while (width > 1 || height > 1)
+		{
+			uint8_t* next = chain + static_cast<size_t>(width) * height * 4;
+			Downsample(chain, width, height, next, filter, srgb);
+
+			chain = next;
+			width = MipSize(width);
+			height = MipSize(height);
+		}
+	}
+}
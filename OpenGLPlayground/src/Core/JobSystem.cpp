@@ -0,0 +1,412 @@
+#include "JobSystem.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+	// Job slots per thread. A slot is reused once the ring wraps around, so at
+	// most this many jobs created by one thread can be unfinished at a time.
+	constexpr size_t JobRingSize = 4096;
+
+	// Failed searches for work before an idle worker goes to sleep
+	constexpr uint32_t IdleSpinCount = 64;
+
+	struct JobRing
+	{
+		std::unique_ptr<Job[]> Jobs = std::make_unique<Job[]>(JobRingSize);
+		size_t Next = 0;
+	};
+
+	// Shared by every system the thread creates jobs in
+	thread_local std::unique_ptr<JobRing> t_JobRing;
+
+	// Set on worker threads only
+	thread_local const JobSystem* t_WorkerSystem = nullptr;
+	thread_local int t_WorkerIndex = -1;
+
+	thread_local uint32_t t_StealSeed = 0;
+
+	uint32_t NextRandom()
+	{
+		// xorshift32, seeded per thread
+		uint32_t x = t_StealSeed;
+		if (x == 0)
+			x = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		t_StealSeed = x;
+		return x;
+	}
+}
+
+// ---------------------------------------------------------------------
+// WorkStealingDeque
+
+WorkStealingDeque::WorkStealingDeque(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	m_Buffer = std::make_unique<std::atomic<Job*>[]>(size);
+	m_Mask = static_cast<int64_t>(size - 1);
+}
+
+bool WorkStealingDeque::Push(Job* job)
+{
+	const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+	const int64_t top = m_Top.load(std::memory_order_acquire);
+	if (bottom - top > m_Mask)
+		return false;
+
+	m_Buffer[bottom & m_Mask].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job* WorkStealingDeque::Pop()
+{
+	const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+	m_Bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_Top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// Empty
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = m_Buffer[bottom & m_Mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// Last job: race the thieves for it
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* WorkStealingDeque::Steal()
+{
+	int64_t top = m_Top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+		return nullptr;
+
+	Job* job = m_Buffer[top & m_Mask].load(std::memory_order_relaxed);
+	if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;	// Lost to the owner or another thief
+	return job;
+}
+
+bool WorkStealingDeque::IsEmpty() const
+{
+	const int64_t top = m_Top.load(std::memory_order_acquire);
+	const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+	return top >= bottom;
+}
+
+// ---------------------------------------------------------------------
+// JobSystem
+
+JobSystem::JobSystem(unsigned threadCount, const char* threadName)
+	: m_ThreadName(threadName),
+	m_OwnerThread(std::this_thread::get_id())
+{
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency());
+
+	m_Executed = std::make_unique<ExecutedCounter[]>(threadCount);
+	m_Deques.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; ++i)
+		m_Deques.push_back(std::make_unique<WorkStealingDeque>());
+
+	// Workers index the deques, so start them only once all exist
+	m_Workers.reserve(threadCount - 1);
+	for (unsigned i = 1; i < threadCount; ++i)
+		m_Workers.emplace_back(&JobSystem::WorkerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	m_Stop.store(true);
+	m_WakeGeneration.fetch_add(1);
+	m_WakeGeneration.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+Job* JobSystem::AllocateJob(JobCounter* counter, JobPriority priority)
+{
+	if (!t_JobRing)
+		t_JobRing = std::make_unique<JobRing>();
+
+	// Take the next finished slot. A slot still in use is skipped rather than
+	// waited for, since it may hold the job this thread is running, but the
+	// thread runs one other job per skip so a ring full of unfinished jobs
+	// drains instead of being scanned over and over.
+	JobRing& ring = *t_JobRing;
+	Job* job = nullptr;
+	while (!job)
+	{
+		Job* candidate = &ring.Jobs[ring.Next];
+		ring.Next = (ring.Next + 1) % JobRingSize;
+
+		if (candidate->Done.load(std::memory_order_acquire))
+			job = candidate;
+		else if (Job* other = FindJob(m_Workers.empty()))
+			Execute(other);
+		else
+			std::this_thread::yield();
+	}
+
+	job->Done.store(false, std::memory_order_relaxed);
+	job->Dependencies.store(1, std::memory_order_relaxed);
+	job->ContinuationCount = 0;
+	job->Counter = counter;
+	job->Priority = priority;
+
+	if (counter)
+		counter->m_Count.fetch_add(1, std::memory_order_relaxed);
+
+	return job;
+}
+
+void JobSystem::AddDependency(Job* before, Job* after)
+{
+	if (before->ContinuationCount == Job::MaxContinuations)
+	{
+		// Out of continuation slots: the cheapest correct fallback is to finish
+		// 'before' now, which leaves nothing for 'after' to wait on
+		Run(before);
+		while (!before->Done.load(std::memory_order_acquire))
+		{
+			if (Job* other = FindJob(m_Workers.empty()))
+				Execute(other);
+			else
+				std::this_thread::yield();
+		}
+		return;
+	}
+
+	after->Dependencies.fetch_add(1, std::memory_order_relaxed);
+	before->Continuations[before->ContinuationCount++] = after;
+}
+
+void JobSystem::Run(Job* job)
+{
+	if (job->Dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		Submit(job);
+}
+
+void JobSystem::Submit(Job* job)
+{
+	if (job->Priority == JobPriority::Background)
+	{
+		std::lock_guard<std::mutex> lock(m_SharedMutex);
+		m_BackgroundJobs.push_back(job);
+		m_BackgroundCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		const int threadIndex = GetThreadIndex();
+		if (threadIndex >= 0)
+		{
+			// A full deque means this thread spawned far more than anyone can
+			// steal; running the job now keeps memory bounded
+			if (!m_Deques[threadIndex]->Push(job))
+			{
+				Execute(job);
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_SharedMutex);
+			m_SharedJobs.push_back(job);
+			m_SharedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	WakeWorkers();
+}
+
+void JobSystem::Execute(Job* job)
+{
+	job->Function(*job);
+
+	const int threadIndex = GetThreadIndex();
+	if (threadIndex >= 0)
+	{
+		// Only this thread writes its count; no read-modify-write needed
+		std::atomic<uint64_t>& executed = m_Executed[threadIndex].Count;
+		executed.store(executed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+	for (uint32_t i = 0; i < job->ContinuationCount; ++i)
+		Run(job->Continuations[i]);
+
+	// Once Done is set the slot may be reused, so read the counter first
+	JobCounter* counter = job->Counter;
+	job->Done.store(true, std::memory_order_release);
+
+	if (counter)
+		counter->m_Count.fetch_sub(1, std::memory_order_release);
+}
+
+Job* JobSystem::FindJob(bool takeBackground)
+{
+	const int threadIndex = GetThreadIndex();
+	if (threadIndex >= 0)
+	{
+		if (Job* job = m_Deques[threadIndex]->Pop())
+			return job;
+	}
+
+	if (m_SharedCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_SharedMutex);
+		if (!m_SharedJobs.empty())
+		{
+			Job* job = m_SharedJobs.front();
+			m_SharedJobs.pop_front();
+			m_SharedCount.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	// Start at a random victim so thieves spread over the deques
+	const unsigned threadCount = GetThreadCount();
+	const unsigned start = NextRandom() % threadCount;
+	for (unsigned i = 0; i < threadCount; ++i)
+	{
+		const unsigned victim = (start + i) % threadCount;
+		if (static_cast<int>(victim) == threadIndex)
+			continue;
+
+		if (Job* job = m_Deques[victim]->Steal())
+		{
+			m_Stolen.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	if (takeBackground && m_BackgroundCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_SharedMutex);
+		if (!m_BackgroundJobs.empty())
+		{
+			Job* job = m_BackgroundJobs.front();
+			m_BackgroundJobs.pop_front();
+			m_BackgroundCount.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::WakeWorkers()
+{
+	if (m_Workers.empty())
+		return;
+
+	// Pairs with the fence in WorkerMain: either the worker sees the new job
+	// when it looks again, or this sees it sleeping and wakes it. A burst of
+	// submissions wakes one worker per wake-up actually taken, not one per job.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_SleepingCount.load(std::memory_order_relaxed) > 0 && !m_WakePending.exchange(true, std::memory_order_relaxed))
+	{
+		m_WakeGeneration.fetch_add(1, std::memory_order_release);
+		m_WakeGeneration.notify_one();
+	}
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	// Without workers nothing else would ever run Background jobs
+	const bool takeBackground = m_Workers.empty();
+
+	while (!counter.IsDone())
+	{
+		if (Job* job = FindJob(takeBackground))
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerMain(unsigned threadIndex)
+{
+	OGLP_PROFILE_THREAD(m_ThreadName);
+
+	t_WorkerSystem = this;
+	t_WorkerIndex = static_cast<int>(threadIndex);
+
+	uint32_t idleSpins = 0;
+	while (!m_Stop.load(std::memory_order_relaxed))
+	{
+		if (Job* job = FindJob(true))
+		{
+			Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < IdleSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Announce the sleep, then look once more so a job submitted in between
+		// is not missed
+		const uint32_t generation = m_WakeGeneration.load(std::memory_order_acquire);
+		m_SleepingCount.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		// A wake-up still pending from before would keep submitters from waking
+		// this worker; clearing it before looking again means any job missed by
+		// the search below comes with a wake-up
+		m_WakePending.store(false, std::memory_order_relaxed);
+
+		Job* job = FindJob(true);
+		if (!job && !m_Stop.load(std::memory_order_relaxed))
+			m_WakeGeneration.wait(generation, std::memory_order_acquire);
+
+		m_SleepingCount.fetch_sub(1, std::memory_order_relaxed);
+		m_WakePending.store(false, std::memory_order_relaxed);
+		idleSpins = 0;
+
+		if (job)
+			Execute(job);
+	}
+
+	t_WorkerSystem = nullptr;
+	t_WorkerIndex = -1;
+}
+
+int JobSystem::GetThreadIndex() const
+{
+	if (t_WorkerSystem == this)
+		return t_WorkerIndex;
+	if (std::this_thread::get_id() == m_OwnerThread)
+		return 0;
+	return -1;
+}
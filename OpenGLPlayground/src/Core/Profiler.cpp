@@ -0,0 +1,396 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace Profiler
+{
+	namespace
+	{
+		struct Event
+		{
+			const char* Name;
+			uint64_t Start;
+			uint64_t End;
+		};
+
+		// Events are appended in fixed blocks so published events never move
+		constexpr uint32_t BlockSize = 4096;
+		constexpr uint32_t MaxBlocks = 256;
+
+		// Written only by its thread. A capture reads the first Count events of
+		// every buffer whose Generation matches the capture.
+		struct ThreadBuffer
+		{
+			uint32_t ThreadId = 0;
+			std::string Name;		// Guarded by Registry::Mutex
+
+			std::atomic<uint32_t> Generation{ 0 };
+			std::atomic<uint32_t> Count{ 0 };
+			std::atomic<uint32_t> Dropped{ 0 };
+			std::atomic<Event*> Blocks[MaxBlocks] = {};
+
+			~ThreadBuffer()
+			{
+				for (std::atomic<Event*>& block : Blocks)
+					delete[] block.load(std::memory_order_relaxed);
+			}
+		};
+
+		struct Registry
+		{
+			std::mutex Mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+		};
+
+		Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		// Bumped by every BeginCapture(); 0 means no capture has started yet
+		std::atomic<uint32_t> s_Generation{ 0 };
+		std::atomic<bool> s_Capturing{ false };
+
+		thread_local ThreadBuffer* t_Buffer = nullptr;
+
+		ThreadBuffer& GetThreadBuffer()
+		{
+			if (!t_Buffer)
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.Mutex);
+
+				registry.Buffers.push_back(std::make_unique<ThreadBuffer>());
+				t_Buffer = registry.Buffers.back().get();
+				t_Buffer->ThreadId = static_cast<uint32_t>(registry.Buffers.size());
+				t_Buffer->Name = "Thread " + std::to_string(t_Buffer->ThreadId);
+			}
+
+			return *t_Buffer;
+		}
+
+		void Record(const char* name, uint64_t start, uint64_t end)
+		{
+			ThreadBuffer& buffer = GetThreadBuffer();
+
+			// First event of a new capture: drop whatever the last one left behind
+			const uint32_t generation = s_Generation.load(std::memory_order_acquire);
+			if (buffer.Generation.load(std::memory_order_relaxed) != generation)
+			{
+				buffer.Count.store(0, std::memory_order_relaxed);
+				buffer.Dropped.store(0, std::memory_order_relaxed);
+				buffer.Generation.store(generation, std::memory_order_release);
+			}
+
+			const uint32_t index = buffer.Count.load(std::memory_order_relaxed);
+			const uint32_t block = index / BlockSize;
+			if (block >= MaxBlocks)
+			{
+				buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			Event* events = buffer.Blocks[block].load(std::memory_order_relaxed);
+			if (!events)
+			{
+				events = new Event[BlockSize];
+				buffer.Blocks[block].store(events, std::memory_order_release);
+			}
+
+			events[index % BlockSize] = { name, start, end };
+			buffer.Count.store(index + 1, std::memory_order_release);
+		}
+
+		// One frame's worth of GPU zones and the queries they used
+		struct GpuFrame
+		{
+			struct Zone
+			{
+				const char* Name;
+				uint32_t Begin;
+				uint32_t End;
+			};
+
+			std::vector<GLuint> Queries;
+			uint32_t UsedQueries = 0;
+			std::vector<Zone> Zones;
+			int64_t CpuMinusGpu = 0;	// Added to GPU timestamps to place them on the CPU clock
+			uint32_t Generation = 0;
+		};
+
+		// GL thread only
+		struct GpuState
+		{
+			GpuFrame Frames[GpuQueryFrames];
+			int Current = -1;
+			std::vector<Event> Events;
+			uint32_t Generation = 0;
+			uint32_t DroppedFrames = 0;
+		};
+
+		GpuState s_Gpu;
+
+		uint32_t AllocateQuery(GpuFrame& frame)
+		{
+			if (frame.UsedQueries == frame.Queries.size())
+			{
+				// Grow in chunks; steady-state frames reuse the same objects
+				const size_t oldSize = frame.Queries.size();
+				frame.Queries.resize(oldSize + 32);
+				glGenQueries(32, frame.Queries.data() + oldSize);
+			}
+
+			return frame.UsedQueries++;
+		}
+
+		// Read back a frame's queries if the GPU is done with them; never waits
+		void ResolveGpuFrame(GpuFrame& frame)
+		{
+			if (frame.Zones.empty())
+				return;
+
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(frame.Queries[frame.UsedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			// Queries complete in order, so the last one being ready means all are
+			if (!available)
+			{
+				++s_Gpu.DroppedFrames;
+			}
+			else if (frame.Generation == s_Gpu.Generation)
+			{
+				for (const GpuFrame::Zone& zone : frame.Zones)
+				{
+					if (zone.End == UINT32_MAX)
+						continue;
+
+					GLuint64 begin = 0;
+					GLuint64 end = 0;
+					glGetQueryObjectui64v(frame.Queries[zone.Begin], GL_QUERY_RESULT, &begin);
+					glGetQueryObjectui64v(frame.Queries[zone.End], GL_QUERY_RESULT, &end);
+
+					s_Gpu.Events.push_back({ zone.Name,
+						static_cast<uint64_t>(static_cast<int64_t>(begin) + frame.CpuMinusGpu),
+						static_cast<uint64_t>(static_cast<int64_t>(end) + frame.CpuMinusGpu) });
+				}
+			}
+
+			frame.UsedQueries = 0;
+			frame.Zones.clear();
+		}
+
+		void WriteEscaped(std::ostream& out, const char* text)
+		{
+			for (; *text; ++text)
+			{
+				if (*text == '"' || *text == '\\')
+					out << '\\';
+				out << *text;
+			}
+		}
+
+		void WriteEvent(std::ostream& out, const Event& event, uint32_t threadId, bool& first)
+		{
+			char times[96];
+			std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+				event.Start / 1000.0, (event.End - event.Start) / 1000.0);
+
+			out << (first ? "\n" : ",\n") << "{\"name\":\"";
+			WriteEscaped(out, event.Name);
+			out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId << "," << times << "}";
+			first = false;
+		}
+
+		void WriteThreadName(std::ostream& out, uint32_t threadId, const std::string& name, bool& first)
+		{
+			out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId
+				<< ",\"args\":{\"name\":\"";
+			WriteEscaped(out, name.c_str());
+			out << "\"}}";
+			first = false;
+		}
+	}
+
+	uint64_t Now()
+	{
+		static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - epoch).count());
+	}
+
+	void SetThreadName(const char* name)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+		buffer.Name = name;
+	}
+
+	void BeginCapture()
+	{
+		Now();	// Pin the epoch before any zone starts
+
+		s_Gpu.Events.clear();
+		s_Gpu.DroppedFrames = 0;
+		s_Gpu.Generation = s_Generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+		s_Capturing.store(true, std::memory_order_release);
+	}
+
+	bool EndCapture(const std::string& path, CaptureStats* stats)
+	{
+		s_Capturing.store(false, std::memory_order_release);
+
+		// Pick up GPU frames that finished since their last check, oldest first
+		if (s_Gpu.Current >= 0)
+		{
+			for (int i = 1; i <= GpuQueryFrames; ++i)
+				ResolveGpuFrame(s_Gpu.Frames[(s_Gpu.Current + i) % GpuQueryFrames]);
+		}
+
+		std::ofstream file(path);
+		if (!file)
+		{
+			std::cerr << "Failed to open trace file: " << path << std::endl;
+			return false;
+		}
+
+		CaptureStats captured;
+		const uint32_t generation = s_Generation.load(std::memory_order_acquire);
+		bool first = true;
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+
+			for (const std::unique_ptr<ThreadBuffer>& buffer : registry.Buffers)
+			{
+				WriteThreadName(file, buffer->ThreadId, buffer->Name, first);
+
+				if (buffer->Generation.load(std::memory_order_acquire) != generation)
+					continue;
+
+				const uint32_t count = buffer->Count.load(std::memory_order_acquire);
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const Event* events = buffer->Blocks[i / BlockSize].load(std::memory_order_acquire);
+					WriteEvent(file, events[i % BlockSize], buffer->ThreadId, first);
+				}
+
+				captured.CpuEvents += count;
+				captured.DroppedEvents += buffer->Dropped.load(std::memory_order_relaxed);
+			}
+		}
+
+		// GPU zones get their own row, after every thread
+		if (!s_Gpu.Events.empty())
+		{
+			WriteThreadName(file, 0, "GPU", first);
+			for (const Event& event : s_Gpu.Events)
+				WriteEvent(file, event, 0, first);
+		}
+
+		captured.GpuEvents = static_cast<uint32_t>(s_Gpu.Events.size());
+		captured.DroppedGpuFrames = s_Gpu.DroppedFrames;
+
+		file << "\n]}\n";
+
+		if (stats)
+			*stats = captured;
+
+		return static_cast<bool>(file);
+	}
+
+	bool IsCapturing()
+	{
+		return s_Capturing.load(std::memory_order_relaxed);
+	}
+
+	void BeginGpuFrame()
+	{
+		if (s_Gpu.Current < 0 && !IsCapturing())
+			return;
+
+		s_Gpu.Current = (s_Gpu.Current + 1) % GpuQueryFrames;
+		GpuFrame& frame = s_Gpu.Frames[s_Gpu.Current];
+		ResolveGpuFrame(frame);
+
+		if (!IsCapturing())
+			return;
+
+		// Current GPU time, without waiting for queued commands
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		frame.CpuMinusGpu = static_cast<int64_t>(Now()) - gpuNow;
+		frame.Generation = s_Gpu.Generation;
+	}
+
+	void ShutdownGpu()
+	{
+		for (GpuFrame& frame : s_Gpu.Frames)
+		{
+			if (!frame.Queries.empty())
+				glDeleteQueries(static_cast<GLsizei>(frame.Queries.size()), frame.Queries.data());
+
+			frame = GpuFrame();
+		}
+
+		s_Gpu.Current = -1;
+	}
+
+	CpuZone::CpuZone(const char* name)
+		: m_Name(name)
+	{
+		if (IsCapturing())
+		{
+			m_Active = true;
+			m_Start = Now();
+		}
+	}
+
+	CpuZone::~CpuZone()
+	{
+		if (m_Active)
+			Record(m_Name, m_Start, Now());
+	}
+
+	GpuZone::GpuZone(const char* name)
+	{
+		if (!IsCapturing() || s_Gpu.Current < 0)
+			return;
+
+		GpuFrame& frame = s_Gpu.Frames[s_Gpu.Current];
+		const uint32_t begin = AllocateQuery(frame);
+		glQueryCounter(frame.Queries[begin], GL_TIMESTAMP);
+
+		m_Zone = static_cast<int>(frame.Zones.size());
+		frame.Zones.push_back({ name, begin, UINT32_MAX });
+	}
+
+	GpuZone::~GpuZone()
+	{
+		if (m_Zone < 0)
+			return;
+
+		// The frame was resolved while this zone was open; nothing to close
+		GpuFrame& frame = s_Gpu.Frames[s_Gpu.Current];
+		if (static_cast<size_t>(m_Zone) >= frame.Zones.size())
+			return;
+		const uint32_t end = AllocateQuery(frame);
+		glQueryCounter(frame.Queries[end], GL_TIMESTAMP);
+
+		frame.Zones[static_cast<size_t>(m_Zone)].End = end;
+	}
+}
@@ -0,0 +1,102 @@
+#include "SkylinePacker.h"
+
+#include <algorithm>
+#include <cstddef>
+
+void SkylinePacker::Reset(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_UsedArea = 0;
+	m_Skyline.clear();
+	m_Skyline.push_back({ 0, 0, width });
+}
+
+bool SkylinePacker::Fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const
+{
+	const uint32_t x = m_Skyline[index].X;
+	if (x + width > m_Width)
+		return false;
+
+	// The rectangle rests on the highest segment it spans
+	y = 0;
+	uint32_t remaining = width;
+	for (size_t i = index; remaining > 0; ++i)
+	{
+		y = std::max(y, m_Skyline[i].Y);
+		if (y + height > m_Height)
+			return false;
+		remaining -= std::min(remaining, m_Skyline[i].Width);
+	}
+	return true;
+}
+
+bool SkylinePacker::Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+	if (width == 0 || height == 0)
+		return false;
+
+	// Lowest top edge wins; on a tie, the narrower segment wastes less
+	size_t bestIndex = m_Skyline.size();
+	uint32_t bestTop = UINT32_MAX;
+	uint32_t bestWidth = UINT32_MAX;
+	uint32_t bestY = 0;
+
+	for (size_t i = 0; i < m_Skyline.size(); ++i)
+	{
+		uint32_t fitY = 0;
+		if (!Fit(i, width, height, fitY))
+			continue;
+
+		const uint32_t top = fitY + height;
+		if (top < bestTop || (top == bestTop && m_Skyline[i].Width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = m_Skyline[i].Width;
+			bestY = fitY;
+		}
+	}
+
+	if (bestIndex == m_Skyline.size())
+		return false;
+
+	x = m_Skyline[bestIndex].X;
+	y = bestY;
+
+	// The new segment covers the rectangle; the ones under it shrink or go
+	m_Skyline.insert(m_Skyline.begin() + static_cast<std::ptrdiff_t>(bestIndex), { x, bestTop, width });
+	const uint32_t right = x + width;
+	size_t next = bestIndex + 1;
+	while (next < m_Skyline.size() && m_Skyline[next].X < right)
+	{
+		Segment& segment = m_Skyline[next];
+		const uint32_t segmentRight = segment.X + segment.Width;
+		if (segmentRight <= right)
+		{
+			m_Skyline.erase(m_Skyline.begin() + static_cast<std::ptrdiff_t>(next));
+			continue;
+		}
+
+		segment.Width = segmentRight - right;
+		segment.X = right;
+		break;
+	}
+
+	// Merge neighbours at the same height
+	for (size_t i = 0; i + 1 < m_Skyline.size();)
+	{
+		if (m_Skyline[i].Y == m_Skyline[i + 1].Y)
+		{
+			m_Skyline[i].Width += m_Skyline[i + 1].Width;
+			m_Skyline.erase(m_Skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	m_UsedArea += static_cast<uint64_t>(width) * height;
+	return true;
+}
@@ -0,0 +1,370 @@
+#include "TransformSystem.h"
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGLP_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// T * R * S for one transform, column by column
+	void ComposeLocal(float px, float py, float pz, float qx, float qy, float qz, float qw,
+		float sx, float sy, float sz, float* out)
+	{
+		const float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		const float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		const float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+		out[0] = sx * (1.0f - 2.0f * (yy + zz));
+		out[1] = sx * 2.0f * (xy + wz);
+		out[2] = sx * 2.0f * (xz - wy);
+		out[3] = 0.0f;
+
+		out[4] = sy * 2.0f * (xy - wz);
+		out[5] = sy * (1.0f - 2.0f * (xx + zz));
+		out[6] = sy * 2.0f * (yz + wx);
+		out[7] = 0.0f;
+
+		out[8] = sz * 2.0f * (xz + wy);
+		out[9] = sz * 2.0f * (yz - wx);
+		out[10] = sz * (1.0f - 2.0f * (xx + yy));
+		out[11] = 0.0f;
+
+		out[12] = px;
+		out[13] = py;
+		out[14] = pz;
+		out[15] = 1.0f;
+	}
+
+#ifdef OGLP_TRANSFORM_SSE
+	// Column-major out = a * b
+	inline void MultiplyMatrix(const float* a, const float* b, float* out)
+	{
+		const __m128 a0 = _mm_loadu_ps(a);
+		const __m128 a1 = _mm_loadu_ps(a + 4);
+		const __m128 a2 = _mm_loadu_ps(a + 8);
+		const __m128 a3 = _mm_loadu_ps(a + 12);
+
+		for (int column = 0; column < 4; ++column)
+		{
+			const __m128 b0 = _mm_loadu_ps(b + column * 4);
+			__m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(0, 0, 0, 0)));
+			result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(1, 1, 1, 1))));
+			result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(2, 2, 2, 2))));
+			result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(out + column * 4, result);
+		}
+	}
+#else
+	inline void MultiplyMatrix(const float* a, const float* b, float* out)
+	{
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				out[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1]
+					+ a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+			}
+		}
+	}
+#endif
+}
+
+TransformSystem::TransformSystem(JobSystem* jobs)
+	: m_Jobs(jobs)
+{
+	const unsigned threadCount = m_Jobs ? m_Jobs->GetThreadCount() : 1;
+	m_ThreadLocalUpdated.resize(threadCount);
+	m_ThreadWorldUpdated.resize(threadCount);
+}
+
+void TransformSystem::Reserve(size_t count)
+{
+	for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ,
+		&m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+	{
+		component->reserve(count);
+	}
+
+	m_Parent.reserve(count);
+	m_LocalDirty.reserve(count);
+	m_WorldDirty.reserve(count);
+	m_Depth.reserve(count);
+	m_Local.reserve(count);
+	m_World.reserve(count);
+}
+
+void TransformSystem::Clear()
+{
+	for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ,
+		&m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+	{
+		component->clear();
+	}
+
+	m_Parent.clear();
+	m_LocalDirty.clear();
+	m_WorldDirty.clear();
+	m_Levels.clear();
+	m_Depth.clear();
+	m_Local.clear();
+	m_World.clear();
+	m_Stats = Stats();
+}
+
+TransformHandle TransformSystem::Create(TransformHandle parent)
+{
+	const TransformHandle handle = static_cast<TransformHandle>(m_Parent.size());
+	const uint32_t depth = parent == InvalidTransformHandle ? 0 : m_Depth[parent] + 1;
+
+	m_PositionX.push_back(0.0f);
+	m_PositionY.push_back(0.0f);
+	m_PositionZ.push_back(0.0f);
+	m_RotationX.push_back(0.0f);
+	m_RotationY.push_back(0.0f);
+	m_RotationZ.push_back(0.0f);
+	m_RotationW.push_back(1.0f);
+	m_ScaleX.push_back(1.0f);
+	m_ScaleY.push_back(1.0f);
+	m_ScaleZ.push_back(1.0f);
+
+	m_Parent.push_back(parent);
+	m_LocalDirty.push_back(1);
+	m_WorldDirty.push_back(1);
+	m_Depth.push_back(depth);
+	m_Local.emplace_back(1.0f);
+	m_World.emplace_back(1.0f);
+
+	if (m_Levels.size() <= depth)
+		m_Levels.resize(depth + 1);
+	m_Levels[depth].push_back(handle);
+
+	return handle;
+}
+
+void TransformSystem::SetPosition(TransformHandle handle, const glm::vec3& position)
+{
+	m_PositionX[handle] = position.x;
+	m_PositionY[handle] = position.y;
+	m_PositionZ[handle] = position.z;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetRotation(TransformHandle handle, const glm::quat& rotation)
+{
+	m_RotationX[handle] = rotation.x;
+	m_RotationY[handle] = rotation.y;
+	m_RotationZ[handle] = rotation.z;
+	m_RotationW[handle] = rotation.w;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetScale(TransformHandle handle, const glm::vec3& scale)
+{
+	m_ScaleX[handle] = scale.x;
+	m_ScaleY[handle] = scale.y;
+	m_ScaleZ[handle] = scale.z;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetLocal(TransformHandle handle, const glm::vec3& position, const glm::quat& rotation,
+	const glm::vec3& scale)
+{
+	SetPosition(handle, position);
+	SetRotation(handle, rotation);
+	SetScale(handle, scale);
+}
+
+glm::vec3 TransformSystem::GetPosition(TransformHandle handle) const
+{
+	return glm::vec3(m_PositionX[handle], m_PositionY[handle], m_PositionZ[handle]);
+}
+
+glm::quat TransformSystem::GetRotation(TransformHandle handle) const
+{
+	return glm::quat(m_RotationW[handle], m_RotationX[handle], m_RotationY[handle], m_RotationZ[handle]);
+}
+
+glm::vec3 TransformSystem::GetScale(TransformHandle handle) const
+{
+	return glm::vec3(m_ScaleX[handle], m_ScaleY[handle], m_ScaleZ[handle]);
+}
+
+void TransformSystem::Update()
+{
+	OGLP_PROFILE_FUNCTION();
+	const Clock::time_point start = Clock::now();
+
+	const size_t count = GetCount();
+	const unsigned threadCount = m_Jobs ? m_Jobs->GetThreadCount() : 1;
+
+	std::fill(m_ThreadLocalUpdated.begin(), m_ThreadLocalUpdated.end(), 0u);
+	std::fill(m_ThreadWorldUpdated.begin(), m_ThreadWorldUpdated.end(), 0u);
+
+	// Slices count into their own entries of the per-slice stats, so they share nothing
+	auto forEachSlice = [&](size_t itemCount, const auto& function)
+	{
+		const unsigned sliceCount = itemCount >= MinTransformsPerThread * 2 ? threadCount : 1;
+		if (sliceCount == 1)
+		{
+			function(0u, 1u);
+			return;
+		}
+
+		m_Jobs->ParallelFor(sliceCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; ++slice)
+				function(static_cast<unsigned>(slice), sliceCount);
+		});
+	};
+
+	// Local matrices in blocks of four, then the hierarchy one level at a time;
+	// each level's jobs start once the level above has finished
+	forEachSlice(count, [&](unsigned slice, unsigned sliceCount)
+	{
+		// Slices start on a multiple of four, so SSE blocks never straddle jobs
+		const size_t blocks = (count + 3) / 4;
+		const size_t begin = std::min(count, blocks * slice / sliceCount * 4);
+		const size_t end = std::min(count, blocks * (slice + 1) / sliceCount * 4);
+		UpdateLocal(begin, end, m_ThreadLocalUpdated[slice]);
+	});
+
+	for (size_t depth = 0; depth < m_Levels.size(); ++depth)
+	{
+		const std::vector<TransformHandle>& level = m_Levels[depth];
+		forEachSlice(level.size(), [&](unsigned slice, unsigned sliceCount)
+		{
+			const size_t begin = level.size() * slice / sliceCount;
+			const size_t end = level.size() * (slice + 1) / sliceCount;
+			UpdateLevel(level, depth == 0, begin, end, m_ThreadWorldUpdated[slice]);
+		});
+	}
+
+	m_Stats = Stats();
+	for (unsigned t = 0; t < m_ThreadLocalUpdated.size(); ++t)
+	{
+		m_Stats.LocalUpdated += m_ThreadLocalUpdated[t];
+		m_Stats.WorldUpdated += m_ThreadWorldUpdated[t];
+	}
+	m_Stats.UpdateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void TransformSystem::UpdateLocal(size_t begin, size_t end, uint32_t& updated)
+{
+	size_t i = begin;
+
+#ifdef OGLP_TRANSFORM_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	for (; i + 4 <= end; i += 4)
+	{
+		uint32_t dirty;
+		std::memcpy(&dirty, &m_LocalDirty[i], sizeof(dirty));
+		if (!dirty)
+			continue;
+
+		// One lane per transform
+		const __m128 qx = _mm_loadu_ps(&m_RotationX[i]);
+		const __m128 qy = _mm_loadu_ps(&m_RotationY[i]);
+		const __m128 qz = _mm_loadu_ps(&m_RotationZ[i]);
+		const __m128 qw = _mm_loadu_ps(&m_RotationW[i]);
+		const __m128 sx = _mm_loadu_ps(&m_ScaleX[i]);
+		const __m128 sy = _mm_loadu_ps(&m_ScaleY[i]);
+		const __m128 sz = _mm_loadu_ps(&m_ScaleZ[i]);
+
+		const __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		const __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		const __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		// Rotation columns scaled by the matching axis; see ComposeLocal()
+		__m128 c0x = _mm_mul_ps(sx, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+		__m128 c0y = _mm_mul_ps(sx, _mm_mul_ps(two, _mm_add_ps(xy, wz)));
+		__m128 c0z = _mm_mul_ps(sx, _mm_mul_ps(two, _mm_sub_ps(xz, wy)));
+		__m128 c0w = _mm_setzero_ps();
+
+		__m128 c1x = _mm_mul_ps(sy, _mm_mul_ps(two, _mm_sub_ps(xy, wz)));
+		__m128 c1y = _mm_mul_ps(sy, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+		__m128 c1z = _mm_mul_ps(sy, _mm_mul_ps(two, _mm_add_ps(yz, wx)));
+		__m128 c1w = _mm_setzero_ps();
+
+		__m128 c2x = _mm_mul_ps(sz, _mm_mul_ps(two, _mm_add_ps(xz, wy)));
+		__m128 c2y = _mm_mul_ps(sz, _mm_mul_ps(two, _mm_sub_ps(yz, wx)));
+		__m128 c2z = _mm_mul_ps(sz, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+		__m128 c2w = _mm_setzero_ps();
+
+		__m128 c3x = _mm_loadu_ps(&m_PositionX[i]);
+		__m128 c3y = _mm_loadu_ps(&m_PositionY[i]);
+		__m128 c3z = _mm_loadu_ps(&m_PositionZ[i]);
+		__m128 c3w = one;
+
+		// Lanes to matrices: after transposing, register n holds that column of transform i + n
+		_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+		_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+		_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+		_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+		const __m128 columns[4][4] = {
+			{ c0x, c1x, c2x, c3x },
+			{ c0y, c1y, c2y, c3y },
+			{ c0z, c1z, c2z, c3z },
+			{ c0w, c1w, c2w, c3w },
+		};
+		for (int n = 0; n < 4; ++n)
+		{
+			float* out = &m_Local[i + n][0][0];
+			_mm_storeu_ps(out, columns[n][0]);
+			_mm_storeu_ps(out + 4, columns[n][1]);
+			_mm_storeu_ps(out + 8, columns[n][2]);
+			_mm_storeu_ps(out + 12, columns[n][3]);
+		}
+
+		updated += 4;
+	}
+#endif
+
+	// Remainder, or everything without SSE
+	for (; i < end; ++i)
+	{
+		if (!m_LocalDirty[i])
+			continue;
+
+		ComposeLocal(m_PositionX[i], m_PositionY[i], m_PositionZ[i],
+			m_RotationX[i], m_RotationY[i], m_RotationZ[i], m_RotationW[i],
+			m_ScaleX[i], m_ScaleY[i], m_ScaleZ[i], &m_Local[i][0][0]);
+		++updated;
+	}
+}
+
+void TransformSystem::UpdateLevel(const std::vector<TransformHandle>& level, bool roots, size_t begin, size_t end,
+	uint32_t& updated)
+{
+	for (size_t n = begin; n < end; ++n)
+	{
+		const TransformHandle handle = level[n];
+		const TransformHandle parent = m_Parent[handle];
+
+		// The parent's flag was settled by the previous level
+		const bool dirty = m_LocalDirty[handle] || (!roots && m_WorldDirty[parent]);
+		m_WorldDirty[handle] = dirty;
+		m_LocalDirty[handle] = 0;
+
+		if (!dirty)
+			continue;
+
+		if (roots)
+			m_World[handle] = m_Local[handle];
+		else
+			MultiplyMatrix(&m_World[parent][0][0], &m_Local[handle][0][0], &m_World[handle][0][0]);
+		++updated;
+	}
+}
@@ -0,0 +1,236 @@
+#include "BatchRenderer.h"
+
+#include "GLStateCache.h"
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace
+{
+	uint32_t PackColor(const glm::vec4& color)
+	{
+		const glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return static_cast<uint32_t>(c.r)
+			| static_cast<uint32_t>(c.g) << 8
+			| static_cast<uint32_t>(c.b) << 16
+			| static_cast<uint32_t>(c.a) << 24;
+	}
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	for (GLsync& fence : m_SegmentFences)
+	{
+		if (fence) glDeleteSync(fence);
+	}
+
+	if (m_InstanceBuffer)
+	{
+		glUnmapNamedBuffer(m_InstanceBuffer);
+		glDeleteBuffers(1, &m_InstanceBuffer);
+	}
+
+	if (m_VAO) glDeleteVertexArrays(1, &m_VAO);
+	if (m_VBO) glDeleteBuffers(1, &m_VBO);
+	if (m_EBO) glDeleteBuffers(1, &m_EBO);
+}
+
+bool BatchRenderer::Initialize(GLStateCache& state, ShaderLibrary& shaders, uint32_t maxQuadsPerSegment)
+{
+	m_State = &state;
+	m_Shaders = &shaders;
+
+	m_Shader = shaders.Load("shaders/Batch.vert", "shaders/Batch.frag");
+	m_ArrayShader = shaders.Load("shaders/Batch.vert", "shaders/BatchArray.frag");
+	if (!shaders.GetProgram(m_Shader) || !shaders.GetProgram(m_ArrayShader))
+	{
+		std::cerr << "Failed to build the batch shaders" << std::endl;
+		return false;
+	}
+
+	m_SegmentCapacity = maxQuadsPerSegment;
+	m_Batches.reserve(64);
+
+	// Unit quad shared by every instance; texture coordinates are derived from the corner
+	const float corners[] = {
+		-0.5f, -0.5f,
+		 0.5f, -0.5f,
+		 0.5f,  0.5f,
+		-0.5f,  0.5f,
+	};
+	const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	glGenVertexArrays(1, &m_VAO);
+	m_State->BindVertexArray(m_VAO);
+
+	glGenBuffers(1, &m_VBO);
+	m_State->BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glGenBuffers(1, &m_EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	// Persistent + coherent: quads are written in place, no map/unmap per frame
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr bufferSize = static_cast<GLsizeiptr>(sizeof(QuadInstance)) * m_SegmentCapacity * SegmentCount;
+
+	glGenBuffers(1, &m_InstanceBuffer);
+	m_State->BindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+	glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, flags);
+	m_Instances = static_cast<QuadInstance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags));
+
+	// Per-instance attributes; draws pick their segment with the base instance
+	const GLsizei stride = sizeof(QuadInstance);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, Row0));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, Row1));
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, Row2));
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, UVRect));
+	glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(QuadInstance, Color));
+	glVertexAttribIPointer(6, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(QuadInstance, Layer));
+	for (GLuint attribute = 1; attribute <= 6; ++attribute)
+	{
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	m_State->BindVertexArray(0);
+
+	if (!m_Instances)
+	{
+		std::cerr << "Failed to map batch instance buffer" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void BatchRenderer::Begin()
+{
+	m_Stats = Stats();
+
+	WaitForSegment();
+}
+
+void BatchRenderer::SubmitQuad(const glm::mat4& transform, const glm::vec4& color, const glm::vec4& uvRect, GLuint texture)
+{
+	QuadInstance* quad = AllocateQuad(GL_TEXTURE_2D, texture);
+
+	// glm is column-major; the shader wants rows
+	quad->Row0 = glm::vec4(transform[0][0], transform[1][0], transform[2][0], transform[3][0]);
+	quad->Row1 = glm::vec4(transform[0][1], transform[1][1], transform[2][1], transform[3][1]);
+	quad->Row2 = glm::vec4(transform[0][2], transform[1][2], transform[2][2], transform[3][2]);
+	quad->UVRect = uvRect;
+	quad->Color = PackColor(color);
+	quad->Layer = 0;
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2& position, const glm::vec2& size, float rotation,
+	const glm::vec4& color, const glm::vec4& uvRect, GLuint texture)
+{
+	QuadInstance* quad = AllocateQuad(GL_TEXTURE_2D, texture);
+
+	const float c = std::cos(rotation);
+	const float s = std::sin(rotation);
+	quad->Row0 = glm::vec4(c * size.x, -s * size.y, 0.0f, position.x);
+	quad->Row1 = glm::vec4(s * size.x, c * size.y, 0.0f, position.y);
+	quad->Row2 = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+	quad->UVRect = uvRect;
+	quad->Color = PackColor(color);
+	quad->Layer = 0;
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2& position, const glm::vec2& size, float rotation,
+	const glm::vec4& color, const TextureAtlas& atlas, AtlasHandle image)
+{
+	const AtlasRegion region = atlas.GetRegion(image);
+	QuadInstance* quad = AllocateQuad(GL_TEXTURE_2D_ARRAY, atlas.GetTexture());
+
+	const float c = std::cos(rotation);
+	const float s = std::sin(rotation);
+	quad->Row0 = glm::vec4(c * size.x, -s * size.y, 0.0f, position.x);
+	quad->Row1 = glm::vec4(s * size.x, c * size.y, 0.0f, position.y);
+	quad->Row2 = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+	quad->UVRect = region.UVRect;
+	quad->Color = PackColor(color);
+	quad->Layer = region.Layer;
+}
+
+void BatchRenderer::End()
+{
+	Flush();
+}
+
+BatchRenderer::QuadInstance* BatchRenderer::AllocateQuad(GLenum target, GLuint texture)
+{
+	if (m_QuadCount == m_SegmentCapacity)
+	{
+		// Segment is full: draw what we have and move on to the next one
+		Flush();
+		WaitForSegment();
+	}
+
+	if (m_Batches.empty() || m_Batches.back().Texture != texture || m_Batches.back().Target != target)
+		m_Batches.push_back({ target, texture, m_QuadCount, 0 });
+
+	++m_Batches.back().Count;
+	++m_Stats.Quads;
+
+	return m_Instances + static_cast<size_t>(m_Segment) * m_SegmentCapacity + m_QuadCount++;
+}
+
+void BatchRenderer::Flush()
+{
+	if (m_QuadCount == 0)
+		return;
+
+	m_State->SetBlend(true);
+	m_State->SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	m_State->SetDepthTest(false);
+
+	m_State->BindVertexArray(m_VAO);
+
+	// Looked up per flush, so hot-reloaded programs are picked up
+	const GLuint program = m_Shaders->GetProgram(m_Shader);
+	const GLuint arrayProgram = m_Shaders->GetProgram(m_ArrayShader);
+
+	const GLuint segmentBase = static_cast<GLuint>(m_Segment) * m_SegmentCapacity;
+	for (const Batch& batch : m_Batches)
+	{
+		m_State->UseProgram(batch.Target == GL_TEXTURE_2D_ARRAY ? arrayProgram : program);
+		m_State->BindTexture(0, batch.Target, batch.Texture);
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr,
+			static_cast<GLsizei>(batch.Count), segmentBase + batch.First);
+	}
+	m_Stats.DrawCalls += static_cast<uint32_t>(m_Batches.size());
+	++m_Stats.Flushes;
+
+	// The GPU owns this segment until the fence passes
+	m_SegmentFences[m_Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Segment = (m_Segment + 1) % SegmentCount;
+
+	m_QuadCount = 0;
+	m_Batches.clear();
+}
+
+void BatchRenderer::WaitForSegment()
+{
+	GLsync& fence = m_SegmentFences[m_Segment];
+	if (!fence)
+		return;
+
+	// Normally signalled already, since the segment was used SegmentCount flushes ago
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		++m_Stats.FenceWaits;
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
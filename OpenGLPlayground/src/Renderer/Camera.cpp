@@ -0,0 +1,75 @@
+#include "Camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+void Camera::SetLookAt(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up)
+{
+	if (position == m_Position && target == m_Target && up == m_Up)
+		return;
+
+	m_Position = position;
+	m_Target = target;
+	m_Up = up;
+	m_ViewDirty = true;
+}
+
+void Camera::SetPerspective(float fovYRadians, float nearPlane, float farPlane)
+{
+	if (!m_Orthographic && fovYRadians == m_FovY && nearPlane == m_Near && farPlane == m_Far)
+		return;
+
+	m_Orthographic = false;
+	m_FovY = fovYRadians;
+	m_Near = nearPlane;
+	m_Far = farPlane;
+	m_ProjectionDirty = true;
+}
+
+void Camera::SetOrthographic(float left, float right, float bottom, float top, float nearPlane, float farPlane)
+{
+	const glm::vec4 bounds(left, right, bottom, top);
+	if (m_Orthographic && bounds == m_OrthographicBounds && nearPlane == m_Near && farPlane == m_Far)
+		return;
+
+	m_Orthographic = true;
+	m_OrthographicBounds = bounds;
+	m_Near = nearPlane;
+	m_Far = farPlane;
+	m_ProjectionDirty = true;
+}
+
+void Camera::SetViewportSize(int width, int height)
+{
+	// Minimized windows report 0x0; keep the last usable aspect ratio
+	if (width <= 0 || height <= 0)
+		return;
+
+	const float aspect = static_cast<float>(width) / static_cast<float>(height);
+	if (aspect == m_Aspect)
+		return;
+
+	m_Aspect = aspect;
+	m_ProjectionDirty = true;
+}
+
+bool Camera::Update()
+{
+	if (!m_ViewDirty && !m_ProjectionDirty)
+		return false;
+
+	if (m_ViewDirty)
+		m_View = glm::lookAt(m_Position, m_Target, m_Up);
+
+	if (m_ProjectionDirty)
+	{
+		const glm::vec4& bounds = m_OrthographicBounds;
+		m_Projection = m_Orthographic ? glm::ortho(bounds.x, bounds.y, bounds.z, bounds.w, m_Near, m_Far)
+			: glm::perspective(m_FovY, m_Aspect, m_Near, m_Far);
+	}
+
+	m_ViewProjection = m_Projection * m_View;
+	m_ViewDirty = false;
+	m_ProjectionDirty = false;
+	++m_Version;
+	return true;
+}
@@ -0,0 +1,369 @@
+#include "CommandBuffer.h"
+
+#include "GLStateCache.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	size_t GetIndexSize(GLenum indexType)
+	{
+		switch (indexType)
+		{
+		case GL_UNSIGNED_BYTE: return 1;
+		case GL_UNSIGNED_SHORT: return 2;
+		default: return 4;
+		}
+	}
+}
+
+uint32_t SortKey::QuantizeDepth(float depth, bool backToFront)
+{
+	const float clamped = std::clamp(depth, 0.0f, 1.0f);
+	const uint32_t quantized = static_cast<uint32_t>(clamped * static_cast<float>(MaxDepth));
+	return backToFront ? MaxDepth - quantized : quantized;
+}
+
+UniformValue UniformValue::MakeInt(GLint location, GLint value)
+{
+	UniformValue uniform;
+	uniform.Location = location;
+	uniform.Kind = Type::Int;
+	uniform.Int = value;
+	return uniform;
+}
+
+UniformValue UniformValue::MakeFloat(GLint location, float value)
+{
+	UniformValue uniform;
+	uniform.Location = location;
+	uniform.Kind = Type::Float;
+	uniform.Float[0] = value;
+	return uniform;
+}
+
+UniformValue UniformValue::MakeVec4(GLint location, const glm::vec4& value)
+{
+	UniformValue uniform;
+	uniform.Location = location;
+	uniform.Kind = Type::Vec4;
+	std::memcpy(uniform.Float, glm::value_ptr(value), sizeof(value));
+	return uniform;
+}
+
+UniformValue UniformValue::MakeMat4(GLint location, const glm::mat4& value)
+{
+	UniformValue uniform;
+	uniform.Location = location;
+	uniform.Kind = Type::Mat4;
+	std::memcpy(uniform.Float, glm::value_ptr(value), sizeof(value));
+	return uniform;
+}
+
+DrawPacket& CommandBuffer::AddDraw(uint64_t key, uint32_t uniformCount)
+{
+	DrawPacket* packet = new (Allocate(sizeof(DrawPacket), alignof(DrawPacket))) DrawPacket();
+
+	if (uniformCount > 0)
+	{
+		UniformValue* uniforms = static_cast<UniformValue*>(
+			Allocate(sizeof(UniformValue) * uniformCount, alignof(UniformValue)));
+		for (uint32_t i = 0; i < uniformCount; ++i)
+			new (uniforms + i) UniformValue();
+
+		packet->Uniforms = uniforms;
+		packet->UniformCount = uniformCount;
+	}
+
+	m_Entries.push_back({ key, packet });
+	return *packet;
+}
+
+void CommandBuffer::Reset()
+{
+	m_Block = 0;
+	m_Offset = 0;
+	m_Entries.clear();
+}
+
+void* CommandBuffer::Allocate(size_t size, size_t alignment)
+{
+	size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+
+	if (m_Blocks.empty() || offset + size > m_Blocks[m_Block].Size)
+	{
+		// Move on to the next block; blocks from earlier frames are reused,
+		// unless this request is too large for the one in line
+		if (!m_Blocks.empty())
+			++m_Block;
+		if (m_Block == m_Blocks.size())
+			m_Blocks.emplace_back();
+
+		Block& block = m_Blocks[m_Block];
+		if (block.Size < size)
+		{
+			block.Size = std::max(BlockSize, size);
+			block.Data.reset(new uint8_t[block.Size]);
+		}
+
+		offset = 0;
+	}
+
+	m_Offset = offset + size;
+	return m_Blocks[m_Block].Data.get() + offset;
+}
+
+CommandQueue::CommandQueue(unsigned threadCount)
+	: m_OwnedJobs(std::make_unique<JobSystem>(threadCount, "CommandQueue")),
+	m_Jobs(*m_OwnedJobs)
+{
+	CreateThreadData();
+}
+
+CommandQueue::CommandQueue(JobSystem& jobs)
+	: m_Jobs(jobs)
+{
+	CreateThreadData();
+}
+
+CommandQueue::~CommandQueue() = default;
+
+void CommandQueue::CreateThreadData()
+{
+	m_ThreadCount = m_Jobs.GetThreadCount();
+
+	for (unsigned i = 0; i < m_ThreadCount; ++i)
+		m_Buffers.push_back(std::make_unique<CommandBuffer>());
+
+	m_Histograms.resize(static_cast<size_t>(m_ThreadCount) * 256);
+	m_KeyAnd.resize(m_ThreadCount);
+	m_KeyOr.resize(m_ThreadCount);
+}
+
+template <typename F>
+void CommandQueue::ForEachSlice(unsigned sliceCount, const F& function)
+{
+	m_Jobs.ParallelFor(sliceCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t slice = begin; slice < end; ++slice)
+			function(static_cast<unsigned>(slice));
+	});
+}
+
+void CommandQueue::Reset()
+{
+	for (std::unique_ptr<CommandBuffer>& buffer : m_Buffers)
+		buffer->Reset();
+
+	m_Sorted = &m_EntriesA;
+	m_Sorted->clear();
+	m_Stats = Stats();
+}
+
+void CommandQueue::Record(uint32_t itemCount, const std::function<void(CommandBuffer&, uint32_t, uint32_t)>& record)
+{
+	OGLP_PROFILE_FUNCTION();
+	const Clock::time_point start = Clock::now();
+
+	ForEachSlice(m_ThreadCount, [&](unsigned slice)
+	{
+		const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * slice / m_ThreadCount);
+		const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * (slice + 1) / m_ThreadCount);
+		if (begin < end)
+		{
+			OGLP_PROFILE_SCOPE("RecordSlice");
+			record(*m_Buffers[slice], begin, end);
+		}
+	});
+
+	m_Stats.RecordMs += MillisecondsSince(start);
+}
+
+void CommandQueue::Sort()
+{
+	OGLP_PROFILE_FUNCTION();
+	const Clock::time_point start = Clock::now();
+
+	m_MergeOffsets.clear();
+	size_t total = 0;
+	for (const std::unique_ptr<CommandBuffer>& buffer : m_Buffers)
+	{
+		m_MergeOffsets.push_back(total);
+		total += buffer->GetEntries().size();
+	}
+
+	m_EntriesA.resize(total);
+	m_EntriesB.resize(total);
+
+	// Small frames sort on the calling thread alone
+	const unsigned sliceCount = m_ThreadCount > 1 && total >= MinEntriesPerThread * 2 ? m_ThreadCount : 1;
+
+	ForEachSlice(sliceCount, [&](unsigned slice) { MergeSlice(slice, sliceCount); });
+
+	// Bits that differ between any two keys; bytes without any are skipped
+	uint64_t allAnd = ~0ull;
+	uint64_t allOr = 0;
+	for (unsigned slice = 0; slice < sliceCount; ++slice)
+	{
+		allAnd &= m_KeyAnd[slice];
+		allOr |= m_KeyOr[slice];
+	}
+	const uint64_t varying = total > 0 ? allAnd ^ allOr : 0;
+
+	CommandBuffer::Entry* source = m_EntriesA.data();
+	CommandBuffer::Entry* destination = m_EntriesB.data();
+	uint32_t passes = 0;
+
+	for (unsigned shift = 0; shift < 64; shift += 8)
+	{
+		if (((varying >> shift) & 0xFF) == 0)
+			continue;
+
+		// Every histogram must be complete before any slice knows where to scatter
+		ForEachSlice(sliceCount, [&](unsigned slice) { HistogramSlice(slice, sliceCount, source, shift); });
+		ForEachSlice(sliceCount, [&](unsigned slice) { ScatterSlice(slice, sliceCount, source, destination, shift); });
+
+		std::swap(source, destination);
+		++passes;
+	}
+
+	m_Sorted = source == m_EntriesA.data() ? &m_EntriesA : &m_EntriesB;
+	m_Stats.SortPasses = passes;
+	m_Stats.Draws = static_cast<uint32_t>(total);
+	m_Stats.SortMs += MillisecondsSince(start);
+}
+
+void CommandQueue::MergeSlice(unsigned slice, unsigned sliceCount)
+{
+	const size_t total = m_EntriesA.size();
+	const size_t begin = total * slice / sliceCount;
+	const size_t end = total * (slice + 1) / sliceCount;
+
+	// Copy the part of every buffer that falls in this slice
+	for (size_t b = 0; b < m_Buffers.size(); ++b)
+	{
+		const std::vector<CommandBuffer::Entry>& entries = m_Buffers[b]->GetEntries();
+		const size_t bufferBegin = m_MergeOffsets[b];
+		const size_t bufferEnd = bufferBegin + entries.size();
+
+		const size_t copyBegin = std::max(begin, bufferBegin);
+		const size_t copyEnd = std::min(end, bufferEnd);
+		if (copyBegin < copyEnd)
+		{
+			std::memcpy(m_EntriesA.data() + copyBegin, entries.data() + (copyBegin - bufferBegin),
+				(copyEnd - copyBegin) * sizeof(CommandBuffer::Entry));
+		}
+	}
+
+	uint64_t keyAnd = ~0ull;
+	uint64_t keyOr = 0;
+	for (size_t i = begin; i < end; ++i)
+	{
+		keyAnd &= m_EntriesA[i].Key;
+		keyOr |= m_EntriesA[i].Key;
+	}
+	m_KeyAnd[slice] = keyAnd;
+	m_KeyOr[slice] = keyOr;
+}
+
+void CommandQueue::HistogramSlice(unsigned slice, unsigned sliceCount, const CommandBuffer::Entry* source, unsigned shift)
+{
+	const size_t total = m_EntriesA.size();
+	const size_t begin = total * slice / sliceCount;
+	const size_t end = total * (slice + 1) / sliceCount;
+
+	uint32_t* histogram = m_Histograms.data() + static_cast<size_t>(slice) * 256;
+	std::fill(histogram, histogram + 256, 0u);
+	for (size_t i = begin; i < end; ++i)
+		++histogram[(source[i].Key >> shift) & 0xFF];
+}
+
+void CommandQueue::ScatterSlice(unsigned slice, unsigned sliceCount, const CommandBuffer::Entry* source,
+	CommandBuffer::Entry* destination, unsigned shift)
+{
+	const size_t total = m_EntriesA.size();
+	const size_t begin = total * slice / sliceCount;
+	const size_t end = total * (slice + 1) / sliceCount;
+
+	// Each digit's output starts after all smaller digits, and after the same
+	// digit from earlier slices, which keeps the sort stable
+	size_t offsets[256];
+	size_t running = 0;
+	for (unsigned digit = 0; digit < 256; ++digit)
+	{
+		for (unsigned t = 0; t < sliceCount; ++t)
+		{
+			if (t == slice)
+				offsets[digit] = running;
+			running += m_Histograms[static_cast<size_t>(t) * 256 + digit];
+		}
+	}
+
+	for (size_t i = begin; i < end; ++i)
+		destination[offsets[(source[i].Key >> shift) & 0xFF]++] = source[i];
+}
+
+void CommandQueue::Execute(GLStateCache& state)
+{
+	OGLP_PROFILE_FUNCTION();
+	const Clock::time_point start = Clock::now();
+
+	for (const CommandBuffer::Entry& entry : *m_Sorted)
+	{
+		const DrawPacket& packet = *entry.Packet;
+
+		state.SetBlend(packet.Blend);
+		if (packet.Blend)
+			state.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		state.SetDepthTest(packet.DepthTest);
+
+		state.UseProgram(packet.Program);
+		state.BindVertexArray(packet.VertexArray);
+
+		for (GLuint unit = 0; unit < DrawPacket::MaxTextures; ++unit)
+		{
+			if (packet.Textures[unit])
+				state.BindTexture(unit, GL_TEXTURE_2D, packet.Textures[unit]);
+		}
+
+		for (uint32_t i = 0; i < packet.UniformCount; ++i)
+		{
+			const UniformValue& uniform = packet.Uniforms[i];
+			switch (uniform.Kind)
+			{
+			case UniformValue::Type::Int: glUniform1i(uniform.Location, uniform.Int); break;
+			case UniformValue::Type::Float: glUniform1f(uniform.Location, uniform.Float[0]); break;
+			case UniformValue::Type::Vec4: glUniform4fv(uniform.Location, 1, uniform.Float); break;
+			case UniformValue::Type::Mat4: glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, uniform.Float); break;
+			}
+		}
+
+		if (packet.DrawCount > 0)
+		{
+			state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, packet.IndirectBuffer);
+			glMultiDrawElementsIndirect(packet.Mode, packet.IndexType,
+				reinterpret_cast<const void*>(static_cast<size_t>(packet.IndirectOffset)),
+				static_cast<GLsizei>(packet.DrawCount), sizeof(DrawElementsIndirectCommand));
+			continue;
+		}
+
+		const size_t indexOffset = static_cast<size_t>(packet.FirstIndex) * GetIndexSize(packet.IndexType);
+		glDrawElementsInstancedBaseVertex(packet.Mode, static_cast<GLsizei>(packet.IndexCount), packet.IndexType,
+			reinterpret_cast<const void*>(indexOffset), static_cast<GLsizei>(packet.InstanceCount), packet.BaseVertex);
+	}
+
+	m_Stats.ExecuteMs += MillisecondsSince(start);
+}
@@ -0,0 +1,159 @@
+#include "CookedMesh.h"
+
+#include "Hash.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+
+const char* GetCookedPositionFormatName(CookedPositionFormat format)
+{
+	switch (format)
+	{
+	case CookedPositionFormat::Snorm16: return "snorm16";
+	case CookedPositionFormat::Half:    return "half";
+	}
+	return "unknown";
+}
+
+bool ParseCookedPositionFormat(const std::string& name, CookedPositionFormat& format)
+{
+	for (CookedPositionFormat candidate : { CookedPositionFormat::Snorm16, CookedPositionFormat::Half })
+	{
+		if (name == GetCookedPositionFormatName(candidate))
+		{
+			format = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string GetCookedMeshPath(const std::string& cookedDirectory, const std::string& sourcePath)
+{
+	return (std::filesystem::path(cookedDirectory) / GetCookedFileStem(sourcePath)).string() + ".oglm";
+}
+
+void SetCookedVertexFormat(GLuint vertexArray, GLuint binding, CookedPositionFormat format)
+{
+	if (format == CookedPositionFormat::Half)
+		glVertexArrayAttribFormat(vertexArray, 0, 3, GL_HALF_FLOAT, GL_FALSE, offsetof(CookedMeshVertex, Position));
+	else
+		glVertexArrayAttribFormat(vertexArray, 0, 3, GL_SHORT, GL_TRUE, offsetof(CookedMeshVertex, Position));
+	glVertexArrayAttribFormat(vertexArray, 1, 3, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(CookedMeshVertex, Color));
+	glVertexArrayAttribFormat(vertexArray, 2, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(CookedMeshVertex, TexCoord));
+
+	for (GLuint attribute = 0; attribute < 3; ++attribute)
+	{
+		glVertexArrayAttribBinding(vertexArray, attribute, binding);
+		glEnableVertexArrayAttrib(vertexArray, attribute);
+	}
+}
+
+bool CookedMesh::Open(const std::string& path)
+{
+	m_Header = nullptr;
+
+	if (!m_File.Open(path))
+	{
+		std::cerr << "Failed to map cooked mesh: " << path << std::endl;
+		return false;
+	}
+
+	m_Data = m_File.GetData();
+	m_Size = m_File.GetSize();
+	return Validate(path);
+}
+
+bool CookedMesh::OpenMemory(const unsigned char* data, size_t size)
+{
+	m_File.Close();
+	m_Header = nullptr;
+	m_Data = data;
+	m_Size = size;
+	return Validate("<memory>");
+}
+
+bool CookedMesh::Validate(const std::string& name)
+{
+	if (m_Size < sizeof(CookedMeshHeader))
+	{
+		std::cerr << "Cooked mesh is truncated: " << name << std::endl;
+		return false;
+	}
+
+	const auto* header = reinterpret_cast<const CookedMeshHeader*>(m_Data);
+	if (header->Magic != CookedMeshHeader::MagicValue
+		|| header->Version != CookedMeshHeader::CurrentVersion
+		|| header->VertexStride != sizeof(CookedMeshVertex)
+		|| (header->IndexSize != 2 && header->IndexSize != 4))
+	{
+		std::cerr << "Not a valid cooked mesh (or an old version): " << name << std::endl;
+		return false;
+	}
+
+	const uint64_t indexBytes = static_cast<uint64_t>(header->IndexCount) * header->IndexSize;
+	const uint64_t vertexBytes = static_cast<uint64_t>(header->VertexCount) * header->VertexStride;
+	if (header->DataOffset + header->DataSize > m_Size
+		|| header->IndexOffset + indexBytes > header->DataSize
+		|| header->VertexOffset + vertexBytes > header->DataSize
+		|| header->IndexOffset % header->IndexSize != 0
+		|| header->VertexOffset % 16 != 0)
+	{
+		std::cerr << "Cooked mesh has a corrupt data layout: " << name << std::endl;
+		return false;
+	}
+
+	m_Header = header;
+	return true;
+}
+
+const CookedMeshVertex* CookedMesh::GetVertices() const
+{
+	return reinterpret_cast<const CookedMeshVertex*>(m_Data + m_Header->DataOffset + m_Header->VertexOffset);
+}
+
+glm::mat4 CookedMesh::GetDequantizeTransform() const
+{
+	if (m_Header->PositionFormat != CookedPositionFormat::Snorm16)
+		return glm::mat4(1.0f);
+
+	// Normalized positions span -1..1 across the bounds on every axis
+	const glm::vec3 boundsMin(m_Header->BoundsMin[0], m_Header->BoundsMin[1], m_Header->BoundsMin[2]);
+	const glm::vec3 boundsMax(m_Header->BoundsMax[0], m_Header->BoundsMax[1], m_Header->BoundsMax[2]);
+	const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	const glm::vec3 extent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-20f));
+
+	glm::mat4 transform(1.0f);
+	transform[0][0] = extent.x;
+	transform[1][1] = extent.y;
+	transform[2][2] = extent.z;
+	transform[3] = glm::vec4(center, 1.0f);
+	return transform;
+}
+
+GLuint CookedMesh::CreateGLBuffer() const
+{
+	if (!m_Header)
+		return 0;
+
+	// Direct state access: nothing is bound, so the renderer's cached buffer
+	// bindings stay valid
+	GLuint buffer = 0;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, static_cast<GLsizeiptr>(m_Header->DataSize), m_Data + m_Header->DataOffset, 0);
+	return buffer;
+}
+
+GLuint CookedMesh::CreateGLVertexArray(GLuint buffer) const
+{
+	if (!m_Header)
+		return 0;
+
+	GLuint vertexArray = 0;
+	glCreateVertexArrays(1, &vertexArray);
+	glVertexArrayVertexBuffer(vertexArray, 0, buffer, static_cast<GLintptr>(m_Header->VertexOffset), sizeof(CookedMeshVertex));
+	glVertexArrayElementBuffer(vertexArray, buffer);
+	SetCookedVertexFormat(vertexArray, 0, m_Header->PositionFormat);
+	return vertexArray;
+}
@@ -0,0 +1,155 @@
+#include "CookedTexture.h"
+
+#include "Hash.h"
+
+#include <filesystem>
+#include <iostream>
+
+const char* GetCookedFormatName(CookedFormat format)
+{
+	switch (format)
+	{
+	case CookedFormat::RGBA8: return "rgba8";
+	case CookedFormat::BC1:   return "bc1";
+	case CookedFormat::BC3:   return "bc3";
+	case CookedFormat::BC7:   return "bc7";
+	}
+	return "unknown";
+}
+
+bool ParseCookedFormat(const std::string& name, CookedFormat& format)
+{
+	for (CookedFormat candidate : { CookedFormat::RGBA8, CookedFormat::BC1, CookedFormat::BC3, CookedFormat::BC7 })
+	{
+		if (name == GetCookedFormatName(candidate))
+		{
+			format = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool IsBlockCompressed(CookedFormat format)
+{
+	return format != CookedFormat::RGBA8;
+}
+
+GLenum GetGLInternalFormat(CookedFormat format)
+{
+	switch (format)
+	{
+	case CookedFormat::BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1;
+	case CookedFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5;
+	case CookedFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default:                return GL_RGBA8;
+	}
+}
+
+size_t GetCookedLevelSize(CookedFormat format, uint32_t width, uint32_t height)
+{
+	if (!IsBlockCompressed(format))
+		return static_cast<size_t>(width) * height * 4;
+
+	const size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+	return blocks * (format == CookedFormat::BC1 ? 8 : 16);
+}
+
+std::string GetCookedTexturePath(const std::string& cookedDirectory, const std::string& sourcePath)
+{
+	return (std::filesystem::path(cookedDirectory) / GetCookedFileStem(sourcePath)).string() + ".oglt";
+}
+
+bool CookedTexture::Open(const std::string& path)
+{
+	m_Header = nullptr;
+
+	if (!m_File.Open(path))
+	{
+		std::cerr << "Failed to map cooked texture: " << path << std::endl;
+		return false;
+	}
+
+	if (m_File.GetSize() < sizeof(CookedTextureHeader))
+	{
+		std::cerr << "Cooked texture is truncated: " << path << std::endl;
+		return false;
+	}
+
+	const auto* header = reinterpret_cast<const CookedTextureHeader*>(m_File.GetData());
+	if (header->Magic != CookedTextureHeader::MagicValue
+		|| header->Version != CookedTextureHeader::CurrentVersion
+		|| header->MipCount == 0
+		|| header->MipCount > CookedTextureHeader::MaxMipLevels)
+	{
+		std::cerr << "Not a valid cooked texture (or an old version): " << path << std::endl;
+		return false;
+	}
+
+	for (uint32_t level = 0; level < header->MipCount; ++level)
+	{
+		const CookedMipLevel& mip = header->Mips[level];
+		if (mip.Offset + mip.Size > m_File.GetSize()
+			|| mip.Size != GetCookedLevelSize(header->Format, mip.Width, mip.Height))
+		{
+			std::cerr << "Cooked texture has a corrupt mip table: " << path << std::endl;
+			return false;
+		}
+	}
+
+	m_Header = header;
+	return true;
+}
+
+const unsigned char* CookedTexture::GetLevelData(uint32_t level) const
+{
+	return m_File.GetData() + m_Header->Mips[level].Offset;
+}
+
+GLuint CookedTexture::CreateGLTexture() const
+{
+	if (!m_Header)
+		return 0;
+
+	const CookedTextureHeader& header = *m_Header;
+	const GLenum internalFormat = GetGLInternalFormat(header.Format);
+
+	// Direct state access: the texture is never bound, so the renderer's
+	// cached texture bindings stay valid
+	GLuint textureID = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+
+	// Set texture parameters (wrapping and filtering)
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, header.MipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(header.MipCount - 1));
+
+	glTextureStorage2D(textureID, static_cast<GLsizei>(header.MipCount), internalFormat,
+		static_cast<GLsizei>(header.Width), static_cast<GLsizei>(header.Height));
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (uint32_t level = 0; level < header.MipCount; ++level)
+	{
+		const CookedMipLevel& mip = header.Mips[level];
+		const GLsizei width = static_cast<GLsizei>(mip.Width);
+		const GLsizei height = static_cast<GLsizei>(mip.Height);
+
+		if (IsBlockCompressed(header.Format))
+		{
+			glCompressedTextureSubImage2D(textureID, static_cast<GLint>(level), 0, 0, width, height,
+				internalFormat, static_cast<GLsizei>(mip.Size), GetLevelData(level));
+		}
+		else
+		{
+			glTextureSubImage2D(textureID, static_cast<GLint>(level), 0, 0, width, height,
+				GL_RGBA, GL_UNSIGNED_BYTE, GetLevelData(level));
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return textureID;
+}
@@ -0,0 +1,322 @@
+#include "FrameCapture.h"
+
+#include "HeadlessContext.h"
+#include "ImageEncoders.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Slots start on this boundary within the buffer
+	constexpr size_t SlotAlignment = 256;
+}
+
+FrameCapture::~FrameCapture()
+{
+	if (!m_Buffer)
+		return;
+
+	Finish();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_StopEncoders = true;
+	}
+	m_JobCondition.notify_all();
+
+	for (std::thread& encoder : m_Encoders)
+	{
+		encoder.join();
+	}
+
+	glUnmapNamedBuffer(m_Buffer);
+	glDeleteBuffers(1, &m_Buffer);
+}
+
+bool FrameCapture::Initialize(int width, int height, const FrameCaptureSettings& settings)
+{
+	m_Settings = settings;
+	m_Width = width;
+	m_Height = height;
+
+	if (m_Settings.Format == CaptureFormat::Png)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_Settings.Path, error);
+		if (error)
+		{
+			std::cerr << "Failed to create capture directory " << m_Settings.Path << ": " << error.message() << std::endl;
+			return false;
+		}
+	}
+	else
+	{
+		m_Stream.open(m_Settings.Path, std::ios::binary | std::ios::trunc);
+		const std::string header = ImageEncoders::GetY4mHeader(width, height, m_Settings.FramesPerSecond);
+		m_Stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+		if (!m_Stream)
+		{
+			std::cerr << "Failed to open capture file " << m_Settings.Path << std::endl;
+			return false;
+		}
+		m_Stats.Bytes += header.size();
+	}
+
+	unsigned encoderCount = m_Settings.EncoderThreads;
+	if (encoderCount == 0)
+	{
+		const unsigned cores = std::thread::hardware_concurrency();
+		encoderCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	// Enough for the frames the GPU may still be drawing, one being read back
+	// and one per encoder, so Capture() waits only if encoding falls behind
+	uint32_t slotCount = m_Settings.ReadbackSlots;
+	if (slotCount == 0)
+		slotCount = HeadlessContext::MaxFramesInFlight + 1 + encoderCount;
+
+	m_FrameBytes = (static_cast<size_t>(width) * height * 4 + SlotAlignment - 1) / SlotAlignment * SlotAlignment;
+	const GLsizeiptr bufferSize = static_cast<GLsizeiptr>(m_FrameBytes * slotCount);
+
+	// Client storage hints the driver to keep this in system memory, where the CPU reads it fastest
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_Buffer);
+	glNamedBufferStorage(m_Buffer, bufferSize, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+	m_Mapped = static_cast<const uint8_t*>(glMapNamedBufferRange(m_Buffer, 0, bufferSize, flags));
+	if (!m_Mapped)
+	{
+		std::cerr << "Failed to map frame capture buffer" << std::endl;
+		glDeleteBuffers(1, &m_Buffer);
+		m_Buffer = 0;
+		return false;
+	}
+
+	m_Slots.resize(slotCount);
+
+	m_Encoders.reserve(encoderCount);
+	for (unsigned i = 0; i < encoderCount; ++i)
+	{
+		m_Encoders.emplace_back(&FrameCapture::EncoderMain, this);
+	}
+
+	return true;
+}
+
+void FrameCapture::Capture(GLuint framebuffer)
+{
+	OGLP_PROFILE_FUNCTION();
+
+	RetireReadbacks(false);
+
+	const uint32_t slotIndex = m_NextSlot;
+	Slot& slot = m_Slots[slotIndex];
+
+	// Slots are used round robin, so this is the oldest one; it is only still
+	// busy if the encoders are behind
+	if (slot.State == SlotState::Reading)
+	{
+		RetireReadbacks(true);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (slot.State != SlotState::Free)
+		{
+			if (m_Settings.DropWhenBusy)
+			{
+				++m_Stats.Dropped;
+				return;
+			}
+
+			const Clock::time_point start = Clock::now();
+			m_SlotCondition.wait(lock, [&] { return slot.State == SlotState::Free; });
+			++m_Stats.Stalls;
+			m_Stats.StallMs += MillisecondsSince(start);
+		}
+		slot.State = SlotState::Reading;
+		++m_Stats.Captured;
+	}
+
+	// Asynchronous: with a pack buffer bound, the "pointer" is an offset into it
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(slotIndex * m_FrameBytes));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.Frame = m_NextFrame++;
+	m_Reading.push_back(slotIndex);
+	m_NextSlot = (m_NextSlot + 1) % static_cast<uint32_t>(m_Slots.size());
+}
+
+void FrameCapture::RetireReadbacks(bool wait)
+{
+	while (!m_Reading.empty())
+	{
+		Slot& slot = m_Slots[m_Reading.front()];
+
+		// Readbacks complete in order, so the first unfinished one ends the scan
+		const GLuint64 timeout = wait ? UINT64_MAX : 0;
+		const GLenum result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+
+		glDeleteSync(slot.Fence);
+		slot.Fence = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			slot.State = SlotState::Encoding;
+			m_Jobs.push_back(m_Reading.front());
+			++m_Unwritten;
+		}
+		m_JobCondition.notify_one();
+
+		m_Reading.pop_front();
+		wait = false;
+	}
+}
+
+bool FrameCapture::Finish()
+{
+	OGLP_PROFILE_FUNCTION();
+
+	while (!m_Reading.empty())
+	{
+		RetireReadbacks(true);
+	}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_SlotCondition.wait(lock, [this] { return m_Unwritten == 0; });
+
+	if (m_Stream.is_open())
+		m_Stream.flush();
+
+	return m_Stats.Failed == 0;
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Stats;
+}
+
+void FrameCapture::EncoderMain()
+{
+	OGLP_PROFILE_THREAD("FrameEncoder");
+
+	std::vector<uint8_t> scratch;
+	for (;;)
+	{
+		uint32_t slot = 0;
+		uint64_t frame = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobCondition.wait(lock, [this] { return m_StopEncoders || !m_Jobs.empty(); });
+
+			if (m_Jobs.empty())
+				return;
+
+			slot = m_Jobs.front();
+			frame = m_Slots[slot].Frame;
+			m_Jobs.pop_front();
+		}
+
+		Encode(slot, frame, scratch);
+	}
+}
+
+bool FrameCapture::Encode(uint32_t slot, uint64_t frame, std::vector<uint8_t>& scratch)
+{
+	OGLP_PROFILE_SCOPE("EncodeFrame");
+
+	const Clock::time_point start = Clock::now();
+	const uint8_t* pixels = m_Mapped + slot * m_FrameBytes;
+	const uint32_t width = static_cast<uint32_t>(m_Width);
+	const uint32_t height = static_cast<uint32_t>(m_Height);
+	const size_t rowBytes = width * 4;
+
+	// Convert out of the slot first, so it is returned before any waiting on
+	// the disk or on other encoders
+	if (m_Settings.Format == CaptureFormat::Png)
+		ImageEncoders::EncodePng(pixels, width, height, rowBytes, true, m_Settings.Alpha, scratch);
+	else
+	{
+		scratch.resize(ImageEncoders::GetYuv420Size(width, height));
+		ImageEncoders::ConvertToYuv420(pixels, width, height, rowBytes, true, scratch.data());
+	}
+	const double encodeMs = MillisecondsSince(start);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Slots[slot].State = SlotState::Free;
+		m_Stats.EncodeMs += encodeMs;
+	}
+	m_SlotCondition.notify_all();
+
+	bool written = false;
+	if (m_Settings.Format == CaptureFormat::Png)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(frame));
+		const std::string path = (std::filesystem::path(m_Settings.Path) / name).string();
+
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+		written = static_cast<bool>(file);
+		if (!written)
+			std::cerr << "Failed to write captured frame " << path << std::endl;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (written)
+		{
+			++m_Stats.Written;
+			m_Stats.Bytes += scratch.size();
+		}
+		else
+		{
+			++m_Stats.Failed;
+		}
+		--m_Unwritten;
+	}
+	else
+	{
+		// Frames may finish out of order across encoders; each waits its turn
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_SlotCondition.wait(lock, [&] { return m_NextStreamFrame == frame; });
+
+		static const char Marker[] = "FRAME\n";
+		m_Stream.write(Marker, sizeof(Marker) - 1);
+		m_Stream.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+		written = static_cast<bool>(m_Stream);
+		if (!written)
+			std::cerr << "Failed to write frame " << frame << " to " << m_Settings.Path << std::endl;
+
+		if (written)
+		{
+			++m_Stats.Written;
+			m_Stats.Bytes += sizeof(Marker) - 1 + scratch.size();
+		}
+		else
+		{
+			++m_Stats.Failed;
+		}
+		++m_NextStreamFrame;
+		--m_Unwritten;
+	}
+
+	m_SlotCondition.notify_all();
+	return written;
+}
@@ -0,0 +1,210 @@
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+void GLStateCache::Invalidate()
+{
+	m_Program = Unknown;
+	m_VertexArray = Unknown;
+	m_ArrayBuffer = Unknown;
+	m_DrawIndirectBuffer = Unknown;
+	std::fill(&m_IndexedBuffers[0][0], &m_IndexedBuffers[0][0] + 2 * MaxBufferBindings, Unknown);
+
+	m_ActiveTexture = Unknown;
+	std::fill(&m_Textures[0][0], &m_Textures[0][0] + MaxTextureUnits * TextureTargetCount, Unknown);
+
+	m_Blend = Unknown;
+	m_BlendSource = Unknown;
+	m_BlendDestination = Unknown;
+
+	m_DepthTest = Unknown;
+	m_DepthWrite = Unknown;
+	m_DepthFunc = Unknown;
+
+	m_ViewportKnown = false;
+}
+
+void GLStateCache::BeginFrame()
+{
+	m_LastFrame = m_Frame;
+	m_Frame = Counters();
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+	if (Change(m_Program, program))
+		glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+	if (Change(m_VertexArray, vertexArray))
+		glBindVertexArray(vertexArray);
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+	GLuint* cached = nullptr;
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: cached = &m_ArrayBuffer; break;
+	case GL_DRAW_INDIRECT_BUFFER: cached = &m_DrawIndirectBuffer; break;
+	default: break;
+	}
+
+	if (!cached)
+		CountIssued();
+	else if (!Change(*cached, buffer))
+		return;
+
+	glBindBuffer(target, buffer);
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	const int targetIndex = GetIndexedTargetIndex(target);
+	if (targetIndex < 0 || index >= MaxBufferBindings)
+	{
+		CountIssued();
+		glBindBufferBase(target, index, buffer);
+		return;
+	}
+
+	if (Change(m_IndexedBuffers[targetIndex][index], buffer))
+		glBindBufferBase(target, index, buffer);
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	const int targetIndex = GetTextureTargetIndex(target);
+	if (targetIndex < 0 || unit >= MaxTextureUnits)
+		CountIssued();
+	else if (!Change(m_Textures[unit][targetIndex], texture))
+		return;
+
+	if (m_ActiveTexture != unit)
+	{
+		m_ActiveTexture = unit;
+		CountIssued();
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::ForgetTexture(GLuint texture)
+{
+	std::replace(&m_Textures[0][0], &m_Textures[0][0] + MaxTextureUnits * TextureTargetCount, texture, Unknown);
+}
+
+void GLStateCache::SetBlend(bool enabled)
+{
+	if (Change(m_Blend, enabled ? 1 : 0))
+	{
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+	}
+}
+
+void GLStateCache::SetBlendFunc(GLenum source, GLenum destination)
+{
+	if (m_BlendSource == source && m_BlendDestination == destination)
+	{
+		CountElided();
+		return;
+	}
+
+	m_BlendSource = source;
+	m_BlendDestination = destination;
+	CountIssued();
+	glBlendFunc(source, destination);
+}
+
+void GLStateCache::SetDepthTest(bool enabled)
+{
+	if (Change(m_DepthTest, enabled ? 1 : 0))
+	{
+		if (enabled)
+			glEnable(GL_DEPTH_TEST);
+		else
+			glDisable(GL_DEPTH_TEST);
+	}
+}
+
+void GLStateCache::SetDepthWrite(bool enabled)
+{
+	if (Change(m_DepthWrite, enabled ? 1 : 0))
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::SetDepthFunc(GLenum func)
+{
+	if (Change(m_DepthFunc, func))
+		glDepthFunc(func);
+}
+
+void GLStateCache::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (m_ViewportKnown && m_Viewport[0] == x && m_Viewport[1] == y && m_Viewport[2] == width && m_Viewport[3] == height)
+	{
+		CountElided();
+		return;
+	}
+
+	m_Viewport[0] = x;
+	m_Viewport[1] = y;
+	m_Viewport[2] = width;
+	m_Viewport[3] = height;
+	m_ViewportKnown = true;
+	CountIssued();
+	glViewport(x, y, width, height);
+}
+
+bool GLStateCache::Change(GLuint& cached, GLuint value)
+{
+	if (cached == value)
+	{
+		CountElided();
+		return false;
+	}
+
+	cached = value;
+	CountIssued();
+	return true;
+}
+
+void GLStateCache::CountIssued()
+{
+	++m_Frame.Issued;
+	++m_Total.Issued;
+}
+
+void GLStateCache::CountElided()
+{
+	++m_Frame.Elided;
+	++m_Total.Elided;
+}
+
+int GLStateCache::GetTextureTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_3D: return 2;
+	case GL_TEXTURE_CUBE_MAP: return 3;
+	default: return -1;
+	}
+}
+
+int GLStateCache::GetIndexedTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_UNIFORM_BUFFER: return 0;
+	case GL_SHADER_STORAGE_BUFFER: return 1;
+	default: return -1;
+	}
+}
@@ -0,0 +1,545 @@
+#include "ShaderLibrary.h"
+
+#include "Hash.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr int MaxIncludeDepth = 32;
+
+	// Header of a cached program binary file
+	struct ProgramBinaryHeader
+	{
+		static constexpr uint32_t MagicValue = 0x534C474F; // "OGLS"
+		static constexpr uint32_t CurrentVersion = 1;
+
+		uint32_t Magic = MagicValue;
+		uint32_t Version = CurrentVersion;
+		uint64_t Key = 0;
+		uint32_t Format = 0;
+		uint32_t Size = 0;
+	};
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	bool ReadTextFile(const std::string& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	std::string CanonicalPath(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		return error ? path.string() : canonical.string();
+	}
+
+	// Returns the quoted name of an #include "name" line, or an empty string
+	std::string ParseInclude(const std::string& line)
+	{
+		size_t i = line.find_first_not_of(" \t");
+		if (i == std::string::npos || line.compare(i, 8, "#include") != 0)
+			return std::string();
+
+		const size_t open = line.find('"', i + 8);
+		const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+		if (close == std::string::npos)
+			return std::string();
+
+		return line.substr(open + 1, close - open - 1);
+	}
+
+	bool IsVersionLine(const std::string& line)
+	{
+		const size_t i = line.find_first_not_of(" \t");
+		return i != std::string::npos && line.compare(i, 8, "#version") == 0;
+	}
+
+	std::string GetInfoLog(GLuint object, bool isProgram)
+	{
+		GLint length = 0;
+		if (isProgram)
+			glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+		else
+			glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+
+		std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+		if (isProgram)
+			glGetProgramInfoLog(object, length, nullptr, log.data());
+		else
+			glGetShaderInfoLog(object, length, nullptr, log.data());
+
+		log.resize(std::char_traits<char>::length(log.c_str()));
+		return log;
+	}
+
+	GLuint CompileStage(GLenum type, const char* stageName, const std::string& text, const std::vector<std::string>& files)
+	{
+		GLuint shader = glCreateShader(type);
+		const char* source = text.c_str();
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint success = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			std::cerr << "Failed to compile " << stageName << " shader " << files.front() << ":\n" << GetInfoLog(shader, false);
+
+			// Messages are prefixed with the source number set by #line
+			for (size_t i = 0; i < files.size(); ++i)
+				std::cerr << "  source " << i << ": " << files[i] << "\n";
+			std::cerr << std::flush;
+
+			glDeleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	for (Program& program : m_Programs)
+	{
+		if (program.Id) glDeleteProgram(program.Id);
+	}
+
+#ifdef __linux__
+	if (m_NotifyFd >= 0)
+		close(m_NotifyFd);
+#endif
+}
+
+bool ShaderLibrary::Initialize(const std::string& cacheDirectory)
+{
+	// A driver update changes these strings and with them every cache key
+	auto getString = [](GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+	};
+	m_DriverId = getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	m_BinaryCacheSupported = formatCount > 0 && !cacheDirectory.empty();
+
+	m_CacheDirectory = cacheDirectory;
+	if (m_BinaryCacheSupported)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_CacheDirectory, error);
+		if (error)
+		{
+			std::cerr << "Failed to create shader cache directory: " << m_CacheDirectory << std::endl;
+			m_BinaryCacheSupported = false;
+		}
+	}
+
+	return true;
+}
+
+void ShaderLibrary::AddIncludeSource(const std::string& name, const std::string& source)
+{
+	m_IncludeSources[name] = source;
+}
+
+ShaderHandle ShaderLibrary::Load(const std::string& vertexPath, const std::string& fragmentPath)
+{
+	const ShaderHandle handle = static_cast<ShaderHandle>(m_Programs.size());
+
+	Program program;
+	program.VertexPath = vertexPath;
+	program.FragmentPath = fragmentPath;
+	Build(program);
+
+	m_Programs.push_back(std::move(program));
+	++m_Stats.Programs;
+
+	if (m_NotifyFd >= 0)
+		WatchDependencies(m_Programs.back());
+
+	return handle;
+}
+
+GLuint ShaderLibrary::GetProgram(ShaderHandle handle) const
+{
+	return handle < m_Programs.size() ? m_Programs[handle].Id : 0;
+}
+
+bool ShaderLibrary::Build(Program& program)
+{
+	std::set<std::string> dependencies;
+	PreprocessedSource vertex;
+	PreprocessedSource fragment;
+	const bool preprocessed = Preprocess(program.VertexPath, vertex, dependencies)
+		&& Preprocess(program.FragmentPath, fragment, dependencies);
+
+	// Keep watching the files of a broken program so fixing them triggers a rebuild
+	program.Dependencies.insert(dependencies.begin(), dependencies.end());
+
+	if (!preprocessed)
+	{
+		++m_Stats.Failures;
+		return false;
+	}
+
+	uint64_t key = HashString(vertex.Text);
+	key = HashString(fragment.Text, key);
+	key = HashString(m_DriverId, key);
+	key = HashValue(ProgramBinaryHeader::CurrentVersion, key);
+
+	GLuint id = 0;
+	if (m_BinaryCacheSupported)
+	{
+		const Clock::time_point start = Clock::now();
+		id = LoadCachedBinary(key);
+		if (id)
+		{
+			m_Stats.CacheLoadMs += MillisecondsSince(start);
+			++m_Stats.CacheHits;
+		}
+	}
+
+	if (!id)
+	{
+		const Clock::time_point start = Clock::now();
+		id = CompileAndLink(vertex, fragment);
+		m_Stats.CompileMs += MillisecondsSince(start);
+		++m_Stats.CacheMisses;
+
+		if (id && m_BinaryCacheSupported)
+			StoreCachedBinary(key, id);
+	}
+
+	if (!id)
+	{
+		++m_Stats.Failures;
+		return false;
+	}
+
+	if (program.Id)
+		glDeleteProgram(program.Id);
+
+	program.Id = id;
+	program.Dependencies = std::move(dependencies);
+	return true;
+}
+
+bool ShaderLibrary::Preprocess(const std::string& path, PreprocessedSource& output, std::set<std::string>& dependencies)
+{
+	const std::string canonical = CanonicalPath(path);
+	dependencies.insert(canonical);
+
+	std::string text;
+	if (!ReadTextFile(path, text))
+	{
+		std::cerr << "Failed to read shader file: " << path << std::endl;
+		return false;
+	}
+
+	std::set<std::string> included = { canonical };
+	output.Files.push_back(path);
+	return AppendFile(canonical, text, output, dependencies, included, 0);
+}
+
+bool ShaderLibrary::AppendFile(const std::string& path, const std::string& text, PreprocessedSource& output,
+	std::set<std::string>& dependencies, std::set<std::string>& included, int depth)
+{
+	const int sourceNumber = static_cast<int>(output.Files.size()) - 1;
+	const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+	std::istringstream lines(text);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line))
+	{
+		++lineNumber;
+
+		if (depth == 0 && IsVersionLine(line))
+		{
+			// #version must come first, so numbering starts right after it
+			output.Text += line + "\n#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+			continue;
+		}
+
+		const std::string name = ParseInclude(line);
+		if (name.empty())
+		{
+			output.Text += line;
+			output.Text += '\n';
+			continue;
+		}
+
+		if (depth >= MaxIncludeDepth)
+		{
+			std::cerr << "Shader includes nested too deeply in " << path << std::endl;
+			return false;
+		}
+
+		// Files next to the includer win over registered sources
+		std::string includeText;
+		std::string includePath = CanonicalPath(directory / name);
+		if (ReadTextFile(includePath, includeText))
+		{
+			dependencies.insert(includePath);
+		}
+		else
+		{
+			const auto source = m_IncludeSources.find(name);
+			if (source == m_IncludeSources.end())
+			{
+				std::cerr << path << ":" << lineNumber << ": cannot find include \"" << name << "\"" << std::endl;
+				return false;
+			}
+
+			includePath = "<" + name + ">";
+			includeText = source->second;
+		}
+
+		if (included.insert(includePath).second)
+		{
+			output.Files.push_back(includePath);
+			output.Text += "#line 1 " + std::to_string(output.Files.size() - 1) + "\n";
+
+			if (!AppendFile(includePath, includeText, output, dependencies, included, depth + 1))
+				return false;
+		}
+
+		output.Text += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+	}
+
+	return true;
+}
+
+GLuint ShaderLibrary::CompileAndLink(const PreprocessedSource& vertex, const PreprocessedSource& fragment)
+{
+	GLuint vertexShader = CompileStage(GL_VERTEX_SHADER, "vertex", vertex.Text, vertex.Files);
+	GLuint fragmentShader = CompileStage(GL_FRAGMENT_SHADER, "fragment", fragment.Text, fragment.Files);
+	if (!vertexShader || !fragmentShader)
+	{
+		if (vertexShader) glDeleteShader(vertexShader);
+		if (fragmentShader) glDeleteShader(fragmentShader);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	if (m_BinaryCacheSupported)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+
+	glDetachShader(program, vertexShader);
+	glDetachShader(program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cerr << "Failed to link " << vertex.Files.front() << " + " << fragment.Files.front() << ":\n"
+			<< GetInfoLog(program, true) << std::endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+GLuint ShaderLibrary::LoadCachedBinary(uint64_t key)
+{
+	const std::string path = GetCachePath(key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return 0;
+
+	ProgramBinaryHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| header.Magic != ProgramBinaryHeader::MagicValue
+		|| header.Version != ProgramBinaryHeader::CurrentVersion
+		|| header.Key != key)
+	{
+		return 0;
+	}
+
+	std::vector<char> binary(header.Size);
+	if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size())))
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.Format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// The driver may reject binaries it wrote itself (e.g. after an update
+		// that kept its version string); drop the file and rebuild from source
+		glDeleteProgram(program);
+		file.close();
+		std::remove(path.c_str());
+		return 0;
+	}
+
+	return program;
+}
+
+void ShaderLibrary::StoreCachedBinary(uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+	ProgramBinaryHeader header;
+	header.Key = key;
+	header.Format = format;
+	header.Size = static_cast<uint32_t>(binary.size());
+
+	// Write to a temporary file first so another instance never reads a partial binary
+	const std::string path = GetCachePath(key);
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+		if (!out)
+		{
+			std::cerr << "Failed to write shader cache file: " << tempPath << std::endl;
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+}
+
+std::string ShaderLibrary::GetCachePath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.glbin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(m_CacheDirectory) / name).string();
+}
+
+bool ShaderLibrary::EnableHotReload()
+{
+#ifdef __linux__
+	if (m_NotifyFd >= 0)
+		return true;
+
+	m_NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_NotifyFd < 0)
+	{
+		std::cerr << "Failed to initialize inotify; shader hot reload is disabled" << std::endl;
+		return false;
+	}
+
+	for (const Program& program : m_Programs)
+		WatchDependencies(program);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ShaderLibrary::WatchDependencies(const Program& program)
+{
+#ifdef __linux__
+	for (const std::string& dependency : program.Dependencies)
+	{
+		// Watching the directory also catches editors that save by renaming a new file over the old one.
+		// Adding an already watched directory returns its existing descriptor.
+		const std::string directory = std::filesystem::path(dependency).parent_path().string();
+		const int watch = inotify_add_watch(m_NotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch >= 0)
+			m_WatchedDirectories[watch] = directory;
+	}
+#else
+	(void)program;
+#endif
+}
+
+void ShaderLibrary::Update()
+{
+	OGLP_PROFILE_SCOPE("ShaderLibrary::Update");
+
+#ifdef __linux__
+	if (m_NotifyFd < 0)
+		return;
+
+	std::set<std::string> changed;
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		const ssize_t length = read(m_NotifyFd, buffer, sizeof(buffer));
+		if (length <= 0)
+			break;
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			const auto directory = m_WatchedDirectories.find(event->wd);
+			if (event->len > 0 && directory != m_WatchedDirectories.end())
+				changed.insert((std::filesystem::path(directory->second) / event->name).string());
+
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+		}
+	}
+
+	if (changed.empty())
+		return;
+
+	for (Program& program : m_Programs)
+	{
+		bool affected = false;
+		for (const std::string& path : changed)
+			affected = affected || program.Dependencies.count(path) > 0;
+
+		if (!affected)
+			continue;
+
+		++m_Stats.Reloads;
+		if (Build(program))
+			std::cout << "Reloaded shader " << program.VertexPath << " + " << program.FragmentPath << std::endl;
+		else
+			std::cerr << "Keeping previous version of " << program.VertexPath << " + " << program.FragmentPath << std::endl;
+
+		// Picks up files newly pulled in by #include
+		WatchDependencies(program);
+	}
+#endif
+}
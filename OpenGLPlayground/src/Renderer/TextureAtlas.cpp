@@ -0,0 +1,293 @@
+#include "TextureAtlas.h"
+
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureAtlas::~TextureAtlas()
+{
+	if (m_Texture) glDeleteTextures(1, &m_Texture);
+	if (m_Scratch) glDeleteTextures(1, &m_Scratch);
+}
+
+bool TextureAtlas::Initialize(GLStateCache& state, uint32_t layerSize, uint32_t maxLayers, uint32_t padding, GLenum internalFormat,
+	uint32_t maxImages)
+{
+	if (layerSize == 0 || maxLayers == 0 || maxImages == 0 || padding * 2 >= layerSize)
+	{
+		std::cerr << "Invalid texture atlas size" << std::endl;
+		return false;
+	}
+
+	m_State = &state;
+	m_LayerSize = layerSize;
+	m_MaxLayers = maxLayers;
+	m_Padding = padding;
+	m_InternalFormat = internalFormat;
+	m_Images.Reset(maxImages);
+
+	m_Texture = CreateArrayTexture(1);
+	m_Layers.resize(1);
+	m_Layers[0].Packer.Reset(layerSize, layerSize);
+
+	// Direct state access throughout: nothing is bound, so the renderer's
+	// cached texture bindings stay valid
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_Scratch);
+	glTextureStorage2D(m_Scratch, 1, internalFormat, static_cast<GLsizei>(layerSize), static_cast<GLsizei>(layerSize));
+
+	return m_Texture != 0 && m_Scratch != 0;
+}
+
+AtlasHandle TextureAtlas::Add(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	if (!m_Texture || width == 0 || height == 0)
+		return InvalidAtlasHandle;
+
+	const uint32_t paddedWidth = width + m_Padding * 2;
+	const uint32_t paddedHeight = height + m_Padding * 2;
+	if (paddedWidth > m_LayerSize || paddedHeight > m_LayerSize)
+	{
+		std::cerr << "Image of " << width << "x" << height << " does not fit in a texture atlas layer of "
+			<< m_LayerSize << "x" << m_LayerSize << std::endl;
+		return InvalidAtlasHandle;
+	}
+
+	if (m_Images.GetCount() == m_Images.GetCapacity())
+	{
+		std::cerr << "Texture atlas is full (" << m_Images.GetCapacity() << " images)" << std::endl;
+		return InvalidAtlasHandle;
+	}
+
+	uint32_t layer = 0, x = 0, y = 0;
+	if (!Allocate(paddedWidth, paddedHeight, layer, x, y))
+	{
+		std::cerr << "Texture atlas is full (" << m_Layers.size() << " layers)" << std::endl;
+		return InvalidAtlasHandle;
+	}
+
+	// Repeat the edge texels into the border
+	m_PaddedPixels.resize(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+	for (uint32_t row = 0; row < paddedHeight; ++row)
+	{
+		const uint32_t sourceRow = std::min(height - 1, row > m_Padding ? row - m_Padding : 0);
+		const uint8_t* source = pixels + static_cast<size_t>(sourceRow) * width * 4;
+		uint8_t* destination = m_PaddedPixels.data() + static_cast<size_t>(row) * paddedWidth * 4;
+
+		for (uint32_t column = 0; column < m_Padding; ++column)
+		{
+			std::memcpy(destination + column * 4, source, 4);
+			std::memcpy(destination + (m_Padding + width + column) * 4, source + (width - 1) * 4, 4);
+		}
+		std::memcpy(destination + m_Padding * 4, source, static_cast<size_t>(width) * 4);
+	}
+
+	glTextureSubImage3D(m_Texture, 0, static_cast<GLint>(x), static_cast<GLint>(y), static_cast<GLint>(layer),
+		static_cast<GLsizei>(paddedWidth), static_cast<GLsizei>(paddedHeight), 1, GL_RGBA, GL_UNSIGNED_BYTE, m_PaddedPixels.data());
+
+	const AtlasHandle handle = m_Images.Allocate();
+	Image& image = m_Images[handle];
+	image.Layer = layer;
+	image.X = x;
+	image.Y = y;
+	image.Width = width;
+	image.Height = height;
+	return handle;
+}
+
+void TextureAtlas::Remove(AtlasHandle handle)
+{
+	if (!IsValid(handle))
+		return;
+
+	const Image& image = m_Images[handle];
+	m_Images.Free(handle);
+
+	Layer& layer = m_Layers[image.Layer];
+	layer.WastedArea += static_cast<uint64_t>(image.Width + m_Padding * 2) * (image.Height + m_Padding * 2);
+
+	// Nothing left to move: the layer is simply empty again
+	if (layer.WastedArea == layer.Packer.GetUsedArea())
+	{
+		layer.Packer.Reset(m_LayerSize, m_LayerSize);
+		layer.WastedArea = 0;
+	}
+}
+
+AtlasRegion TextureAtlas::GetRegion(AtlasHandle handle) const
+{
+	AtlasRegion region;
+	if (!IsValid(handle))
+		return region;
+
+	const Image& image = m_Images[handle];
+	const float scale = 1.0f / static_cast<float>(m_LayerSize);
+	region.Layer = image.Layer;
+	region.UVRect = glm::vec4(static_cast<float>(image.X + m_Padding), static_cast<float>(image.Y + m_Padding),
+		static_cast<float>(image.Width), static_cast<float>(image.Height)) * scale;
+	return region;
+}
+
+uint32_t TextureAtlas::Defragment(float minWastedFraction)
+{
+	uint32_t moved = 0;
+	for (uint32_t layer = 0; layer < m_Layers.size(); ++layer)
+	{
+		const Layer& current = m_Layers[layer];
+		if (current.WastedArea > 0
+			&& static_cast<double>(current.WastedArea) >= minWastedFraction * static_cast<double>(current.Packer.GetUsedArea()))
+		{
+			moved += RepackLayer(layer);
+		}
+	}
+	return moved;
+}
+
+TextureAtlas::Stats TextureAtlas::GetStats() const
+{
+	Stats stats;
+	stats.Layers = static_cast<uint32_t>(m_Layers.size());
+	stats.Images = m_Images.GetCount();
+	for (const Layer& layer : m_Layers)
+	{
+		stats.LiveTexels += layer.Packer.GetUsedArea() - layer.WastedArea;
+		stats.WastedTexels += layer.WastedArea;
+	}
+	stats.Defragmentations = m_Defragmentations;
+	stats.MovedImages = m_MovedImages;
+	stats.Reallocations = m_Reallocations;
+	return stats;
+}
+
+bool TextureAtlas::Allocate(uint32_t paddedWidth, uint32_t paddedHeight, uint32_t& layer, uint32_t& x, uint32_t& y)
+{
+	if (TryLayers(paddedWidth, paddedHeight, layer, x, y))
+		return true;
+
+	// Reclaim holes in the layer with the most of them, if that could be enough
+	const uint64_t area = static_cast<uint64_t>(paddedWidth) * paddedHeight;
+	uint32_t wasteful = 0;
+	for (uint32_t i = 1; i < m_Layers.size(); ++i)
+	{
+		if (m_Layers[i].WastedArea > m_Layers[wasteful].WastedArea)
+			wasteful = i;
+	}
+
+	if (m_Layers[wasteful].WastedArea >= area)
+	{
+		RepackLayer(wasteful);
+		layer = wasteful;
+		if (m_Layers[wasteful].WastedArea == 0 && m_Layers[wasteful].Packer.Insert(paddedWidth, paddedHeight, x, y))
+			return true;
+	}
+
+	while (GrowLayers())
+	{
+		if (TryLayers(paddedWidth, paddedHeight, layer, x, y))
+			return true;
+	}
+	return false;
+}
+
+bool TextureAtlas::TryLayers(uint32_t paddedWidth, uint32_t paddedHeight, uint32_t& layer, uint32_t& x, uint32_t& y)
+{
+	for (layer = 0; layer < m_Layers.size(); ++layer)
+	{
+		if (m_Layers[layer].Packer.Insert(paddedWidth, paddedHeight, x, y))
+			return true;
+	}
+	return false;
+}
+
+bool TextureAtlas::GrowLayers()
+{
+	const uint32_t oldCount = static_cast<uint32_t>(m_Layers.size());
+	const uint32_t newCount = std::min(m_MaxLayers, oldCount * 2);
+	if (newCount <= oldCount)
+		return false;
+
+	// Immutable storage cannot grow: allocate a larger array and copy the old layers over on the GPU
+	const GLuint texture = CreateArrayTexture(newCount);
+	glCopyImageSubData(m_Texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+		static_cast<GLsizei>(m_LayerSize), static_cast<GLsizei>(m_LayerSize), static_cast<GLsizei>(oldCount));
+	m_State->ForgetTexture(m_Texture);
+	glDeleteTextures(1, &m_Texture);
+	m_Texture = texture;
+
+	m_Layers.resize(newCount);
+	for (uint32_t layer = oldCount; layer < newCount; ++layer)
+		m_Layers[layer].Packer.Reset(m_LayerSize, m_LayerSize);
+
+	++m_Reallocations;
+	return true;
+}
+
+uint32_t TextureAtlas::RepackLayer(uint32_t layer)
+{
+	std::vector<AtlasHandle> images;
+	for (AtlasHandle handle = 0; handle < m_Images.GetHighWater(); ++handle)
+	{
+		if (m_Images.IsAllocated(handle) && m_Images[handle].Layer == layer)
+			images.push_back(handle);
+	}
+
+	// Tallest first packs a skyline tightest
+	std::sort(images.begin(), images.end(), [this](AtlasHandle a, AtlasHandle b)
+	{
+		const Image& imageA = m_Images[a];
+		const Image& imageB = m_Images[b];
+		return imageA.Height != imageB.Height ? imageA.Height > imageB.Height : imageA.Width > imageB.Width;
+	});
+
+	SkylinePacker packer(m_LayerSize, m_LayerSize);
+	std::vector<glm::uvec2> positions(images.size());
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		const Image& image = m_Images[images[i]];
+		if (!packer.Insert(image.Width + m_Padding * 2, image.Height + m_Padding * 2, positions[i].x, positions[i].y))
+			return 0;	// Rare: the new order packs worse than the old one did, so keep the old layout
+	}
+
+	// Old and new rectangles can overlap, so go through the scratch texture
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		const Image& image = m_Images[images[i]];
+		glCopyImageSubData(m_Texture, GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(image.X), static_cast<GLint>(image.Y), static_cast<GLint>(layer),
+			m_Scratch, GL_TEXTURE_2D, 0, static_cast<GLint>(positions[i].x), static_cast<GLint>(positions[i].y), 0,
+			static_cast<GLsizei>(image.Width + m_Padding * 2), static_cast<GLsizei>(image.Height + m_Padding * 2), 1);
+	}
+
+	uint32_t moved = 0;
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		Image& image = m_Images[images[i]];
+		glCopyImageSubData(m_Scratch, GL_TEXTURE_2D, 0, static_cast<GLint>(positions[i].x), static_cast<GLint>(positions[i].y), 0,
+			m_Texture, GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(positions[i].x), static_cast<GLint>(positions[i].y), static_cast<GLint>(layer),
+			static_cast<GLsizei>(image.Width + m_Padding * 2), static_cast<GLsizei>(image.Height + m_Padding * 2), 1);
+
+		if (image.X != positions[i].x || image.Y != positions[i].y)
+			++moved;
+		image.X = positions[i].x;
+		image.Y = positions[i].y;
+	}
+
+	m_Layers[layer].Packer = packer;
+	m_Layers[layer].WastedArea = 0;
+	++m_Defragmentations;
+	m_MovedImages += moved;
+	return moved;
+}
+
+GLuint TextureAtlas::CreateArrayTexture(uint32_t layerCount) const
+{
+	GLuint texture = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+	glTextureStorage3D(texture, 1, m_InternalFormat, static_cast<GLsizei>(m_LayerSize), static_cast<GLsizei>(m_LayerSize),
+		static_cast<GLsizei>(layerCount));
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
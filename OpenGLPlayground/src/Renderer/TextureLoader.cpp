@@ -0,0 +1,488 @@
+#include "TextureLoader.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace
+{
+	constexpr size_t StagingAlignment = 256;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	int MipLevelCount(int width, int height)
+	{
+		int levels = 1;
+		int size = std::max(width, height);
+		while (size > 1)
+		{
+			size /= 2;
+			++levels;
+		}
+		return levels;
+	}
+
+	unsigned GetDefaultWorkerCount(unsigned requested)
+	{
+		if (requested > 0)
+			return requested;
+
+		const unsigned cores = std::thread::hardware_concurrency();
+		return cores > 1 ? cores - 1 : 1;
+	}
+
+	// Workers hand over 1, 2 or 4 channels; 3-channel images are expanded to RGBA
+	void GetFormats(int channels, bool srgb, GLenum& internalFormat, GLenum& format)
+	{
+		switch (channels)
+		{
+		case 1:  internalFormat = GL_R8;  format = GL_RED; break;
+		case 2:  internalFormat = GL_RG8; format = GL_RG;  break;
+		default: internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8; format = GL_RGBA; break;
+		}
+	}
+}
+
+TextureLoader::TextureLoader(unsigned workerCount)
+	: m_OwnedJobs(std::make_unique<JobSystem>(GetDefaultWorkerCount(workerCount) + 1, "TextureLoader")),
+	m_Jobs(*m_OwnedJobs),
+	m_MaxDecodeChains(std::max(m_Jobs.GetWorkerCount(), 1u))
+{
+}
+
+TextureLoader::TextureLoader(JobSystem& jobs)
+	: m_Jobs(jobs),
+	m_MaxDecodeChains(std::max(m_Jobs.GetWorkerCount(), 1u))
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+	// Decode jobs still queued return without decoding
+	{
+		std::lock_guard<std::mutex> lock(m_RequestMutex);
+		m_StopDecoding = true;
+	}
+	m_Jobs.Wait(m_DecodeJobs);
+
+	for (StagingRegion& region : m_StagingInFlight)
+	{
+		glDeleteSync(region.Fence);
+	}
+
+	for (GLuint texture : m_Textures)
+	{
+		if (texture) glDeleteTextures(1, &texture);
+	}
+
+	if (m_StagingBuffer)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &m_StagingBuffer);
+	}
+
+	if (m_Placeholder) glDeleteTextures(1, &m_Placeholder);
+}
+
+bool TextureLoader::Initialize(size_t stagingBytes)
+{
+	m_Placeholder = CreatePlaceholderTexture();
+
+	// Persistent + coherent mapping: workers' results are memcpy'd straight
+	// into GPU-visible memory without map/unmap calls per upload.
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	m_StagingSize = stagingBytes;
+	glGenBuffers(1, &m_StagingBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(m_StagingSize), nullptr, flags);
+	m_StagingPtr = static_cast<unsigned char*>(
+		glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(m_StagingSize), flags));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!m_StagingPtr)
+	{
+		std::cerr << "Failed to map texture staging buffer" << std::endl;
+		return false;
+	}
+
+	return m_Placeholder != 0;
+}
+
+TextureHandle TextureLoader::Load(const std::string& path, const TextureLoadOptions& options)
+{
+	TextureHandle handle = InvalidTextureHandle;
+	bool startChain = false;
+	{
+		std::lock_guard<std::mutex> lock(m_RequestMutex);
+		handle = m_NextHandle++;
+		m_Requests.push_back({ handle, path, options });
+
+		// Otherwise a running job picks the request up when it finishes its own
+		if (m_DecodeChains < m_MaxDecodeChains)
+		{
+			++m_DecodeChains;
+			startChain = true;
+		}
+	}
+
+	if (startChain)
+		m_Jobs.Run([this] { DecodeNext(); }, &m_DecodeJobs, JobPriority::Background);
+
+	++m_Requested;
+	return handle;
+}
+
+void TextureLoader::DecodeNext()
+{
+	OGLP_PROFILE_SCOPE("DecodeTexture");
+
+	DecodeRequest request;
+	{
+		std::lock_guard<std::mutex> lock(m_RequestMutex);
+		if (m_StopDecoding || m_Requests.empty())
+		{
+			--m_DecodeChains;
+			return;
+		}
+
+		request = std::move(m_Requests.front());
+		m_Requests.pop_front();
+	}
+
+	// Per-thread setting, so it does not race with other stb_image users
+	stbi_set_unpremultiply_on_load_thread(1);
+
+	DecodedImage image;
+	image.Handle = request.Handle;
+
+	if (Decode(request, image))
+	{
+		++m_DecodedCount;
+
+		std::lock_guard<std::mutex> lock(m_DecodedMutex);
+		m_Decoded.push_back(std::move(image));
+	}
+	else
+	{
+		++m_Failed;
+	}
+
+	// One job per image rather than a loop, so frame work queued meanwhile
+	// gets the worker first. Queued from the worker, into its own job ring.
+	m_Jobs.Run([this] { DecodeNext(); }, &m_DecodeJobs, JobPriority::Background);
+}
+
+bool TextureLoader::Decode(const DecodeRequest& request, DecodedImage& image)
+{
+	if (!m_CookedDirectory.empty())
+	{
+		const std::string cookedPath = GetCookedTexturePath(m_CookedDirectory, request.Path);
+		if (std::filesystem::exists(cookedPath))
+		{
+			auto cooked = std::make_unique<CookedTexture>();
+			if (cooked->Open(cookedPath))
+			{
+				m_DecodedBytes += cooked->GetFileSize();
+				++m_CookedCount;
+				image.Cooked = std::move(cooked);
+				return true;
+			}
+			// An unreadable cooked file falls back to the source image
+		}
+	}
+
+	int channels = 0;
+	unsigned char* pixels = stbi_load(request.Path.c_str(), &image.Width, &image.Height, &channels, 0);
+	if (!pixels)
+	{
+		std::cerr << "Failed to load texture image: " << request.Path
+			<< " (" << stbi_failure_reason() << ")" << std::endl;
+		return false;
+	}
+
+	const TextureLoadOptions& options = request.Options;
+	const uint32_t width = static_cast<uint32_t>(image.Width);
+	const uint32_t height = static_cast<uint32_t>(image.Height);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	m_DecodedBytes += pixelCount * channels;
+
+	if (channels < 3)
+	{
+		// Luminance(+alpha) keeps its channel count and GPU-generated mips
+		image.Channels = channels;
+		image.Pixels.assign(pixels, pixels + pixelCount * channels);
+		stbi_image_free(pixels);
+
+		if (options.FlipVertically)
+			ImageOps::FlipVertically(image.Pixels.data(), static_cast<size_t>(width) * channels, height);
+		return true;
+	}
+
+	// Reserve room for the whole chain up front so levels are built in place
+	uint32_t levelCount = 1;
+	const size_t chainSize = options.GenerateMips ? ImageOps::GetMipChainSize(width, height, &levelCount) : pixelCount * 4;
+
+	image.Channels = 4;
+	image.LevelCount = levelCount;
+	image.SRGB = options.SRGB;
+	image.Pixels.resize(chainSize);
+
+	if (channels == 3)
+		ImageOps::ExpandRGBToRGBA(pixels, image.Pixels.data(), pixelCount);
+	else
+		std::memcpy(image.Pixels.data(), pixels, pixelCount * 4);
+	stbi_image_free(pixels);
+
+	if (options.FlipVertically)
+		ImageOps::FlipVertically(image.Pixels.data(), static_cast<size_t>(width) * 4, height);
+
+	if (options.PremultiplyAlpha)
+		ImageOps::PremultiplyAlpha(image.Pixels.data(), pixelCount);
+
+	if (levelCount > 1)
+		ImageOps::GenerateMipChain(image.Pixels.data(), width, height, options.Filter, options.SRGB);
+
+	return true;
+}
+
+void TextureLoader::Update(size_t uploadBudgetBytes)
+{
+	OGLP_PROFILE_SCOPE("TextureLoader::Update");
+
+	RetireStaging();
+
+	size_t uploadedBytes = 0;
+	while (uploadedBytes < uploadBudgetBytes)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(m_DecodedMutex);
+			if (m_Decoded.empty())
+				break;
+
+			image = std::move(m_Decoded.front());
+			m_Decoded.pop_front();
+		}
+
+		Upload(image);
+
+		if (image.Cooked)
+		{
+			uploadedBytes += image.Cooked->GetFileSize();
+		}
+		else
+		{
+			uploadedBytes += image.Pixels.size();
+		}
+	}
+}
+
+void TextureLoader::Upload(const DecodedImage& image)
+{
+	OGLP_PROFILE_SCOPE("UploadTexture");
+	OGLP_PROFILE_GPU_SCOPE("UploadTexture");
+
+	if (image.Cooked)
+	{
+		// Mip chain is prebuilt and already in GPU format; upload from the mapping
+		Publish(image.Handle, image.Cooked->CreateGLTexture());
+		return;
+	}
+
+	GLenum internalFormat = GL_RGBA8;
+	GLenum format = GL_RGBA;
+	GetFormats(image.Channels, image.SRGB, internalFormat, format);
+
+	const size_t size = image.Pixels.size();
+
+	// Direct state access: the texture is never bound, so the renderer's
+	// cached texture bindings stay valid
+	GLuint textureID = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+
+	// Set texture parameters (wrapping and filtering)
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTextureStorage2D(textureID, MipLevelCount(image.Width, image.Height), internalFormat, image.Width, image.Height);
+
+	// Rows are tightly packed, which matters for 1-channel images
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Larger than the whole ring, or the ring is still busy: upload from client memory
+	size_t offset = 0;
+	const bool staged = AllocateStaging(size, offset);
+	if (staged)
+	{
+		std::memcpy(m_StagingPtr + offset, image.Pixels.data(), size);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+	}
+
+	// Levels are stored back to back, each tightly packed
+	size_t levelOffset = 0;
+	int levelWidth = image.Width;
+	int levelHeight = image.Height;
+	for (uint32_t level = 0; level < image.LevelCount; ++level)
+	{
+		const void* source = staged
+			? reinterpret_cast<const void*>(offset + levelOffset)
+			: static_cast<const void*>(image.Pixels.data() + levelOffset);
+		glTextureSubImage2D(textureID, static_cast<GLint>(level), 0, 0, levelWidth, levelHeight, format, GL_UNSIGNED_BYTE, source);
+
+		levelOffset += static_cast<size_t>(levelWidth) * levelHeight * image.Channels;
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+	}
+
+	if (staged)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		m_StagingInFlight.back().Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (image.LevelCount == 1)
+		glGenerateTextureMipmap(textureID);
+
+	Publish(image.Handle, textureID);
+}
+
+void TextureLoader::Publish(TextureHandle handle, GLuint texture)
+{
+	if (handle >= m_Textures.size())
+		m_Textures.resize(handle + 1, 0);
+
+	m_Textures[handle] = texture;
+	++m_Uploaded;
+}
+
+bool TextureLoader::AllocateStaging(size_t size, size_t& offset)
+{
+	size = AlignUp(size, StagingAlignment);
+	if (!m_StagingPtr || size > m_StagingSize)
+		return false;
+
+	if (m_StagingInFlight.empty())
+	{
+		// Nothing in flight, so the whole ring is free
+		offset = 0;
+	}
+	else
+	{
+		const size_t tail = m_StagingInFlight.front().Begin;
+		if (m_StagingHead >= tail)
+		{
+			// Free space is [head, end) and [0, tail)
+			if (m_StagingSize - m_StagingHead >= size)
+				offset = m_StagingHead;
+			else if (tail > size)
+				offset = 0;
+			else
+				return false;
+		}
+		else
+		{
+			// Free space is [head, tail); keep head from catching up with tail
+			if (tail - m_StagingHead > size)
+				offset = m_StagingHead;
+			else
+				return false;
+		}
+	}
+
+	m_StagingHead = offset + size;
+	m_StagingInFlight.push_back({ offset, offset + size, nullptr });
+	return true;
+}
+
+void TextureLoader::RetireStaging()
+{
+	while (!m_StagingInFlight.empty())
+	{
+		StagingRegion& region = m_StagingInFlight.front();
+		if (glClientWaitSync(region.Fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			break;
+
+		glDeleteSync(region.Fence);
+		m_StagingInFlight.pop_front();
+	}
+}
+
+GLuint TextureLoader::GetTexture(TextureHandle handle) const
+{
+	if (handle < m_Textures.size() && m_Textures[handle] != 0)
+		return m_Textures[handle];
+
+	return m_Placeholder;
+}
+
+bool TextureLoader::IsReady(TextureHandle handle) const
+{
+	return handle < m_Textures.size() && m_Textures[handle] != 0;
+}
+
+uint32_t TextureLoader::GetPendingCount() const
+{
+	return m_Requested - m_Uploaded - m_Failed;
+}
+
+TextureLoader::Stats TextureLoader::GetStats() const
+{
+	Stats stats;
+	stats.Requested = m_Requested;
+	stats.Decoded = m_DecodedCount;
+	stats.Uploaded = m_Uploaded;
+	stats.Failed = m_Failed;
+	stats.Cooked = m_CookedCount;
+	stats.DecodedBytes = m_DecodedBytes;
+	return stats;
+}
+
+GLuint TextureLoader::CreatePlaceholderTexture()
+{
+	// Small grey checkerboard, shown while the real texture is on its way
+	constexpr int size = 64;
+	std::vector<unsigned char> pixels(size * size * 4);
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			unsigned char value = ((x / 8) + (y / 8)) % 2 ? 200 : 120;
+			unsigned char* pixel = &pixels[(y * size + x) * 4];
+			pixel[0] = value;
+			pixel[1] = value;
+			pixel[2] = value;
+			pixel[3] = 255;
+		}
+	}
+
+	GLuint textureID = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTextureStorage2D(textureID, MipLevelCount(size, size), GL_RGBA8, size, size);
+	glTextureSubImage2D(textureID, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glGenerateTextureMipmap(textureID);
+
+	return textureID;
+}
@@ -0,0 +1,102 @@
+#include "UniformBuffers.h"
+
+#include "Camera.h"
+#include "GLStateCache.h"
+
+// Binding numbers must match UniformBinding
+const char* const UniformBlockSource = R"(
+layout(std140, binding = 0) uniform FrameBlock
+{
+	float uTime;
+	float uDeltaTime;
+};
+
+layout(std140, binding = 1) uniform CameraBlock
+{
+	mat4 uView;
+	mat4 uProjection;
+	mat4 uViewProjection;
+	vec4 uCameraPosition;
+};
+)";
+
+UniformBuffers::~UniformBuffers()
+{
+	if (m_FrameBuffer) glDeleteBuffers(1, &m_FrameBuffer);
+	for (CameraSlot& slot : m_Cameras)
+	{
+		if (slot.Buffer) glDeleteBuffers(1, &slot.Buffer);
+	}
+}
+
+bool UniformBuffers::Initialize(GLStateCache& state)
+{
+	m_State = &state;
+
+	// Direct state access throughout: uploads never disturb the generic binding
+	glCreateBuffers(1, &m_FrameBuffer);
+	glNamedBufferStorage(m_FrameBuffer, sizeof(FrameBlock), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	bool created = m_FrameBuffer != 0;
+	for (CameraSlot& slot : m_Cameras)
+	{
+		glCreateBuffers(1, &slot.Buffer);
+		glNamedBufferStorage(slot.Buffer, sizeof(CameraBlock), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		created = created && slot.Buffer != 0;
+	}
+
+	Bind();
+	return created;
+}
+
+void UniformBuffers::SetFrame(float time, float deltaTime)
+{
+	FrameBlock block;
+	block.Time = time;
+	block.DeltaTime = deltaTime;
+
+	glNamedBufferSubData(m_FrameBuffer, 0, sizeof(block), &block);
+
+	++m_Stats.FrameUploads;
+}
+
+void UniformBuffers::SetCamera(Camera& camera)
+{
+	camera.Update();
+
+	// The camera's own slot, else a free one; with every slot taken the last is shared
+	uint32_t index = 0;
+	while (index < MaxCameras - 1 && m_Cameras[index].Owner && m_Cameras[index].Owner != &camera)
+	{
+		++index;
+	}
+
+	CameraSlot& slot = m_Cameras[index];
+	if (slot.Owner == &camera && slot.Version == camera.GetVersion())
+	{
+		++m_Stats.CameraUploadsSkipped;
+	}
+	else
+	{
+		CameraBlock block;
+		block.View = camera.GetView();
+		block.Projection = camera.GetProjection();
+		block.ViewProjection = camera.GetViewProjection();
+		block.Position = glm::vec4(camera.GetPosition(), 1.0f);
+
+		glNamedBufferSubData(slot.Buffer, 0, sizeof(block), &block);
+
+		slot.Owner = &camera;
+		slot.Version = camera.GetVersion();
+		++m_Stats.CameraUploads;
+	}
+
+	m_BoundCamera = index;
+	m_State->BindBufferBase(GL_UNIFORM_BUFFER, UniformBinding::Camera, slot.Buffer);
+}
+
+void UniformBuffers::Bind()
+{
+	m_State->BindBufferBase(GL_UNIFORM_BUFFER, UniformBinding::Frame, m_FrameBuffer);
+	m_State->BindBufferBase(GL_UNIFORM_BUFFER, UniformBinding::Camera, m_Cameras[m_BoundCamera].Buffer);
+}
@@ -0,0 +1,706 @@
+#include "VirtualTexture.h"
+
+#include "GLStateCache.h"
+#include "Hash.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Fixed part of the page table buffer, laid out as the std430 block in ShaderSource
+	struct PageTableParameters
+	{
+		uint32_t Info[4];		// Tile size, border, page size, level count
+		float Cache[4];			// 1 / cache width, 1 / cache height in texels
+		uint32_t Levels[VirtualTextureHeader::MaxLevels][4];	// Width, height, tiles across, first entry
+	};
+	static_assert(sizeof(PageTableParameters) == 288, "Must match the page table block in the shader");
+
+	// Pages are addressed with 8 bits per axis in page table entries
+	constexpr uint32_t MaxPagesPerAxis = 256;
+
+	// Free pages needed beyond the pinned level for streaming to make progress
+	constexpr uint32_t MinStreamingPages = 4;
+
+	// Reads that finish this many frames after their tile was last requested
+	// are dropped rather than evicting something the view still uses
+	constexpr uint32_t StaleFrames = 8;
+
+	// Feedback grid resolution per axis, at most
+	constexpr uint32_t MaxFeedbackCells = 128;
+
+	uint32_t EncodeEntry(uint32_t pageX, uint32_t pageY, uint32_t level)
+	{
+		return pageX | pageY << 8 | level << 16;
+	}
+}
+
+const char* const VirtualTexture::ShaderSource = R"(
+layout(std430, binding = 0) readonly buffer VirtualPageTable
+{
+	uvec4 vtInfo;			// Tile size, border, page size, level count
+	vec4 vtCache;			// 1 / cache width, 1 / cache height in texels
+	uvec4 vtLevels[16];		// Width, height, tiles across, first entry
+	uint vtEntries[];		// Page x | page y << 8 | level << 16
+};
+
+vec4 SampleVirtualTexture(sampler2D cache, vec2 uv)
+{
+	uv = clamp(uv, 0.0, 1.0);
+
+	// Texels of the largest level per pixel, as VirtualTexture::RequestQuad estimates it
+	vec2 texel = uv * vec2(vtLevels[0].xy);
+	float rho = max(length(dFdx(texel)), length(dFdy(texel)));
+	uint level = uint(clamp(floor(log2(max(rho, 1.0))), 0.0, float(vtInfo.w - 1u)));
+
+	uvec4 info = vtLevels[level];
+	uvec2 tile = min(uvec2(uv * vec2(info.xy)), info.xy - 1u) / vtInfo.x;
+	uint entry = vtEntries[info.w + tile.y * info.z + tile.x];
+
+	// The entry may be an ancestor of the tile when the tile is not resident.
+	// Odd sizes drop their last texel each level, hence the clamp.
+	uint pageLevel = (entry >> 16) & 0xFFu;
+	uvec2 pageTile = min(tile >> (pageLevel - level), (vtLevels[pageLevel].xy - 1u) / vtInfo.x);
+	vec2 inTile = uv * vec2(vtLevels[pageLevel].xy) - vec2(pageTile * vtInfo.x);
+	inTile = clamp(inTile, vec2(0.5 - float(vtInfo.y)), vec2(float(vtInfo.x + vtInfo.y) - 0.5));
+
+	vec2 page = vec2(entry & 0xFFu, (entry >> 8) & 0xFFu);
+	vec2 cacheTexel = page * float(vtInfo.z) + float(vtInfo.y) + inTile;
+	return textureLod(cache, cacheTexel * vtCache.xy, 0.0);
+}
+)";
+
+bool ReadVirtualTextureHeader(std::istream& file, VirtualTextureHeader& header)
+{
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	if (header.Magic != VirtualTextureHeader::MagicValue
+		|| header.Version != VirtualTextureHeader::CurrentVersion
+		|| header.LevelCount == 0 || header.LevelCount > VirtualTextureHeader::MaxLevels
+		|| header.PageSize != header.TileSize + 2 * header.Border
+		|| header.PageBytes != GetCookedLevelSize(header.Format, header.PageSize, header.PageSize))
+	{
+		return false;
+	}
+
+	const VirtualTextureLevel& last = header.Levels[header.LevelCount - 1];
+	return last.FirstTile + last.TilesX * last.TilesY == header.TileCount;
+}
+
+std::string GetVirtualTexturePath(const std::string& directory, const std::string& sourcePath)
+{
+	return (std::filesystem::path(directory) / GetCookedFileStem(sourcePath)).string() + ".oglv";
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_ReadMutex);
+		m_StopLoaders = true;
+	}
+	m_ReadCondition.notify_all();
+
+	for (std::thread& loader : m_Loaders)
+	{
+		loader.join();
+	}
+
+	for (GLsync fence : m_SlotFences)
+	{
+		if (fence) glDeleteSync(fence);
+	}
+
+	if (m_StagingBuffer)
+	{
+		glUnmapNamedBuffer(m_StagingBuffer);
+		glDeleteBuffers(1, &m_StagingBuffer);
+	}
+
+	if (m_PageTable) glDeleteBuffers(1, &m_PageTable);
+	if (m_Cache) glDeleteTextures(1, &m_Cache);
+}
+
+bool VirtualTexture::Initialize(const std::string& path, const VirtualTextureSettings& settings)
+{
+	m_Path = path;
+	m_Settings = settings;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file || !ReadVirtualTextureHeader(file, m_Header))
+	{
+		std::cerr << "Failed to open virtual texture: " << path << std::endl;
+		return false;
+	}
+
+	m_InternalFormat = GetGLInternalFormat(m_Header.Format);
+	const uint32_t pageSize = m_Header.PageSize;
+	const VirtualTextureLevel& pinnedLevel = m_Header.Levels[m_Header.LevelCount - 1];
+	const uint32_t pinnedTiles = pinnedLevel.TilesX * pinnedLevel.TilesY;
+
+	// As many pages as the GPU budget holds after the page table, in a grid
+	// no wider than the entries can address or the driver allows
+	const uint64_t pageTableBytes = sizeof(PageTableParameters) + static_cast<uint64_t>(m_Header.TileCount) * sizeof(uint32_t);
+	const uint64_t pageBudget = settings.GpuBudgetBytes > pageTableBytes ? (settings.GpuBudgetBytes - pageTableBytes) / m_Header.PageBytes : 0;
+
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	const uint32_t maxPagesPerAxis = std::min(MaxPagesPerAxis, static_cast<uint32_t>(maxTextureSize) / pageSize);
+
+	m_PagesX = std::min<uint32_t>(maxPagesPerAxis, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(pageBudget)))));
+	m_PagesY = m_PagesX > 0 ? std::min<uint32_t>(maxPagesPerAxis, static_cast<uint32_t>(pageBudget / m_PagesX)) : 0;
+	const uint32_t pageCount = m_PagesX * m_PagesY;
+	if (pageCount < pinnedTiles + MinStreamingPages)
+	{
+		std::cerr << "GPU budget of " << settings.GpuBudgetBytes << " bytes is too small for virtual texture " << path << std::endl;
+		return false;
+	}
+
+	// Bookkeeping grows with the source, so it comes out of the host budget
+	// before the staging slots
+	const uint64_t bookkeepingBytes = static_cast<uint64_t>(m_Header.TileCount) * (sizeof(Tile) + sizeof(uint32_t))
+		+ static_cast<uint64_t>(pageCount) * (sizeof(Page) + sizeof(uint32_t));
+	const uint64_t slotCount = settings.HostBudgetBytes > bookkeepingBytes ? (settings.HostBudgetBytes - bookkeepingBytes) / m_Header.PageBytes : 0;
+	if (slotCount == 0)
+	{
+		std::cerr << "Host budget of " << settings.HostBudgetBytes << " bytes is too small for virtual texture " << path << std::endl;
+		return false;
+	}
+
+	m_Tiles.assign(m_Header.TileCount, Tile());
+	m_Entries.assign(m_Header.TileCount, 0);
+	m_Pages.assign(pageCount, Page());
+	m_FreePages.reserve(pageCount);
+	for (uint32_t page = pageCount; page > 0; --page)
+	{
+		m_FreePages.push_back(page - 1);
+	}
+
+	// Frame 0 is what every tile's RequestFrame starts at
+	m_Frame = 1;
+
+	// Direct state access: nothing is bound, so the renderer's cached bindings stay valid
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_Cache);
+	glTextureStorage2D(m_Cache, 1, m_InternalFormat, static_cast<GLsizei>(m_PagesX * pageSize), static_cast<GLsizei>(m_PagesY * pageSize));
+	glTextureParameteri(m_Cache, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_Cache, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_Cache, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_Cache, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	PageTableParameters parameters = {};
+	parameters.Info[0] = m_Header.TileSize;
+	parameters.Info[1] = m_Header.Border;
+	parameters.Info[2] = pageSize;
+	parameters.Info[3] = m_Header.LevelCount;
+	parameters.Cache[0] = 1.0f / static_cast<float>(m_PagesX * pageSize);
+	parameters.Cache[1] = 1.0f / static_cast<float>(m_PagesY * pageSize);
+	for (uint32_t level = 0; level < m_Header.LevelCount; ++level)
+	{
+		const VirtualTextureLevel& info = m_Header.Levels[level];
+		parameters.Levels[level][0] = info.Width;
+		parameters.Levels[level][1] = info.Height;
+		parameters.Levels[level][2] = info.TilesX;
+		parameters.Levels[level][3] = info.FirstTile;
+	}
+
+	glCreateBuffers(1, &m_PageTable);
+	glNamedBufferStorage(m_PageTable, static_cast<GLsizeiptr>(pageTableBytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferSubData(m_PageTable, 0, sizeof(parameters), &parameters);
+
+	// Loaders read tiles straight into this, and uploads source from it
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr stagingBytes = static_cast<GLsizeiptr>(slotCount * m_Header.PageBytes);
+	glCreateBuffers(1, &m_StagingBuffer);
+	glNamedBufferStorage(m_StagingBuffer, stagingBytes, nullptr, flags);
+	m_StagingPtr = static_cast<unsigned char*>(glMapNamedBufferRange(m_StagingBuffer, 0, stagingBytes, flags));
+	if (!m_StagingPtr)
+	{
+		std::cerr << "Failed to map virtual texture staging buffer" << std::endl;
+		return false;
+	}
+
+	m_SlotFences.assign(slotCount, nullptr);
+	for (uint32_t slot = 0; slot < slotCount; ++slot)
+	{
+		m_FreeSlots.push_back(slot);
+	}
+
+	if (!LoadPinnedLevel())
+		return false;
+
+	RebuildPageTable();
+
+	for (unsigned i = 0; i < std::max(settings.LoaderThreads, 1u); ++i)
+	{
+		m_Loaders.emplace_back(&VirtualTexture::LoaderMain, this);
+	}
+
+	m_Stats.PageCapacity = pageCount;
+	m_Stats.ResidentPages = pinnedTiles;
+	m_Stats.GpuBytes = GetCookedLevelSize(m_Header.Format, m_PagesX * pageSize, m_PagesY * pageSize) + pageTableBytes;
+	m_Stats.HostBytes = static_cast<uint64_t>(stagingBytes) + bookkeepingBytes;
+
+	return true;
+}
+
+bool VirtualTexture::LoadPinnedLevel()
+{
+	std::ifstream file(m_Path, std::ios::binary);
+	std::vector<char> pixels(m_Header.PageBytes);
+
+	const VirtualTextureLevel& info = m_Header.Levels[m_Header.LevelCount - 1];
+	for (uint32_t tileIndex = info.FirstTile; tileIndex < m_Header.TileCount; ++tileIndex)
+	{
+		file.seekg(static_cast<std::streamoff>(m_Header.DataOffset + tileIndex * m_Header.PageBytes));
+		if (!file.read(pixels.data(), static_cast<std::streamsize>(pixels.size())))
+		{
+			std::cerr << "Virtual texture is truncated: " << m_Path << std::endl;
+			return false;
+		}
+
+		const uint32_t page = m_FreePages.back();
+		m_FreePages.pop_back();
+		m_Pages[page].Tile = tileIndex;
+		m_Pages[page].Pinned = true;
+		m_Tiles[tileIndex].Page = page;
+
+		UploadPage(page, pixels.data());
+	}
+
+	return true;
+}
+
+void VirtualTexture::LoaderMain()
+{
+	OGLP_PROFILE_THREAD("VirtualTextureLoader");
+
+	// One stream per thread, so reads need no lock
+	std::ifstream file(m_Path, std::ios::binary);
+
+	for (;;)
+	{
+		TileRead read;
+		{
+			std::unique_lock<std::mutex> lock(m_ReadMutex);
+			m_ReadCondition.wait(lock, [this] { return m_StopLoaders || !m_Reads.empty(); });
+
+			if (m_StopLoaders)
+				return;
+
+			read = m_Reads.front();
+			m_Reads.pop_front();
+		}
+
+		OGLP_PROFILE_SCOPE("ReadTile");
+
+		char* slot = reinterpret_cast<char*>(m_StagingPtr + read.Slot * m_Header.PageBytes);
+		file.seekg(static_cast<std::streamoff>(m_Header.DataOffset + read.Tile * m_Header.PageBytes));
+		read.Succeeded = static_cast<bool>(file.read(slot, static_cast<std::streamsize>(m_Header.PageBytes)));
+		if (!read.Succeeded)
+			file.clear();
+
+		std::lock_guard<std::mutex> lock(m_FinishedMutex);
+		m_Finished.push_back(read);
+	}
+}
+
+void VirtualTexture::BeginFrame()
+{
+	++m_Frame;
+	m_Requested.clear();
+
+	m_Stats.Requested = 0;
+	m_Stats.Uploaded = 0;
+	m_Stats.Evicted = 0;
+	m_Stats.Dropped = 0;
+}
+
+void VirtualTexture::RequestTile(uint32_t level, uint32_t tileX, uint32_t tileY)
+{
+	if (level >= m_Header.LevelCount)
+		return;
+
+	const VirtualTextureLevel& info = m_Header.Levels[level];
+	if (tileX >= info.TilesX || tileY >= info.TilesY)
+		return;
+
+	const uint32_t tileIndex = GetTileIndex(level, tileX, tileY);
+	Tile& tile = m_Tiles[tileIndex];
+	if (tile.RequestFrame == m_Frame)
+		return;
+
+	tile.RequestFrame = m_Frame;
+	m_Requested.push_back(tileIndex);
+
+	if (tile.Page != NoPage)
+		Touch(tile.Page);
+}
+
+void VirtualTexture::RequestQuad(const glm::mat4& modelViewProjection, const glm::vec2& viewportSize)
+{
+	OGLP_PROFILE_FUNCTION();
+
+	// The quad is split into a grid of cells, each requesting the level its
+	// centre would sample at. Cells are at most a few tiles of the largest
+	// level across, so the estimate is per region rather than per pixel.
+	const VirtualTextureLevel& top = m_Header.Levels[0];
+	const uint32_t cells = std::clamp(std::max(top.TilesX, top.TilesY), 1u, MaxFeedbackCells);
+	const float cellSize = 1.0f / static_cast<float>(cells);
+
+	m_FeedbackCorners.resize(static_cast<size_t>(cells + 1) * (cells + 1));
+	for (uint32_t y = 0; y <= cells; ++y)
+	{
+		for (uint32_t x = 0; x <= cells; ++x)
+		{
+			const glm::vec4 position(x * cellSize - 0.5f, y * cellSize - 0.5f, 0.0f, 1.0f);
+			m_FeedbackCorners[y * (cells + 1) + x] = modelViewProjection * position;
+		}
+	}
+
+	const float cellTexelsU = cellSize * static_cast<float>(top.Width);
+	const float cellTexelsV = cellSize * static_cast<float>(top.Height);
+	const uint32_t coarsest = m_Header.LevelCount - 1;
+
+	for (uint32_t y = 0; y < cells; ++y)
+	{
+		for (uint32_t x = 0; x < cells; ++x)
+		{
+			const glm::vec4 corners[4] = {
+				m_FeedbackCorners[y * (cells + 1) + x],
+				m_FeedbackCorners[y * (cells + 1) + x + 1],
+				m_FeedbackCorners[(y + 1) * (cells + 1) + x],
+				m_FeedbackCorners[(y + 1) * (cells + 1) + x + 1],
+			};
+
+			// Entirely outside one clip plane
+			bool outside = false;
+			for (int axis = 0; axis < 3 && !outside; ++axis)
+			{
+				bool allAbove = true;
+				bool allBelow = true;
+				for (const glm::vec4& corner : corners)
+				{
+					allAbove = allAbove && corner[axis] > corner.w;
+					allBelow = allBelow && corner[axis] < -corner.w;
+				}
+				outside = allAbove || allBelow;
+			}
+			if (outside)
+				continue;
+
+			uint32_t level = 0;
+			const bool crossesCamera = std::any_of(std::begin(corners), std::end(corners),
+				[](const glm::vec4& corner) { return corner.w <= 1e-5f; });
+			if (!crossesCamera)
+			{
+				glm::vec2 screen[4];
+				for (int i = 0; i < 4; ++i)
+				{
+					screen[i] = (glm::vec2(corners[i]) / corners[i].w * 0.5f + 0.5f) * viewportSize;
+				}
+
+				// Screen pixels per texel along u and v, then inverted to texels per pixel
+				const glm::vec2 alongU = ((screen[1] - screen[0]) + (screen[3] - screen[2])) * (0.5f / cellTexelsU);
+				const glm::vec2 alongV = ((screen[2] - screen[0]) + (screen[3] - screen[1])) * (0.5f / cellTexelsV);
+				const float determinant = alongU.x * alongV.y - alongV.x * alongU.y;
+				if (std::abs(determinant) < 1e-12f)
+				{
+					level = coarsest;
+				}
+				else
+				{
+					const glm::vec2 texelsPerPixelX = glm::vec2(alongV.y, -alongU.y) / determinant;
+					const glm::vec2 texelsPerPixelY = glm::vec2(-alongV.x, alongU.x) / determinant;
+					const float rho = std::max(glm::length(texelsPerPixelX), glm::length(texelsPerPixelY));
+					level = static_cast<uint32_t>(std::clamp(std::floor(std::log2(std::max(rho, 1.0f))), 0.0f, static_cast<float>(coarsest)));
+				}
+			}
+
+			// Tiles of that level under the cell, addressed as the shader does
+			const VirtualTextureLevel& info = m_Header.Levels[level];
+			auto tileOf = [this](float uv, uint32_t size)
+			{
+				const uint32_t texel = std::min(static_cast<uint32_t>(std::max(uv, 0.0f) * static_cast<float>(size)), size - 1);
+				return texel / m_Header.TileSize;
+			};
+
+			const uint32_t firstX = tileOf(x * cellSize, info.Width);
+			const uint32_t lastX = tileOf((x + 1) * cellSize, info.Width);
+			const uint32_t firstY = tileOf(y * cellSize, info.Height);
+			const uint32_t lastY = tileOf((y + 1) * cellSize, info.Height);
+			for (uint32_t tileY = firstY; tileY <= lastY; ++tileY)
+			{
+				for (uint32_t tileX = firstX; tileX <= lastX; ++tileX)
+				{
+					RequestTile(level, tileX, tileY);
+				}
+			}
+		}
+	}
+}
+
+void VirtualTexture::Update()
+{
+	OGLP_PROFILE_FUNCTION();
+
+	{
+		std::lock_guard<std::mutex> lock(m_FinishedMutex);
+		m_ReadyToUpload.insert(m_ReadyToUpload.end(), m_Finished.begin(), m_Finished.end());
+		m_Finished.clear();
+	}
+
+	// Upload finished reads into pages of the cache
+	const Clock::time_point now = Clock::now();
+	bool stagingBound = false;
+	uint32_t uploads = 0;
+	while (!m_ReadyToUpload.empty() && uploads < m_Settings.MaxUploadsPerFrame)
+	{
+		const TileRead read = m_ReadyToUpload.front();
+		m_ReadyToUpload.pop_front();
+
+		Tile& tile = m_Tiles[read.Tile];
+		tile.Loading = false;
+		--m_LoadingCount;
+
+		if (!read.Succeeded)
+		{
+			std::cerr << "Failed to read tile " << read.Tile << " of virtual texture " << m_Path << std::endl;
+			m_FreeSlots.push_back(read.Slot);
+			continue;
+		}
+
+		// The view has moved on; keep what is cached instead
+		if (m_Frame - tile.RequestFrame > StaleFrames)
+		{
+			m_FreeSlots.push_back(read.Slot);
+			continue;
+		}
+
+		const uint32_t page = AllocatePage();
+		if (page == NoPage)
+		{
+			++m_Stats.Dropped;
+			m_FreeSlots.push_back(read.Slot);
+			continue;
+		}
+
+		tile.Page = page;
+		m_Pages[page].Tile = read.Tile;
+		Touch(page);
+
+		if (!stagingBound)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+			stagingBound = true;
+		}
+		UploadPage(page, reinterpret_cast<const void*>(static_cast<uintptr_t>(read.Slot * m_Header.PageBytes)));
+
+		// The slot is free to read into again once the GPU has copied it
+		m_SlotFences[read.Slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_FreeSlots.push_back(read.Slot);
+
+		m_TotalLatencyMs += std::chrono::duration<double, std::milli>(now - read.Queued).count();
+		++m_Stats.TotalUploaded;
+		++m_Stats.Uploaded;
+		++uploads;
+		m_PageTableDirty = true;
+	}
+
+	if (stagingBound)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// Queue reads for missing tiles, coarsest first: tiles are stored largest
+	// level first, so that is the highest index first
+	m_Missing.clear();
+	for (uint32_t tileIndex : m_Requested)
+	{
+		const Tile& tile = m_Tiles[tileIndex];
+		if (tile.Page == NoPage && !tile.Loading)
+			m_Missing.push_back(tileIndex);
+	}
+	std::sort(m_Missing.begin(), m_Missing.end(), std::greater<uint32_t>());
+
+	size_t queued = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_ReadMutex);
+		for (uint32_t tileIndex : m_Missing)
+		{
+			if (m_FreeSlots.empty())
+				break;
+
+			// Slots are reused in upload order, so if this one is still busy so is the rest
+			const uint32_t slot = m_FreeSlots.front();
+			GLsync& fence = m_SlotFences[slot];
+			if (fence)
+			{
+				if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+					break;
+
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+			m_FreeSlots.pop_front();
+
+			m_Tiles[tileIndex].Loading = true;
+			++m_LoadingCount;
+
+			TileRead read;
+			read.Tile = tileIndex;
+			read.Slot = slot;
+			read.Queued = now;
+			m_Reads.push_back(read);
+			++queued;
+		}
+	}
+	if (queued > 0)
+		m_ReadCondition.notify_all();
+
+	if (m_PageTableDirty)
+		RebuildPageTable();
+
+	m_Stats.Requested = static_cast<uint32_t>(m_Requested.size());
+	m_Stats.Missing = static_cast<uint32_t>(std::count_if(m_Requested.begin(), m_Requested.end(),
+		[this](uint32_t tileIndex) { return m_Tiles[tileIndex].Page == NoPage; }));
+	m_Stats.Loading = m_LoadingCount;
+	m_Stats.ResidentPages = static_cast<uint32_t>(m_Pages.size() - m_FreePages.size());
+	m_Stats.MeanLatencyMs = m_Stats.TotalUploaded > 0 ? m_TotalLatencyMs / static_cast<double>(m_Stats.TotalUploaded) : 0.0;
+}
+
+void VirtualTexture::Bind(GLStateCache& state, GLuint textureUnit) const
+{
+	state.BindTexture(textureUnit, GL_TEXTURE_2D, m_Cache);
+	state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, PageTableBinding, m_PageTable);
+}
+
+bool VirtualTexture::GetResidentPage(uint32_t level, uint32_t tileX, uint32_t tileY, uint32_t& pageX, uint32_t& pageY) const
+{
+	if (level >= m_Header.LevelCount || tileX >= m_Header.Levels[level].TilesX || tileY >= m_Header.Levels[level].TilesY)
+		return false;
+
+	const uint32_t page = m_Tiles[GetTileIndex(level, tileX, tileY)].Page;
+	if (page == NoPage)
+		return false;
+
+	pageX = page % m_PagesX;
+	pageY = page / m_PagesX;
+	return true;
+}
+
+uint32_t VirtualTexture::AllocatePage()
+{
+	if (!m_FreePages.empty())
+	{
+		const uint32_t page = m_FreePages.back();
+		m_FreePages.pop_back();
+		return page;
+	}
+
+	// Everything requested this frame stays, even if that leaves no page
+	const uint32_t page = m_LeastRecent;
+	if (page == NoPage || m_Pages[page].LastUsed >= m_Frame)
+		return NoPage;
+
+	Unlink(page);
+	m_Tiles[m_Pages[page].Tile].Page = NoPage;
+	m_Pages[page].Tile = NoTile;
+
+	++m_Stats.Evicted;
+	++m_Stats.TotalEvicted;
+	return page;
+}
+
+void VirtualTexture::UploadPage(uint32_t page, const void* pixels)
+{
+	const GLint x = static_cast<GLint>(page % m_PagesX * m_Header.PageSize);
+	const GLint y = static_cast<GLint>(page / m_PagesX * m_Header.PageSize);
+	const GLsizei size = static_cast<GLsizei>(m_Header.PageSize);
+
+	if (IsBlockCompressed(m_Header.Format))
+	{
+		glCompressedTextureSubImage2D(m_Cache, 0, x, y, size, size, m_InternalFormat,
+			static_cast<GLsizei>(m_Header.PageBytes), pixels);
+	}
+	else
+	{
+		glTextureSubImage2D(m_Cache, 0, x, y, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+}
+
+void VirtualTexture::Touch(uint32_t page)
+{
+	Page& entry = m_Pages[page];
+	if (entry.Pinned)
+		return;
+
+	entry.LastUsed = m_Frame;
+	if (m_MostRecent == page)
+		return;
+
+	if (entry.Previous != NoPage || entry.Next != NoPage || m_LeastRecent == page)
+		Unlink(page);
+
+	entry.Previous = m_MostRecent;
+	entry.Next = NoPage;
+	if (m_MostRecent != NoPage)
+		m_Pages[m_MostRecent].Next = page;
+	else
+		m_LeastRecent = page;
+	m_MostRecent = page;
+}
+
+void VirtualTexture::Unlink(uint32_t page)
+{
+	Page& entry = m_Pages[page];
+
+	if (entry.Previous != NoPage)
+		m_Pages[entry.Previous].Next = entry.Next;
+	else
+		m_LeastRecent = entry.Next;
+
+	if (entry.Next != NoPage)
+		m_Pages[entry.Next].Previous = entry.Previous;
+	else
+		m_MostRecent = entry.Previous;
+
+	entry.Previous = NoPage;
+	entry.Next = NoPage;
+}
+
+void VirtualTexture::RebuildPageTable()
+{
+	OGLP_PROFILE_FUNCTION();
+
+	// Coarsest level first, so each missing tile can copy its parent's entry
+	for (uint32_t level = m_Header.LevelCount; level-- > 0;)
+	{
+		const VirtualTextureLevel& info = m_Header.Levels[level];
+		for (uint32_t tileY = 0; tileY < info.TilesY; ++tileY)
+		{
+			for (uint32_t tileX = 0; tileX < info.TilesX; ++tileX)
+			{
+				const uint32_t tileIndex = info.FirstTile + tileY * info.TilesX + tileX;
+				const uint32_t page = m_Tiles[tileIndex].Page;
+				if (page != NoPage)
+					m_Entries[tileIndex] = EncodeEntry(page % m_PagesX, page / m_PagesX, level);
+				else
+				{
+					// Odd sizes drop their last texel, so the last tile may have no parent of its own
+					const VirtualTextureLevel& parent = m_Header.Levels[level + 1];
+					m_Entries[tileIndex] = m_Entries[GetTileIndex(level + 1,
+						std::min(tileX / 2, parent.TilesX - 1), std::min(tileY / 2, parent.TilesY - 1))];
+				}
+			}
+		}
+	}
+
+	glNamedBufferSubData(m_PageTable, sizeof(PageTableParameters),
+		static_cast<GLsizeiptr>(m_Entries.size() * sizeof(uint32_t)), m_Entries.data());
+	m_PageTableDirty = false;
+}
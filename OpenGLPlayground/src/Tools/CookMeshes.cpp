@@ -0,0 +1,104 @@
+#include "MeshCooker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Offline mesh cooker. Converts OBJ files into .oglm containers with
+// cache-optimized 16-byte vertices and 16-bit indices where they fit. Usage:
+//   MeshCooker [--positions snorm16|half] [--no-optimize] [--no-overdraw] [--force] --out <dir> <mesh.obj|dir>...
+// Files whose source content and settings are unchanged are skipped.
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: MeshCooker [--positions snorm16|half] [--no-optimize] [--no-overdraw] [--force] --out <dir> <mesh.obj|dir>..." << std::endl;
+	}
+
+	bool IsMeshFile(const std::filesystem::path& path)
+	{
+		return path.extension().string() == ".obj";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	MeshCookSettings settings;
+	std::string outputDirectory;
+	std::vector<std::filesystem::path> sources;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--positions") == 0 && i + 1 < argc)
+		{
+			if (!ParseCookedPositionFormat(argv[++i], settings.PositionFormat))
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--no-optimize") == 0)
+			settings.OptimizeVertexCache = false;
+		else if (std::strcmp(argv[i], "--no-overdraw") == 0)
+			settings.OptimizeOverdraw = false;
+		else if (std::strcmp(argv[i], "--force") == 0)
+			settings.Force = true;
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			outputDirectory = argv[++i];
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+		else if (std::filesystem::is_directory(argv[i]))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(argv[i]))
+			{
+				if (entry.is_regular_file() && IsMeshFile(entry.path()))
+					sources.push_back(entry.path());
+			}
+		}
+		else
+			sources.emplace_back(argv[i]);
+	}
+
+	if (outputDirectory.empty() || sources.empty())
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	int cooked = 0;
+	int upToDate = 0;
+	int failed = 0;
+
+	for (const std::filesystem::path& source : sources)
+	{
+		const std::string outputPath = GetCookedMeshPath(outputDirectory, source.string());
+		MeshCookStats stats;
+		switch (CookMesh(source.string(), outputPath, settings, &stats))
+		{
+		case CookResult::Cooked:
+			std::printf("cooked     %s -> %s (ACMR %.3f -> %.3f, ATVR %.3f -> %.3f)\n", source.string().c_str(), outputPath.c_str(),
+				stats.Before.Acmr, stats.After.Acmr, stats.Before.Atvr, stats.After.Atvr);
+			if (stats.ClampedTexCoords > 0)
+				std::printf("           %u texture coordinates outside 0..1 were clamped\n", stats.ClampedTexCoords);
+			++cooked;
+			break;
+		case CookResult::UpToDate:
+			++upToDate;
+			break;
+		case CookResult::Failed:
+			++failed;
+			break;
+		}
+	}
+
+	std::cout << cooked << " cooked, " << upToDate << " up to date, " << failed << " failed ("
+		<< GetCookedPositionFormatName(settings.PositionFormat) << " positions)" << std::endl;
+
+	return failed > 0 ? -1 : 0;
+}
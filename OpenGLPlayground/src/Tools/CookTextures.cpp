@@ -0,0 +1,112 @@
+#include "TextureCooker.h"
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Offline texture cooker. Converts source images into .oglt containers with
+// a prebuilt mip chain, optionally block compressed. Usage:
+//   TextureCooker [--format rgba8|bc1|bc3|bc7] [--filter box|kaiser] [--no-mips] [--force] --out <dir> <image|dir>...
+// Files whose source content and settings are unchanged are skipped.
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: TextureCooker [--format rgba8|bc1|bc3|bc7] [--filter box|kaiser] [--no-mips] [--force] --out <dir> <image|dir>..." << std::endl;
+	}
+
+	bool IsImageFile(const std::filesystem::path& path)
+	{
+		const std::string extension = path.extension().string();
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg"
+			|| extension == ".tga" || extension == ".bmp";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	TextureCookSettings settings;
+	std::string outputDirectory;
+	std::vector<std::filesystem::path> sources;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			if (!ParseCookedFormat(argv[++i], settings.Format))
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			const std::string filter = argv[++i];
+			if (filter == "box")
+				settings.Filter = ImageOps::MipFilter::Box;
+			else if (filter == "kaiser")
+				settings.Filter = ImageOps::MipFilter::Kaiser;
+			else
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--no-mips") == 0)
+			settings.GenerateMips = false;
+		else if (std::strcmp(argv[i], "--force") == 0)
+			settings.Force = true;
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			outputDirectory = argv[++i];
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+		else if (std::filesystem::is_directory(argv[i]))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(argv[i]))
+			{
+				if (entry.is_regular_file() && IsImageFile(entry.path()))
+					sources.push_back(entry.path());
+			}
+		}
+		else
+			sources.emplace_back(argv[i]);
+	}
+
+	if (outputDirectory.empty() || sources.empty())
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	int cooked = 0;
+	int upToDate = 0;
+	int failed = 0;
+
+	for (const std::filesystem::path& source : sources)
+	{
+		const std::string outputPath = GetCookedTexturePath(outputDirectory, source.string());
+		switch (CookTexture(source.string(), outputPath, settings))
+		{
+		case CookResult::Cooked:
+			std::cout << "cooked     " << source.string() << " -> " << outputPath << std::endl;
+			++cooked;
+			break;
+		case CookResult::UpToDate:
+			++upToDate;
+			break;
+		case CookResult::Failed:
+			++failed;
+			break;
+		}
+	}
+
+	std::cout << cooked << " cooked, " << upToDate << " up to date, " << failed << " failed ("
+		<< GetCookedFormatName(settings.Format) << ")" << std::endl;
+
+	return failed > 0 ? -1 : 0;
+}
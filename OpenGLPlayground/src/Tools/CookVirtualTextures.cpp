@@ -0,0 +1,116 @@
+#include "Hash.h"
+#include "VirtualTextureCooker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Offline virtual texture cooker. Cuts source images and their mip chains into
+// bordered tiles and writes them as .oglv page files for VirtualTexture. Usage:
+//   VirtualTextureCooker [--format rgba8|bc1|bc3|bc7] [--page N] [--border N] [--test-pattern WxH] [--force] --out <dir> <image>...
+// --test-pattern cooks the synthetic source used by VirtualTextureBenchmark
+// as <dir>/test_pattern_WxH-<hash>.oglv, at any size, without a source file.
+// Files whose source content and settings are unchanged are skipped.
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: VirtualTextureCooker [--format rgba8|bc1|bc3|bc7] [--page N] [--border N] "
+			"[--test-pattern WxH] [--force] --out <dir> <image>..." << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	VirtualTextureCookSettings settings;
+	std::string outputDirectory;
+	std::vector<std::string> sources;
+	uint32_t patternWidth = 0;
+	uint32_t patternHeight = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			if (!ParseCookedFormat(argv[++i], settings.Format))
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--page") == 0 && i + 1 < argc)
+			settings.PageSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--border") == 0 && i + 1 < argc)
+			settings.Border = static_cast<uint32_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--test-pattern") == 0 && i + 1 < argc)
+		{
+			if (std::sscanf(argv[++i], "%ux%u", &patternWidth, &patternHeight) != 2 || patternWidth == 0 || patternHeight == 0)
+			{
+				PrintUsage();
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--force") == 0)
+			settings.Force = true;
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			outputDirectory = argv[++i];
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return std::strcmp(argv[i], "--help") == 0 ? 0 : -1;
+		}
+		else
+			sources.emplace_back(argv[i]);
+	}
+
+	if (outputDirectory.empty() || (sources.empty() && patternWidth == 0))
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	int cooked = 0;
+	int upToDate = 0;
+	int failed = 0;
+
+	auto count = [&](CookResult result, const std::string& source, const std::string& outputPath)
+	{
+		switch (result)
+		{
+		case CookResult::Cooked:
+			std::cout << "cooked     " << source << " -> " << outputPath << std::endl;
+			++cooked;
+			break;
+		case CookResult::UpToDate:
+			++upToDate;
+			break;
+		case CookResult::Failed:
+			++failed;
+			break;
+		}
+	};
+
+	if (patternWidth > 0)
+	{
+		const std::string name = "test_pattern_" + std::to_string(patternWidth) + "x" + std::to_string(patternHeight);
+		const std::string outputPath = GetVirtualTexturePath(outputDirectory, name);
+		const CookResult result = CookVirtualTexture(patternWidth, patternHeight,
+			[&](uint32_t y, uint8_t* row) { GetTestPatternRow(patternWidth, patternHeight, y, row); },
+			HashString("test pattern"), outputPath, settings);
+		count(result, name, outputPath);
+	}
+
+	for (const std::string& source : sources)
+	{
+		const std::string outputPath = GetVirtualTexturePath(outputDirectory, source);
+		count(CookVirtualTexture(source, outputPath, settings), source, outputPath);
+	}
+
+	std::cout << cooked << " cooked, " << upToDate << " up to date, " << failed << " failed ("
+		<< GetCookedFormatName(settings.Format) << ", " << settings.PageSize << " texel pages)" << std::endl;
+
+	return failed > 0 ? -1 : 0;
+}
@@ -1,8 +1,39 @@
 #include "Application.h"
 
-int main()
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Usage: OpenGLPlayground [--pacing vsync|uncapped|limited|low-latency] [--pacing-rate HZ]
+// The rate defaults to the monitor's refresh rate.
+int main(int argc, char** argv)
 {
+	PacingMode pacing = PacingMode::VSync;
+	double pacingRate = 0.0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--pacing") == 0 && hasValue && ParsePacingMode(argv[i + 1], pacing))
+		{
+			++i;
+		}
+		else if (std::strcmp(arg, "--pacing-rate") == 0 && hasValue)
+		{
+			pacingRate = std::atof(argv[++i]);
+		}
+		else
+		{
+			std::cout << "Usage: OpenGLPlayground [--pacing vsync|uncapped|limited|low-latency] [--pacing-rate HZ]"
+				<< std::endl;
+			return std::strcmp(arg, "--help") == 0 ? 0 : -1;
+		}
+	}
+
 	Application app(1280, 720, "OpenGL Playground");
+	app.SetFramePacing(pacing, pacingRate);
 	
 	if (!app.Initialize())
 	{
@@ -10,4 +41,4 @@ int main()
 	}
 
 	return app.Run();
-}
\ No newline at end of file
+}